@@ -0,0 +1,198 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* AllocationTracker counts heap allocations per frame phase. Defining MARKET_TRACK_ALLOCATIONS in the
+* project's preprocessor definitions, as the Debug configurations do, replaces the global operator
+* new/delete with counting versions, and every frame after the warm-up is checked to make sure update and
+* render did not touch the heap. Only the threads that run the frame are counted, the main thread and the
+* thread pool's workers, so background threads like the entity reorder worker don't fail a frame.
+*/
+#include "PCH.h"
+#include "AllocationTracker.h"
+#include <SDL.h>
+#include <cstdlib>
+#include <new>
+
+
+atomic<uint8_t> AllocationTracker::sCurrPhase(static_cast<uint8_t>(EAllocationPhase::OTHER));
+atomic<uint64_t> AllocationTracker::sAllocations[static_cast<size_t>(EAllocationPhase::COUNT)] = {};
+atomic<uint64_t> AllocationTracker::sBytes[static_cast<size_t>(EAllocationPhase::COUNT)] = {};
+uint32_t AllocationTracker::sFrameCount = 0;
+
+// Whether the calling thread's allocations are counted
+static thread_local bool sTrackedThread = false;
+
+
+/**
+* Whether the global allocation hooks were compiled in.
+* @return bool True if MARKET_TRACK_ALLOCATIONS is defined, otherwise false.
+*/
+bool AllocationTracker::isEnabled()
+{
+#ifdef MARKET_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/**
+* Count the calling thread's allocations from now on, called by the threads that run the frame.
+*/
+void AllocationTracker::trackThread()
+{
+    sTrackedThread = true;
+}
+
+
+/**
+* Start the warm-up over, for a new game whose caches and vectors haven't reached their steady size.
+*/
+void AllocationTracker::restartWarmup()
+{
+    sFrameCount = 0;
+}
+
+
+/**
+* Set the phase following allocations are charged to.
+* @param aPhase - The new frame phase.
+*/
+void AllocationTracker::setPhase(const EAllocationPhase& aPhase)
+{
+    sCurrPhase.store(static_cast<uint8_t>(aPhase), memory_order_relaxed);
+}
+
+
+/**
+* Record one allocation if the calling thread is tracked, called from the global operator new.
+* @param aSize - The number of bytes requested.
+*/
+void AllocationTracker::recordAllocation(size_t aSize)
+{
+    if (!sTrackedThread)
+    {
+        return;
+    }
+
+    uint8_t phase = sCurrPhase.load(memory_order_relaxed);
+    sAllocations[phase].fetch_add(1, memory_order_relaxed);
+    sBytes[phase].fetch_add(aSize, memory_order_relaxed);
+}
+
+
+/**
+* Get the number of allocations made in a phase of the current frame.
+* @param aPhase - The phase to query.
+* @return uint64_t The allocation count.
+*/
+uint64_t AllocationTracker::getAllocations(const EAllocationPhase& aPhase)
+{
+    return sAllocations[static_cast<size_t>(aPhase)].load(memory_order_relaxed);
+}
+
+
+/**
+* Get the number of bytes allocated in a phase of the current frame.
+* @param aPhase - The phase to query.
+* @return uint64_t The allocated bytes.
+*/
+uint64_t AllocationTracker::getBytes(const EAllocationPhase& aPhase)
+{
+    return sBytes[static_cast<size_t>(aPhase)].load(memory_order_relaxed);
+}
+
+
+/**
+* Finish the frame, once the warm-up is over any allocation made during update or render is reported
+* and fails an SDL_assert. The counters are reset for the next frame.
+* @param aAsserting - False to only report the allocations, for runs nobody is watching.
+* @return bool True if the frame met the zero-allocation guarantee, otherwise false.
+*/
+bool AllocationTracker::endFrame(const bool& aAsserting)
+{
+    bool steady = true;
+
+    if (isEnabled() && ++sFrameCount > ALLOCATION_WARMUP_FRAMES)
+    {
+        uint64_t updateAllocations = getAllocations(EAllocationPhase::UPDATE);
+        uint64_t renderAllocations = getAllocations(EAllocationPhase::RENDER);
+
+        if (updateAllocations || renderAllocations)
+        {
+            SDL_Log("Frame %u allocated in steady state: update %llu (%llu bytes), render %llu (%llu bytes)\n",
+                sFrameCount,
+                static_cast<unsigned long long>(updateAllocations),
+                static_cast<unsigned long long>(getBytes(EAllocationPhase::UPDATE)),
+                static_cast<unsigned long long>(renderAllocations),
+                static_cast<unsigned long long>(getBytes(EAllocationPhase::RENDER)));
+            steady = false;
+        }
+        if (aAsserting)
+        {
+            SDL_assert(steady && "A steady state frame performed a heap allocation");
+        }
+    }
+
+    for (size_t i = 0; i < static_cast<size_t>(EAllocationPhase::COUNT); ++i)
+    {
+        sAllocations[i].store(0, memory_order_relaxed);
+        sBytes[i].store(0, memory_order_relaxed);
+    }
+
+    return steady;
+}
+
+
+#ifdef MARKET_TRACK_ALLOCATIONS
+// Counting replacements for the global allocation functions, the remaining overloads forward to these
+void* operator new(size_t aSize)
+{
+    AllocationTracker::recordAllocation(aSize);
+    void* memory = malloc(aSize ? aSize : 1);
+    if (!memory)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](size_t aSize)
+{
+    return operator new(aSize);
+}
+
+void* operator new(size_t aSize, const nothrow_t&) noexcept
+{
+    AllocationTracker::recordAllocation(aSize);
+    return malloc(aSize ? aSize : 1);
+}
+
+void* operator new[](size_t aSize, const nothrow_t& aTag) noexcept
+{
+    return operator new(aSize, aTag);
+}
+
+void operator delete(void* aMemory) noexcept
+{
+    free(aMemory);
+}
+
+void operator delete[](void* aMemory) noexcept
+{
+    free(aMemory);
+}
+
+void operator delete(void* aMemory, size_t) noexcept
+{
+    free(aMemory);
+}
+
+void operator delete[](void* aMemory, size_t) noexcept
+{
+    free(aMemory);
+}
+#endif
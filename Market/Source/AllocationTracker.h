@@ -0,0 +1,93 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* AllocationTracker counts heap allocations per frame phase. Defining MARKET_TRACK_ALLOCATIONS in the
+* project's preprocessor definitions, as the Debug configurations do, replaces the global operator
+* new/delete with counting versions, and every frame after the warm-up is checked to make sure update and
+* render did not touch the heap. Only the threads that run the frame are counted, the main thread and the
+* thread pool's workers, so background threads like the entity reorder worker don't fail a frame.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// The frame phases allocations are attributed to
+enum class EAllocationPhase
+{
+    OTHER,
+    UPDATE,
+    RENDER,
+    COUNT
+};
+
+
+// Number of frames that are allowed to allocate while caches and vectors reach their steady size
+constexpr uint32_t ALLOCATION_WARMUP_FRAMES = 120;
+
+
+class AllocationTracker
+{
+private:
+    // The phase the main thread is currently in, allocations on the tracked threads are charged to it
+    static atomic<uint8_t> sCurrPhase;
+
+    // Allocations and bytes allocated in each phase of the current frame
+    static atomic<uint64_t> sAllocations[static_cast<size_t>(EAllocationPhase::COUNT)];
+    static atomic<uint64_t> sBytes[static_cast<size_t>(EAllocationPhase::COUNT)];
+
+    // Number of frames ended since the tracker started
+    static uint32_t sFrameCount;
+
+public:
+    /**
+    * Whether the global allocation hooks were compiled in.
+    * @return bool True if MARKET_TRACK_ALLOCATIONS is defined, otherwise false.
+    */
+    static bool isEnabled();
+
+    /**
+    * Count the calling thread's allocations from now on, called by the threads that run the frame.
+    */
+    static void trackThread();
+
+    /**
+    * Start the warm-up over, for a new game whose caches and vectors haven't reached their steady size.
+    */
+    static void restartWarmup();
+
+    /**
+    * Set the phase following allocations are charged to.
+    * @param aPhase - The new frame phase.
+    */
+    static void setPhase(const EAllocationPhase& aPhase);
+
+    /**
+    * Record one allocation if the calling thread is tracked, called from the global operator new.
+    * @param aSize - The number of bytes requested.
+    */
+    static void recordAllocation(size_t aSize);
+
+    /**
+    * Get the number of allocations made in a phase of the current frame.
+    * @param aPhase - The phase to query.
+    * @return uint64_t The allocation count.
+    */
+    static uint64_t getAllocations(const EAllocationPhase& aPhase);
+
+    /**
+    * Get the number of bytes allocated in a phase of the current frame.
+    * @param aPhase - The phase to query.
+    * @return uint64_t The allocated bytes.
+    */
+    static uint64_t getBytes(const EAllocationPhase& aPhase);
+
+    /**
+    * Finish the frame, once the warm-up is over any allocation made during update or render is reported
+    * and fails an SDL_assert. The counters are reset for the next frame.
+    * @param aAsserting - False to only report the allocations, for runs nobody is watching.
+    * @return bool True if the frame met the zero-allocation guarantee, otherwise false.
+    */
+    static bool endFrame(const bool& aAsserting = true);
+};
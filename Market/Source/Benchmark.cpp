@@ -0,0 +1,611 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Benchmark drives the whole update and render pipeline for a fixed number of ticks from a world snapshot,
+* at a fixed tick time and rendering to an offscreen target, so two runs see identical input and their
+* per phase timings can be compared. Rendering is split into recording the draws and submitting them to
+* the renderer, and the draw rate is reported next to them. Every NPC's neighbors are looked up in the
+* world's spatial index each tick too, so the grid and quadtree backends can be compared under each layout.
+* The medians and 99th percentiles are written out as JSON, for one run or for a suite of every layout
+* under each backend in one file. The spatial queries can also be timed on their own, in a world filled
+* with far more entities than the market holds.
+*/
+#include "PCH.h"
+#include "Benchmark.h"
+#include "Game.h"
+#include "SDLManager.h"
+#include "Texture.h"
+#include "FrameStats.h"
+#include "PerfCounters.h"
+#include "ThreadPool.h"
+#include "AllocationTracker.h"
+
+
+static const char* const FRAME_PHASE_NAMES[] = { "frame", "update", "order", "trade", "render" };
+
+// The kinds of query the query benchmark times, and their names in the results
+enum class EQueryKind
+{
+    RADIUS,
+    RECT,
+    NEAREST,
+    COUNT
+};
+static const char* const QUERY_KIND_NAMES[] = { "radius", "rect", "nearest" };
+
+// Most entities one radius or rectangle query in the query benchmark finds
+constexpr uint32_t BENCHMARK_QUERY_CAPACITY = 256;
+
+
+// What every query benchmark task shares, the world queried, the kind of query, and the entities found
+struct QueryBenchmarkContext
+{
+    const World* mWorld;
+    EQueryKind mKind;
+    atomic<uint64_t> mFound;
+};
+
+
+/**
+* Get a percentile of sorted samples.
+*/
+static float percentile(const vector<float>& aSorted, const float& aPercentile)
+{
+    if (aSorted.empty())
+    {
+        return 0;
+    }
+    size_t rank = min(static_cast<size_t>(aPercentile * aSorted.size()), aSorted.size() - 1);
+    return aSorted[rank];
+}
+
+
+/**
+* Write the median, 99th percentile, mean and max of samples as a JSON object.
+*/
+static void writeJSONSummary(ofstream& aOut, vector<float>& aSamples)
+{
+    sort(aSamples.begin(), aSamples.end());
+
+    double total = 0;
+    for (float sample : aSamples)
+    {
+        total += sample;
+    }
+    double mean = (aSamples.empty()) ? (0.0) : (total / aSamples.size());
+
+    aOut << "{ \"medianMs\": " << percentile(aSamples, .5f) << ", \"p99Ms\": " << percentile(aSamples, .99f)
+        << ", \"meanMs\": " << mean << ", \"maxMs\": " << ((aSamples.empty()) ? (0.f) : (aSamples.back())) << " }";
+}
+
+
+/**
+* Write a string as a JSON string literal.
+*/
+static void writeJSONString(ofstream& aOut, const char* aString)
+{
+    aOut << '"';
+    for (const char* c = aString; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            aOut << '\\';
+        }
+        aOut << *c;
+    }
+    aOut << '"';
+}
+
+
+/**
+* Map a query's index to a value in [0, 1), the same index always gives the same value.
+*/
+static float hashToUnit(uint32_t aValue)
+{
+    aValue ^= aValue >> 16;
+    aValue *= 0x7FEB352Du;
+    aValue ^= aValue >> 15;
+    aValue *= 0x846CA68Bu;
+    aValue ^= aValue >> 16;
+    return static_cast<float>(aValue >> 8) / static_cast<float>(1u << 24);
+}
+
+
+/**
+* ThreadPool task that runs the query benchmark's query at aIndex, centered on a point hashed from the index
+* so every backend answers the same queries. The rectangle queries look for NPCs, and the nearest queries
+* for the rugs trading one of the goods, so the filters are timed too.
+*/
+static void queryTask(void* aContext, uint32_t aIndex)
+{
+    QueryBenchmarkContext* context = static_cast<QueryBenchmarkContext*>(aContext);
+    const World* world = context->mWorld;
+    Vector center = { hashToUnit(aIndex * 2) * world->getWidth(), hashToUnit((aIndex * 2) + 1) * world->getHeight(), 0 };
+    Vector reach = { BENCHMARK_NEIGHBOR_RADIUS, BENCHMARK_NEIGHBOR_RADIUS, 0 };
+
+    Entity* results[BENCHMARK_QUERY_CAPACITY];
+    uint32_t found = 0;
+    switch (context->mKind)
+    {
+    case EQueryKind::RADIUS:
+        found = world->queryRadius(center, BENCHMARK_NEIGHBOR_RADIUS, results, BENCHMARK_QUERY_CAPACITY);
+        break;
+    case EQueryKind::RECT:
+        found = world->queryRect(center - reach, center + reach, results, BENCHMARK_QUERY_CAPACITY, QueryFilter().withType(EEntityType::NPC));
+        break;
+    default:
+        found = world->queryNearest(center, BENCHMARK_NEAREST_COUNT, results, QueryFilter().withType(EEntityType::RUG).withTradeState(static_cast<ETradeState>(aIndex % 3)));
+        break;
+    }
+    context->mFound.fetch_add(found, memory_order_relaxed);
+}
+
+
+/**
+* Measure a game started from a scenario, and write its results as a JSON object.
+* @param aGame         - The game, already started from the scenario.
+* @param aSDL          - The SDL subsystem the game renders with.
+* @param aScenarioPath - The world snapshot or layout the game was started from, recorded in the results.
+* @param aTicks        - The number of ticks to measure.
+* @param aResults      - The results file, the object is written at its current position.
+* @param aIndent       - The indent of the object's closing brace, and of its members one level deeper.
+* @param aAllocatingTicks - Set to the number of steady state ticks that allocated, 0 when the allocation
+*                           tracker isn't compiled in.
+* @return bool True if every tick ran and the results were written, otherwise false.
+*/
+static bool measure(Game& aGame, SDLManager& aSDL, const char* aScenarioPath, const uint32_t& aTicks, ofstream& aResults, const char* aIndent,
+    uint32_t& aAllocatingTicks)
+{
+    if (!aGame.isReproducible())
+    {
+        SDL_Log("Benchmark: the scenario %s could not be restored, or was generated without a set seed", aScenarioPath);
+        return false;
+    }
+
+    // Render offscreen, so the display's refresh rate and the window's visibility don't matter
+    SDL_Renderer* renderer = aSDL.getRenderer();
+    int width = 0;
+    int height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    SDL_Texture* target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+    if (!target || SDL_SetRenderTarget(renderer, target) != 0)
+    {
+        SDL_Log("Benchmark: failed to create the offscreen target! SDL Error: %s", SDL_GetError());
+        SDL_DestroyTexture(target);
+        return false;
+    }
+
+    vector<float> samples[static_cast<size_t>(EFramePhase::COUNT)];
+    for (vector<float>& phaseSamples : samples)
+    {
+        phaseSamples.reserve(aTicks);
+    }
+
+    // Time spent recording the draws, and submitting them to the renderer, and the draws made
+    vector<float> recordSamples;
+    vector<float> submitSamples;
+    recordSamples.reserve(aTicks);
+    submitSamples.reserve(aTicks);
+    uint64_t draws = 0;
+    double renderMilliseconds = 0;
+
+    // Time spent finding every NPC's neighbors, and the neighbors found
+    vector<float> neighborSamples;
+    neighborSamples.reserve(aTicks);
+    uint64_t neighbors = 0;
+
+    // The subspaces' mean occupancy over the measured ticks, and the most entities in one subspace
+    double occupancyTotal = 0;
+    uint32_t maxOccupancy = 0;
+
+    // Ticks past the allocation tracker's warm-up that allocated, counted when the tracker is compiled in
+    aAllocatingTicks = 0;
+    AllocationTracker::restartWarmup();
+
+    bool quit = false;
+    SDL_Event e;
+    for (uint32_t tick = 0; tick < BENCHMARK_WARMUP_TICKS + aTicks && !quit; ++tick)
+    {
+        uint64_t start = FrameStats::now();
+        AllocationTracker::setPhase(EAllocationPhase::UPDATE);
+        {
+            FrameStatsScope updateScope(EFramePhase::UPDATE);
+            aGame.update(BENCHMARK_TICK_TIME);
+        }
+        uint64_t drawsBefore = Texture::getDrawCount();
+        uint64_t recordStart;
+        uint64_t submitStart;
+        uint64_t submitEnd;
+        AllocationTracker::setPhase(EAllocationPhase::RENDER);
+        {
+            FrameStatsScope renderScope(EFramePhase::RENDER);
+            recordStart = FrameStats::now();
+            SDL_SetRenderDrawColor(renderer, 0xD3, 0xD3, 0xD3, 0xFF);
+            SDL_RenderClear(renderer);
+            aGame.render();
+
+            // Wait for the batched draws to be submitted, so they count towards the tick that made them
+            submitStart = FrameStats::now();
+            SDL_RenderFlush(renderer);
+            submitEnd = FrameStats::now();
+        }
+        FrameStats::endFrame(FrameStats::now() - start);
+        AllocationTracker::setPhase(EAllocationPhase::OTHER);
+        if (!AllocationTracker::endFrame(false))
+        {
+            ++aAllocatingTicks;
+        }
+
+        // Outside of the frame, so the frame's phases match a run without the lookups
+        uint64_t neighborStart = FrameStats::now();
+        uint64_t found = aGame.queryAllNeighbors(BENCHMARK_NEIGHBOR_RADIUS);
+        uint64_t neighborEnd = FrameStats::now();
+
+        // The hardware counters only cover the measured ticks
+        if (tick + 1 == BENCHMARK_WARMUP_TICKS)
+        {
+            PerfCounters::start();
+        }
+
+        if (tick >= BENCHMARK_WARMUP_TICKS)
+        {
+            for (size_t phase = 0; phase < static_cast<size_t>(EFramePhase::COUNT); ++phase)
+            {
+                samples[phase].push_back(FrameStats::getLastSample(static_cast<EFramePhase>(phase)));
+            }
+
+            float recordMilliseconds = static_cast<float>(FrameStats::toMilliseconds(submitStart - recordStart));
+            float submitMilliseconds = static_cast<float>(FrameStats::toMilliseconds(submitEnd - submitStart));
+            recordSamples.push_back(recordMilliseconds);
+            submitSamples.push_back(submitMilliseconds);
+            renderMilliseconds += static_cast<double>(recordMilliseconds) + submitMilliseconds;
+            draws += Texture::getDrawCount() - drawsBefore;
+            neighborSamples.push_back(static_cast<float>(FrameStats::toMilliseconds(neighborEnd - neighborStart)));
+            neighbors += found;
+            occupancyTotal += FrameStats::getAverageOccupancy();
+            maxOccupancy = max(maxOccupancy, FrameStats::getMaxOccupancy());
+        }
+
+        // Keep the window responsive, and let it be closed to abort the run
+        while (SDL_PollEvent(&e) != 0)
+        {
+            quit = quit || (e.type == SDL_QUIT);
+        }
+    }
+
+    SDL_SetRenderTarget(renderer, nullptr);
+    SDL_DestroyTexture(target);
+
+    // Read the cache misses before stop() logs the full counter table
+    uint64_t cacheMisses[static_cast<size_t>(EPerfPhase::COUNT)][2] = {};
+    bool countersAvailable = PerfCounters::isAvailable();
+    for (size_t phase = 0; phase < static_cast<size_t>(EPerfPhase::COUNT); ++phase)
+    {
+        cacheMisses[phase][0] = PerfCounters::getTotal(static_cast<EPerfPhase>(phase), EPerfCounter::L1D_MISSES);
+        cacheMisses[phase][1] = PerfCounters::getTotal(static_cast<EPerfPhase>(phase), EPerfCounter::LLC_MISSES);
+    }
+    PerfCounters::stop();
+
+    if (quit)
+    {
+        SDL_Log("Benchmark: aborted");
+        return false;
+    }
+
+    aResults << fixed << setprecision(4);
+    aResults << "{\n";
+    aResults << aIndent << "  \"scenario\": ";
+    writeJSONString(aResults, aScenarioPath);
+    aResults << ",\n";
+    aResults << aIndent << "  \"ticks\": " << aTicks << ",\n";
+    aResults << aIndent << "  \"warmupTicks\": " << BENCHMARK_WARMUP_TICKS << ",\n";
+    aResults << aIndent << "  \"tickTime\": " << BENCHMARK_TICK_TIME << ",\n";
+    aResults << aIndent << "  \"headless\": " << ((aSDL.isHeadless()) ? ("true") : ("false")) << ",\n";
+    aResults << aIndent << "  \"renderBatching\": " << ((aSDL.isRenderBatching()) ? ("true") : ("false")) << ",\n";
+    aResults << aIndent << "  \"compositor\": " << ((aGame.isCompositing()) ? ("true") : ("false")) << ",\n";
+    aResults << aIndent << "  \"layout\": \"" << World::getLayoutName(aGame.getWorldLayout()) << "\",\n";
+    aResults << aIndent << "  \"backend\": \"" << World::getBackendName(aGame.getWorldBackend()) << "\",\n";
+    aResults << aIndent << "  \"broadphase\": \"" << Broadphase::getName(aGame.getBroadphase()) << "\",\n";
+    aResults << aIndent << "  \"seeking\": " << ((aGame.isSeekingRugs()) ? ("true") : ("false")) << ",\n";
+    aResults << aIndent << "  \"obstacles\": " << aGame.getObstacleCount() << ",\n";
+    aResults << aIndent << "  \"flowFields\": " << ((aGame.isFlowNavigating()) ? ("true") : ("false")) << ",\n";
+    aResults << aIndent << "  \"reorder\": " << ((aGame.isReorderingEntities()) ? ("true") : ("false")) << ",\n";
+
+    // The steady state ticks that allocated, null where the allocation tracker isn't compiled in
+    aResults << aIndent << "  \"allocatingTicks\": ";
+    if (AllocationTracker::isEnabled())
+    {
+        aResults << aAllocatingTicks << ",\n";
+    }
+    else
+    {
+        aResults << "null,\n";
+    }
+    aResults << aIndent << "  \"phases\": {\n";
+    for (size_t phase = 0; phase < static_cast<size_t>(EFramePhase::COUNT); ++phase)
+    {
+        aResults << aIndent << "    \"" << FRAME_PHASE_NAMES[phase] << "\": ";
+        writeJSONSummary(aResults, samples[phase]);
+        aResults << ",\n";
+    }
+    aResults << aIndent << "    \"render-record\": ";
+    writeJSONSummary(aResults, recordSamples);
+    aResults << ",\n";
+    aResults << aIndent << "    \"render-submit\": ";
+    writeJSONSummary(aResults, submitSamples);
+    aResults << ",\n";
+    aResults << aIndent << "    \"neighbors\": ";
+    writeJSONSummary(aResults, neighborSamples);
+    aResults << "\n";
+    aResults << aIndent << "  },\n";
+    aResults << aIndent << "  \"drawsPerTick\": " << ((aTicks > 0) ? (static_cast<double>(draws) / aTicks) : (0.0)) << ",\n";
+    aResults << aIndent << "  \"drawsPerSecond\": " << ((renderMilliseconds > 0) ? ((draws * 1000.0) / renderMilliseconds) : (0.0)) << ",\n";
+    aResults << aIndent << "  \"neighborsPerNPC\": " << ((aTicks > 0 && ENTITY_COUNT > 0) ? (static_cast<double>(neighbors) / (static_cast<double>(aTicks) * ENTITY_COUNT)) : (0.0)) << ",\n";
+    aResults << aIndent << "  \"grid\": { \"tileLength\": " << FrameStats::getTileLength() << ", \"averageOccupancy\": "
+        << ((aTicks > 0) ? (occupancyTotal / aTicks) : (0.0)) << ", \"maxOccupancy\": " << maxOccupancy << " },\n";
+
+    // The cache misses of each simulation phase per measured tick, null where the counters are unavailable
+    aResults << aIndent << "  \"cacheMissesPerTick\": ";
+    if (!countersAvailable || aTicks == 0)
+    {
+        aResults << "null\n";
+    }
+    else
+    {
+        aResults << "{\n";
+        for (size_t phase = 0; phase < static_cast<size_t>(EPerfPhase::COUNT); ++phase)
+        {
+            aResults << aIndent << "    \"" << PerfCounters::getPhaseName(static_cast<EPerfPhase>(phase)) << "\": { \"l1d\": "
+                << (static_cast<double>(cacheMisses[phase][0]) / aTicks) << ", \"llc\": "
+                << (static_cast<double>(cacheMisses[phase][1]) / aTicks) << " }";
+            aResults << ((phase + 1 < static_cast<size_t>(EPerfPhase::COUNT)) ? (",\n") : ("\n"));
+        }
+        aResults << aIndent << "  }\n";
+    }
+    aResults << aIndent << "}";
+
+    SDL_Log("Benchmark: %s, %u ticks, frame median %.3f ms p99 %.3f ms, %.0f draws/s", aScenarioPath, aTicks,
+        percentile(samples[static_cast<size_t>(EFramePhase::FRAME)], .5f),
+        percentile(samples[static_cast<size_t>(EFramePhase::FRAME)], .99f),
+        (renderMilliseconds > 0) ? ((draws * 1000.0) / renderMilliseconds) : (0.0));
+    if (aAllocatingTicks > 0)
+    {
+        SDL_Log("Benchmark: %s, %u steady state ticks allocated", aScenarioPath, aAllocatingTicks);
+    }
+    return static_cast<bool>(aResults);
+}
+
+
+/**
+* Run the benchmark on a game restored from the scenario's world snapshot, or generated from a set seed,
+* and write the results.
+* @param aGame         - The game, already started from the scenario.
+* @param aSDL          - The SDL subsystem the game renders with.
+* @param aScenarioPath - The world snapshot or layout the game was started from, recorded in the results.
+* @param aTicks        - The number of ticks to measure.
+* @param aResultsPath  - Where to write the results.
+* @return bool True if every tick ran without a steady state tick allocating and the results were written,
+* otherwise false.
+*/
+bool Benchmark::run(Game& aGame, SDLManager& aSDL, const char* aScenarioPath, const uint32_t& aTicks, const char* aResultsPath)
+{
+    ofstream results(aResultsPath, ios::trunc);
+    if (!results)
+    {
+        SDL_Log("Benchmark: failed to create %s", aResultsPath);
+        return false;
+    }
+
+    uint32_t allocatingTicks = 0;
+    bool success = measure(aGame, aSDL, aScenarioPath, aTicks, results, "", allocatingTicks);
+    results << "\n";
+    SDL_Log("Benchmark: results written to %s", aResultsPath);
+    return success && allocatingTicks == 0 && static_cast<bool>(results);
+}
+
+
+/**
+* Benchmark a market generated from the set seed in every layout under each backend, one game after
+* another, and write every run's results to one file.
+* @param aSDL         - The SDL subsystem the games render with.
+* @param aTicks       - The number of ticks to measure each run.
+* @param aResultsPath - Where to write the results.
+* @param aStartGame   - Configures and starts a game in a layout and backend, with every other setting from
+*                       the command line.
+* @param aMismatches  - Set to the broadphase and flow field mismatches summed over the runs.
+* @return bool True if every run measured every tick without a steady state tick allocating and the
+* results were written, otherwise false.
+*/
+bool Benchmark::runSuite(SDLManager& aSDL, const uint32_t& aTicks, const char* aResultsPath,
+    const function<void(Game&, const EWorldLayout&, const EWorldBackend&)>& aStartGame, uint32_t& aMismatches)
+{
+    ofstream results(aResultsPath, ios::trunc);
+    if (!results)
+    {
+        SDL_Log("Benchmark: failed to create %s", aResultsPath);
+        return false;
+    }
+
+    bool success = true;
+    aMismatches = 0;
+    results << "{\n";
+    results << "  \"suite\": \"layouts\",\n";
+    results << "  \"runs\": [\n";
+    for (uint32_t layout = 0; layout <= static_cast<uint32_t>(EWorldLayout::RING); ++layout)
+    {
+        for (uint32_t backend = 0; backend <= static_cast<uint32_t>(EWorldBackend::QUADTREE); ++backend)
+        {
+            // Every run starts from a freshly generated market, so the runs don't share any state
+            Game game;
+            aStartGame(game, static_cast<EWorldLayout>(layout), static_cast<EWorldBackend>(backend));
+
+            // A run that couldn't be measured is recorded as null, so the file stays valid JSON, a run whose
+            // steady state ticks allocated is recorded but still fails the suite
+            uint32_t allocatingTicks = 0;
+            results << "    ";
+            if (!measure(game, aSDL, World::getLayoutName(static_cast<EWorldLayout>(layout)), aTicks, results, "    ", allocatingTicks))
+            {
+                results << "null";
+                success = false;
+            }
+            success = success && allocatingTicks == 0;
+            bool last = (layout == static_cast<uint32_t>(EWorldLayout::RING) && backend == static_cast<uint32_t>(EWorldBackend::QUADTREE));
+            results << ((last) ? ("\n") : (",\n"));
+
+            aMismatches += game.getBroadphaseMismatches() + game.getFlowFieldMismatches();
+            game.close();
+        }
+    }
+    results << "  ]\n";
+    results << "}\n";
+
+    SDL_Log("Benchmark: suite results written to %s", aResultsPath);
+    return success && static_cast<bool>(results);
+}
+
+
+/**
+* Fill a world of its own with half rugs and half NPCs, as densely as the market is, time the radius,
+* rectangle, and nearest queries across the thread pool under each backend, and write the results. Must
+* be called once SDL is initialized, the market isn't needed.
+* @param aPopulation  - The number of entities in the world.
+* @param aResultsPath - Where to write the results.
+* @return bool True if every query ran, the backends found the same number of entities for each kind, and
+* the results were written, otherwise false.
+*/
+bool Benchmark::runQueries(const uint32_t& aPopulation, const char* aResultsPath)
+{
+    // The world is square, and holds as many entities per pixel as the market in the window does
+    double areaPerEntity = (static_cast<double>(max(SDLManager::mWindowWidth, 1)) * max(SDLManager::mWindowHeight, 1)) / (ENTITY_COUNT * 2.0);
+    uint32_t side = static_cast<uint32_t>(sqrt(aPopulation * areaPerEntity)) + 1;
+
+    World world;
+    if (!world.init(side, side, aPopulation))
+    {
+        SDL_Log("Benchmark: failed to make a %u by %u world for the queries", side, side);
+        return false;
+    }
+
+    // The entities are never drawn, so they share a texture that's never loaded
+    srand(BENCHMARK_SEED);
+    Texture texture;
+    SDL_Rect frames[max(RUG_FRAME_COLS * RUG_FRAME_ROWS, NPC_FRAME_COLS * NPC_FRAME_ROWS)] = {};
+    uint32_t rugCount = aPopulation / 2;
+    uint32_t npcCount = aPopulation - rugCount;
+
+    vector<Rug*> rugs;
+    rugs.reserve(rugCount);
+    for (uint32_t i = 0; i < rugCount; ++i)
+    {
+        rugs.push_back(new Rug());
+        rugs[i]->init(&texture, frames, world);
+    }
+
+    NPC* npcPool = new NPC[npcCount];
+    vector<NPC*> npcs;
+    npcs.reserve(npcCount);
+    for (uint32_t i = 0; i < npcCount; ++i)
+    {
+        npcs.push_back(&npcPool[i]);
+        npcs[i]->init(&texture, frames, &world);
+    }
+
+    uint32_t hardwareThreads = thread::hardware_concurrency();
+    ThreadPool threadPool;
+    threadPool.init((hardwareThreads > 1) ? (hardwareThreads - 1) : (1));
+
+    // Each backend's time to build its index, the grid is filled as the entities are placed so only the
+    // quadtree's is measured, and each kind of query's time and entities found
+    const uint32_t backendCount = static_cast<uint32_t>(EWorldBackend::QUADTREE) + 1;
+    const uint32_t kindCount = static_cast<uint32_t>(EQueryKind::COUNT);
+    double buildMilliseconds[backendCount] = {};
+    double queryMilliseconds[backendCount][kindCount] = {};
+    uint64_t queryFound[backendCount][kindCount] = {};
+
+    for (uint32_t backend = 0; backend < backendCount; ++backend)
+    {
+        world.setBackend(static_cast<EWorldBackend>(backend));
+        uint64_t buildStart = FrameStats::now();
+        world.updateSpatialIndex(rugs, npcs);
+        buildMilliseconds[backend] = FrameStats::toMilliseconds(FrameStats::now() - buildStart);
+
+        for (uint32_t kind = 0; kind < kindCount; ++kind)
+        {
+            QueryBenchmarkContext context;
+            context.mWorld = &world;
+            context.mKind = static_cast<EQueryKind>(kind);
+            context.mFound = 0;
+
+            uint64_t queryStart = FrameStats::now();
+            threadPool.run(BENCHMARK_QUERY_COUNT, &queryTask, &context);
+            queryMilliseconds[backend][kind] = FrameStats::toMilliseconds(FrameStats::now() - queryStart);
+            queryFound[backend][kind] = context.mFound;
+        }
+    }
+    uint32_t workerCount = threadPool.getWorkerCount();
+    threadPool.close();
+
+    // Every backend answers the same queries, so they should find the same number of entities, the kinds
+    // that don't fail the benchmark
+    uint32_t mismatches = 0;
+    for (uint32_t kind = 0; kind < kindCount; ++kind)
+    {
+        if (queryFound[static_cast<size_t>(EWorldBackend::GRID)][kind] != queryFound[static_cast<size_t>(EWorldBackend::QUADTREE)][kind])
+        {
+            ++mismatches;
+            SDL_Log("Benchmark: the %s queries found %llu entities in the grid and %llu in the quadtree", QUERY_KIND_NAMES[kind],
+                static_cast<unsigned long long>(queryFound[static_cast<size_t>(EWorldBackend::GRID)][kind]),
+                static_cast<unsigned long long>(queryFound[static_cast<size_t>(EWorldBackend::QUADTREE)][kind]));
+        }
+    }
+
+    for (Rug* rug : rugs)
+    {
+        delete rug;
+    }
+    rugs.clear();
+    npcs.clear();
+    delete[] npcPool;
+
+    ofstream results(aResultsPath, ios::trunc);
+    if (!results)
+    {
+        SDL_Log("Benchmark: failed to create %s", aResultsPath);
+        return false;
+    }
+
+    results << fixed << setprecision(4);
+    results << "{\n";
+    results << "  \"population\": " << aPopulation << ",\n";
+    results << "  \"worldSize\": " << side << ",\n";
+    results << "  \"queries\": " << BENCHMARK_QUERY_COUNT << ",\n";
+    results << "  \"threads\": " << (workerCount + 1) << ",\n";
+    results << "  \"radius\": " << BENCHMARK_NEIGHBOR_RADIUS << ",\n";
+    results << "  \"nearestCount\": " << BENCHMARK_NEAREST_COUNT << ",\n";
+    results << "  \"mismatches\": " << mismatches << ",\n";
+    results << "  \"backends\": {\n";
+    for (uint32_t backend = 0; backend < backendCount; ++backend)
+    {
+        results << "    \"" << World::getBackendName(static_cast<EWorldBackend>(backend)) << "\": {\n";
+        results << "      \"buildMs\": " << buildMilliseconds[backend] << ",\n";
+        for (uint32_t kind = 0; kind < kindCount; ++kind)
+        {
+            results << "      \"" << QUERY_KIND_NAMES[kind] << "\": { \"totalMs\": " << queryMilliseconds[backend][kind]
+                << ", \"nsPerQuery\": " << ((queryMilliseconds[backend][kind] * 1000000.0) / BENCHMARK_QUERY_COUNT)
+                << ", \"resultsPerQuery\": " << (static_cast<double>(queryFound[backend][kind]) / BENCHMARK_QUERY_COUNT) << " }";
+            results << ((kind + 1 < kindCount) ? (",\n") : ("\n"));
+        }
+        results << ((backend + 1 < backendCount) ? ("    },\n") : ("    }\n"));
+    }
+    results << "  }\n";
+    results << "}\n";
+
+    SDL_Log("Benchmark: %u queries of each kind over %u entities, grid radius %.1f ns quadtree radius %.1f ns, written to %s",
+        BENCHMARK_QUERY_COUNT, aPopulation,
+        (queryMilliseconds[static_cast<size_t>(EWorldBackend::GRID)][static_cast<size_t>(EQueryKind::RADIUS)] * 1000000.0) / BENCHMARK_QUERY_COUNT,
+        (queryMilliseconds[static_cast<size_t>(EWorldBackend::QUADTREE)][static_cast<size_t>(EQueryKind::RADIUS)] * 1000000.0) / BENCHMARK_QUERY_COUNT,
+        aResultsPath);
+    return mismatches == 0 && static_cast<bool>(results);
+}
@@ -0,0 +1,86 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Benchmark drives the whole update and render pipeline for a fixed number of ticks from a world snapshot,
+* at a fixed tick time and rendering to an offscreen target, so two runs see identical input and their
+* per phase timings can be compared. Rendering is split into recording the draws and submitting them to
+* the renderer, and the draw rate is reported next to them. Every NPC's neighbors are looked up in the
+* world's spatial index each tick too, so the grid and quadtree backends can be compared under each layout.
+* The medians and 99th percentiles are written out as JSON, for one run or for a suite of every layout
+* under each backend in one file. The spatial queries can also be timed on their own, in a world filled
+* with far more entities than the market holds.
+*/
+#pragma once
+#include "PCH.h"
+class Game;
+class SDLManager;
+enum class EWorldLayout;
+enum class EWorldBackend;
+
+
+// Where the results are written, unless another path is given
+constexpr const char* BENCHMARK_RESULTS_PATH = "market_benchmark.json";
+
+// The number of ticks measured unless another count is given, the ticks simulated first without being
+// measured, and the fixed time every tick covers
+constexpr uint32_t BENCHMARK_DEFAULT_TICKS = 1000;
+constexpr uint32_t BENCHMARK_WARMUP_TICKS  = 30;
+constexpr float BENCHMARK_TICK_TIME        = 1.f / 60.f;
+
+// The seed a market generated for a benchmark is generated from, unless another seed is given
+constexpr uint32_t BENCHMARK_SEED          = 20261019;
+
+// Every tick every NPC looks for its neighbors this far away in the world's spatial index, timed on its own
+constexpr float BENCHMARK_NEIGHBOR_RADIUS  = TRADE_RADIUS * 2.f;
+
+// The entities the query benchmark fills its world with unless another population is given, the queries
+// of each kind it times under each backend, and the most entities each nearest query finds
+constexpr uint32_t BENCHMARK_QUERY_POPULATION = 1000000;
+constexpr uint32_t BENCHMARK_QUERY_COUNT      = 100000;
+constexpr uint32_t BENCHMARK_NEAREST_COUNT    = 8;
+
+
+class Benchmark
+{
+public:
+    /**
+    * Run the benchmark on a game restored from the scenario's world snapshot, or generated from a set seed,
+    * and write the results.
+    * @param aGame         - The game, already started from the scenario.
+    * @param aSDL          - The SDL subsystem the game renders with.
+    * @param aScenarioPath - The world snapshot or layout the game was started from, recorded in the results.
+    * @param aTicks        - The number of ticks to measure.
+    * @param aResultsPath  - Where to write the results.
+    * @return bool True if every tick ran without a steady state tick allocating and the results were written,
+    * otherwise false.
+    */
+    static bool run(Game& aGame, SDLManager& aSDL, const char* aScenarioPath, const uint32_t& aTicks, const char* aResultsPath);
+
+    /**
+    * Benchmark a market generated from the set seed in every layout under each backend, one game after
+    * another, and write every run's results to one file.
+    * @param aSDL         - The SDL subsystem the games render with.
+    * @param aTicks       - The number of ticks to measure each run.
+    * @param aResultsPath - Where to write the results.
+    * @param aStartGame   - Configures and starts a game in a layout and backend, with every other setting
+    *                       from the command line.
+    * @param aMismatches  - Set to the broadphase and flow field mismatches summed over the runs.
+    * @return bool True if every run measured every tick without a steady state tick allocating and the
+    * results were written, otherwise false.
+    */
+    static bool runSuite(SDLManager& aSDL, const uint32_t& aTicks, const char* aResultsPath,
+        const function<void(Game&, const EWorldLayout&, const EWorldBackend&)>& aStartGame, uint32_t& aMismatches);
+
+    /**
+    * Fill a world of its own with half rugs and half NPCs, as densely as the market is, time the radius,
+    * rectangle, and nearest queries across the thread pool under each backend, and write the results. Must
+    * be called once SDL is initialized, the market isn't needed.
+    * @param aPopulation  - The number of entities in the world.
+    * @param aResultsPath - Where to write the results.
+    * @return bool True if every query ran, the backends found the same number of entities for each kind, and
+    * the results were written, otherwise false.
+    */
+    static bool runQueries(const uint32_t& aPopulation, const char* aResultsPath);
+};
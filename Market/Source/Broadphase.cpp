@@ -0,0 +1,472 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Broadphase finds the NPC and rug pairs that could trade this tick, every NPC whose path this tick
+* overlapped a rug's trade radius paired with the rug. There are several ways of finding them, the rug
+* index's grid, a grid with each rug copied into every cell its trade radius reaches, a sweep and prune
+* along x that keeps its order from tick to tick, and testing every NPC against every rug, which the
+* others are checked against. Every one of them finds the same pairs.
+*/
+#include "PCH.h"
+#include "Broadphase.h"
+#include "Rug.h"
+#include "NPC.h"
+
+
+// The names of the broadphases, in the order of their enum
+static const char* const BROADPHASE_NAMES[] = { "grid", "halo", "sap", "brute" };
+
+
+/**
+* Whether an NPC's path this tick overlapped a rug's trade radius, the exact test every broadphase ends
+* with so they all agree.
+* @param aPrevLocation - Where the NPC started the tick.
+* @param aCurrLocation - Where the NPC ended the tick.
+* @param aRugLocation  - The rug's location.
+* @return bool True if the path overlapped the trade radius, otherwise false.
+*/
+static bool pathOverlapsRug(const Vector& aPrevLocation, const Vector& aCurrLocation, const Vector& aRugLocation)
+{
+    return MATH::doesLineSegmentOverlapCircle(aPrevLocation, aCurrLocation, aRugLocation, TRADE_RADIUS);
+}
+
+
+/**
+* Default Constructor
+*/
+Broadphase::Broadphase()
+{
+    mRugIndex = nullptr;
+}
+
+
+/**
+* Destructor
+*/
+Broadphase::~Broadphase()
+{}
+
+
+/**
+* Keep the rug index and copy the rugs' locations out of it.
+* @param aRugIndex - The rug index.
+*/
+void Broadphase::setRugIndex(const StaticRugIndex& aRugIndex)
+{
+    mRugIndex = &aRugIndex;
+    mRugLocations.resize(aRugIndex.size());
+    for (size_t rug = 0; rug < aRugIndex.size(); ++rug)
+    {
+        mRugLocations[rug] = aRugIndex.getRug(static_cast<uint32_t>(rug))->getLocation();
+    }
+}
+
+
+/**
+* Make a broadphase.
+* @param aBroadphase - The way of finding the pairs.
+* @return Broadphase* The broadphase, the caller deletes it.
+*/
+Broadphase* Broadphase::create(const EBroadphase& aBroadphase)
+{
+    switch (aBroadphase)
+    {
+    case EBroadphase::HALO_GRID:
+        return new HaloGridBroadphase();
+    case EBroadphase::SWEEP_AND_PRUNE:
+        return new SweepAndPruneBroadphase();
+    case EBroadphase::BRUTE_FORCE:
+        return new BruteForceBroadphase();
+    default:
+        return new GridBroadphase();
+    }
+}
+
+
+/**
+* Get a broadphase's name, as it's given on the command line.
+* @param aBroadphase - The way of finding the pairs.
+* @return const char* The name.
+*/
+const char* Broadphase::getName(const EBroadphase& aBroadphase)
+{
+    return BROADPHASE_NAMES[static_cast<size_t>(aBroadphase)];
+}
+
+
+/**
+* Prepare for the rugs in a rug index.
+* @param aRugIndex - The rug index.
+* @param aWidth    - The world's width.
+* @param aHeight   - The world's height.
+*/
+void GridBroadphase::build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight)
+{
+    // The rug index already covers the world
+    (void)aWidth;
+    (void)aHeight;
+    setRugIndex(aRugIndex);
+    mOverlappingRugs.assign(max(aRugIndex.size(), static_cast<size_t>(1)), 0);
+}
+
+
+/**
+* Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius.
+* @param aNPCs  - Every NPC in the world.
+* @param aPairs - Cleared, then set to the pairs.
+*/
+void GridBroadphase::findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs)
+{
+    aPairs.clear();
+    uint32_t maxRugs = static_cast<uint32_t>(mOverlappingRugs.size());
+
+    for (uint32_t npc = 0; npc < aNPCs.size(); ++npc)
+    {
+        if (aNPCs[npc]->isSkippingUpdates())
+        {
+            continue;
+        }
+
+        uint32_t rugCount = mRugIndex->querySegment(aNPCs[npc]->getPrevLocation(), aNPCs[npc]->getLocation(), mOverlappingRugs.data(), maxRugs);
+        for (uint32_t i = 0; i < rugCount; ++i)
+        {
+            aPairs.push_back({ npc, mOverlappingRugs[i] });
+        }
+    }
+}
+
+
+/**
+* Default Constructor, the grid is empty until it is built.
+*/
+HaloGridBroadphase::HaloGridBroadphase()
+{
+    mCols = 0;
+    mRows = 0;
+    mStamp = 0;
+}
+
+
+/**
+* Get the cell column or row containing a coordinate, clamped to the grid.
+* @param aCoordinate - The x or y coordinate.
+* @param aCount      - The number of columns or rows.
+* @return uint32_t The column or row.
+*/
+uint32_t HaloGridBroadphase::toCell(const float& aCoordinate, const uint32_t& aCount) const
+{
+    if (aCoordinate <= 0)
+    {
+        return 0;
+    }
+
+    uint32_t cell = static_cast<uint32_t>(aCoordinate / BROADPHASE_HALO_CELL_LENGTH);
+    return (cell < aCount) ? (cell) : (aCount - 1);
+}
+
+
+/**
+* Prepare for the rugs in a rug index.
+* @param aRugIndex - The rug index.
+* @param aWidth    - The world's width.
+* @param aHeight   - The world's height.
+*/
+void HaloGridBroadphase::build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight)
+{
+    setRugIndex(aRugIndex);
+    mCols = static_cast<uint32_t>(aWidth / BROADPHASE_HALO_CELL_LENGTH) + 1;
+    mRows = static_cast<uint32_t>(aHeight / BROADPHASE_HALO_CELL_LENGTH) + 1;
+    const float reach = TRADE_RADIUS + BROADPHASE_MARGIN;
+
+    // Count the rugs reaching each cell, turn the counts into each cell's starting index, then scatter the
+    // rugs into every cell they reach
+    mCellStart.assign((static_cast<size_t>(mCols) * mRows) + 1, 0);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        vector<uint32_t> next;
+        if (pass == 1)
+        {
+            for (size_t cell = 1; cell < mCellStart.size(); ++cell)
+            {
+                mCellStart[cell] += mCellStart[cell - 1];
+            }
+            mCellRugs.assign(mCellStart.back(), 0);
+            next.assign(mCellStart.begin(), mCellStart.end() - 1);
+        }
+
+        for (uint32_t rug = 0; rug < mRugLocations.size(); ++rug)
+        {
+            const Vector& location = mRugLocations[rug];
+            uint32_t firstCol = toCell(location.x - reach, mCols);
+            uint32_t lastCol  = toCell(location.x + reach, mCols);
+            uint32_t firstRow = toCell(location.y - reach, mRows);
+            uint32_t lastRow  = toCell(location.y + reach, mRows);
+
+            for (uint32_t row = firstRow; row <= lastRow; ++row)
+            {
+                for (uint32_t col = firstCol; col <= lastCol; ++col)
+                {
+                    size_t cell = (static_cast<size_t>(row) * mCols) + col;
+                    if (pass == 0)
+                    {
+                        ++mCellStart[cell + 1];
+                    }
+                    else
+                    {
+                        mCellRugs[next[cell]++] = rug;
+                    }
+                }
+            }
+        }
+    }
+
+    mRugStamps.assign(mRugLocations.size(), 0);
+    mStamp = 0;
+}
+
+
+/**
+* Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius.
+* @param aNPCs  - Every NPC in the world.
+* @param aPairs - Cleared, then set to the pairs.
+*/
+void HaloGridBroadphase::findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs)
+{
+    aPairs.clear();
+    if (mCellStart.empty())
+    {
+        return;
+    }
+
+    for (uint32_t npc = 0; npc < aNPCs.size(); ++npc)
+    {
+        if (aNPCs[npc]->isSkippingUpdates())
+        {
+            continue;
+        }
+
+        // Start the stamps over once they run out
+        if (++mStamp == 0)
+        {
+            fill(mRugStamps.begin(), mRugStamps.end(), 0);
+            mStamp = 1;
+        }
+
+        // Every rug that could reach the path was copied into the cells the path passes through
+        Vector prevLocation = aNPCs[npc]->getPrevLocation();
+        Vector currLocation = aNPCs[npc]->getLocation();
+        uint32_t firstCol = toCell(min(prevLocation.x, currLocation.x), mCols);
+        uint32_t lastCol  = toCell(max(prevLocation.x, currLocation.x), mCols);
+        uint32_t firstRow = toCell(min(prevLocation.y, currLocation.y), mRows);
+        uint32_t lastRow  = toCell(max(prevLocation.y, currLocation.y), mRows);
+
+        for (uint32_t row = firstRow; row <= lastRow; ++row)
+        {
+            for (uint32_t col = firstCol; col <= lastCol; ++col)
+            {
+                size_t cell = (static_cast<size_t>(row) * mCols) + col;
+                for (uint32_t i = mCellStart[cell]; i < mCellStart[cell + 1]; ++i)
+                {
+                    uint32_t rug = mCellRugs[i];
+                    if (mRugStamps[rug] == mStamp)
+                    {
+                        continue;
+                    }
+                    mRugStamps[rug] = mStamp;
+
+                    if (pathOverlapsRug(prevLocation, currLocation, mRugLocations[rug]))
+                    {
+                        aPairs.push_back({ npc, rug });
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/**
+* Default Constructor, the list is empty until it is built.
+*/
+SweepAndPruneBroadphase::SweepAndPruneBroadphase()
+{
+    mNPCCount = 0;
+}
+
+
+/**
+* Drop the entries whose extents ended before a coordinate from an active list.
+* @param aActive - The active list.
+* @param aX      - The coordinate.
+*/
+void SweepAndPruneBroadphase::dropEnded(vector<uint32_t>& aActive, const float& aX)
+{
+    for (size_t i = 0; i < aActive.size();)
+    {
+        if (mEntries[aActive[i]].mMaxX < aX)
+        {
+            aActive[i] = aActive.back();
+            aActive.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+
+/**
+* Prepare for the rugs in a rug index.
+* @param aRugIndex - The rug index.
+* @param aWidth    - The world's width.
+* @param aHeight   - The world's height.
+*/
+void SweepAndPruneBroadphase::build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight)
+{
+    // The axes are sorted by the extents alone, the world's size doesn't bound them
+    (void)aWidth;
+    (void)aHeight;
+    setRugIndex(aRugIndex);
+    const float reach = TRADE_RADIUS + BROADPHASE_MARGIN;
+
+    // The rugs never move, so their extents are set once, the NPCs' are added on the next findPairs(..)
+    mEntries.clear();
+    mNPCCount = 0;
+    for (uint32_t rug = 0; rug < mRugLocations.size(); ++rug)
+    {
+        const Vector& location = mRugLocations[rug];
+        mEntries.push_back({ location.x - reach, location.x + reach, location.y - reach, location.y + reach, rug, true });
+    }
+}
+
+
+/**
+* Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius.
+* @param aNPCs  - Every NPC in the world.
+* @param aPairs - Cleared, then set to the pairs.
+*/
+void SweepAndPruneBroadphase::findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs)
+{
+    aPairs.clear();
+
+    // The NPCs changed, so the list is made again with their entries at the end and re-sorted in full
+    if (mNPCCount != aNPCs.size())
+    {
+        mEntries.erase(remove_if(mEntries.begin(), mEntries.end(), [](const SweepEntry& aEntry) { return !aEntry.mIsRug; }), mEntries.end());
+        for (uint32_t npc = 0; npc < aNPCs.size(); ++npc)
+        {
+            mEntries.push_back({ 0.f, 0.f, 0.f, 0.f, npc, false });
+        }
+        mNPCCount = aNPCs.size();
+    }
+
+    // Bring the NPCs' extents up to date with their paths this tick
+    for (SweepEntry& entry : mEntries)
+    {
+        if (!entry.mIsRug)
+        {
+            Vector prevLocation = aNPCs[entry.mIndex]->getPrevLocation();
+            Vector currLocation = aNPCs[entry.mIndex]->getLocation();
+            entry.mMinX = min(prevLocation.x, currLocation.x);
+            entry.mMaxX = max(prevLocation.x, currLocation.x);
+            entry.mMinY = min(prevLocation.y, currLocation.y);
+            entry.mMaxY = max(prevLocation.y, currLocation.y);
+        }
+    }
+
+    // Insertion sort, the entries only moved as far as the NPCs walked since last tick so few are out of
+    // place and this is close to linear
+    for (size_t i = 1; i < mEntries.size(); ++i)
+    {
+        SweepEntry entry = mEntries[i];
+        size_t j = i;
+        while (j > 0 && mEntries[j - 1].mMinX > entry.mMinX)
+        {
+            mEntries[j] = mEntries[j - 1];
+            --j;
+        }
+        mEntries[j] = entry;
+    }
+
+    // Sweep along x, each entry is paired with the active entries of the other kind, every one of which
+    // started before it and hasn't ended yet
+    mActiveRugs.clear();
+    mActiveNPCs.clear();
+    for (uint32_t i = 0; i < mEntries.size(); ++i)
+    {
+        const SweepEntry& entry = mEntries[i];
+        dropEnded(mActiveRugs, entry.mMinX);
+        dropEnded(mActiveNPCs, entry.mMinX);
+
+        if (!entry.mIsRug && aNPCs[entry.mIndex]->isSkippingUpdates())
+        {
+            continue;
+        }
+
+        vector<uint32_t>& others = (entry.mIsRug) ? (mActiveNPCs) : (mActiveRugs);
+        for (uint32_t other : others)
+        {
+            const SweepEntry& rugEntry = (entry.mIsRug) ? (entry) : (mEntries[other]);
+            const SweepEntry& npcEntry = (entry.mIsRug) ? (mEntries[other]) : (entry);
+            if (npcEntry.mMaxY < rugEntry.mMinY || rugEntry.mMaxY < npcEntry.mMinY)
+            {
+                continue;
+            }
+
+            NPC* npc = aNPCs[npcEntry.mIndex];
+            if (pathOverlapsRug(npc->getPrevLocation(), npc->getLocation(), mRugLocations[rugEntry.mIndex]))
+            {
+                aPairs.push_back({ npcEntry.mIndex, rugEntry.mIndex });
+            }
+        }
+
+        ((entry.mIsRug) ? (mActiveRugs) : (mActiveNPCs)).push_back(i);
+    }
+}
+
+
+/**
+* Prepare for the rugs in a rug index.
+* @param aRugIndex - The rug index.
+* @param aWidth    - The world's width.
+* @param aHeight   - The world's height.
+*/
+void BruteForceBroadphase::build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight)
+{
+    // Every rug is tested, the world's size doesn't matter
+    (void)aWidth;
+    (void)aHeight;
+    setRugIndex(aRugIndex);
+}
+
+
+/**
+* Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius.
+* @param aNPCs  - Every NPC in the world.
+* @param aPairs - Cleared, then set to the pairs.
+*/
+void BruteForceBroadphase::findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs)
+{
+    aPairs.clear();
+
+    for (uint32_t npc = 0; npc < aNPCs.size(); ++npc)
+    {
+        if (aNPCs[npc]->isSkippingUpdates())
+        {
+            continue;
+        }
+
+        Vector prevLocation = aNPCs[npc]->getPrevLocation();
+        Vector currLocation = aNPCs[npc]->getLocation();
+        for (uint32_t rug = 0; rug < mRugLocations.size(); ++rug)
+        {
+            if (pathOverlapsRug(prevLocation, currLocation, mRugLocations[rug]))
+            {
+                aPairs.push_back({ npc, rug });
+            }
+        }
+    }
+}
@@ -0,0 +1,259 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Broadphase finds the NPC and rug pairs that could trade this tick, every NPC whose path this tick
+* overlapped a rug's trade radius paired with the rug. There are several ways of finding them, the rug
+* index's grid, a grid with each rug copied into every cell its trade radius reaches, a sweep and prune
+* along x that keeps its order from tick to tick, and testing every NPC against every rug, which the
+* others are checked against. Every one of them finds the same pairs.
+*/
+#pragma once
+#include "PCH.h"
+#include "StaticRugIndex.h"
+class NPC;
+
+
+// The ways of finding the pairs
+enum class EBroadphase
+{
+    GRID,
+    HALO_GRID,
+    SWEEP_AND_PRUNE,
+    BRUTE_FORCE
+};
+
+// Number of ways of finding the pairs
+constexpr uint32_t BROADPHASE_COUNT = static_cast<uint32_t>(EBroadphase::BRUTE_FORCE) + 1;
+
+// Added to the trade radius when pruning, so a pair the exact test finds is never pruned by rounding
+constexpr float BROADPHASE_MARGIN = 1.f;
+
+// The side length of the halo grid's cells
+constexpr float BROADPHASE_HALO_CELL_LENGTH = TRADE_RADIUS * 2.f;
+
+
+// An NPC whose path this tick overlapped a rug's trade radius
+struct BroadphasePair
+{
+    // The NPC's index in the NPCs the pairs were found for, and the rug's index in the rug index
+    uint32_t mNPC;
+    uint32_t mRug;
+};
+
+
+class Broadphase
+{
+public:
+    /**
+    * Destructor
+    */
+    virtual ~Broadphase();
+
+    /**
+    * Prepare for the rugs in a rug index, called again whenever the rug index is rebuilt.
+    * @param aRugIndex - The rug index, it must outlive the broadphase's use of it.
+    * @param aWidth    - The world's width.
+    * @param aHeight   - The world's height.
+    */
+    virtual void build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight) = 0;
+
+    /**
+    * Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius, the NPCs
+    * skipping this tick's update are left out. Must be called on one thread once every NPC has moved.
+    * @param aNPCs  - Every NPC in the world.
+    * @param aPairs - Cleared, then set to the pairs, in no particular order.
+    */
+    virtual void findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs) = 0;
+
+    /**
+    * Make a broadphase.
+    * @param aBroadphase - The way of finding the pairs.
+    * @return Broadphase* The broadphase, the caller deletes it.
+    */
+    static Broadphase* create(const EBroadphase& aBroadphase);
+
+    /**
+    * Get a broadphase's name, as it's given on the command line.
+    * @param aBroadphase - The way of finding the pairs.
+    * @return const char* The name.
+    */
+    static const char* getName(const EBroadphase& aBroadphase);
+
+protected:
+    // The rugs' index, and their locations by their index in it
+    const StaticRugIndex* mRugIndex;
+    vector<Vector> mRugLocations;
+
+    /**
+    * Default Constructor
+    */
+    Broadphase();
+
+    /**
+    * Keep the rug index and copy the rugs' locations out of it.
+    * @param aRugIndex - The rug index.
+    */
+    void setRugIndex(const StaticRugIndex& aRugIndex);
+};
+
+
+/**
+* The rug index's own grid, every NPC's path is looked up in it.
+*/
+class GridBroadphase : public Broadphase
+{
+private:
+    // The rugs one NPC's path overlaps, large enough to hold every rug
+    vector<uint32_t> mOverlappingRugs;
+
+public:
+    /**
+    * Prepare for the rugs in a rug index.
+    * @param aRugIndex - The rug index.
+    * @param aWidth    - The world's width.
+    * @param aHeight   - The world's height.
+    */
+    void build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight) override;
+
+    /**
+    * Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius.
+    * @param aNPCs  - Every NPC in the world.
+    * @param aPairs - Cleared, then set to the pairs.
+    */
+    void findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs) override;
+};
+
+
+/**
+* A grid with each rug copied into every cell its trade radius reaches, so an NPC's path only looks in the
+* cells it passes through, usually the one it's standing in.
+*/
+class HaloGridBroadphase : public Broadphase
+{
+private:
+    // Grid dimensions
+    uint32_t mCols;
+    uint32_t mRows;
+
+    // mCellStart[i] is the index of cell i's first rug in mCellRugs, mCellStart[i + 1] is one past its last
+    vector<uint32_t> mCellStart;
+    vector<uint32_t> mCellRugs;
+
+    // The stamp of the last NPC each rug was tested against, a rug seen in more than one of an NPC's cells
+    // is tested once, and the current NPC's stamp
+    vector<uint32_t> mRugStamps;
+    uint32_t mStamp;
+
+    /**
+    * Get the cell column or row containing a coordinate, clamped to the grid.
+    * @param aCoordinate - The x or y coordinate.
+    * @param aCount      - The number of columns or rows.
+    * @return uint32_t The column or row.
+    */
+    uint32_t toCell(const float& aCoordinate, const uint32_t& aCount) const;
+
+public:
+    /**
+    * Default Constructor, the grid is empty until it is built.
+    */
+    HaloGridBroadphase();
+
+    /**
+    * Prepare for the rugs in a rug index.
+    * @param aRugIndex - The rug index.
+    * @param aWidth    - The world's width.
+    * @param aHeight   - The world's height.
+    */
+    void build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight) override;
+
+    /**
+    * Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius.
+    * @param aNPCs  - Every NPC in the world.
+    * @param aPairs - Cleared, then set to the pairs.
+    */
+    void findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs) override;
+};
+
+
+/**
+* Sweep and prune along x. Every rug's and NPC's extent on x is kept in one list sorted by where the
+* extents start, the NPCs move a little each tick so last tick's order is nearly sorted and an insertion
+* sort brings it up to date. A sweep down the list pairs the NPCs with the rugs whose extents overlap.
+*/
+class SweepAndPruneBroadphase : public Broadphase
+{
+private:
+    // An extent on x, an NPC's path this tick or a rug's trade radius grown by the margin, and its extent
+    // on y, checked once the extents overlap on x
+    struct SweepEntry
+    {
+        float mMinX;
+        float mMaxX;
+        float mMinY;
+        float mMaxY;
+        uint32_t mIndex;
+        bool mIsRug;
+    };
+
+    // Every extent, sorted by where it starts as of last tick, and the number of NPCs the extents were
+    // made for
+    vector<SweepEntry> mEntries;
+    size_t mNPCCount;
+
+    // The entries reached by the sweep whose extents haven't ended yet
+    vector<uint32_t> mActiveRugs;
+    vector<uint32_t> mActiveNPCs;
+
+    /**
+    * Drop the entries whose extents ended before a coordinate from an active list.
+    * @param aActive - The active list.
+    * @param aX      - The coordinate.
+    */
+    void dropEnded(vector<uint32_t>& aActive, const float& aX);
+
+public:
+    /**
+    * Default Constructor, the list is empty until it is built.
+    */
+    SweepAndPruneBroadphase();
+
+    /**
+    * Prepare for the rugs in a rug index.
+    * @param aRugIndex - The rug index.
+    * @param aWidth    - The world's width.
+    * @param aHeight   - The world's height.
+    */
+    void build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight) override;
+
+    /**
+    * Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius.
+    * @param aNPCs  - Every NPC in the world.
+    * @param aPairs - Cleared, then set to the pairs.
+    */
+    void findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs) override;
+};
+
+
+/**
+* Every NPC tested against every rug, the reference the others are checked against.
+*/
+class BruteForceBroadphase : public Broadphase
+{
+public:
+    /**
+    * Prepare for the rugs in a rug index.
+    * @param aRugIndex - The rug index.
+    * @param aWidth    - The world's width.
+    * @param aHeight   - The world's height.
+    */
+    void build(const StaticRugIndex& aRugIndex, const float& aWidth, const float& aHeight) override;
+
+    /**
+    * Find every NPC and rug pair whose NPC's path this tick overlapped the rug's trade radius.
+    * @param aNPCs  - Every NPC in the world.
+    * @param aPairs - Cleared, then set to the pairs.
+    */
+    void findPairs(const vector<NPC*>& aNPCs, vector<BroadphasePair>& aPairs) override;
+};
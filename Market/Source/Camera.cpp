@@ -0,0 +1,151 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Camera is the view of the world drawn in the window. It has a position in world coordinates and a zoom,
+* so the world can be larger than the window, and it maps world coordinates to screen coordinates for
+* rendering. The view is kept inside the world, and never zoomed out past the world filling the window.
+*/
+#include "PCH.h"
+#include "Camera.h"
+
+
+/**
+* Keep the zoom in range and the view inside the world.
+*/
+void Camera::clampToWorld()
+{
+    // Zoomed out no further than the world filling the window
+    float minZoom = 1.f;
+    if (mWorldWidth > 0 && mWorldHeight > 0)
+    {
+        minZoom = max(mViewWidth / mWorldWidth, mViewHeight / mWorldHeight);
+    }
+    mZoom = min(max(mZoom, minZoom), max(CAMERA_MAX_ZOOM, minZoom));
+
+    mX = min(max(mX, 0.f), max(mWorldWidth - (mViewWidth / mZoom), 0.f));
+    mY = min(max(mY, 0.f), max(mWorldHeight - (mViewHeight / mZoom), 0.f));
+}
+
+
+/**
+* Default Constructor, the camera shows nothing until it is initialized.
+*/
+Camera::Camera()
+{
+    mX           = 0;
+    mY           = 0;
+    mZoom        = 1;
+    mViewWidth   = 0;
+    mViewHeight  = 0;
+    mWorldWidth  = 0;
+    mWorldHeight = 0;
+}
+
+
+/**
+* Initialize the camera to show the world's top left corner at a zoom of 1.
+* @param aViewWidth   - The window's width.
+* @param aViewHeight  - The window's height.
+* @param aWorldWidth  - The world's width.
+* @param aWorldHeight - The world's height.
+*/
+void Camera::init(const uint32_t& aViewWidth, const uint32_t& aViewHeight, const uint32_t& aWorldWidth, const uint32_t& aWorldHeight)
+{
+    mViewWidth   = static_cast<float>(aViewWidth);
+    mViewHeight  = static_cast<float>(aViewHeight);
+    mWorldWidth  = static_cast<float>(aWorldWidth);
+    mWorldHeight = static_cast<float>(aWorldHeight);
+    reset();
+}
+
+
+/**
+* Show the world's top left corner at a zoom of 1 again.
+*/
+void Camera::reset()
+{
+    mX = 0;
+    mY = 0;
+    mZoom = 1;
+    clampToWorld();
+}
+
+
+/**
+* Move the camera.
+* @param aScreenX - How far to move horizontally, in screen pixels.
+* @param aScreenY - How far to move vertically, in screen pixels.
+*/
+void Camera::pan(const float& aScreenX, const float& aScreenY)
+{
+    mX += aScreenX / mZoom;
+    mY += aScreenY / mZoom;
+    clampToWorld();
+}
+
+
+/**
+* Zoom the camera, keeping the world point under a screen point in place.
+* @param aFactor  - How much to zoom in by, less than 1 zooms out.
+* @param aScreenX - The screen point's x coordinate.
+* @param aScreenY - The screen point's y coordinate.
+*/
+void Camera::zoomAt(const float& aFactor, const float& aScreenX, const float& aScreenY)
+{
+    // The world point under the screen point before zooming
+    float worldX = mX + (aScreenX / mZoom);
+    float worldY = mY + (aScreenY / mZoom);
+
+    mZoom *= aFactor;
+    clampToWorld();
+
+    mX = worldX - (aScreenX / mZoom);
+    mY = worldY - (aScreenY / mZoom);
+    clampToWorld();
+}
+
+
+/**
+* Get the camera's zoom.
+* @return float The screen pixels per world unit.
+*/
+float Camera::getZoom() const
+{
+    return mZoom;
+}
+
+
+/**
+* Get the corners of the world area in view.
+* @param aMin - Set to the view's top left corner.
+* @param aMax - Set to the view's bottom right corner.
+*/
+void Camera::getView(Vector& aMin, Vector& aMax) const
+{
+    aMin = Vector{ mX, mY, 0 };
+    aMax = Vector{ mX + (mViewWidth / mZoom), mY + (mViewHeight / mZoom), 0 };
+}
+
+
+/**
+* Map a world x coordinate to the screen.
+* @param aWorldX - The world x coordinate.
+* @return int The screen x coordinate.
+*/
+int Camera::toScreenX(const float& aWorldX) const
+{
+    return static_cast<int>(floor((aWorldX - mX) * mZoom));
+}
+
+
+/**
+* Map a world y coordinate to the screen.
+* @param aWorldY - The world y coordinate.
+* @return int The screen y coordinate.
+*/
+int Camera::toScreenY(const float& aWorldY) const
+{
+    return static_cast<int>(floor((aWorldY - mY) * mZoom));
+}
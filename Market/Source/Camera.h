@@ -0,0 +1,102 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Camera is the view of the world drawn in the window. It has a position in world coordinates and a zoom,
+* so the world can be larger than the window, and it maps world coordinates to screen coordinates for
+* rendering. The view is kept inside the world, and never zoomed out past the world filling the window.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// The most the camera can be zoomed in, and how much one mouse wheel step zooms
+constexpr float CAMERA_MAX_ZOOM   = 4.f;
+constexpr float CAMERA_ZOOM_STEP  = 1.25f;
+
+// How far one arrow key press pans the camera, as a fraction of the view
+constexpr float CAMERA_PAN_STEP   = .25f;
+
+
+class Camera
+{
+private:
+    // The world coordinate at the view's top left corner, and the zoom, screen pixels per world unit
+    float mX;
+    float mY;
+    float mZoom;
+
+    // The window's dimensions in screen pixels, and the world's dimensions
+    float mViewWidth;
+    float mViewHeight;
+    float mWorldWidth;
+    float mWorldHeight;
+
+    /**
+    * Keep the zoom in range and the view inside the world.
+    */
+    void clampToWorld();
+
+public:
+    /**
+    * Default Constructor, the camera shows nothing until it is initialized.
+    */
+    Camera();
+
+    /**
+    * Initialize the camera to show the world's top left corner at a zoom of 1.
+    * @param aViewWidth   - The window's width.
+    * @param aViewHeight  - The window's height.
+    * @param aWorldWidth  - The world's width.
+    * @param aWorldHeight - The world's height.
+    */
+    void init(const uint32_t& aViewWidth, const uint32_t& aViewHeight, const uint32_t& aWorldWidth, const uint32_t& aWorldHeight);
+
+    /**
+    * Show the world's top left corner at a zoom of 1 again.
+    */
+    void reset();
+
+    /**
+    * Move the camera.
+    * @param aScreenX - How far to move horizontally, in screen pixels.
+    * @param aScreenY - How far to move vertically, in screen pixels.
+    */
+    void pan(const float& aScreenX, const float& aScreenY);
+
+    /**
+    * Zoom the camera, keeping the world point under a screen point in place.
+    * @param aFactor  - How much to zoom in by, less than 1 zooms out.
+    * @param aScreenX - The screen point's x coordinate.
+    * @param aScreenY - The screen point's y coordinate.
+    */
+    void zoomAt(const float& aFactor, const float& aScreenX, const float& aScreenY);
+
+    /**
+    * Get the camera's zoom.
+    * @return float The screen pixels per world unit.
+    */
+    float getZoom() const;
+
+    /**
+    * Get the corners of the world area in view.
+    * @param aMin - Set to the view's top left corner.
+    * @param aMax - Set to the view's bottom right corner.
+    */
+    void getView(Vector& aMin, Vector& aMax) const;
+
+    /**
+    * Map a world x coordinate to the screen.
+    * @param aWorldX - The world x coordinate.
+    * @return int The screen x coordinate.
+    */
+    int toScreenX(const float& aWorldX) const;
+
+    /**
+    * Map a world y coordinate to the screen.
+    * @param aWorldY - The world y coordinate.
+    * @return int The screen y coordinate.
+    */
+    int toScreenY(const float& aWorldY) const;
+};
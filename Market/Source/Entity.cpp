@@ -22,6 +22,18 @@ Entity::Entity()
 }
 
 
+/**
+* Swap the unique ID and subspace with another Entity, for when the two Entities' storage is swapped.
+*
+* @param aOther - The Entity to swap with.
+*/
+void Entity::swapIdentity(Entity& aOther)
+{
+    swap(mID, aOther.mID);
+    swap(mCurrSubspace, aOther.mCurrSubspace);
+}
+
+
 /**
 * Set the Entity's current subspace.
 *
@@ -8,6 +8,7 @@
 */
 #pragma once
 #include "PCH.h"
+class Camera;
 
 /**
 * The different subclasses that inherit from Entity
@@ -32,6 +33,14 @@ private:
                                             // (If the mCurrSubspace is UINT32_MAX, then the
                                             //  entity has not been added to the subspace.)
 
+protected:
+    /**
+    * Swap the unique ID and subspace with another Entity, for when the two Entities' storage is swapped.
+    * 
+    * @param aOther - The Entity to swap with.
+    */
+    void swapIdentity(Entity& aOther);
+
 public:
     /**
     * Every time an Entity is constructed increment the sCreatedEntityCount, and assign this 
@@ -55,8 +64,10 @@ public:
 
     /**
     * Renders the Entity in the window.
+    * 
+    * @param aCamera - The view of the world drawn in the window.
     */
-    virtual void render() = 0;
+    virtual void render(const Camera& aCamera) = 0;
 
     /**
     * Set the Entity's current subspace.
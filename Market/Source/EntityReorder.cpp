@@ -0,0 +1,176 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* EntityReorder sorts the entities' storage slots by the Morton code of the subspace each entity is in, on
+* a background thread so the sort never stalls a frame. The game hands it the codes, keeps simulating
+* while it sorts, and applies the finished order between ticks, so entities near each other in the world
+* end up near each other in memory.
+*/
+#include "PCH.h"
+#include "EntityReorder.h"
+#include "Trace.h"
+
+
+/**
+* Default Constructor, there is no worker until init(..) is called.
+*/
+EntityReorder::EntityReorder()
+{
+    mState = EReorderState::IDLE;
+    mQuit  = false;
+}
+
+
+/**
+* Joins the worker thread.
+*/
+EntityReorder::~EntityReorder()
+{
+    close();
+}
+
+
+/**
+* Start the worker thread, and reserve room for the given number of entities.
+* @param aEntityCount - The number of entities sorted.
+* @return bool True if the worker was started, otherwise false.
+*/
+bool EntityReorder::init(const uint32_t& aEntityCount)
+{
+    bool success = true;
+
+    if (mWorker.joinable())
+    {
+        // cout << "EntityReorder::init(..) was called on a running sorter.\n";
+        success = false;
+    }
+    else
+    {
+        mKeys.reserve(aEntityCount);
+        mOrder.reserve(aEntityCount);
+        mState = EReorderState::IDLE;
+        mQuit  = false;
+        mWorker = thread(&EntityReorder::workerLoop, this);
+    }
+
+    return success;
+}
+
+
+/**
+* Stop and join the worker thread.
+*/
+void EntityReorder::close()
+{
+    {
+        lock_guard<mutex> lock(mMtx);
+        mQuit = true;
+    }
+    mWorkCV.notify_all();
+
+    if (mWorker.joinable())
+    {
+        mWorker.join();
+    }
+    mState = EReorderState::IDLE;
+}
+
+
+/**
+* Start sorting the slots by their Morton codes, unless a sort is already running or waiting to be
+* applied.
+* @param aCodes - The Morton code of every slot, in slot order.
+* @return bool True if the sort was started, otherwise false.
+*/
+bool EntityReorder::request(const vector<uint32_t>& aCodes)
+{
+    {
+        lock_guard<mutex> lock(mMtx);
+        if (!mWorker.joinable() || mState != EReorderState::IDLE)
+        {
+            return false;
+        }
+
+        // The worker only touches the keys while SORTING, so they're filled here under the lock
+        mKeys.resize(aCodes.size());
+        for (size_t slot = 0; slot < aCodes.size(); ++slot)
+        {
+            mKeys[slot] = (static_cast<uint64_t>(aCodes[slot]) << 32) | slot;
+        }
+        mState = EReorderState::SORTING;
+    }
+    mWorkCV.notify_one();
+
+    return true;
+}
+
+
+/**
+* Whether a sort finished and its order is waiting to be applied.
+* @return bool True if getOrder() can be read, otherwise false.
+*/
+bool EntityReorder::isReady() const
+{
+    return mState == EReorderState::READY;
+}
+
+
+/**
+* Get the finished order, only valid while isReady().
+* @return const vector<uint32_t>& For every new slot, the slot its entity comes from.
+*/
+const vector<uint32_t>& EntityReorder::getOrder() const
+{
+    return mOrder;
+}
+
+
+/**
+* Mark the finished order as applied, so the next sort can be requested.
+*/
+void EntityReorder::finish()
+{
+    lock_guard<mutex> lock(mMtx);
+    if (mState == EReorderState::READY)
+    {
+        mState = EReorderState::IDLE;
+    }
+}
+
+
+/**
+* The loop the worker thread runs, waits for a sort request and runs it.
+*/
+void EntityReorder::workerLoop()
+{
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(mMtx);
+            mWorkCV.wait(lock, [this] { return mQuit || mState == EReorderState::SORTING; });
+
+            if (mQuit)
+            {
+                return;
+            }
+        }
+
+        // The game doesn't touch the keys or the order until the state is READY, so the sort runs
+        // without the lock, the slot in the low bits keeps equal codes in their current order
+        {
+            TRACE_SCOPE("EntityReorder::sort");
+            sort(mKeys.begin(), mKeys.end());
+
+            mOrder.resize(mKeys.size());
+            for (size_t i = 0; i < mKeys.size(); ++i)
+            {
+                mOrder[i] = static_cast<uint32_t>(mKeys[i] & UINT32_MAX);
+            }
+        }
+
+        lock_guard<mutex> lock(mMtx);
+        mState = EReorderState::READY;
+    }
+}
@@ -0,0 +1,99 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* EntityReorder sorts the entities' storage slots by the Morton code of the subspace each entity is in, on
+* a background thread so the sort never stalls a frame. The game hands it the codes, keeps simulating
+* while it sorts, and applies the finished order between ticks, so entities near each other in the world
+* end up near each other in memory.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// How many ticks apart the entities' storage is re-sorted
+constexpr uint32_t ENTITY_REORDER_INTERVAL = 120;
+
+
+// The state of a sort, the game hands over work while IDLE and takes the result while READY
+enum class EReorderState
+{
+    IDLE,
+    SORTING,
+    READY
+};
+
+
+class EntityReorder
+{
+private:
+    // The background thread the sorts run on
+    thread mWorker;
+
+    // Guards the state and wakes the worker when there is a sort to run
+    mutex mMtx;
+    condition_variable mWorkCV;
+    atomic<EReorderState> mState;
+
+    // Set when the sorter is closing
+    bool mQuit;
+
+    // The sort keys, each a Morton code in the high bits and the slot in the low bits, and the sorted
+    // order, the slot each entity in the new order comes from
+    vector<uint64_t> mKeys;
+    vector<uint32_t> mOrder;
+
+    /**
+    * The loop the worker thread runs, waits for a sort request and runs it.
+    */
+    void workerLoop();
+
+public:
+    /**
+    * Default Constructor, there is no worker until init(..) is called.
+    */
+    EntityReorder();
+
+    /**
+    * Joins the worker thread.
+    */
+    ~EntityReorder();
+
+    /**
+    * Start the worker thread, and reserve room for the given number of entities.
+    * @param aEntityCount - The number of entities sorted.
+    * @return bool True if the worker was started, otherwise false.
+    */
+    bool init(const uint32_t& aEntityCount);
+
+    /**
+    * Stop and join the worker thread.
+    */
+    void close();
+
+    /**
+    * Start sorting the slots by their Morton codes, unless a sort is already running or waiting to be
+    * applied.
+    * @param aCodes - The Morton code of every slot, in slot order.
+    * @return bool True if the sort was started, otherwise false.
+    */
+    bool request(const vector<uint32_t>& aCodes);
+
+    /**
+    * Whether a sort finished and its order is waiting to be applied.
+    * @return bool True if getOrder() can be read, otherwise false.
+    */
+    bool isReady() const;
+
+    /**
+    * Get the finished order, only valid while isReady().
+    * @return const vector<uint32_t>& For every new slot, the slot its entity comes from.
+    */
+    const vector<uint32_t>& getOrder() const;
+
+    /**
+    * Mark the finished order as applied, so the next sort can be requested.
+    */
+    void finish();
+};
@@ -0,0 +1,893 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* FlowField steers the NPCs around the market's obstacles. The world is covered by a navigation grid of
+* square cells, a cell is blocked while an obstacle covers it. A flow field is worked out once per goal
+* region, every cell's cost of walking to the region and the neighbor to step to, so finding a path costs
+* once per goal instead of once per NPC and an NPC only looks up the cell it's standing in. The fields are
+* cached, evicted least recently used first once they take more memory than their budget, and repaired in
+* place when an obstacle appears or goes away instead of being worked out again. The NPCs only read the
+* cache while they update, a field that isn't cached is requested and worked out on the main thread
+* before the next update.
+*/
+#include "PCH.h"
+#include "FlowField.h"
+#include <SDL.h>
+
+
+// Each direction's step in columns and rows, clockwise from the right, the odd directions are the corners
+static const int FLOW_STEP_COLS[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int FLOW_STEP_ROWS[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+
+/**
+* Get the direction opposite a direction.
+* @param aDirection - The direction, 0 to 7.
+* @return uint8_t The opposite direction.
+*/
+static uint8_t oppositeDirection(const uint8_t& aDirection)
+{
+    return (aDirection + 4) & 7;
+}
+
+
+/**
+* Get the cost of a step in a direction.
+* @param aDirection - The direction, 0 to 7.
+* @return uint32_t The cost.
+*/
+static uint32_t stepCost(const uint8_t& aDirection)
+{
+    return (aDirection & 1) ? (FLOW_CORNER_COST) : (FLOW_SIDE_COST);
+}
+
+
+/**
+* Default Constructor, the grid is empty until it is initialized.
+*/
+NavigationGrid::NavigationGrid()
+{
+    mCellLength = FLOW_CELL_LENGTH;
+    mCols       = 0;
+    mRows       = 0;
+    mRegionCols = 0;
+}
+
+
+/**
+* Cover a world with unblocked cells.
+* @param aWidth  - The world's width.
+* @param aHeight - The world's height.
+*/
+void NavigationGrid::init(const uint32_t& aWidth, const uint32_t& aHeight)
+{
+    // Large worlds get larger cells, so a field's memory stays bounded
+    float area = static_cast<float>(aWidth) * static_cast<float>(aHeight);
+    mCellLength = max(FLOW_CELL_LENGTH, ceil(sqrt(area / FLOW_MAX_CELLS)));
+    mCols = max(1u, static_cast<uint32_t>(ceil(aWidth / mCellLength)));
+    mRows = max(1u, static_cast<uint32_t>(ceil(aHeight / mCellLength)));
+    while (static_cast<uint64_t>(mCols) * mRows > FLOW_MAX_CELLS)
+    {
+        mCellLength += 1.f;
+        mCols = max(1u, static_cast<uint32_t>(ceil(aWidth / mCellLength)));
+        mRows = max(1u, static_cast<uint32_t>(ceil(aHeight / mCellLength)));
+    }
+    mRegionCols = (mCols + FLOW_GOAL_REGION_CELLS - 1) / FLOW_GOAL_REGION_CELLS;
+
+    mBlocked.assign(static_cast<size_t>(mCols) * mRows, 0);
+}
+
+
+/**
+* Get the cell column or row containing a coordinate, clamped to the grid.
+* @param aCoordinate - The x or y coordinate.
+* @param aCount      - The number of columns or rows.
+* @return uint32_t The column or row.
+*/
+uint32_t NavigationGrid::toCell(const float& aCoordinate, const uint32_t& aCount) const
+{
+    if (aCoordinate <= 0.f)
+    {
+        return 0;
+    }
+    return min(static_cast<uint32_t>(aCoordinate / mCellLength), aCount - 1);
+}
+
+
+/**
+* Add or remove an obstacle covering a rectangle.
+* @param aMin      - The rectangle's top left corner.
+* @param aMax      - The rectangle's bottom right corner.
+* @param aBlocking - True to add the obstacle, false to remove it.
+* @param aChanged  - The cells that became blocked or unblocked are appended.
+*/
+void NavigationGrid::setBlocking(const Vector& aMin, const Vector& aMax, const bool& aBlocking, vector<uint32_t>& aChanged)
+{
+    if (mBlocked.empty())
+    {
+        return;
+    }
+
+    uint32_t minCol = toCell(aMin.x, mCols);
+    uint32_t maxCol = toCell(aMax.x, mCols);
+    uint32_t minRow = toCell(aMin.y, mRows);
+    uint32_t maxRow = toCell(aMax.y, mRows);
+    for (uint32_t row = minRow; row <= maxRow; ++row)
+    {
+        for (uint32_t col = minCol; col <= maxCol; ++col)
+        {
+            uint32_t cell = (row * mCols) + col;
+            if (aBlocking)
+            {
+                if (mBlocked[cell]++ == 0)
+                {
+                    aChanged.push_back(cell);
+                }
+            }
+            else if (mBlocked[cell] > 0 && --mBlocked[cell] == 0)
+            {
+                aChanged.push_back(cell);
+            }
+        }
+    }
+}
+
+
+/**
+* Whether an obstacle covers a cell.
+* @param aCell - The cell.
+* @return bool True if the cell is blocked, otherwise false.
+*/
+bool NavigationGrid::isBlocked(const uint32_t& aCell) const
+{
+    return mBlocked[aCell] > 0;
+}
+
+
+/**
+* Get a cell's neighbor in a direction.
+* @param aCell      - The cell.
+* @param aDirection - The direction, 0 to 7.
+* @param aNeighbor  - Set to the neighbor.
+* @return bool True if the neighbor is in the grid, otherwise false.
+*/
+bool NavigationGrid::getNeighbor(const uint32_t& aCell, const uint8_t& aDirection, uint32_t& aNeighbor) const
+{
+    int col = static_cast<int>(aCell % mCols) + FLOW_STEP_COLS[aDirection];
+    int row = static_cast<int>(aCell / mCols) + FLOW_STEP_ROWS[aDirection];
+    if (col < 0 || row < 0 || col >= static_cast<int>(mCols) || row >= static_cast<int>(mRows))
+    {
+        return false;
+    }
+
+    aNeighbor = (static_cast<uint32_t>(row) * mCols) + static_cast<uint32_t>(col);
+    return true;
+}
+
+
+/**
+* Whether an NPC can step from a cell to its neighbor in a direction, the neighbor must be unblocked and a
+* step to a corner neighbor must not cut past a blocked side neighbor.
+* @param aCell      - The cell.
+* @param aDirection - The direction, 0 to 7.
+* @param aNeighbor  - Set to the neighbor.
+* @return bool True if the step can be taken, otherwise false.
+*/
+bool NavigationGrid::canStep(const uint32_t& aCell, const uint8_t& aDirection, uint32_t& aNeighbor) const
+{
+    if (!getNeighbor(aCell, aDirection, aNeighbor) || isBlocked(aNeighbor))
+    {
+        return false;
+    }
+
+    // The side neighbors on either side of a corner step share its column or row
+    if (aDirection & 1)
+    {
+        uint32_t col = aCell % mCols;
+        uint32_t row = aCell / mCols;
+        uint32_t besideCol = (row * mCols) + static_cast<uint32_t>(static_cast<int>(col) + FLOW_STEP_COLS[aDirection]);
+        uint32_t besideRow = (static_cast<uint32_t>(static_cast<int>(row) + FLOW_STEP_ROWS[aDirection]) * mCols) + col;
+        if (isBlocked(besideCol) || isBlocked(besideRow))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+* Get the cell containing a location, clamped to the grid.
+* @param aLocation - The location.
+* @return uint32_t The cell.
+*/
+uint32_t NavigationGrid::toCell(const Vector& aLocation) const
+{
+    return (toCell(aLocation.y, mRows) * mCols) + toCell(aLocation.x, mCols);
+}
+
+
+/**
+* Get the center of a cell.
+* @param aCell - The cell.
+* @return Vector The center.
+*/
+Vector NavigationGrid::getCellCenter(const uint32_t& aCell) const
+{
+    return Vector{ ((aCell % mCols) + .5f) * mCellLength, ((aCell / mCols) + .5f) * mCellLength, 0 };
+}
+
+
+/**
+* Get the goal region containing a location.
+* @param aLocation - The location.
+* @return uint32_t The goal region.
+*/
+uint32_t NavigationGrid::toGoalRegion(const Vector& aLocation) const
+{
+    uint32_t col = toCell(aLocation.x, mCols) / FLOW_GOAL_REGION_CELLS;
+    uint32_t row = toCell(aLocation.y, mRows) / FLOW_GOAL_REGION_CELLS;
+    return (row * mRegionCols) + col;
+}
+
+
+/**
+* Whether a cell is in a goal region.
+* @param aCell   - The cell.
+* @param aRegion - The goal region.
+* @return bool True if the cell is in the region, otherwise false.
+*/
+bool NavigationGrid::isInGoalRegion(const uint32_t& aCell, const uint32_t& aRegion) const
+{
+    return ((aCell % mCols) / FLOW_GOAL_REGION_CELLS) == (aRegion % mRegionCols) &&
+        ((aCell / mCols) / FLOW_GOAL_REGION_CELLS) == (aRegion / mRegionCols);
+}
+
+
+/**
+* Get the number of goal regions.
+* @return uint32_t The number of regions.
+*/
+uint32_t NavigationGrid::getGoalRegionCount() const
+{
+    return mRegionCols * ((mRows + FLOW_GOAL_REGION_CELLS - 1) / FLOW_GOAL_REGION_CELLS);
+}
+
+
+/**
+* Get the cells' side length.
+* @return float The side length.
+*/
+float NavigationGrid::getCellLength() const
+{
+    return mCellLength;
+}
+
+
+/**
+* Get the number of cells.
+* @return uint32_t The number of cells.
+*/
+uint32_t NavigationGrid::getCellCount() const
+{
+    return static_cast<uint32_t>(mBlocked.size());
+}
+
+
+/**
+* Constructor
+* @param aRegion - The goal region.
+*/
+FlowField::FlowField(const uint32_t& aRegion)
+{
+    mRegion = aRegion;
+    mUsers.store(0, memory_order_relaxed);
+    mLastUsed.store(0, memory_order_relaxed);
+}
+
+
+/**
+* Add a cell to the open list.
+* @param aOpen - The open list.
+* @param aCost - The cell's cost.
+* @param aCell - The cell.
+*/
+void FlowField::pushOpen(FlowOpenList& aOpen, const uint32_t& aCost, const uint32_t& aCell)
+{
+    aOpen.push_back(FlowOpenCell(aCost, aCell));
+    push_heap(aOpen.begin(), aOpen.end(), greater<FlowOpenCell>());
+}
+
+
+/**
+* Settle the cells on the open list and every cell they lead to, closest first.
+* @param aGrid - The navigation grid.
+* @param aOpen - The open list, emptied.
+*/
+void FlowField::propagate(const NavigationGrid& aGrid, FlowOpenList& aOpen)
+{
+    while (!aOpen.empty())
+    {
+        pop_heap(aOpen.begin(), aOpen.end(), greater<FlowOpenCell>());
+        FlowOpenCell open = aOpen.back();
+        aOpen.pop_back();
+
+        // A cell is opened again each time it gets cheaper, only its cheapest opening counts
+        if (open.first != mCosts[open.second])
+        {
+            continue;
+        }
+
+        for (uint8_t direction = 0; direction < 8; ++direction)
+        {
+            uint32_t neighbor;
+            if (!aGrid.canStep(open.second, direction, neighbor))
+            {
+                continue;
+            }
+
+            uint32_t cost = open.first + stepCost(direction);
+            if (cost < mCosts[neighbor])
+            {
+                mCosts[neighbor] = cost;
+                mDirections[neighbor] = oppositeDirection(direction);
+                pushOpen(aOpen, cost, neighbor);
+            }
+        }
+    }
+}
+
+
+/**
+* Set a cell's cost from its cheapest neighbor, or to zero inside the goal region, and open it.
+* @param aGrid - The navigation grid.
+* @param aCell - The cell, unblocked.
+* @param aOpen - The open list.
+*/
+void FlowField::reopen(const NavigationGrid& aGrid, const uint32_t& aCell, FlowOpenList& aOpen)
+{
+    if (aGrid.isInGoalRegion(aCell, mRegion))
+    {
+        mCosts[aCell] = 0;
+        mDirections[aCell] = FLOW_DIRECTION_GOAL;
+        pushOpen(aOpen, 0, aCell);
+        return;
+    }
+
+    for (uint8_t direction = 0; direction < 8; ++direction)
+    {
+        uint32_t neighbor;
+        if (aGrid.canStep(aCell, direction, neighbor) && mCosts[neighbor] != FLOW_UNREACHABLE &&
+            mCosts[neighbor] + stepCost(direction) < mCosts[aCell])
+        {
+            mCosts[aCell] = mCosts[neighbor] + stepCost(direction);
+            mDirections[aCell] = direction;
+        }
+    }
+
+    if (mCosts[aCell] != FLOW_UNREACHABLE)
+    {
+        pushOpen(aOpen, mCosts[aCell], aCell);
+    }
+}
+
+
+/**
+* Work out every cell's cost and direction, a recycled field keeps its memory.
+* @param aGrid - The navigation grid.
+* @param aOpen - An empty open list to work with, left empty.
+*/
+void FlowField::compute(const NavigationGrid& aGrid, FlowOpenList& aOpen)
+{
+    mCosts.assign(aGrid.getCellCount(), FLOW_UNREACHABLE);
+    mDirections.assign(aGrid.getCellCount(), FLOW_DIRECTION_NONE);
+
+    // Every unblocked cell of the goal region is a goal
+    for (uint32_t cell = 0; cell < aGrid.getCellCount(); ++cell)
+    {
+        if (!aGrid.isBlocked(cell) && aGrid.isInGoalRegion(cell, mRegion))
+        {
+            mCosts[cell] = 0;
+            mDirections[cell] = FLOW_DIRECTION_GOAL;
+            pushOpen(aOpen, 0, cell);
+        }
+    }
+
+    propagate(aGrid, aOpen);
+}
+
+
+/**
+* Bring the field up to date after cells became blocked or unblocked. Only the cells whose way to the goal
+* went through a newly blocked cell are worked out again, along with the cells the unblocked cells make
+* cheaper. The costs match a field computed from scratch.
+* @param aGrid    - The navigation grid.
+* @param aChanged - The cells that became blocked or unblocked.
+* @param aOpen    - An empty open list to work with, left empty.
+* @param aInvalid - A list to collect the cells that lost their costs in, cleared first.
+*/
+void FlowField::repair(const NavigationGrid& aGrid, const vector<uint32_t>& aChanged, FlowOpenList& aOpen, vector<uint32_t>& aInvalid)
+{
+    // The newly blocked cells, and the cells whose step the blocked cells cut off, lose their costs
+    aInvalid.clear();
+    for (uint32_t cell : aChanged)
+    {
+        if (!aGrid.isBlocked(cell))
+        {
+            continue;
+        }
+
+        aInvalid.push_back(cell);
+        for (uint8_t direction = 0; direction < 8; ++direction)
+        {
+            uint32_t neighbor;
+            uint32_t next;
+            if (aGrid.getNeighbor(cell, direction, neighbor) && mDirections[neighbor] < FLOW_DIRECTION_GOAL &&
+                !aGrid.canStep(neighbor, mDirections[neighbor], next))
+            {
+                aInvalid.push_back(neighbor);
+            }
+        }
+    }
+    for (uint32_t cell : aInvalid)
+    {
+        mCosts[cell] = FLOW_UNREACHABLE;
+        mDirections[cell] = FLOW_DIRECTION_NONE;
+    }
+
+    // So does every cell whose way to the goal led through them
+    for (size_t i = 0; i < aInvalid.size(); ++i)
+    {
+        for (uint8_t direction = 0; direction < 8; ++direction)
+        {
+            uint32_t neighbor;
+            if (aGrid.getNeighbor(aInvalid[i], direction, neighbor) && mDirections[neighbor] == oppositeDirection(direction))
+            {
+                mCosts[neighbor] = FLOW_UNREACHABLE;
+                mDirections[neighbor] = FLOW_DIRECTION_NONE;
+                aInvalid.push_back(neighbor);
+            }
+        }
+    }
+
+    // The cells that lost their costs take them from their neighbors again, the unblocked cells do too and
+    // their neighbors are opened so the steps through them are tried
+    for (uint32_t cell : aInvalid)
+    {
+        if (!aGrid.isBlocked(cell))
+        {
+            reopen(aGrid, cell, aOpen);
+        }
+    }
+    for (uint32_t cell : aChanged)
+    {
+        if (aGrid.isBlocked(cell))
+        {
+            continue;
+        }
+
+        reopen(aGrid, cell, aOpen);
+        for (uint8_t direction = 0; direction < 8; ++direction)
+        {
+            uint32_t neighbor;
+            if (aGrid.canStep(cell, direction, neighbor) && mCosts[neighbor] != FLOW_UNREACHABLE)
+            {
+                pushOpen(aOpen, mCosts[neighbor], neighbor);
+            }
+        }
+    }
+
+    propagate(aGrid, aOpen);
+}
+
+
+/**
+* Count the cells whose cost differs from another field's for the same goal region, or whose direction
+* doesn't step to a neighbor that much cheaper. Ties between neighbors may be broken either way.
+* @param aGrid      - The navigation grid.
+* @param aReference - The field worked out from scratch.
+* @return uint32_t The number of cells that don't match.
+*/
+uint32_t FlowField::countMismatches(const NavigationGrid& aGrid, const FlowField& aReference) const
+{
+    uint32_t mismatches = 0;
+    for (uint32_t cell = 0; cell < aGrid.getCellCount(); ++cell)
+    {
+        uint8_t direction = mDirections[cell];
+        uint32_t neighbor;
+        bool matches = (mCosts[cell] == aReference.mCosts[cell]);
+        if (matches && direction < FLOW_DIRECTION_GOAL)
+        {
+            matches = aGrid.canStep(cell, direction, neighbor) && mCosts[neighbor] + stepCost(direction) == mCosts[cell];
+        }
+        else if (matches)
+        {
+            matches = (direction == aReference.mDirections[cell]);
+        }
+
+        if (!matches)
+        {
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+
+/**
+* Find what an NPC standing at a location does next. Safe to call from any thread while the field isn't
+* being repaired.
+* @param aGrid     - The navigation grid.
+* @param aLocation - The NPC's location.
+* @param aNextCell - Set to the cell to walk to while following the field.
+* @return EFlowStep Follow the field, arrived in the goal region, standing on an obstacle, or unable to
+*                   reach the goal region.
+*/
+EFlowStep FlowField::step(const NavigationGrid& aGrid, const Vector& aLocation, uint32_t& aNextCell) const
+{
+    uint32_t cell = aGrid.toCell(aLocation);
+    if (aGrid.isBlocked(cell))
+    {
+        return EFlowStep::BLOCKED;
+    }
+
+    uint8_t direction = mDirections[cell];
+    if (direction == FLOW_DIRECTION_GOAL)
+    {
+        return EFlowStep::ARRIVED;
+    }
+    if (direction == FLOW_DIRECTION_NONE || !aGrid.getNeighbor(cell, direction, aNextCell))
+    {
+        return EFlowStep::UNREACHABLE;
+    }
+    return EFlowStep::FOLLOW;
+}
+
+
+/**
+* Get a cell's cost of walking to the goal region.
+* @param aCell - The cell.
+* @return uint32_t The cost, FLOW_UNREACHABLE if the cell can't reach the region.
+*/
+uint32_t FlowField::getCost(const uint32_t& aCell) const
+{
+    return mCosts[aCell];
+}
+
+
+/**
+* Get the memory the field takes.
+* @return size_t The size in bytes.
+*/
+size_t FlowField::getBytes() const
+{
+    return sizeof(FlowField) + (mCosts.capacity() * sizeof(uint32_t)) + (mDirections.capacity() * sizeof(uint8_t));
+}
+
+
+/**
+* Default Constructor, the cache is empty until it is initialized.
+*/
+FlowFieldCache::FlowFieldCache() : mReference(0)
+{
+    mPendingCount.store(0, memory_order_relaxed);
+    mPass      = 0;
+    mBudget    = FLOW_FIELD_MEMORY_BUDGET;
+    mBytes     = 0;
+    mPeakBytes = 0;
+    mHits.store(0, memory_order_relaxed);
+    mMisses    = 0;
+    mEvictions = 0;
+    mRepairs   = 0;
+    mVerifyingRepairs = false;
+    mRepairMismatches = 0;
+}
+
+
+/**
+* Destructor
+*/
+FlowFieldCache::~FlowFieldCache()
+{
+    clear();
+}
+
+
+/**
+* Get the size a field takes on this grid.
+* @return size_t The size in bytes.
+*/
+size_t FlowFieldCache::getFieldBytes() const
+{
+    return sizeof(FlowField) + (mGrid.getCellCount() * (sizeof(uint32_t) + sizeof(uint8_t)));
+}
+
+
+/**
+* Evict the least recently used field no NPC follows, skipping the fields worked out in this pass.
+* @return FlowField* The evicted field to recycle, nullptr if every field is in use.
+*/
+FlowField* FlowFieldCache::evict()
+{
+    size_t victim = mCached.size();
+    uint32_t oldest = mPass;
+    for (size_t i = 0; i < mCached.size(); ++i)
+    {
+        uint32_t lastUsed = mCached[i]->mLastUsed.load(memory_order_relaxed);
+        if (mCached[i]->mUsers.load(memory_order_relaxed) == 0 && lastUsed < oldest)
+        {
+            victim = i;
+            oldest = lastUsed;
+        }
+    }
+    if (victim == mCached.size())
+    {
+        return nullptr;
+    }
+
+    FlowField* field = mCached[victim];
+    mCached[victim] = mCached.back();
+    mCached.pop_back();
+    mFields[field->mRegion] = nullptr;
+    mBytes -= field->getBytes();
+    ++mEvictions;
+    return field;
+}
+
+
+/**
+* Drop every cached field and request.
+*/
+void FlowFieldCache::clear()
+{
+    for (FlowField* field : mCached)
+    {
+        delete field;
+    }
+    mCached.clear();
+    mFields.clear();
+    mPending.clear();
+    mPendingCount.store(0, memory_order_relaxed);
+    mBytes = 0;
+}
+
+
+/**
+* Cover a world with a navigation grid, dropping every cached field.
+* @param aWidth  - The world's width.
+* @param aHeight - The world's height.
+*/
+void FlowFieldCache::init(const uint32_t& aWidth, const uint32_t& aHeight)
+{
+    clear();
+    mGrid.init(aWidth, aHeight);
+
+    // Every region can be requested once between passes, so the lists never grow while the NPCs update
+    uint32_t regionCount = mGrid.getGoalRegionCount();
+    mFields.assign(regionCount, nullptr);
+    mPending.resize(regionCount);
+    vector<atomic<uint32_t>> requests(regionCount);
+    mRequests.swap(requests);
+
+    SDL_Log("Flow fields: %.0f pixel cells, %u cells, %.1f KB a field", mGrid.getCellLength(), mGrid.getCellCount(),
+        getFieldBytes() / 1024.f);
+}
+
+
+/**
+* Set the memory the fields may take, the fields are evicted as others are worked out.
+* @param aBudget - The budget in bytes.
+*/
+void FlowFieldCache::setBudget(const size_t& aBudget)
+{
+    mBudget = aBudget;
+}
+
+
+/**
+* Set whether every repaired field is checked against one worked out from scratch, a debugging aid that
+* makes each obstacle change cost a full field per cached field.
+* @param aVerifying - True to check the repairs.
+*/
+void FlowFieldCache::setVerifyingRepairs(const bool& aVerifying)
+{
+    mVerifyingRepairs = aVerifying;
+}
+
+
+/**
+* Get the number of repaired fields that didn't match one worked out from scratch.
+* @return uint32_t The mismatches.
+*/
+uint32_t FlowFieldCache::getRepairMismatches() const
+{
+    return mRepairMismatches;
+}
+
+
+/**
+* Add or remove an obstacle covering a rectangle, and repair every cached field. Must not be called while
+* the NPCs are updated.
+* @param aMin      - The rectangle's top left corner.
+* @param aMax      - The rectangle's bottom right corner.
+* @param aBlocking - True to add the obstacle, false to remove it.
+*/
+void FlowFieldCache::setBlocking(const Vector& aMin, const Vector& aMax, const bool& aBlocking)
+{
+    mChanged.clear();
+    mGrid.setBlocking(aMin, aMax, aBlocking, mChanged);
+    if (mChanged.empty())
+    {
+        return;
+    }
+
+    for (FlowField* field : mCached)
+    {
+        field->repair(mGrid, mChanged, mOpen, mInvalid);
+        ++mRepairs;
+
+        if (mVerifyingRepairs)
+        {
+            mReference.mRegion = field->mRegion;
+            mReference.compute(mGrid, mOpen);
+            uint32_t mismatches = field->countMismatches(mGrid, mReference);
+            if (mismatches > 0 && ++mRepairMismatches <= FLOW_MISMATCH_LOG_LIMIT)
+            {
+                SDL_Log("Flow fields: repaired field for region %u mismatched one worked out from scratch in %u of %u cells",
+                    field->mRegion, mismatches, mGrid.getCellCount());
+            }
+        }
+    }
+}
+
+
+/**
+* Pin the field leading to the goal region containing a location, it isn't evicted until it's released.
+* A field that isn't cached is requested instead, and pinned once it's worked out by the next update.
+* Safe to call from any thread while the NPCs are updated, it neither locks nor allocates.
+* @param aGoal - The location.
+* @return FlowField* The field, nullptr if it was requested.
+*/
+FlowField* FlowFieldCache::acquire(const Vector& aGoal)
+{
+    uint32_t region = mGrid.toGoalRegion(aGoal);
+    FlowField* field = mFields[region];
+    if (field)
+    {
+        field->mUsers.fetch_add(1, memory_order_relaxed);
+        field->mLastUsed.store(mPass, memory_order_relaxed);
+        mHits.fetch_add(1, memory_order_relaxed);
+        return field;
+    }
+
+    // The first request for the region queues it, the rest only add their pins
+    if (mRequests[region].fetch_add(1, memory_order_relaxed) == 0)
+    {
+        uint32_t slot = mPendingCount.fetch_add(1, memory_order_relaxed);
+        if (slot < mPending.size())
+        {
+            mPending[slot] = region;
+        }
+    }
+    return nullptr;
+}
+
+
+/**
+* Get the cached field leading to the goal region containing a location, without pinning it. Safe to
+* call from any thread while the NPCs are updated.
+* @param aGoal - The location.
+* @return FlowField* The field, nullptr if it isn't cached.
+*/
+FlowField* FlowFieldCache::find(const Vector& aGoal) const
+{
+    return mFields[mGrid.toGoalRegion(aGoal)];
+}
+
+
+/**
+* Release the pin an acquire took on a goal region's field, or withdraw its request. Safe to call from
+* any thread while the NPCs are updated.
+* @param aGoal - The location the field was acquired for.
+*/
+void FlowFieldCache::release(const Vector& aGoal)
+{
+    uint32_t region = mGrid.toGoalRegion(aGoal);
+    FlowField* field = mFields[region];
+    if (field)
+    {
+        field->mUsers.fetch_sub(1, memory_order_relaxed);
+    }
+    // The request stays queued, the field is worked out unpinned and can be evicted
+    else
+    {
+        mRequests[region].fetch_sub(1, memory_order_relaxed);
+    }
+}
+
+
+/**
+* Work out the fields requested since the last pass, evicting or recycling the least recently used ones
+* that don't fit in the budget. Must be called on one thread, between the NPCs' updates.
+*/
+void FlowFieldCache::update()
+{
+    ++mPass;
+    uint32_t pendingCount = min(mPendingCount.exchange(0, memory_order_relaxed), static_cast<uint32_t>(mPending.size()));
+    for (uint32_t i = 0; i < pendingCount; ++i)
+    {
+        // A region withdrawn and requested again is queued twice, the second request only adds its pins
+        uint32_t region = mPending[i];
+        uint32_t requests = mRequests[region].exchange(0, memory_order_relaxed);
+        if (mFields[region])
+        {
+            mFields[region]->mUsers.fetch_add(requests, memory_order_relaxed);
+            continue;
+        }
+
+        // The last field evicted is recycled, its memory already fits the grid
+        FlowField* field = nullptr;
+        while (mBytes + getFieldBytes() > mBudget)
+        {
+            FlowField* evicted = evict();
+            if (!evicted)
+            {
+                break;
+            }
+            delete field;
+            field = evicted;
+        }
+        if (field)
+        {
+            field->mRegion = region;
+        }
+        else
+        {
+            field = new FlowField(region);
+        }
+
+        field->compute(mGrid, mOpen);
+        field->mUsers.store(requests, memory_order_relaxed);
+        field->mLastUsed.store(mPass, memory_order_relaxed);
+        mFields[region] = field;
+        mCached.push_back(field);
+        mBytes += field->getBytes();
+        mPeakBytes = max(mPeakBytes, mBytes);
+        ++mMisses;
+    }
+}
+
+
+/**
+* Get the navigation grid.
+* @return const NavigationGrid& The grid.
+*/
+const NavigationGrid& FlowFieldCache::getGrid() const
+{
+    return mGrid;
+}
+
+
+/**
+* Log the fields cached, the memory they take, and how often they were found cached.
+*/
+void FlowFieldCache::logStats()
+{
+    uint64_t hits = mHits.load(memory_order_relaxed);
+    if (hits + mMisses == 0)
+    {
+        return;
+    }
+
+    SDL_Log("Flow fields: %u cached in %.1f of %.1f MB, peak %.1f MB, %llu found cached, %llu worked out, %llu evicted, %llu repaired",
+        static_cast<uint32_t>(mCached.size()), mBytes / (1024.f * 1024.f), mBudget / (1024.f * 1024.f), mPeakBytes / (1024.f * 1024.f),
+        static_cast<unsigned long long>(hits), static_cast<unsigned long long>(mMisses),
+        static_cast<unsigned long long>(mEvictions), static_cast<unsigned long long>(mRepairs));
+    if (mVerifyingRepairs)
+    {
+        SDL_Log("Flow fields: %u of %llu repairs mismatched a field worked out from scratch", mRepairMismatches,
+            static_cast<unsigned long long>(mRepairs));
+    }
+}
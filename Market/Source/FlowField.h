@@ -0,0 +1,432 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* FlowField steers the NPCs around the market's obstacles. The world is covered by a navigation grid of
+* square cells, a cell is blocked while an obstacle covers it. A flow field is worked out once per goal
+* region, every cell's cost of walking to the region and the neighbor to step to, so finding a path costs
+* once per goal instead of once per NPC and an NPC only looks up the cell it's standing in. The fields are
+* cached, evicted least recently used first once they take more memory than their budget, and repaired in
+* place when an obstacle appears or goes away instead of being worked out again. The NPCs only read the
+* cache while they update, a field that isn't cached is requested and worked out on the main thread
+* before the next update.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// Side length of the navigation grid's cells, grown on large worlds so there are no more than FLOW_MAX_CELLS
+constexpr float FLOW_CELL_LENGTH = 16.f;
+constexpr uint32_t FLOW_MAX_CELLS = 1 << 20;
+
+// Side length of a goal region in cells, every goal in a region shares the region's field
+constexpr uint32_t FLOW_GOAL_REGION_CELLS = 2;
+
+// Memory the cached fields take before the least recently used are evicted, in bytes
+constexpr size_t FLOW_FIELD_MEMORY_BUDGET = 32 * 1024 * 1024;
+
+// Cost of stepping to a side neighbor and a corner neighbor, in tenths of a cell so the costs add up exactly
+constexpr uint32_t FLOW_SIDE_COST = 10;
+constexpr uint32_t FLOW_CORNER_COST = 14;
+
+// The cost of a cell that can't reach the goal region
+constexpr uint32_t FLOW_UNREACHABLE = UINT32_MAX;
+
+// A cell's direction once it's in the goal region, or when it can't reach it, directions 0 to 7 are its
+// neighbors clockwise from the right
+constexpr uint8_t FLOW_DIRECTION_GOAL = 8;
+constexpr uint8_t FLOW_DIRECTION_NONE = 9;
+
+// No cell
+constexpr uint32_t FLOW_NO_CELL = UINT32_MAX;
+
+// Most repaired fields logged for not matching a field worked out from scratch
+constexpr uint32_t FLOW_MISMATCH_LOG_LIMIT = 8;
+
+
+// What an NPC standing at a location does next
+enum class EFlowStep
+{
+    FOLLOW,
+    ARRIVED,
+    BLOCKED,
+    UNREACHABLE
+};
+
+
+// The cells of the world, and how many obstacles cover each
+class NavigationGrid
+{
+private:
+    // The cells' side length, grid dimensions, and goal region columns
+    float mCellLength;
+    uint32_t mCols;
+    uint32_t mRows;
+    uint32_t mRegionCols;
+
+    // The number of obstacles covering each cell, a cell is blocked while any does
+    vector<uint16_t> mBlocked;
+
+    /**
+    * Get the cell column or row containing a coordinate, clamped to the grid.
+    * @param aCoordinate - The x or y coordinate.
+    * @param aCount      - The number of columns or rows.
+    * @return uint32_t The column or row.
+    */
+    uint32_t toCell(const float& aCoordinate, const uint32_t& aCount) const;
+
+public:
+    /**
+    * Default Constructor, the grid is empty until it is initialized.
+    */
+    NavigationGrid();
+
+    /**
+    * Cover a world with unblocked cells.
+    * @param aWidth  - The world's width.
+    * @param aHeight - The world's height.
+    */
+    void init(const uint32_t& aWidth, const uint32_t& aHeight);
+
+    /**
+    * Add or remove an obstacle covering a rectangle.
+    * @param aMin      - The rectangle's top left corner.
+    * @param aMax      - The rectangle's bottom right corner.
+    * @param aBlocking - True to add the obstacle, false to remove it.
+    * @param aChanged  - The cells that became blocked or unblocked are appended.
+    */
+    void setBlocking(const Vector& aMin, const Vector& aMax, const bool& aBlocking, vector<uint32_t>& aChanged);
+
+    /**
+    * Whether an obstacle covers a cell.
+    * @param aCell - The cell.
+    * @return bool True if the cell is blocked, otherwise false.
+    */
+    bool isBlocked(const uint32_t& aCell) const;
+
+    /**
+    * Get a cell's neighbor in a direction.
+    * @param aCell      - The cell.
+    * @param aDirection - The direction, 0 to 7.
+    * @param aNeighbor  - Set to the neighbor.
+    * @return bool True if the neighbor is in the grid, otherwise false.
+    */
+    bool getNeighbor(const uint32_t& aCell, const uint8_t& aDirection, uint32_t& aNeighbor) const;
+
+    /**
+    * Whether an NPC can step from a cell to its neighbor in a direction, the neighbor must be unblocked and a
+    * step to a corner neighbor must not cut past a blocked side neighbor.
+    * @param aCell      - The cell.
+    * @param aDirection - The direction, 0 to 7.
+    * @param aNeighbor  - Set to the neighbor.
+    * @return bool True if the step can be taken, otherwise false.
+    */
+    bool canStep(const uint32_t& aCell, const uint8_t& aDirection, uint32_t& aNeighbor) const;
+
+    /**
+    * Get the cell containing a location, clamped to the grid.
+    * @param aLocation - The location.
+    * @return uint32_t The cell.
+    */
+    uint32_t toCell(const Vector& aLocation) const;
+
+    /**
+    * Get the center of a cell.
+    * @param aCell - The cell.
+    * @return Vector The center.
+    */
+    Vector getCellCenter(const uint32_t& aCell) const;
+
+    /**
+    * Get the goal region containing a location.
+    * @param aLocation - The location.
+    * @return uint32_t The goal region.
+    */
+    uint32_t toGoalRegion(const Vector& aLocation) const;
+
+    /**
+    * Whether a cell is in a goal region.
+    * @param aCell   - The cell.
+    * @param aRegion - The goal region.
+    * @return bool True if the cell is in the region, otherwise false.
+    */
+    bool isInGoalRegion(const uint32_t& aCell, const uint32_t& aRegion) const;
+
+    /**
+    * Get the number of goal regions.
+    * @return uint32_t The number of regions.
+    */
+    uint32_t getGoalRegionCount() const;
+
+    /**
+    * Get the cells' side length.
+    * @return float The side length.
+    */
+    float getCellLength() const;
+
+    /**
+    * Get the number of cells.
+    * @return uint32_t The number of cells.
+    */
+    uint32_t getCellCount() const;
+};
+
+
+// A cell waiting for its cost to be settled, and the cells whose costs are settled closest first, a heap
+// by cost kept in a vector the cache reuses for every field
+typedef pair<uint32_t, uint32_t> FlowOpenCell;
+typedef vector<FlowOpenCell> FlowOpenList;
+
+
+// One goal region's field, each cell's cost of walking to the region and the neighbor to step to
+class FlowField
+{
+private:
+    // The cache pins, stamps, and recycles the fields
+    friend class FlowFieldCache;
+
+    // The goal region
+    uint32_t mRegion;
+
+    // Each cell's cost of walking to the goal region, and direction to step in
+    vector<uint32_t> mCosts;
+    vector<uint8_t> mDirections;
+
+    // The NPCs following the field, it isn't evicted while any are, and the cache pass it was last acquired
+    // in, both changed from the NPCs' update
+    atomic<uint32_t> mUsers;
+    atomic<uint32_t> mLastUsed;
+
+    /**
+    * Add a cell to the open list.
+    * @param aOpen - The open list.
+    * @param aCost - The cell's cost.
+    * @param aCell - The cell.
+    */
+    static void pushOpen(FlowOpenList& aOpen, const uint32_t& aCost, const uint32_t& aCell);
+
+    /**
+    * Settle the cells on the open list and every cell they lead to, closest first.
+    * @param aGrid - The navigation grid.
+    * @param aOpen - The open list, emptied.
+    */
+    void propagate(const NavigationGrid& aGrid, FlowOpenList& aOpen);
+
+    /**
+    * Set a cell's cost from its cheapest neighbor, or to zero inside the goal region, and open it.
+    * @param aGrid - The navigation grid.
+    * @param aCell - The cell, unblocked.
+    * @param aOpen - The open list.
+    */
+    void reopen(const NavigationGrid& aGrid, const uint32_t& aCell, FlowOpenList& aOpen);
+
+public:
+    /**
+    * Constructor
+    * @param aRegion - The goal region.
+    */
+    explicit FlowField(const uint32_t& aRegion);
+
+    /**
+    * Work out every cell's cost and direction, a recycled field keeps its memory.
+    * @param aGrid - The navigation grid.
+    * @param aOpen - An empty open list to work with, left empty.
+    */
+    void compute(const NavigationGrid& aGrid, FlowOpenList& aOpen);
+
+    /**
+    * Bring the field up to date after cells became blocked or unblocked. Only the cells whose way to the goal
+    * went through a newly blocked cell are worked out again, along with the cells the unblocked cells make
+    * cheaper. The costs match a field computed from scratch.
+    * @param aGrid    - The navigation grid.
+    * @param aChanged - The cells that became blocked or unblocked.
+    * @param aOpen    - An empty open list to work with, left empty.
+    * @param aInvalid - A list to collect the cells that lost their costs in, cleared first.
+    */
+    void repair(const NavigationGrid& aGrid, const vector<uint32_t>& aChanged, FlowOpenList& aOpen, vector<uint32_t>& aInvalid);
+
+    /**
+    * Count the cells whose cost differs from another field's for the same goal region, or whose direction
+    * doesn't step to a neighbor that much cheaper. Ties between neighbors may be broken either way.
+    * @param aGrid      - The navigation grid.
+    * @param aReference - The field worked out from scratch.
+    * @return uint32_t The number of cells that don't match.
+    */
+    uint32_t countMismatches(const NavigationGrid& aGrid, const FlowField& aReference) const;
+
+    /**
+    * Find what an NPC standing at a location does next. Safe to call from any thread while the field isn't
+    * being repaired.
+    * @param aGrid     - The navigation grid.
+    * @param aLocation - The NPC's location.
+    * @param aNextCell - Set to the cell to walk to while following the field.
+    * @return EFlowStep Follow the field, arrived in the goal region, standing on an obstacle, or unable to
+    *                   reach the goal region.
+    */
+    EFlowStep step(const NavigationGrid& aGrid, const Vector& aLocation, uint32_t& aNextCell) const;
+
+    /**
+    * Get a cell's cost of walking to the goal region.
+    * @param aCell - The cell.
+    * @return uint32_t The cost, FLOW_UNREACHABLE if the cell can't reach the region.
+    */
+    uint32_t getCost(const uint32_t& aCell) const;
+
+    /**
+    * Get the memory the field takes.
+    * @return size_t The size in bytes.
+    */
+    size_t getBytes() const;
+};
+
+
+// Every goal region's field that's been worked out, evicted least recently used first
+class FlowFieldCache
+{
+private:
+    NavigationGrid mGrid;
+
+    // Each goal region's field, nullptr while it isn't cached. Only changed between the NPCs' updates, so
+    // they look fields up without a lock
+    vector<FlowField*> mFields;
+
+    // The cached fields, in no particular order
+    vector<FlowField*> mCached;
+
+    // The pins each uncached goal region's field gets once it's worked out, and the regions requested since
+    // the last pass, the first request for a region adds it to the list
+    vector<atomic<uint32_t>> mRequests;
+    vector<uint32_t> mPending;
+    atomic<uint32_t> mPendingCount;
+
+    // Counts the passes that work out the requested fields, the fields are stamped with the pass they were
+    // last acquired in
+    uint32_t mPass;
+
+    // The memory the fields may take and do take, and the most they've taken
+    size_t mBudget;
+    size_t mBytes;
+    size_t mPeakBytes;
+
+    // Fields found cached, worked out, evicted, and repaired
+    atomic<uint64_t> mHits;
+    uint64_t mMisses;
+    uint64_t mEvictions;
+    uint64_t mRepairs;
+
+    // Whether every repaired field is checked against one worked out from scratch, the field they're
+    // worked out in, and the repairs that didn't match
+    bool mVerifyingRepairs;
+    FlowField mReference;
+    uint32_t mRepairMismatches;
+
+    // The cells changed by the last obstacle, and the lists the fields are worked out and repaired with
+    vector<uint32_t> mChanged;
+    FlowOpenList mOpen;
+    vector<uint32_t> mInvalid;
+
+    /**
+    * Get the size a field takes on this grid.
+    * @return size_t The size in bytes.
+    */
+    size_t getFieldBytes() const;
+
+    /**
+    * Evict the least recently used field no NPC follows, skipping the fields worked out in this pass.
+    * @return FlowField* The evicted field to recycle, nullptr if every field is in use.
+    */
+    FlowField* evict();
+
+    /**
+    * Drop every cached field and request.
+    */
+    void clear();
+
+public:
+    /**
+    * Default Constructor, the cache is empty until it is initialized.
+    */
+    FlowFieldCache();
+
+    /**
+    * Destructor
+    */
+    ~FlowFieldCache();
+
+    /**
+    * Cover a world with a navigation grid, dropping every cached field.
+    * @param aWidth  - The world's width.
+    * @param aHeight - The world's height.
+    */
+    void init(const uint32_t& aWidth, const uint32_t& aHeight);
+
+    /**
+    * Set the memory the fields may take, the fields are evicted as others are worked out.
+    * @param aBudget - The budget in bytes.
+    */
+    void setBudget(const size_t& aBudget);
+
+    /**
+    * Set whether every repaired field is checked against one worked out from scratch, a debugging aid that
+    * makes each obstacle change cost a full field per cached field.
+    * @param aVerifying - True to check the repairs.
+    */
+    void setVerifyingRepairs(const bool& aVerifying);
+
+    /**
+    * Get the number of repaired fields that didn't match one worked out from scratch.
+    * @return uint32_t The mismatches.
+    */
+    uint32_t getRepairMismatches() const;
+
+    /**
+    * Add or remove an obstacle covering a rectangle, and repair every cached field. Must not be called while
+    * the NPCs are updated.
+    * @param aMin      - The rectangle's top left corner.
+    * @param aMax      - The rectangle's bottom right corner.
+    * @param aBlocking - True to add the obstacle, false to remove it.
+    */
+    void setBlocking(const Vector& aMin, const Vector& aMax, const bool& aBlocking);
+
+    /**
+    * Pin the field leading to the goal region containing a location, it isn't evicted until it's released.
+    * A field that isn't cached is requested instead, and pinned once it's worked out by the next update.
+    * Safe to call from any thread while the NPCs are updated, it neither locks nor allocates.
+    * @param aGoal - The location.
+    * @return FlowField* The field, nullptr if it was requested.
+    */
+    FlowField* acquire(const Vector& aGoal);
+
+    /**
+    * Get the cached field leading to the goal region containing a location, without pinning it. Safe to
+    * call from any thread while the NPCs are updated.
+    * @param aGoal - The location.
+    * @return FlowField* The field, nullptr if it isn't cached.
+    */
+    FlowField* find(const Vector& aGoal) const;
+
+    /**
+    * Release the pin an acquire took on a goal region's field, or withdraw its request. Safe to call from
+    * any thread while the NPCs are updated.
+    * @param aGoal - The location the field was acquired for.
+    */
+    void release(const Vector& aGoal);
+
+    /**
+    * Work out the fields requested since the last pass, evicting or recycling the least recently used ones
+    * that don't fit in the budget. Must be called on one thread, between the NPCs' updates.
+    */
+    void update();
+
+    /**
+    * Get the navigation grid.
+    * @return const NavigationGrid& The grid.
+    */
+    const NavigationGrid& getGrid() const;
+
+    /**
+    * Log the fields cached, the memory they take, and how often they were found cached.
+    */
+    void logStats();
+};
@@ -0,0 +1,258 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* FrameStats is a high resolution timing service built on SDL_GetPerformanceCounter. Every phase of the
+* frame keeps a rolling window of its most recent samples so the percentiles can be read at any time
+* without taking a lock.
+*/
+#include "PCH.h"
+#include "FrameStats.h"
+#include <SDL.h>
+
+
+atomic<uint64_t> FrameStats::sAccumulated[static_cast<size_t>(EFramePhase::COUNT)] = {};
+atomic<uint32_t> FrameStats::sTrades(0);
+atomic<uint32_t> FrameStats::sSkippedUpdates(0);
+atomic<float> FrameStats::sSamples[static_cast<size_t>(EFramePhase::COUNT)][FRAME_STATS_WINDOW] = {};
+atomic<uint32_t> FrameStats::sTradeSamples[FRAME_STATS_WINDOW] = {};
+atomic<uint32_t> FrameStats::sSkippedUpdateSamples[FRAME_STATS_WINDOW] = {};
+atomic<uint32_t> FrameStats::sFrameCount(0);
+atomic<float> FrameStats::sTileLength(0.f);
+atomic<float> FrameStats::sAverageOccupancy(0.f);
+atomic<uint32_t> FrameStats::sMaxOccupancy(0);
+
+
+/**
+* Get the current time of the performance counter.
+* @return uint64_t The performance counter ticks.
+*/
+uint64_t FrameStats::now()
+{
+    return SDL_GetPerformanceCounter();
+}
+
+
+/**
+* Convert performance counter ticks to milliseconds.
+* @param aTicks - The ticks to convert.
+* @return double The ticks in milliseconds.
+*/
+double FrameStats::toMilliseconds(const uint64_t& aTicks)
+{
+    static const double ticksPerMillisecond = SDL_GetPerformanceFrequency() / 1000.0;
+    return aTicks / ticksPerMillisecond;
+}
+
+
+/**
+* Add time to a phase of the current frame, safe to call from any thread.
+* @param aPhase - The phase the time was spent in.
+* @param aTicks - The performance counter ticks spent.
+*/
+void FrameStats::add(const EFramePhase& aPhase, const uint64_t& aTicks)
+{
+    sAccumulated[static_cast<size_t>(aPhase)].fetch_add(aTicks, memory_order_relaxed);
+}
+
+
+/**
+* Count trades made during the current frame, safe to call from any thread.
+* @param aTrades - The number of trades.
+*/
+void FrameStats::addTrades(const uint32_t& aTrades)
+{
+    sTrades.fetch_add(aTrades, memory_order_relaxed);
+}
+
+
+/**
+* Count entity updates the simulation level of detail skipped during the current frame, safe to call
+* from any thread.
+* @param aUpdates - The number of updates skipped.
+*/
+void FrameStats::addSkippedUpdates(const uint32_t& aUpdates)
+{
+    sSkippedUpdates.fetch_add(aUpdates, memory_order_relaxed);
+}
+
+
+/**
+* Set the world's subspace size and how full the subspaces are, called once per tick once the world is
+* ordered.
+* @param aTileLength       - The subspaces' side length.
+* @param aAverageOccupancy - The average number of entities in an occupied subspace.
+* @param aMaxOccupancy     - The most entities in one subspace.
+*/
+void FrameStats::setGridOccupancy(const float& aTileLength, const float& aAverageOccupancy, const uint32_t& aMaxOccupancy)
+{
+    sTileLength.store(aTileLength, memory_order_relaxed);
+    sAverageOccupancy.store(aAverageOccupancy, memory_order_relaxed);
+    sMaxOccupancy.store(aMaxOccupancy, memory_order_relaxed);
+}
+
+
+/**
+* Commit the current frame's accumulated times to the rolling windows, called once per frame by the
+* thread driving the main loop.
+* @param aFrameTicks - The ticks between the start of this frame and the start of the previous frame.
+*/
+void FrameStats::endFrame(const uint64_t& aFrameTicks)
+{
+    uint32_t slot = sFrameCount.load(memory_order_relaxed) % FRAME_STATS_WINDOW;
+
+    sAccumulated[static_cast<size_t>(EFramePhase::FRAME)].store(aFrameTicks, memory_order_relaxed);
+    for (size_t phase = 0; phase < static_cast<size_t>(EFramePhase::COUNT); ++phase)
+    {
+        uint64_t ticks = sAccumulated[phase].exchange(0, memory_order_relaxed);
+        sSamples[phase][slot].store(static_cast<float>(toMilliseconds(ticks)), memory_order_relaxed);
+    }
+    sTradeSamples[slot].store(sTrades.exchange(0, memory_order_relaxed), memory_order_relaxed);
+    sSkippedUpdateSamples[slot].store(sSkippedUpdates.exchange(0, memory_order_relaxed), memory_order_relaxed);
+
+    // Publish the frame once every sample in its slot is written
+    sFrameCount.fetch_add(1, memory_order_release);
+}
+
+
+/**
+* Get a percentile of a phase's rolling window.
+* @param aPhase      - The phase to read.
+* @param aPercentile - The percentile in [0, 1].
+* @return float The percentile in milliseconds.
+*/
+float FrameStats::getPercentile(const EFramePhase& aPhase, const float& aPercentile)
+{
+    uint32_t count = min(sFrameCount.load(memory_order_acquire), FRAME_STATS_WINDOW);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    float samples[FRAME_STATS_WINDOW];
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        samples[i] = sSamples[static_cast<size_t>(aPhase)][i].load(memory_order_relaxed);
+    }
+
+    uint32_t rank = min(static_cast<uint32_t>(aPercentile * count), count - 1);
+    nth_element(samples, samples + rank, samples + count);
+    return samples[rank];
+}
+
+
+/**
+* Get the sample of a phase committed last.
+* @param aPhase - The phase to read.
+* @return float The phase's time in the last committed frame in milliseconds.
+*/
+float FrameStats::getLastSample(const EFramePhase& aPhase)
+{
+    uint32_t count = sFrameCount.load(memory_order_acquire);
+    if (count == 0)
+    {
+        return 0;
+    }
+    return sSamples[static_cast<size_t>(aPhase)][(count - 1) % FRAME_STATS_WINDOW].load(memory_order_relaxed);
+}
+
+
+/**
+* Get the mean of a phase's rolling window.
+* @param aPhase - The phase to read.
+* @return float The mean in milliseconds.
+*/
+float FrameStats::getMean(const EFramePhase& aPhase)
+{
+    uint32_t count = min(sFrameCount.load(memory_order_acquire), FRAME_STATS_WINDOW);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    float total = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        total += sSamples[static_cast<size_t>(aPhase)][i].load(memory_order_relaxed);
+    }
+    return total / count;
+}
+
+
+/**
+* Get the average number of trades per second over the rolling window.
+* @return float Trades per second.
+*/
+float FrameStats::getTradesPerSecond()
+{
+    uint32_t count = min(sFrameCount.load(memory_order_acquire), FRAME_STATS_WINDOW);
+
+    float milliseconds = 0;
+    uint64_t trades = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        milliseconds += sSamples[static_cast<size_t>(EFramePhase::FRAME)][i].load(memory_order_relaxed);
+        trades += sTradeSamples[i].load(memory_order_relaxed);
+    }
+    return (milliseconds > 0) ? ((trades * 1000.f) / milliseconds) : (0.f);
+}
+
+
+/**
+* Get the average number of entity updates skipped per second over the rolling window.
+* @return float Updates saved per second.
+*/
+float FrameStats::getSkippedUpdatesPerSecond()
+{
+    uint32_t count = min(sFrameCount.load(memory_order_acquire), FRAME_STATS_WINDOW);
+
+    float milliseconds = 0;
+    uint64_t updates = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        milliseconds += sSamples[static_cast<size_t>(EFramePhase::FRAME)][i].load(memory_order_relaxed);
+        updates += sSkippedUpdateSamples[i].load(memory_order_relaxed);
+    }
+    return (milliseconds > 0) ? ((updates * 1000.f) / milliseconds) : (0.f);
+}
+
+
+/**
+* Get the world's subspace side length as of the last tick.
+* @return float The side length.
+*/
+float FrameStats::getTileLength()
+{
+    return sTileLength.load(memory_order_relaxed);
+}
+
+
+/**
+* Get the average number of entities in an occupied subspace as of the last tick.
+* @return float The average occupancy.
+*/
+float FrameStats::getAverageOccupancy()
+{
+    return sAverageOccupancy.load(memory_order_relaxed);
+}
+
+
+/**
+* Get the most entities in one subspace as of the last tick.
+* @return uint32_t The max occupancy.
+*/
+uint32_t FrameStats::getMaxOccupancy()
+{
+    return sMaxOccupancy.load(memory_order_relaxed);
+}
+
+
+/**
+* Get the number of frames committed so far.
+* @return uint32_t The frame count.
+*/
+uint32_t FrameStats::getFrameCount()
+{
+    return sFrameCount.load(memory_order_acquire);
+}
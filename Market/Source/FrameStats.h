@@ -0,0 +1,183 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* FrameStats is a high resolution timing service built on SDL_GetPerformanceCounter. Every phase of the
+* frame keeps a rolling window of its most recent samples so the percentiles can be read at any time
+* without taking a lock.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// The measured phases, ORDER and TRADE are summed over every worker thread so they are CPU time
+enum class EFramePhase
+{
+    FRAME,
+    UPDATE,
+    ORDER,
+    TRADE,
+    RENDER,
+    COUNT
+};
+
+
+// Number of frames kept in each phase's rolling window
+constexpr uint32_t FRAME_STATS_WINDOW = 256;
+
+
+class FrameStats
+{
+private:
+    // Time accumulated in each phase during the current frame, in performance counter ticks
+    static atomic<uint64_t> sAccumulated[static_cast<size_t>(EFramePhase::COUNT)];
+    static atomic<uint32_t> sTrades;
+    static atomic<uint32_t> sSkippedUpdates;
+
+    // Rolling windows of each phase's per frame time in milliseconds, and of the trades made and entity
+    // updates skipped each frame
+    static atomic<float> sSamples[static_cast<size_t>(EFramePhase::COUNT)][FRAME_STATS_WINDOW];
+    static atomic<uint32_t> sTradeSamples[FRAME_STATS_WINDOW];
+    static atomic<uint32_t> sSkippedUpdateSamples[FRAME_STATS_WINDOW];
+
+    // Number of frames committed to the windows
+    static atomic<uint32_t> sFrameCount;
+
+    // The world's subspace side length, and the average and most entities in an occupied subspace, as of
+    // the last tick
+    static atomic<float> sTileLength;
+    static atomic<float> sAverageOccupancy;
+    static atomic<uint32_t> sMaxOccupancy;
+
+public:
+    /**
+    * Get the current time of the performance counter.
+    * @return uint64_t The performance counter ticks.
+    */
+    static uint64_t now();
+
+    /**
+    * Convert performance counter ticks to milliseconds.
+    * @param aTicks - The ticks to convert.
+    * @return double The ticks in milliseconds.
+    */
+    static double toMilliseconds(const uint64_t& aTicks);
+
+    /**
+    * Add time to a phase of the current frame, safe to call from any thread.
+    * @param aPhase - The phase the time was spent in.
+    * @param aTicks - The performance counter ticks spent.
+    */
+    static void add(const EFramePhase& aPhase, const uint64_t& aTicks);
+
+    /**
+    * Count trades made during the current frame, safe to call from any thread.
+    * @param aTrades - The number of trades.
+    */
+    static void addTrades(const uint32_t& aTrades);
+
+    /**
+    * Count entity updates the simulation level of detail skipped during the current frame, safe to call
+    * from any thread.
+    * @param aUpdates - The number of updates skipped.
+    */
+    static void addSkippedUpdates(const uint32_t& aUpdates);
+
+    /**
+    * Set the world's subspace size and how full the subspaces are, called once per tick once the world
+    * is ordered.
+    * @param aTileLength       - The subspaces' side length.
+    * @param aAverageOccupancy - The average number of entities in an occupied subspace.
+    * @param aMaxOccupancy     - The most entities in one subspace.
+    */
+    static void setGridOccupancy(const float& aTileLength, const float& aAverageOccupancy, const uint32_t& aMaxOccupancy);
+
+    /**
+    * Commit the current frame's accumulated times to the rolling windows, called once per frame by the
+    * thread driving the main loop.
+    * @param aFrameTicks - The ticks between the start of this frame and the start of the previous frame.
+    */
+    static void endFrame(const uint64_t& aFrameTicks);
+
+    /**
+    * Get a percentile of a phase's rolling window.
+    * @param aPhase      - The phase to read.
+    * @param aPercentile - The percentile in [0, 1].
+    * @return float The percentile in milliseconds.
+    */
+    static float getPercentile(const EFramePhase& aPhase, const float& aPercentile);
+
+    /**
+    * Get the sample of a phase committed last.
+    * @param aPhase - The phase to read.
+    * @return float The phase's time in the last committed frame in milliseconds.
+    */
+    static float getLastSample(const EFramePhase& aPhase);
+
+    /**
+    * Get the mean of a phase's rolling window.
+    * @param aPhase - The phase to read.
+    * @return float The mean in milliseconds.
+    */
+    static float getMean(const EFramePhase& aPhase);
+
+    /**
+    * Get the average number of trades per second over the rolling window.
+    * @return float Trades per second.
+    */
+    static float getTradesPerSecond();
+
+    /**
+    * Get the average number of entity updates skipped per second over the rolling window.
+    * @return float Updates saved per second.
+    */
+    static float getSkippedUpdatesPerSecond();
+
+    /**
+    * Get the world's subspace side length as of the last tick.
+    * @return float The side length.
+    */
+    static float getTileLength();
+
+    /**
+    * Get the average number of entities in an occupied subspace as of the last tick.
+    * @return float The average occupancy.
+    */
+    static float getAverageOccupancy();
+
+    /**
+    * Get the most entities in one subspace as of the last tick.
+    * @return uint32_t The max occupancy.
+    */
+    static uint32_t getMaxOccupancy();
+
+    /**
+    * Get the number of frames committed so far.
+    * @return uint32_t The frame count.
+    */
+    static uint32_t getFrameCount();
+};
+
+
+/**
+* Adds the time spent in its lifetime to a phase of the current frame.
+*/
+class FrameStatsScope
+{
+private:
+    EFramePhase mPhase;
+    uint64_t mStart;
+
+public:
+    explicit FrameStatsScope(const EFramePhase& aPhase)
+    {
+        mPhase = aPhase;
+        mStart = FrameStats::now();
+    }
+
+    ~FrameStatsScope()
+    {
+        FrameStats::add(mPhase, FrameStats::now() - mStart);
+    }
+};
@@ -8,6 +8,10 @@
 #include "PCH.h"
 #include "Game.h"
 #include "ThreadSafeRNG.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include "TradeEvents.h"
+#include "FrameStats.h"
 
 
 // Constructor
@@ -17,13 +21,39 @@ Game::Game()
     mLoading = true;
     mInitSuccess = true;
     mCurrLoadingFrame = 0;
+    mFrameDt = 0;
+    mTick = 0;
+    mRestorePath = nullptr;
+    mRestored = false;
+    mCompositing = false;
+    mWorldWidth = 0;
+    mWorldHeight = 0;
+    mDistantTickRatio = SIMULATION_LOD_DISTANT_RATIO;
+    mSkippedUpdates = 0;
+    mNPCPool = nullptr;
+    mReorderingEntities = true;
+    mSeed = 0;
+    mObstacleCount = 0;
+    mToggledObstacle = 0;
+    mNeighborRadius = 0;
+    mNeighborsFound = 0;
 }
 
 
-// Loads the game objects and renders the loading screen while they are initializing
-bool Game::start(SDLManager* aSDL)
+// Set the world's dimensions, must be called before start, the world matches the window otherwise
+void Game::setWorldSize(const uint32_t& aWidth, const uint32_t& aHeight)
 {
-    srand(static_cast<unsigned>(time(0)));
+    mWorldWidth = aWidth;
+    mWorldHeight = aHeight;
+}
+
+
+// Loads the game objects and renders the loading screen while they are initializing, the market is
+// restored from the world snapshot at the given path if there is one
+bool Game::start(SDLManager* aSDL, const char* aRestorePath)
+{
+    srand((mSeed) ? (mSeed) : (static_cast<unsigned>(time(0))));
+    mRestorePath = aRestorePath;
 
     // Success status of this function
     bool success = true;
@@ -50,6 +80,19 @@ bool Game::start(SDLManager* aSDL)
         }
         else
         {
+            // The calling thread takes part in every job, so leave it a core
+            uint32_t hardwareThreads = thread::hardware_concurrency();
+            mThreadPool.init((hardwareThreads > 1) ? (hardwareThreads - 1) : (1));
+
+            // Every trade is streamed to the statistics, the trade log, and the overlay
+            TradeEvents::addConsumer(&mTradeStatistics);
+            if (mTradeLog.open(TRADE_LOG_PATH))
+            {
+                TradeEvents::addConsumer(&mTradeLog);
+            }
+            TradeEvents::addConsumer(&mHUD);
+            TradeEvents::start();
+
             std::thread initThread(&Game::init, this, backgroundScale);
 
             // Game running flag
@@ -120,13 +163,18 @@ bool Game::start(SDLManager* aSDL)
 // Initialize the game world
 void Game::init(const float& aBackgroundScale)
 {
-    if (!mWorld.init())
+    uint32_t worldWidth = (mWorldWidth) ? (mWorldWidth) : (static_cast<uint32_t>(SDLManager::mWindowWidth));
+    uint32_t worldHeight = (mWorldHeight) ? (mWorldHeight) : (static_cast<uint32_t>(SDLManager::mWindowHeight));
+    // The world holds a rug and an NPC per ENTITY_COUNT, its subspaces are sized for them
+    if (!mWorld.init(worldWidth, worldHeight, static_cast<size_t>(ENTITY_COUNT) * 2))
     {
         // cout << "Failed to initialize the World!\n";
         mInitSuccess = false;
     }
     else
     {
+        mCamera.init(SDLManager::mWindowWidth, SDLManager::mWindowHeight, worldWidth, worldHeight);
+
         // Load the rugs shared resources
         mRugTexture.initTexture(sdl->getRenderer());
         if (!mRugTexture.loadFromFile("assets/rug.png"))
@@ -156,6 +204,11 @@ void Game::init(const float& aBackgroundScale)
                 rugs.push_back(new Rug());
                 rugs[i]->init(&mRugTexture, mRugFrames, mWorld);
             }
+            mWorld.buildRugIndex(rugs);
+            if (mObstacleCount > 0)
+            {
+                mWorld.generateObstacles(mObstacleCount, rugs);
+            }
 
             // Load the NPCs shared resources
             mNPCTexture.initTexture(sdl->getRenderer());
@@ -180,11 +233,28 @@ void Game::init(const float& aBackgroundScale)
                     }
                 }
 
-                // Create unique NPCs
+                // Create unique NPCs, every NPC starts in the storage slot matching its handle
+                mNPCPool = new NPC[ENTITY_COUNT];
                 for (uint16_t i = 0; i < ENTITY_COUNT; ++i)
                 {
-                    npcs.push_back(new NPC());
+                    npcs.push_back(&mNPCPool[i]);
                     npcs[i]->init(&mNPCTexture, mNPCFrames, &mWorld);
+                    mSlotHandles.push_back(i);
+                }
+                mRandomValues.resize(static_cast<size_t>(ENTITY_COUNT) * 2);
+
+                // Resize the subspaces if the market's population is far from what the world was sized for
+                mWorld.regrid(rugs, npcs);
+
+                // Room to sort and move the NPCs' storage without allocating during a frame
+                mReorderCodes.resize(ENTITY_COUNT);
+                mReorderPositions.resize(ENTITY_COUNT);
+                mReorderContents.resize(ENTITY_COUNT);
+                mReorderHandles.resize(ENTITY_COUNT);
+                if (mReorderingEntities && !mEntityReorder.init(ENTITY_COUNT))
+                {
+                    // cout << "Failed to start the entity reorder thread!\n";
+                    mReorderingEntities = false;
                 }
 
                 // Load the background and scale it to fit the screen
@@ -204,7 +274,14 @@ void Game::init(const float& aBackgroundScale)
                     // Order the world partitions in different threads
                     vector<thread> localThreads;
 
+                    // A restored market is already warm
+                    if (mRestorePath && restoreSnapshot(mRestorePath))
+                    {
+                        mRestored = true;
+                        mThreadPool.run(static_cast<uint32_t>(PARTITION_COUNT), &Game::orderPartitionTask, this);
+                    }
                     // warm up the game so it starts smoothly
+                    else
                     {
                         update(1.f);
                         update(1.f);
@@ -289,6 +366,13 @@ bool Game::initLoadingScreen(const float& aBackgroundScale)
 }
 
 
+// Set how many ticks apart the regions distant from the camera step, 1 simulates every region every tick
+void Game::setDistantTickRatio(const uint32_t& aRatio)
+{
+    mDistantTickRatio = max(aRatio, 1u);
+}
+
+
 // Handle's user events
 bool Game::handleEvent(SDL_Event& e)
 {
@@ -297,6 +381,41 @@ bool Game::handleEvent(SDL_Event& e)
         return true;
     }
 
+    // Pan the camera with the arrow keys, held keys keep panning, and show the whole window's worth of the
+    // world's top left corner again with home
+    if (e.type == SDL_KEYDOWN)
+    {
+        switch (e.key.keysym.sym)
+        {
+        case SDLK_LEFT:
+            mCamera.pan(-CAMERA_PAN_STEP * SDLManager::mWindowWidth, 0);
+            break;
+        case SDLK_RIGHT:
+            mCamera.pan(CAMERA_PAN_STEP * SDLManager::mWindowWidth, 0);
+            break;
+        case SDLK_UP:
+            mCamera.pan(0, -CAMERA_PAN_STEP * SDLManager::mWindowHeight);
+            break;
+        case SDLK_DOWN:
+            mCamera.pan(0, CAMERA_PAN_STEP * SDLManager::mWindowHeight);
+            break;
+        case SDLK_HOME:
+            mCamera.reset();
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Zoom the camera in and out around the mouse with the mouse wheel
+    if (e.type == SDL_MOUSEWHEEL && e.wheel.y != 0)
+    {
+        int mouseX = 0;
+        int mouseY = 0;
+        SDL_GetMouseState(&mouseX, &mouseY);
+        mCamera.zoomAt((e.wheel.y > 0) ? (CAMERA_ZOOM_STEP) : (1.f / CAMERA_ZOOM_STEP), static_cast<float>(mouseX), static_cast<float>(mouseY));
+    }
+
     // If someone pressed a key
     if (e.type == SDL_KEYDOWN && e.key.repeat == 0)
     {
@@ -305,6 +424,124 @@ bool Game::handleEvent(SDL_Event& e)
         case SDLK_ESCAPE:
             return true;
             break;
+
+        // Toggle the performance overlay
+        case SDLK_F1:
+            mHUD.toggle();
+            break;
+
+        // Toggle the trace capture, the capture is written out when it stops
+        case SDLK_F2:
+            if (Trace::isEnabled())
+            {
+                Trace::stop(TRACE_FILE_PATH);
+            }
+            else
+            {
+                Trace::start();
+            }
+            break;
+
+        // Toggle the per second lock contention report
+        case SDLK_F3:
+            ProfiledMutex::setReporting(!ProfiledMutex::isReporting());
+            break;
+
+        // Toggle the hardware counter phase profile, the totals are logged when it stops
+        case SDLK_F4:
+            if (PerfCounters::isEnabled())
+            {
+                PerfCounters::stop();
+            }
+            else
+            {
+                PerfCounters::start();
+            }
+            break;
+
+        // Switch between polling the world partitions for trades and predicting them with the trade scheduler
+        case SDLK_F5:
+            if (mTradeScheduler.isEnabled())
+            {
+                mTradeScheduler.stop();
+                mWorld.setPolledTrading(true);
+                SDL_Log("Trades: polled");
+            }
+            else
+            {
+                mTradeScheduler.start(npcs, rugs, mWorld.getRugIndex());
+                mWorld.setPolledTrading(false);
+                SDL_Log("Trades: scheduled");
+            }
+            break;
+
+        // Save the market to the world snapshot
+        case SDLK_F6:
+            if (saveSnapshot(WORLD_SNAPSHOT_FILE_PATH))
+            {
+                SDL_Log("Snapshot: saved %s on tick %u", WORLD_SNAPSHOT_FILE_PATH, mTick);
+            }
+            break;
+
+        // Toggle recording every tick to the replay
+        case SDLK_F7:
+            if (mReplayRecorder.isRecording())
+            {
+                mReplayRecorder.stop();
+                SDL_Log("Replay: recorded %s", REPLAY_FILE_PATH);
+            }
+            else if (!mReplayPlayer.isPlaying() && mReplayRecorder.start(REPLAY_FILE_PATH, static_cast<uint32_t>(npcs.size()), static_cast<uint32_t>(rugs.size())))
+            {
+                SDL_Log("Replay: recording");
+            }
+            break;
+
+        // Toggle playing the replay back in place of the simulation
+        case SDLK_F8:
+            if (mReplayPlayer.isPlaying())
+            {
+                stopReplay();
+            }
+            else
+            {
+                startReplay(REPLAY_FILE_PATH);
+            }
+            break;
+
+        // Restore the market from the world snapshot
+        case SDLK_F9:
+            if (restoreSnapshot(WORLD_SNAPSHOT_FILE_PATH))
+            {
+                SDL_Log("Snapshot: restored %s on tick %u", WORLD_SNAPSHOT_FILE_PATH, mTick);
+            }
+            break;
+
+        // Switch between the sprite compositor and drawing every sprite with the renderer
+        case SDLK_F10:
+            if (setCompositing(!mCompositing))
+            {
+                SDL_Log("Render: %s", (mCompositing) ? ("compositor") : ("renderer"));
+            }
+            break;
+
+        // Switch the spatial index the world answers neighbor queries from
+        case SDLK_F11:
+            setWorldBackend((mWorld.getBackend() == EWorldBackend::GRID) ? (EWorldBackend::QUADTREE) : (EWorldBackend::GRID));
+            SDL_Log("World: %s backend", World::getBackendName(mWorld.getBackend()));
+            break;
+
+        // Take the next obstacle down, or put it back up, the flow fields are repaired around it
+        case SDLK_o:
+            if (!mWorld.getObstacles().empty())
+            {
+                uint32_t obstacle = mToggledObstacle++ % static_cast<uint32_t>(mWorld.getObstacles().size());
+                bool standing = !mWorld.getObstacles()[obstacle].mStanding;
+                uint64_t start = FrameStats::now();
+                mWorld.setObstacleStanding(obstacle, standing);
+                SDL_Log("Obstacles: %s %u, flow fields repaired in %.3f ms", (standing) ? ("put up") : ("took down"), obstacle,
+                    FrameStats::toMilliseconds(FrameStats::now() - start));
+            }
+            break;
         default:
             // cout << "Unhandled Key!\n";
             break;
@@ -315,55 +552,540 @@ bool Game::handleEvent(SDL_Event& e)
 }
 
 
+// Set the seed the market is generated from, must be called before start, 0 seeds it from the clock
+void Game::setSeed(const uint32_t& aSeed)
+{
+    mSeed = aSeed;
+}
+
+
+// Whether the market is the same every run, restored from a world snapshot or generated from a set seed
+bool Game::isReproducible()
+{
+    return mRestored || (mSeed != 0 && !mRestorePath);
+}
+
+
+// Set where the generated market's rugs are placed and its NPCs walk to, must be called before start
+void Game::setWorldLayout(const EWorldLayout& aLayout)
+{
+    mWorld.setLayout(aLayout);
+}
+
+
+// Set the spatial index the world answers neighbor queries from, the quadtree is built on the next update
+void Game::setWorldBackend(const EWorldBackend& aBackend)
+{
+    mWorld.setBackend(aBackend);
+}
+
+
+// Get the world's spatial index
+EWorldBackend Game::getWorldBackend()
+{
+    return mWorld.getBackend();
+}
+
+
+// Get where the market is laid out
+EWorldLayout Game::getWorldLayout()
+{
+    return mWorld.getLayout();
+}
+
+
+// Set the way the trade pairs are found, must be called before start
+void Game::setBroadphase(const EBroadphase& aBroadphase)
+{
+    mWorld.setBroadphase(aBroadphase);
+}
+
+
+// Get the way the trade pairs are found
+EBroadphase Game::getBroadphase()
+{
+    return mWorld.getBroadphase();
+}
+
+
+// Set whether every broadphase's trade pairs are checked against brute force's each tick
+void Game::setVerifyingBroadphases(const bool& aVerifying)
+{
+    mWorld.setVerifyingBroadphases(aVerifying);
+}
+
+
+// Get the number of ticks a broadphase's trade pairs didn't match brute force's
+uint32_t Game::getBroadphaseMismatches()
+{
+    return mWorld.getBroadphaseMismatches();
+}
+
+
+// Set whether every flow field repaired around an obstacle is checked against one worked out from scratch
+void Game::setVerifyingFlowFields(const bool& aVerifying)
+{
+    mWorld.setVerifyingFlowFields(aVerifying);
+}
+
+
+// Get the number of repaired flow fields that didn't match one worked out from scratch
+uint32_t Game::getFlowFieldMismatches()
+{
+    return mWorld.getFlowFieldMismatches();
+}
+
+
+// Set whether the NPCs walk to the closest rug trading a good other than theirs, must be called before start
+void Game::setSeekingRugs(const bool& aSeekingRugs)
+{
+    mWorld.setSeekingRugs(aSeekingRugs);
+}
+
+
+// Get whether the NPCs walk to the closest rug trading a good other than theirs
+bool Game::isSeekingRugs()
+{
+    return mWorld.isSeekingRugs();
+}
+
+
+// Set the number of stalls and walls the market is generated with, must be called before start
+void Game::setObstacleCount(const uint32_t& aCount)
+{
+    mObstacleCount = aCount;
+}
+
+
+// Get the number of obstacles in the market
+uint32_t Game::getObstacleCount()
+{
+    return static_cast<uint32_t>(mWorld.getObstacles().size());
+}
+
+
+// Set whether the NPCs follow flow fields around the obstacles, must be called before start
+void Game::setFlowNavigating(const bool& aFlowNavigating)
+{
+    mWorld.setFlowNavigating(aFlowNavigating);
+}
+
+
+// Get whether the NPCs follow flow fields around the obstacles
+bool Game::isFlowNavigating()
+{
+    return mWorld.isFlowNavigating();
+}
+
+
+// Set the memory in bytes the cached flow fields may take
+void Game::setFlowFieldBudget(const size_t& aBudget)
+{
+    mWorld.setFlowFieldBudget(aBudget);
+}
+
+
+// Find every NPC's neighbors within a radius in the world's spatial index, spread across the thread pool,
+// and return the total found
+uint64_t Game::queryAllNeighbors(const float& aRadius)
+{
+    TRACE_SCOPE("Game::queryAllNeighbors");
+    mNeighborRadius = aRadius;
+    mNeighborsFound = 0;
+    mThreadPool.run(static_cast<uint32_t>(npcs.size()), &Game::queryNeighborsTask, this);
+    return mNeighborsFound;
+}
+
+
+// Set whether the NPCs' storage is re-sorted along the Morton curve, must be called before start
+void Game::setReorderingEntities(const bool& aReordering)
+{
+    mReorderingEntities = aReordering;
+}
+
+
+// Whether the NPCs' storage is re-sorted along the Morton curve
+bool Game::isReorderingEntities()
+{
+    return mReorderingEntities;
+}
+
+
+// Apply a finished sort of the NPCs' storage, and request the next one every few ticks
+void Game::reorderEntities()
+{
+    if (!mReorderingEntities)
+    {
+        return;
+    }
+
+    if (mEntityReorder.isReady())
+    {
+        TRACE_SCOPE("Game::reorderEntities");
+        const vector<uint32_t>& order = mEntityReorder.getOrder();
+
+        // Move the NPCs into the sorted order with swaps, tracking the slot each NPC is in while they move,
+        // order holds the slot each NPC comes from
+        for (uint32_t slot = 0; slot < ENTITY_COUNT; ++slot)
+        {
+            mReorderPositions[slot] = slot;
+            mReorderContents[slot] = slot;
+        }
+        for (uint32_t slot = 0; slot < ENTITY_COUNT; ++slot)
+        {
+            uint32_t source = mReorderPositions[order[slot]];
+            if (source != slot)
+            {
+                mNPCPool[slot].swapState(mNPCPool[source]);
+
+                // The NPC that was in this slot is now in the source slot
+                uint32_t displaced = mReorderContents[slot];
+                mReorderPositions[displaced] = source;
+                mReorderContents[source] = displaced;
+            }
+            mReorderPositions[order[slot]] = slot;
+            mReorderContents[slot] = order[slot];
+            mReorderHandles[slot] = mSlotHandles[order[slot]];
+        }
+
+        // Point every handle at its NPC's new slot, and rebuild the subspaces that held the old addresses
+        for (uint32_t slot = 0; slot < ENTITY_COUNT; ++slot)
+        {
+            mSlotHandles[slot] = mReorderHandles[slot];
+            npcs[mSlotHandles[slot]] = &mNPCPool[slot];
+        }
+        mWorld.rebuildSubspaces(rugs, mNPCPool, ENTITY_COUNT);
+        mEntityReorder.finish();
+    }
+    else if ((mTick % ENTITY_REORDER_INTERVAL) == 0)
+    {
+        for (uint32_t slot = 0; slot < ENTITY_COUNT; ++slot)
+        {
+            mReorderCodes[slot] = mWorld.getMortonCode(mNPCPool[slot].getSubspace());
+        }
+        mEntityReorder.request(mReorderCodes);
+    }
+}
+
+
 // Update the game world
 void Game::update(const float& dt)
 {
-    for (uint16_t i = 0; i < ENTITY_COUNT; ++i)
+    TRACE_SCOPE("Game::update");
+    mFrameDt = dt;
+    TradeEvents::setTick(++mTick);
+
+    // Between ticks nothing else is using the NPCs, so their storage can move
+    reorderEntities();
+
+    // Play the replay's next tick back instead of simulating one, the partitions are still ordered for rendering
+    if (mReplayPlayer.isPlaying())
+    {
+        if (mReplayPlayer.next())
+        {
+            TRACE_SCOPE("Game::update replay");
+            mReplayPlayer.apply(npcs, rugs, dt);
+            Rug::updateCooldowns(dt);
+            mThreadPool.run(static_cast<uint32_t>(PARTITION_COUNT), &Game::orderPartitionTask, this);
+            mWorld.reportOccupancy();
+            mWorld.updateSpatialIndex(rugs, npcs);
+            return;
+        }
+        stopReplay();
+    }
+
+    // Draw every NPC's random values up front, in NPC order
+    for (float& randomValue : mRandomValues)
+    {
+        randomValue = Rand_ThreadSafeRNG();
+    }
+
+    // Move the entities, then order each world partition and collect its trades once every entity has moved,
+    // and make the trades in order
+    {
+        TRACE_SCOPE("Game::update NPCs");
+        mWorld.updateSimulationLOD(mCamera);
+        mThreadPool.run(static_cast<uint32_t>(npcs.size()), &Game::updateNPCTask, this);
+        FrameStats::addSkippedUpdates(mSkippedUpdates.exchange(0, memory_order_relaxed));
+        mWorld.updateSpatialIndex(rugs, npcs);
+
+        // The flow fields the NPCs requested are worked out here, not while the NPCs wait on each other
+        mWorld.updateFlowFields();
+    }
+    Rug::updateCooldowns(dt);
+    {
+        TRACE_SCOPE("Game::update partitions");
+        mThreadPool.run(static_cast<uint32_t>(PARTITION_COUNT), &Game::orderPartitionTask, this);
+    }
+    mWorld.reportOccupancy();
+    mWorld.resolveTrades(npcs);
+    mWorld.verifyBroadphases(npcs);
+    mTradeScheduler.update(dt);
+
+    mReplayRecorder.capture(npcs, rugs, mTick);
+}
+
+
+// Play a replay back in place of the simulation, stops recording
+bool Game::startReplay(const char* aPath)
+{
+    mReplayRecorder.stop();
+    if (!mReplayPlayer.open(aPath, static_cast<uint32_t>(npcs.size()), static_cast<uint32_t>(rugs.size())))
+    {
+        SDL_Log("Replay: failed to open %s", aPath);
+        return false;
+    }
+
+    // The replay already holds the trades, so nothing trades while it plays
+    mTradeScheduler.stop();
+    mWorld.setPolledTrading(false);
+    SDL_Log("Replay: playing %s", aPath);
+    return true;
+}
+
+
+// Whether a replay is playing
+bool Game::isPlayingReplay()
+{
+    return mReplayPlayer.isPlaying();
+}
+
+
+// Stop playing the replay and hand the entities back to the simulation
+void Game::stopReplay()
+{
+    mReplayPlayer.close();
+    mWorld.setPolledTrading(true);
+    SDL_Log("Replay: stopped");
+}
+
+
+// Save the market to a world snapshot
+bool Game::saveSnapshot(const char* aPath)
+{
+    uint64_t seed;
+    uint64_t draws;
+    string rngState;
+    Save_ThreadSafeRNG(seed, draws, rngState);
+
+    bool success = WorldSnapshot::save(aPath, npcs, rugs, mWorld, mTick, seed, draws, rngState);
+    if (!success)
+    {
+        SDL_Log("Snapshot: failed to save %s", aPath);
+    }
+    return success;
+}
+
+
+// Restore the market from a world snapshot, the market is unchanged if it can't be restored
+bool Game::restoreSnapshot(const char* aPath)
+{
+    WorldSnapshot snapshot;
+    if (!snapshot.open(aPath, static_cast<uint32_t>(npcs.size()), static_cast<uint32_t>(rugs.size()), mWorld))
     {
-        threads.push_back(thread(&NPC::update, npcs[i], dt, Rand_ThreadSafeRNG(), Rand_ThreadSafeRNG()));
-        threads.push_back(thread(&Rug::update, rugs[i], dt));
+        SDL_Log("Snapshot: failed to open %s", aPath);
+        return false;
     }
 
-    // Order each world parition in seperate threads
-    threads.push_back(thread(&World::orderWorld, &mWorld, EWorldPartition::LEFT));
-    threads.push_back(thread(&World::orderWorld, &mWorld, EWorldPartition::CENTER));
-    threads.push_back(thread(&World::orderWorld, &mWorld, EWorldPartition::RIGHT));
+    const WorldSnapshotHeader& header = snapshot.getHeader();
+    if (!Restore_ThreadSafeRNG(header.mRNGSeed, header.mRNGDraws, snapshot.getRNGState()))
+    {
+        SDL_Log("Snapshot: failed to restore the random number generator from %s", aPath);
+        return false;
+    }
+
+    if (mReplayPlayer.isPlaying())
+    {
+        stopReplay();
+    }
 
-    for (thread& thread : threads)
+    snapshot.restore(npcs, rugs, mWorld);
+    mWorld.updateFlowFields();
+    mWorld.regrid(rugs, npcs);
+    mWorld.resetSpatialIndex();
+    mWorld.buildRugIndex(rugs);
+    mTick = header.mTick;
+    TradeEvents::setTick(mTick);
+
+    // Every predicted contact is out of date
+    if (mTradeScheduler.isEnabled())
     {
-            thread.join();
+        mTradeScheduler.stop();
+        mTradeScheduler.start(npcs, rugs, mWorld.getRugIndex());
     }
 
-    threads.clear();
+    return true;
 }
 
 
 // Render the game world
 void Game::render()
 {
-    mBackgroundTexture.render(0, 0);
+    TRACE_SCOPE("Game::render");
+
+    // The compositor records the draws, and draws the background, the rugs, then the world partitions in
+    // their own layers
+    if (mCompositing)
+    {
+        mCompositor.begin();
+        Texture::setCompositor(&mCompositor);
+    }
+
+    // The background is tiled across the world, only the tiles in view are drawn
+    Vector viewMin;
+    Vector viewMax;
+    mCamera.getView(viewMin, viewMax);
+    float tileWidth = mBackgroundTexture.getWidth();
+    float tileHeight = mBackgroundTexture.getHeight();
+    if (tileWidth > 0 && tileHeight > 0)
+    {
+        for (float y = floor(viewMin.y / tileHeight) * tileHeight; y < viewMax.y; y += tileHeight)
+        {
+            for (float x = floor(viewMin.x / tileWidth) * tileWidth; x < viewMax.x; x += tileWidth)
+            {
+                mBackgroundTexture.render(mCamera.toScreenX(x), mCamera.toScreenY(y), nullptr, 0, nullptr, SDL_FLIP_NONE, mCamera.getZoom());
+            }
+        }
+    }
 
+    // Only the rugs whose sprite reaches into the view
+    const float rugReach = RUG_FRAME_WIDTH * RUG_SCALE;
+    mCompositor.setLayer(1);
     for (Rug* rug : rugs)
     {
-        rug->renderFull();
+        Vector location = rug->getLocation();
+        if (location.x + rugReach >= viewMin.x && location.x - rugReach <= viewMax.x && location.y + rugReach >= viewMin.y && location.y - rugReach <= viewMax.y)
+        {
+            rug->renderFull(mCamera);
+        }
     }
 
-    // Render each world parition in seperate threads
-    threads.push_back(thread(&World::render, &mWorld, EWorldPartition::LEFT));
-    threads.push_back(thread(&World::render, &mWorld, EWorldPartition::CENTER));
-    threads.push_back(thread(&World::render, &mWorld, EWorldPartition::RIGHT));
+    // Render each world parition on the thread pool
+    mCompositor.setLayer(2);
+    mThreadPool.run(static_cast<uint32_t>(PARTITION_COUNT), &Game::renderPartitionTask, this);
+
+    if (mCompositing)
+    {
+        Texture::setCompositor(nullptr);
+        mCompositor.present(sdl->getRenderer(), mThreadPool);
+    }
 
-    for (thread& thread : threads)
+    // The standing obstacles in view are drawn over the market, the NPCs walk around them
+    SDL_SetRenderDrawColor(sdl->getRenderer(), 0x6B, 0x4F, 0x2F, 0xFF);
+    for (const WorldObstacle& obstacle : mWorld.getObstacles())
     {
-        thread.join();
+        if (obstacle.mStanding && obstacle.mMax.x >= viewMin.x && obstacle.mMin.x <= viewMax.x && obstacle.mMax.y >= viewMin.y && obstacle.mMin.y <= viewMax.y)
+        {
+            int left = mCamera.toScreenX(obstacle.mMin.x);
+            int top = mCamera.toScreenY(obstacle.mMin.y);
+            SDL_Rect rect{ left, top, mCamera.toScreenX(obstacle.mMax.x) - left, mCamera.toScreenY(obstacle.mMax.y) - top };
+            SDL_RenderFillRect(sdl->getRenderer(), &rect);
+        }
     }
-    threads.clear();
+}
+
+
+// Switch between drawing with the sprite compositor and drawing every sprite with the renderer
+bool Game::setCompositing(const bool& aCompositing)
+{
+    if (aCompositing && !mCompositing && !mCompositor.init(sdl->getRenderer(), SDLManager::mWindowWidth, SDLManager::mWindowHeight))
+    {
+        SDL_Log("Compositor: failed to start");
+        return false;
+    }
+    if (!aCompositing && mCompositing)
+    {
+        mCompositor.free();
+    }
+
+    mCompositing = aCompositing;
+    return true;
+}
+
+
+// Whether the sprite compositor draws the sprites
+bool Game::isCompositing()
+{
+    return mCompositing;
+}
+
+
+// Draw the performance overlay on top of the game world
+void Game::renderHUD()
+{
+    mHUD.render(sdl->getRenderer(), static_cast<uint32_t>(npcs.size() + rugs.size()), mCamera);
+}
+
+
+// ThreadPool task that updates the NPC in the storage slot at aIndex, the tasks walk the storage in order
+// and the NPC's handle picks its random values
+void Game::updateNPCTask(void* aGame, uint32_t aIndex)
+{
+    PERF_PHASE(EPerfPhase::MOVEMENT);
+    Game* game = static_cast<Game*>(aGame);
+    NPC* npc = &game->mNPCPool[aIndex];
+    uint32_t handle = game->mSlotHandles[aIndex];
+    ESimulationLOD lod = game->mWorld.getSimulationLOD(npc->getSubspace());
+
+    // A distant NPC steps once every few ticks, staggered by its handle so every tick steps the same share
+    if (lod == ESimulationLOD::DISTANT && ((game->mTick + handle) % game->mDistantTickRatio) != 0)
+    {
+        npc->skipUpdate(game->mFrameDt);
+        game->mSkippedUpdates.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    npc->update(game->mFrameDt, game->mRandomValues[handle * 2], game->mRandomValues[(handle * 2) + 1], lod == ESimulationLOD::VISIBLE);
+}
+
+
+// ThreadPool task that orders, and trades within the world partition at aIndex
+void Game::orderPartitionTask(void* aGame, uint32_t aIndex)
+{
+    static_cast<Game*>(aGame)->mWorld.orderWorld(static_cast<EWorldPartition>(aIndex));
+}
+
+
+// ThreadPool task that renders the world partition at aIndex
+void Game::renderPartitionTask(void* aGame, uint32_t aIndex)
+{
+    Game* game = static_cast<Game*>(aGame);
+    game->mWorld.render(static_cast<EWorldPartition>(aIndex), game->mCamera);
+}
+
+
+// ThreadPool task that finds the neighbors of the NPC in the storage slot at aIndex
+void Game::queryNeighborsTask(void* aGame, uint32_t aIndex)
+{
+    Game* game = static_cast<Game*>(aGame);
+    Entity* neighbors[NEIGHBOR_QUERY_CAPACITY];
+    uint32_t found = game->mWorld.queryRadius(game->mNPCPool[aIndex].getLocation(), game->mNeighborRadius, neighbors, NEIGHBOR_QUERY_CAPACITY);
+    game->mNeighborsFound.fetch_add(found, memory_order_relaxed);
+}
+
+
+// Whether the market was restored from the world snapshot passed to start
+bool Game::isRestored()
+{
+    return mRestored;
 }
 
 
 // Deallocate the game world
 void Game::close()
 {
+    mThreadPool.close();
+    mEntityReorder.close();
+    mCompositor.free();
+    mReplayRecorder.stop();
+    mReplayPlayer.close();
+
+    // Consume the last trade events before the consumers go away
+    TradeEvents::stop();
+    mTradeLog.close();
+    mTradeStatistics.logSummary();
+    mWorld.logBroadphaseVerification();
+    mWorld.logFlowFields();
+
     // Delete rugs
     mRugTexture.free();
     for (auto rug : rugs)
@@ -376,17 +1098,12 @@ void Game::close()
     }
     rugs.clear();
 
-    // Delete npcs
+    // Delete npcs, they're all stored in the pool
     mNPCTexture.free();
-    for (auto npc : npcs)
-    {
-        if (npc)
-        {
-            delete npc;
-            npc = nullptr;
-        }
-    }
     npcs.clear();
+    mSlotHandles.clear();
+    delete[] mNPCPool;
+    mNPCPool = nullptr;
 
     // If sdl is a valid pointer change it to a nullptr, no need to explicitly delete the
     //  sdl pointer because it's managed by the SDLManager
@@ -11,6 +11,21 @@
 #include "Rug.h"
 #include "NPC.h"
 #include "World.h"
+#include "ThreadPool.h"
+#include "PerformanceHUD.h"
+#include "TradeScheduler.h"
+#include "TradeStatistics.h"
+#include "TradeLogWriter.h"
+#include "ReplayRecorder.h"
+#include "ReplayPlayer.h"
+#include "WorldSnapshot.h"
+#include "SpriteCompositor.h"
+#include "Camera.h"
+#include "EntityReorder.h"
+
+
+// Most neighbors one query in queryAllNeighbors(..) finds
+constexpr uint32_t NEIGHBOR_QUERY_CAPACITY = 256;
 
 
 class Game
@@ -30,10 +45,23 @@ private:
     SDL_Rect mRugFrames[RUG_FRAME_COLS * RUG_FRAME_ROWS];
     vector<Rug*> rugs;
 
-    // Collection of NPCs, and shared resources used by the rug
+    // Collection of NPCs, and shared resources used by the rug. The NPCs are stored in one block that is
+    // re-sorted along the Morton curve of their subspaces, npcs is indexed by the NPC's handle and always
+    // points to where the NPC is stored, and mSlotHandles is the handle of the NPC in each storage slot
     Texture mNPCTexture;
     SDL_Rect mNPCFrames[NPC_FRAME_COLS * NPC_FRAME_ROWS];
+    NPC* mNPCPool;
     vector<NPC*> npcs;
+    vector<uint32_t> mSlotHandles;
+
+    // Sorts the NPCs' storage in the background while enabled, and the buffers the sort is requested and
+    // applied with
+    EntityReorder mEntityReorder;
+    bool mReorderingEntities;
+    vector<uint32_t> mReorderCodes;
+    vector<uint32_t> mReorderPositions;
+    vector<uint32_t> mReorderContents;
+    vector<uint32_t> mReorderHandles;
 
     // The background texture
     Texture mBackgroundTexture;
@@ -43,18 +71,143 @@ private:
     SDL_Rect mLoadingFrames[TOTAL_LOAD_FRAMES];
     atomic<uint8_t> mCurrLoadingFrame;
 
-    // Our collection of threads
-    vector<thread> threads;
+    // Persistent worker threads that every frame's work is spread across
+    ThreadPool mThreadPool;
+
+    // The delta time of the frame being updated, and two random values per NPC drawn in order on the
+    // calling thread so the NPCs receive the same values however the tasks are scheduled
+    float mFrameDt;
+    vector<float> mRandomValues;
+
+    // Number of ticks the game world has been updated, stamped on the trade events
+    uint32_t mTick;
+
+    // World snapshot the market is restored from instead of being generated, or nullptr, and whether the
+    // market was restored from it
+    const char* mRestorePath;
+    atomic<bool> mRestored;
 
     // 2D array with every elements current position and 
     World mWorld;
 
+    // The world's dimensions, the window's when they are 0, and the view of the world drawn in the window
+    uint32_t mWorldWidth;
+    uint32_t mWorldHeight;
+    Camera mCamera;
+
+    // Distant regions step once every this many ticks, and the NPC updates skipped this tick
+    uint32_t mDistantTickRatio;
+    atomic<uint32_t> mSkippedUpdates;
+
+    // The seed the market is generated from, it's seeded from the clock when 0
+    uint32_t mSeed;
+
+    // The number of obstacles the market is generated with, and the next obstacle O takes down or puts up
+    uint32_t mObstacleCount;
+    uint32_t mToggledObstacle;
+
+    // The radius of the neighbor queries being run, and the neighbors they found
+    float mNeighborRadius;
+    atomic<uint64_t> mNeighborsFound;
+
+    // Event driven trade engine, used instead of polling the world partitions for trades while enabled
+    TradeScheduler mTradeScheduler;
+
+    // Draws the sprites on the CPU instead of one renderer call per sprite while enabled
+    SpriteCompositor mCompositor;
+    bool mCompositing;
+
+    // Frame time overlay
+    PerformanceHUD mHUD;
+
+    // Trade event consumers, next to the overlay
+    TradeStatistics mTradeStatistics;
+    TradeLogWriter mTradeLog;
+
+    // Records every tick to a replay, and plays a replay back in place of the simulation
+    ReplayRecorder mReplayRecorder;
+    ReplayPlayer mReplayPlayer;
+
 public:
     // Initializes game entities
     Game();
 
-    // Loads the game objects and renders the loading screen while they are initializing
-    bool start(SDLManager*);
+    // Loads the game objects and renders the loading screen while they are initializing, the market is
+    // restored from the world snapshot at the given path if there is one
+    bool start(SDLManager*, const char* aRestorePath = nullptr);
+
+    // Set the world's dimensions, must be called before start, the world matches the window otherwise
+    void setWorldSize(const uint32_t&, const uint32_t&);
+
+    // Set how many ticks apart the regions distant from the camera step, 1 simulates every region every tick
+    void setDistantTickRatio(const uint32_t&);
+
+    // Set whether the NPCs' storage is re-sorted along the Morton curve, must be called before start
+    void setReorderingEntities(const bool&);
+
+    // Whether the NPCs' storage is re-sorted along the Morton curve
+    bool isReorderingEntities();
+
+    // Set the seed the market is generated from, must be called before start, 0 seeds it from the clock
+    void setSeed(const uint32_t&);
+
+    // Whether the market is the same every run, restored from a world snapshot or generated from a set seed
+    bool isReproducible();
+
+    // Set where the generated market's rugs are placed and its NPCs walk to, must be called before start
+    void setWorldLayout(const EWorldLayout&);
+
+    // Set the spatial index the world answers neighbor queries from
+    void setWorldBackend(const EWorldBackend&);
+
+    // Get the world's spatial index
+    EWorldBackend getWorldBackend();
+
+    // Get where the market is laid out
+    EWorldLayout getWorldLayout();
+
+    // Set the way the trade pairs are found, must be called before start
+    void setBroadphase(const EBroadphase&);
+
+    // Get the way the trade pairs are found
+    EBroadphase getBroadphase();
+
+    // Set whether every broadphase's trade pairs are checked against brute force's each tick
+    void setVerifyingBroadphases(const bool&);
+
+    // Get the number of ticks a broadphase's trade pairs didn't match brute force's
+    uint32_t getBroadphaseMismatches();
+
+    // Set whether every flow field repaired around an obstacle is checked against one worked out from scratch
+    void setVerifyingFlowFields(const bool&);
+
+    // Get the number of repaired flow fields that didn't match one worked out from scratch
+    uint32_t getFlowFieldMismatches();
+
+    // Set whether the NPCs walk to the closest rug trading a good other than theirs, must be called before start
+    void setSeekingRugs(const bool&);
+
+    // Get whether the NPCs walk to the closest rug trading a good other than theirs
+    bool isSeekingRugs();
+
+    // Set the number of stalls and walls the market is generated with, must be called before start
+    void setObstacleCount(const uint32_t&);
+
+    // Get the number of obstacles in the market
+    uint32_t getObstacleCount();
+
+    // Set whether the NPCs follow flow fields around the obstacles, must be called before start
+    void setFlowNavigating(const bool&);
+
+    // Get whether the NPCs follow flow fields around the obstacles
+    bool isFlowNavigating();
+
+    // Set the memory in bytes the cached flow fields may take
+    void setFlowFieldBudget(const size_t&);
+
+    // Find every NPC's neighbors within a radius in the world's spatial index, spread across the thread
+    // pool, and return the total found
+    uint64_t queryAllNeighbors(const float&);
 
     // Handle's user events events
     bool handleEvent(SDL_Event&);
@@ -65,13 +218,49 @@ public:
     // Draw the game world
     void render();
 
+    // Draw the performance overlay on top of the game world
+    void renderHUD();
+
     // Free the resources
     void close();
 
+    // Whether the market was restored from the world snapshot passed to start
+    bool isRestored();
+
+    // Play a replay back in place of the simulation, stops recording
+    bool startReplay(const char*);
+
+    // Whether a replay is playing
+    bool isPlayingReplay();
+
+    // Switch between drawing with the sprite compositor and drawing every sprite with the renderer
+    bool setCompositing(const bool&);
+
+    // Whether the sprite compositor draws the sprites
+    bool isCompositing();
+
 private: 
     // Loads the objects used while the game is running
     void init(const float&);
 
     // Loads only the loading screen assets
     bool initLoadingScreen(const float&);
+
+    // Stop playing the replay and hand the entities back to the simulation
+    void stopReplay();
+
+    // Apply a finished sort of the NPCs' storage, and request the next one every few ticks
+    void reorderEntities();
+
+    // Save the market to a world snapshot
+    bool saveSnapshot(const char*);
+
+    // Restore the market from a world snapshot, the market is unchanged if it can't be restored
+    bool restoreSnapshot(const char*);
+
+    // ThreadPool tasks, the index selects the NPC's storage slot, or world partition to work on
+    static void updateNPCTask(void*, uint32_t);
+    static void orderPartitionTask(void*, uint32_t);
+    static void renderPartitionTask(void*, uint32_t);
+    static void queryNeighborsTask(void*, uint32_t);
 };
\ No newline at end of file
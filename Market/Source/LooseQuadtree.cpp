@@ -0,0 +1,508 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* LooseQuadtree indexes the entities by location in a quadtree whose cells adapt to how crowded the world
+* is, a cell splits into four once it holds more than QUADTREE_SPLIT_THRESHOLD entities and its children
+* merge back once the cell holds fewer than QUADTREE_MERGE_THRESHOLD. The cells are loose, an entity stays
+* in its cell until it walks out of the cell's bounds grown by QUADTREE_LOOSENESS, so the entities standing
+* on a cell's edge don't move between cells every tick. It's updated incrementally, only the entities that
+* left their cell are moved.
+*/
+#include "PCH.h"
+#include "LooseQuadtree.h"
+
+
+/**
+* Default Constructor, the quadtree is empty until init(..) is called.
+*/
+LooseQuadtree::LooseQuadtree()
+{}
+
+
+/**
+* Whether a location is within a cell's loose bounds.
+* @param aNode     - The cell's index.
+* @param aLocation - The location.
+* @return bool True if the location is within the loose bounds, otherwise false.
+*/
+bool LooseQuadtree::isInLooseBounds(const uint32_t& aNode, const Vector& aLocation) const
+{
+    const QuadtreeNode& node = mNodes[aNode];
+    float looseHalfSize = node.mHalfSize * QUADTREE_LOOSENESS;
+    return abs(aLocation.x - node.mCenterX) <= looseHalfSize && abs(aLocation.y - node.mCenterY) <= looseHalfSize;
+}
+
+
+/**
+* Find the leaf whose cell contains a location.
+* @param aLocation - The location.
+* @return uint32_t The leaf's index.
+*/
+uint32_t LooseQuadtree::findLeaf(const Vector& aLocation) const
+{
+    uint32_t node = 0;
+    while (mNodes[node].mFirstChild != UINT32_MAX)
+    {
+        // The children are ordered left to right, then top to bottom
+        uint32_t quadrant = ((aLocation.x >= mNodes[node].mCenterX) ? (1) : (0)) + ((aLocation.y >= mNodes[node].mCenterY) ? (2) : (0));
+        node = mNodes[node].mFirstChild + quadrant;
+    }
+    return node;
+}
+
+
+/**
+* Add an entity to a leaf, and count it in every cell above the leaf.
+* @param aLeaf   - The leaf's index.
+* @param aEntity - The entity.
+*/
+void LooseQuadtree::addToLeaf(const uint32_t& aLeaf, Entity* aEntity)
+{
+    uint32_t id = aEntity->getUniqueID();
+    if (id >= mEntityLeaves.size())
+    {
+        mEntityLeaves.resize(static_cast<size_t>(id) + 1, UINT32_MAX);
+    }
+    mEntityLeaves[id] = aLeaf;
+    mNodes[aLeaf].mEntities.push_back(aEntity);
+
+    for (uint32_t node = aLeaf; node != UINT32_MAX; node = mNodes[node].mParent)
+    {
+        ++mNodes[node].mCount;
+    }
+
+    if (mNodes[aLeaf].mCount > QUADTREE_SPLIT_THRESHOLD && mNodes[aLeaf].mDepth < QUADTREE_MAX_DEPTH)
+    {
+        split(aLeaf);
+    }
+}
+
+
+/**
+* Split a leaf into four children, and move its entities into them. An entity that wandered out of the
+* leaf's cell may be outside every child's loose bounds, it's added again from the root.
+* @param aLeaf - The leaf's index.
+*/
+void LooseQuadtree::split(const uint32_t& aLeaf)
+{
+    // Reuse a merged block of children if there is one, mNodes may grow so the cells are indexed from here on
+    uint32_t firstChild;
+    if (!mFreeChildren.empty())
+    {
+        firstChild = mFreeChildren.back();
+        mFreeChildren.pop_back();
+    }
+    else
+    {
+        firstChild = static_cast<uint32_t>(mNodes.size());
+        mNodes.resize(mNodes.size() + 4);
+    }
+
+    float quarterSize = mNodes[aLeaf].mHalfSize / 2.f;
+    for (uint32_t quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        QuadtreeNode& child = mNodes[firstChild + quadrant];
+        child.mCenterX    = mNodes[aLeaf].mCenterX + (((quadrant & 1) != 0) ? (quarterSize) : (-quarterSize));
+        child.mCenterY    = mNodes[aLeaf].mCenterY + (((quadrant & 2) != 0) ? (quarterSize) : (-quarterSize));
+        child.mHalfSize   = quarterSize;
+        child.mDepth      = mNodes[aLeaf].mDepth + 1;
+        child.mParent     = aLeaf;
+        child.mFirstChild = UINT32_MAX;
+        child.mCount      = 0;
+        child.mEntities.clear();
+    }
+    mNodes[aLeaf].mFirstChild = firstChild;
+
+    vector<Entity*> entities;
+    entities.swap(mNodes[aLeaf].mEntities);
+
+    // Entities that wandered too far to fit in a child
+    vector<Entity*> wanderers;
+    for (Entity* entity : entities)
+    {
+        Vector location = entity->getLocation();
+        uint32_t quadrant = ((location.x >= mNodes[aLeaf].mCenterX) ? (1) : (0)) + ((location.y >= mNodes[aLeaf].mCenterY) ? (2) : (0));
+        uint32_t child = firstChild + quadrant;
+        if (isInLooseBounds(child, location))
+        {
+            mNodes[child].mEntities.push_back(entity);
+            ++mNodes[child].mCount;
+            mEntityLeaves[entity->getUniqueID()] = child;
+        }
+        else
+        {
+            wanderers.push_back(entity);
+        }
+    }
+
+    for (Entity* entity : wanderers)
+    {
+        for (uint32_t node = aLeaf; node != UINT32_MAX; node = mNodes[node].mParent)
+        {
+            --mNodes[node].mCount;
+        }
+        mEntityLeaves[entity->getUniqueID()] = UINT32_MAX;
+        insert(entity);
+    }
+}
+
+
+/**
+* Merge every cell below a cell back into it, moving their entities into it. Every entity is within its
+* leaf's loose bounds, which are within the loose bounds of every cell above the leaf.
+* @param aNode - The cell's index.
+*/
+void LooseQuadtree::merge(const uint32_t& aNode)
+{
+    vector<Entity*> entities;
+    collectAndFree(aNode, entities);
+
+    mNodes[aNode].mEntities.swap(entities);
+    for (Entity* entity : mNodes[aNode].mEntities)
+    {
+        mEntityLeaves[entity->getUniqueID()] = aNode;
+    }
+}
+
+
+/**
+* Move the entities of every cell below a cell into a buffer, and free the cells.
+* @param aNode     - The cell's index.
+* @param aEntities - The buffer the entities are moved to.
+*/
+void LooseQuadtree::collectAndFree(const uint32_t& aNode, vector<Entity*>& aEntities)
+{
+    QuadtreeNode& node = mNodes[aNode];
+    aEntities.insert(aEntities.end(), node.mEntities.begin(), node.mEntities.end());
+    node.mEntities.clear();
+
+    if (node.mFirstChild != UINT32_MAX)
+    {
+        uint32_t firstChild = node.mFirstChild;
+        for (uint32_t quadrant = 0; quadrant < 4; ++quadrant)
+        {
+            collectAndFree(firstChild + quadrant, aEntities);
+        }
+        mFreeChildren.push_back(firstChild);
+        mNodes[aNode].mFirstChild = UINT32_MAX;
+    }
+}
+
+
+/**
+* Make the quadtree a single empty cell covering an area.
+* @param aWidth  - The area's width.
+* @param aHeight - The area's height.
+*/
+void LooseQuadtree::init(const uint32_t& aWidth, const uint32_t& aHeight)
+{
+    clear();
+
+    // The root is square, so every cell is
+    QuadtreeNode root;
+    root.mHalfSize   = max(aWidth, aHeight) / 2.f;
+    root.mCenterX    = root.mHalfSize;
+    root.mCenterY    = root.mHalfSize;
+    root.mDepth      = 0;
+    root.mParent     = UINT32_MAX;
+    root.mFirstChild = UINT32_MAX;
+    root.mCount      = 0;
+    mNodes.push_back(root);
+}
+
+
+/**
+* Remove every entity and cell.
+*/
+void LooseQuadtree::clear()
+{
+    mNodes.clear();
+    mFreeChildren.clear();
+    mEntityLeaves.clear();
+}
+
+
+/**
+* Whether the quadtree was initialized.
+* @return bool True if the quadtree has a root cell, otherwise false.
+*/
+bool LooseQuadtree::isInitialized() const
+{
+    return !mNodes.empty();
+}
+
+
+/**
+* Add an entity at its current location.
+* @param aEntity - The entity.
+*/
+void LooseQuadtree::insert(Entity* aEntity)
+{
+    if (mNodes.empty())
+    {
+        return;
+    }
+    addToLeaf(findLeaf(aEntity->getLocation()), aEntity);
+}
+
+
+/**
+* Remove an entity, merging the cells above it that fell below the merge threshold.
+* @param aEntity - The entity.
+*/
+void LooseQuadtree::remove(Entity* aEntity)
+{
+    uint32_t id = aEntity->getUniqueID();
+    if (id >= mEntityLeaves.size() || mEntityLeaves[id] == UINT32_MAX)
+    {
+        return;
+    }
+
+    uint32_t leaf = mEntityLeaves[id];
+    vector<Entity*>& entities = mNodes[leaf].mEntities;
+    auto itr = find(entities.begin(), entities.end(), aEntity);
+    if (itr != entities.end())
+    {
+        *itr = entities.back();
+        entities.pop_back();
+    }
+    mEntityLeaves[id] = UINT32_MAX;
+
+    // The highest cell above the leaf that fell below the merge threshold is merged, with everything below it
+    uint32_t mergeNode = UINT32_MAX;
+    for (uint32_t node = leaf; node != UINT32_MAX; node = mNodes[node].mParent)
+    {
+        --mNodes[node].mCount;
+        if (node != leaf && mNodes[node].mCount < QUADTREE_MERGE_THRESHOLD)
+        {
+            mergeNode = node;
+        }
+    }
+
+    if (mergeNode != UINT32_MAX)
+    {
+        merge(mergeNode);
+    }
+}
+
+
+/**
+* Move an entity to the cell of its current location, if it left its cell's loose bounds.
+* @param aEntity - The entity.
+* @return bool True if the entity was moved, otherwise false.
+*/
+bool LooseQuadtree::update(Entity* aEntity)
+{
+    uint32_t id = aEntity->getUniqueID();
+    if (id < mEntityLeaves.size() && mEntityLeaves[id] != UINT32_MAX && isInLooseBounds(mEntityLeaves[id], aEntity->getLocation()))
+    {
+        return false;
+    }
+
+    remove(aEntity);
+    insert(aEntity);
+    return true;
+}
+
+
+/**
+* Find the entities within a radius of a point, in no particular order. Only the cells whose loose bounds
+* overlap the circle are visited.
+* @param aCenter   - The point.
+* @param aRadius   - The radius.
+* @param aResults  - The buffer the entities are written to.
+* @param aCapacity - The most entities written.
+* @param aFilter   - Which entities are reported.
+* @return uint32_t The number of entities written.
+*/
+uint32_t LooseQuadtree::query(const Vector& aCenter, const float& aRadius, Entity** aResults, const uint32_t& aCapacity, const QueryFilter& aFilter) const
+{
+    if (mNodes.empty())
+    {
+        return 0;
+    }
+
+    // Every visit pushes four children and pops one, so the stack never holds more than this
+    uint32_t stack[(QUADTREE_MAX_DEPTH * 3) + 1];
+    uint32_t stackSize = 0;
+    uint32_t found = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0 && found < aCapacity)
+    {
+        const QuadtreeNode& node = mNodes[stack[--stackSize]];
+
+        // The distance from the circle's center to the cell's loose bounds
+        float looseHalfSize = node.mHalfSize * QUADTREE_LOOSENESS;
+        float deltaX = max(abs(aCenter.x - node.mCenterX) - looseHalfSize, 0.f);
+        float deltaY = max(abs(aCenter.y - node.mCenterY) - looseHalfSize, 0.f);
+        if ((deltaX * deltaX) + (deltaY * deltaY) > aRadius * aRadius || node.mCount == 0)
+        {
+            continue;
+        }
+
+        if (node.mFirstChild == UINT32_MAX)
+        {
+            for (Entity* entity : node.mEntities)
+            {
+                if (found < aCapacity && MATH::pointsInRange(entity->getLocation(), aCenter, aRadius) && aFilter.matches(entity))
+                {
+                    aResults[found++] = entity;
+                }
+            }
+        }
+        else
+        {
+            for (uint32_t quadrant = 0; quadrant < 4; ++quadrant)
+            {
+                stack[stackSize++] = node.mFirstChild + quadrant;
+            }
+        }
+    }
+
+    return found;
+}
+
+
+/**
+* Find the entities within a rectangle, in no particular order. Only the cells whose loose bounds overlap
+* the rectangle are visited.
+* @param aMin      - The rectangle's corner with the smallest coordinates.
+* @param aMax      - The rectangle's corner with the largest coordinates.
+* @param aResults  - The buffer the entities are written to.
+* @param aCapacity - The most entities written.
+* @param aFilter   - Which entities are reported.
+* @return uint32_t The number of entities written.
+*/
+uint32_t LooseQuadtree::queryRect(const Vector& aMin, const Vector& aMax, Entity** aResults, const uint32_t& aCapacity, const QueryFilter& aFilter) const
+{
+    if (mNodes.empty())
+    {
+        return 0;
+    }
+
+    uint32_t stack[(QUADTREE_MAX_DEPTH * 3) + 1];
+    uint32_t stackSize = 0;
+    uint32_t found = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0 && found < aCapacity)
+    {
+        const QuadtreeNode& node = mNodes[stack[--stackSize]];
+
+        float looseHalfSize = node.mHalfSize * QUADTREE_LOOSENESS;
+        if (node.mCount == 0 || node.mCenterX + looseHalfSize < aMin.x || node.mCenterX - looseHalfSize > aMax.x ||
+            node.mCenterY + looseHalfSize < aMin.y || node.mCenterY - looseHalfSize > aMax.y)
+        {
+            continue;
+        }
+
+        if (node.mFirstChild == UINT32_MAX)
+        {
+            for (Entity* entity : node.mEntities)
+            {
+                Vector location = entity->getLocation();
+                if (found < aCapacity && location.x >= aMin.x && location.x <= aMax.x && location.y >= aMin.y && location.y <= aMax.y && aFilter.matches(entity))
+                {
+                    aResults[found++] = entity;
+                }
+            }
+        }
+        else
+        {
+            for (uint32_t quadrant = 0; quadrant < 4; ++quadrant)
+            {
+                stack[stackSize++] = node.mFirstChild + quadrant;
+            }
+        }
+    }
+
+    return found;
+}
+
+
+/**
+* Offer the entities closest to a point to a nearest queue. The children of each cell are visited closest
+* first, and a cell farther than the farthest entity the queue keeps is skipped with everything below it.
+* @param aCenter    - The point.
+* @param aMaxRadius - The farthest an entity can be.
+* @param aQueue     - The queue the entities are offered to.
+* @param aFilter    - Which entities are offered.
+*/
+void LooseQuadtree::queryNearest(const Vector& aCenter, const float& aMaxRadius, NearestQueue& aQueue, const QueryFilter& aFilter) const
+{
+    if (mNodes.empty())
+    {
+        return;
+    }
+
+    uint32_t stack[(QUADTREE_MAX_DEPTH * 3) + 1];
+    float stackDistances[(QUADTREE_MAX_DEPTH * 3) + 1];
+    uint32_t stackSize = 0;
+    stack[stackSize] = 0;
+    stackDistances[stackSize++] = 0.f;
+    float maxRadiusSquared = aMaxRadius * aMaxRadius;
+
+    while (stackSize > 0)
+    {
+        --stackSize;
+        const QuadtreeNode& node = mNodes[stack[stackSize]];
+        float nodeDistanceSquared = stackDistances[stackSize];
+        if (node.mCount == 0 || nodeDistanceSquared > maxRadiusSquared || nodeDistanceSquared > aQueue.getBoundSquared())
+        {
+            continue;
+        }
+
+        if (node.mFirstChild == UINT32_MAX)
+        {
+            for (Entity* entity : node.mEntities)
+            {
+                Vector location = entity->getLocation();
+                float deltaX = location.x - aCenter.x;
+                float deltaY = location.y - aCenter.y;
+                float distanceSquared = (deltaX * deltaX) + (deltaY * deltaY);
+                if (distanceSquared <= maxRadiusSquared && aFilter.matches(entity))
+                {
+                    aQueue.offer(entity, distanceSquared);
+                }
+            }
+            continue;
+        }
+
+        // The distance from the point to each child's loose bounds, the children are pushed farthest first
+        // so the closest is visited next
+        uint32_t children[4];
+        float distances[4];
+        for (uint32_t quadrant = 0; quadrant < 4; ++quadrant)
+        {
+            const QuadtreeNode& child = mNodes[node.mFirstChild + quadrant];
+            float looseHalfSize = child.mHalfSize * QUADTREE_LOOSENESS;
+            float deltaX = max(abs(aCenter.x - child.mCenterX) - looseHalfSize, 0.f);
+            float deltaY = max(abs(aCenter.y - child.mCenterY) - looseHalfSize, 0.f);
+            children[quadrant] = node.mFirstChild + quadrant;
+            distances[quadrant] = (deltaX * deltaX) + (deltaY * deltaY);
+            for (uint32_t i = quadrant; i > 0 && distances[i - 1] < distances[i]; --i)
+            {
+                std::swap(children[i - 1], children[i]);
+                std::swap(distances[i - 1], distances[i]);
+            }
+        }
+        for (uint32_t quadrant = 0; quadrant < 4; ++quadrant)
+        {
+            stack[stackSize] = children[quadrant];
+            stackDistances[stackSize++] = distances[quadrant];
+        }
+    }
+}
+
+
+/**
+* Get the number of cells in use.
+* @return uint32_t The cell count.
+*/
+uint32_t LooseQuadtree::getNodeCount() const
+{
+    return static_cast<uint32_t>(mNodes.size() - (mFreeChildren.size() * 4));
+}
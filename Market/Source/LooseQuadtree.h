@@ -0,0 +1,184 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* LooseQuadtree indexes the entities by location in a quadtree whose cells adapt to how crowded the world
+* is, a cell splits into four once it holds more than QUADTREE_SPLIT_THRESHOLD entities and its children
+* merge back once the cell holds fewer than QUADTREE_MERGE_THRESHOLD. The cells are loose, an entity stays
+* in its cell until it walks out of the cell's bounds grown by QUADTREE_LOOSENESS, so the entities standing
+* on a cell's edge don't move between cells every tick. It's updated incrementally, only the entities that
+* left their cell are moved.
+*/
+#pragma once
+#include "PCH.h"
+#include "Entity.h"
+#include "SpatialQuery.h"
+
+
+// A cell splits once it holds more entities than the split threshold, and its children merge back once
+// they hold fewer than the merge threshold, the gap keeps a crowd on the edge from splitting and merging
+// the same cell every tick
+constexpr uint32_t QUADTREE_SPLIT_THRESHOLD = 16;
+constexpr uint32_t QUADTREE_MERGE_THRESHOLD = 6;
+
+// Deepest a cell can be, the cells at this depth hold every entity in them however many there are
+constexpr uint32_t QUADTREE_MAX_DEPTH = 12;
+
+// How much larger than its cell the bounds an entity can wander in before it's moved are
+constexpr float QUADTREE_LOOSENESS = 1.5f;
+
+
+// A cell of the quadtree, its four children are stored next to each other
+struct QuadtreeNode
+{
+    // The cell's center and half its side length
+    float mCenterX;
+    float mCenterY;
+    float mHalfSize;
+
+    // The cell's depth, parent, and first child, UINT32_MAX if the cell is a leaf
+    uint32_t mDepth;
+    uint32_t mParent;
+    uint32_t mFirstChild;
+
+    // The entities in the cell and every cell below it
+    uint32_t mCount;
+
+    // The entities in the cell, only leaves hold entities
+    vector<Entity*> mEntities;
+};
+
+
+class LooseQuadtree
+{
+private:
+    // Every cell, the root is first, and the first child of each block of four children that were merged
+    // and can be reused
+    vector<QuadtreeNode> mNodes;
+    vector<uint32_t> mFreeChildren;
+
+    // The leaf each entity is in, by the entity's unique ID, UINT32_MAX if it isn't in the quadtree
+    vector<uint32_t> mEntityLeaves;
+
+    /**
+    * Whether a location is within a cell's loose bounds.
+    * @param aNode     - The cell's index.
+    * @param aLocation - The location.
+    * @return bool True if the location is within the loose bounds, otherwise false.
+    */
+    bool isInLooseBounds(const uint32_t& aNode, const Vector& aLocation) const;
+
+    /**
+    * Find the leaf whose cell contains a location.
+    * @param aLocation - The location.
+    * @return uint32_t The leaf's index.
+    */
+    uint32_t findLeaf(const Vector& aLocation) const;
+
+    /**
+    * Add an entity to a leaf, and count it in every cell above the leaf.
+    * @param aLeaf   - The leaf's index.
+    * @param aEntity - The entity.
+    */
+    void addToLeaf(const uint32_t& aLeaf, Entity* aEntity);
+
+    /**
+    * Split a leaf into four children, and move its entities into them.
+    * @param aLeaf - The leaf's index.
+    */
+    void split(const uint32_t& aLeaf);
+
+    /**
+    * Merge every cell below a cell back into it, moving their entities into it.
+    * @param aNode - The cell's index.
+    */
+    void merge(const uint32_t& aNode);
+
+    /**
+    * Move the entities of every cell below a cell into a buffer, and free the cells.
+    * @param aNode     - The cell's index.
+    * @param aEntities - The buffer the entities are moved to.
+    */
+    void collectAndFree(const uint32_t& aNode, vector<Entity*>& aEntities);
+
+public:
+    /**
+    * Default Constructor, the quadtree is empty until init(..) is called.
+    */
+    LooseQuadtree();
+
+    /**
+    * Make the quadtree a single empty cell covering an area.
+    * @param aWidth  - The area's width.
+    * @param aHeight - The area's height.
+    */
+    void init(const uint32_t& aWidth, const uint32_t& aHeight);
+
+    /**
+    * Remove every entity and cell.
+    */
+    void clear();
+
+    /**
+    * Whether the quadtree was initialized.
+    * @return bool True if the quadtree has a root cell, otherwise false.
+    */
+    bool isInitialized() const;
+
+    /**
+    * Add an entity at its current location.
+    * @param aEntity - The entity.
+    */
+    void insert(Entity* aEntity);
+
+    /**
+    * Remove an entity, merging the cells above it that fell below the merge threshold.
+    * @param aEntity - The entity.
+    */
+    void remove(Entity* aEntity);
+
+    /**
+    * Move an entity to the cell of its current location, if it left its cell's loose bounds.
+    * @param aEntity - The entity.
+    * @return bool True if the entity was moved, otherwise false.
+    */
+    bool update(Entity* aEntity);
+
+    /**
+    * Find the entities within a radius of a point, in no particular order.
+    * @param aCenter   - The point.
+    * @param aRadius   - The radius.
+    * @param aResults  - The buffer the entities are written to.
+    * @param aCapacity - The most entities written.
+    * @param aFilter   - Which entities are reported.
+    * @return uint32_t The number of entities written.
+    */
+    uint32_t query(const Vector& aCenter, const float& aRadius, Entity** aResults, const uint32_t& aCapacity, const QueryFilter& aFilter = QueryFilter()) const;
+
+    /**
+    * Find the entities within a rectangle, in no particular order.
+    * @param aMin      - The rectangle's corner with the smallest coordinates.
+    * @param aMax      - The rectangle's corner with the largest coordinates.
+    * @param aResults  - The buffer the entities are written to.
+    * @param aCapacity - The most entities written.
+    * @param aFilter   - Which entities are reported.
+    * @return uint32_t The number of entities written.
+    */
+    uint32_t queryRect(const Vector& aMin, const Vector& aMax, Entity** aResults, const uint32_t& aCapacity, const QueryFilter& aFilter = QueryFilter()) const;
+
+    /**
+    * Offer the entities closest to a point to a nearest queue.
+    * @param aCenter    - The point.
+    * @param aMaxRadius - The farthest an entity can be.
+    * @param aQueue     - The queue the entities are offered to.
+    * @param aFilter    - Which entities are offered.
+    */
+    void queryNearest(const Vector& aCenter, const float& aMaxRadius, NearestQueue& aQueue, const QueryFilter& aFilter = QueryFilter()) const;
+
+    /**
+    * Get the number of cells in use.
+    * @return uint32_t The cell count.
+    */
+    uint32_t getNodeCount() const;
+};
@@ -6,36 +6,334 @@
 * Main.cpp contains the main entry point of the program, and manages the SDL
 * subsystem. 
 * 
-* WARNING!!! Uses floats and int16_t so these are small values and can result
-*            in unintended integer wrapping not intended to be a full game 
-*            engine!
+* WARNING!!! Uses floats for the world coordinates so they are only exact up to
+*            16 million, not intended to be a full game engine!
 */
 #include "PCH.h"
 #include "SDLManager.h"
 #include "Game.h"
+#include "AllocationTracker.h"
+#include "ProfiledMutex.h"
+#include "FrameStats.h"
+#include "Benchmark.h"
 #include <SDL.h>
 #include <SDL_image.h>
 #include "Windows.h"
 
 
+// Find the layout with the given name, false and the layout unchanged if there is none
+static bool parseLayout(const char* aName, EWorldLayout& aLayout)
+{
+    for (uint32_t layout = 0; layout <= static_cast<uint32_t>(EWorldLayout::RING); ++layout)
+    {
+        if (strcmp(aName, World::getLayoutName(static_cast<EWorldLayout>(layout))) == 0)
+        {
+            aLayout = static_cast<EWorldLayout>(layout);
+            return true;
+        }
+    }
+    SDL_Log("Unknown layout %s", aName);
+    return false;
+}
+
+
+// Find the spatial index with the given name, false and the index unchanged if there is none
+static bool parseBackend(const char* aName, EWorldBackend& aBackend)
+{
+    for (uint32_t backend = 0; backend <= static_cast<uint32_t>(EWorldBackend::QUADTREE); ++backend)
+    {
+        if (strcmp(aName, World::getBackendName(static_cast<EWorldBackend>(backend))) == 0)
+        {
+            aBackend = static_cast<EWorldBackend>(backend);
+            return true;
+        }
+    }
+    SDL_Log("Unknown backend %s", aName);
+    return false;
+}
+
+
+// Find the broadphase with the given name, false and the broadphase unchanged if there is none
+static bool parseBroadphase(const char* aName, EBroadphase& aBroadphase)
+{
+    for (uint32_t broadphase = 0; broadphase < BROADPHASE_COUNT; ++broadphase)
+    {
+        if (strcmp(aName, Broadphase::getName(static_cast<EBroadphase>(broadphase))) == 0)
+        {
+            aBroadphase = static_cast<EBroadphase>(broadphase);
+            return true;
+        }
+    }
+    SDL_Log("Unknown broadphase %s", aName);
+    return false;
+}
+
+
 int main(int argc, char* args[])
 {
     // Hide the console window at startup
     ::ShowWindow(::GetConsoleWindow(), SW_HIDE);
 
 
+    // Command line options
+    //  -snapshot <path>   restore the market from a world snapshot instead of generating one
+    //  -benchmark <path>  restore the market the same way and measure a fixed number of ticks instead of playing
+    //  -ticks <count>     the number of ticks a benchmark or headless run lasts
+    //  -results <path>    where the benchmark results are written
+    //  -replay <path>     play a replay back in place of the simulation
+    //  -headless          run on the software renderer without a display, as fast as possible
+    //  -nobatch           turn off the renderer's draw batching
+    //  -compositor        draw the sprites with the CPU sprite compositor
+    //  -world <w> <h>     make the world w by h instead of the window's size, the camera pans and zooms over it
+    //  -lod <ratio>       step the regions distant from the camera once every ratio ticks, 1 turns it off
+    //  -noreorder         keep the NPCs in their creation order instead of re-sorting them along the Morton curve
+    //  -seed <n>          generate the market from a set seed instead of the clock
+    //  -layout <name>     lay the generated market out uniform, clustered, or in a ring
+    //  -backend <name>    answer neighbor queries from the grid or the quadtree, F11 switches while playing
+    //  -benchlayout <name> benchmark a market generated in a layout from a set seed instead of a snapshot
+    //  -benchsuite        benchmark a market generated from a set seed in every layout under each backend, one
+    //                     after another, and write every run's results to one file
+    //  -broadphase <name> find the trade pairs with the grid, halo grid, sweep and prune, or brute force
+    //  -verifybroadphase  check every broadphase's trade pairs against brute force's each tick, and exit with
+    //                     1 if any didn't match
+    //  -benchqueries <n>  time the radius, rectangle, and nearest queries in a world of n entities under each
+    //                     backend instead of playing, 0 uses BENCHMARK_QUERY_POPULATION, and exit with 1 if the
+    //                     backends found different numbers of entities
+    //  -seek              the NPCs walk to the closest rug trading a good other than theirs instead of wandering
+    //  -obstacles <n>     generate the market with n stalls and walls, O takes them down and puts them up
+    //  -flowfields        the NPCs follow cached flow fields around the obstacles instead of walking straight
+    //  -flowbudget <mb>   the memory the cached flow fields may take, in megabytes
+    //  -verifyflowfields  check every flow field repaired around an obstacle against one worked out from scratch, and
+    //                     exit with 1 if any didn't match
+    //  -lockstats         log every lock's contention each second from the start, F3 toggles it while playing
+    const char* snapshotPath = nullptr;
+    const char* benchmarkPath = nullptr;
+    const char* benchmarkResultsPath = BENCHMARK_RESULTS_PATH;
+    const char* replayPath = nullptr;
+    uint32_t ticks = BENCHMARK_DEFAULT_TICKS;
+    ERenderMode renderMode = ERenderMode::WINDOWED;
+    bool renderBatching = true;
+    bool compositing = false;
+    uint32_t worldWidth = 0;
+    uint32_t worldHeight = 0;
+    uint32_t distantTickRatio = SIMULATION_LOD_DISTANT_RATIO;
+    bool reorderingEntities = true;
+    uint32_t seed = 0;
+    EWorldLayout layout = EWorldLayout::UNIFORM;
+    EWorldBackend backend = EWorldBackend::GRID;
+    EBroadphase broadphase = EBroadphase::GRID;
+    bool verifyingBroadphases = false;
+    bool verifyingFlowFields = false;
+    bool benchmarkingSuite = false;
+    bool benchmarkingQueries = false;
+    uint32_t queryPopulation = BENCHMARK_QUERY_POPULATION;
+    bool seekingRugs = false;
+    uint32_t obstacleCount = 0;
+    bool flowNavigating = false;
+    size_t flowFieldBudget = FLOW_FIELD_MEMORY_BUDGET;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(args[i], "-snapshot") == 0 && hasValue)
+        {
+            snapshotPath = args[++i];
+        }
+        else if (strcmp(args[i], "-benchmark") == 0 && hasValue)
+        {
+            benchmarkPath = args[++i];
+            snapshotPath = benchmarkPath;
+        }
+        else if (strcmp(args[i], "-ticks") == 0 && hasValue)
+        {
+            ticks = static_cast<uint32_t>(strtoul(args[++i], nullptr, 10));
+        }
+        else if (strcmp(args[i], "-results") == 0 && hasValue)
+        {
+            benchmarkResultsPath = args[++i];
+        }
+        else if (strcmp(args[i], "-replay") == 0 && hasValue)
+        {
+            replayPath = args[++i];
+        }
+        else if (strcmp(args[i], "-headless") == 0)
+        {
+            renderMode = ERenderMode::HEADLESS;
+        }
+        else if (strcmp(args[i], "-nobatch") == 0)
+        {
+            renderBatching = false;
+        }
+        else if (strcmp(args[i], "-compositor") == 0)
+        {
+            compositing = true;
+        }
+        else if (strcmp(args[i], "-world") == 0 && i + 2 < argc)
+        {
+            worldWidth = static_cast<uint32_t>(strtoul(args[++i], nullptr, 10));
+            worldHeight = static_cast<uint32_t>(strtoul(args[++i], nullptr, 10));
+        }
+        else if (strcmp(args[i], "-lod") == 0 && hasValue)
+        {
+            distantTickRatio = static_cast<uint32_t>(strtoul(args[++i], nullptr, 10));
+        }
+        else if (strcmp(args[i], "-noreorder") == 0)
+        {
+            reorderingEntities = false;
+        }
+        else if (strcmp(args[i], "-seed") == 0 && hasValue)
+        {
+            seed = static_cast<uint32_t>(strtoul(args[++i], nullptr, 10));
+        }
+        else if (strcmp(args[i], "-layout") == 0 && hasValue)
+        {
+            if (!parseLayout(args[++i], layout))
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(args[i], "-benchlayout") == 0 && hasValue)
+        {
+            benchmarkPath = args[++i];
+            snapshotPath = nullptr;
+            seed = (seed) ? (seed) : (BENCHMARK_SEED);
+            if (!parseLayout(benchmarkPath, layout))
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(args[i], "-benchsuite") == 0)
+        {
+            benchmarkingSuite = true;
+            snapshotPath = nullptr;
+            seed = (seed) ? (seed) : (BENCHMARK_SEED);
+        }
+        else if (strcmp(args[i], "-backend") == 0 && hasValue)
+        {
+            if (!parseBackend(args[++i], backend))
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(args[i], "-broadphase") == 0 && hasValue)
+        {
+            if (!parseBroadphase(args[++i], broadphase))
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(args[i], "-verifybroadphase") == 0)
+        {
+            verifyingBroadphases = true;
+        }
+        else if (strcmp(args[i], "-verifyflowfields") == 0)
+        {
+            verifyingFlowFields = true;
+        }
+        else if (strcmp(args[i], "-lockstats") == 0)
+        {
+            // A headless run has no keyboard to press F3 on
+            ProfiledMutex::setReporting(true);
+        }
+        else if (strcmp(args[i], "-benchqueries") == 0 && hasValue)
+        {
+            benchmarkingQueries = true;
+            queryPopulation = static_cast<uint32_t>(strtoul(args[++i], nullptr, 10));
+            queryPopulation = (queryPopulation) ? (queryPopulation) : (BENCHMARK_QUERY_POPULATION);
+        }
+        else if (strcmp(args[i], "-seek") == 0)
+        {
+            seekingRugs = true;
+        }
+        else if (strcmp(args[i], "-obstacles") == 0 && hasValue)
+        {
+            obstacleCount = static_cast<uint32_t>(strtoul(args[++i], nullptr, 10));
+        }
+        else if (strcmp(args[i], "-flowfields") == 0)
+        {
+            flowNavigating = true;
+        }
+        else if (strcmp(args[i], "-flowbudget") == 0 && hasValue)
+        {
+            flowFieldBudget = static_cast<size_t>(strtoul(args[++i], nullptr, 10)) * 1024 * 1024;
+        }
+    }
+
+
+    // Set to 1 if a broadphase or repaired flow field was checked and didn't match its reference, or a
+    // steady state frame allocated
+    int exitCode = 0;
+
+    // The main thread runs the frames, its allocations count against them
+    AllocationTracker::trackThread();
+
     SDLManager sdl;
+    sdl.setRenderBatching(renderBatching);
 
     // Initialize SDL subsystem
-    if (!sdl.init("Market", 1280, 760, "Assets/icon.png"))
+    if (!sdl.init("Market", 1280, 760, "Assets/icon.png", SDL_WINDOW_SHOWN, renderMode))
     {
         // cout << "Failed to initialize SDL!\n";
     }
+    else if (benchmarkingQueries)
+    {
+        // The query benchmark fills a world of its own, the market isn't started
+        exitCode = (Benchmark::runQueries(queryPopulation, benchmarkResultsPath)) ? (0) : (1);
+    }
     else
     {
+        // Every game is set up from the command line, a suite only changes its layout and backend
+        auto startGame = [&](Game& aGame, const EWorldLayout& aLayout, const EWorldBackend& aBackend)
+        {
+            aGame.setWorldSize(worldWidth, worldHeight);
+            aGame.setDistantTickRatio(distantTickRatio);
+            aGame.setReorderingEntities(reorderingEntities);
+            aGame.setSeed(seed);
+            aGame.setWorldLayout(aLayout);
+            aGame.setWorldBackend(aBackend);
+            aGame.setBroadphase(broadphase);
+            aGame.setVerifyingBroadphases(verifyingBroadphases);
+            aGame.setVerifyingFlowFields(verifyingFlowFields);
+            aGame.setSeekingRugs(seekingRugs);
+            aGame.setObstacleCount(obstacleCount);
+            aGame.setFlowNavigating(flowNavigating);
+            aGame.setFlowFieldBudget(flowFieldBudget);
+            aGame.start(&sdl, snapshotPath);
+            if (compositing)
+            {
+                aGame.setCompositing(true);
+            }
+        };
+
+        if (benchmarkingSuite)
+        {
+            uint32_t mismatches = 0;
+            bool measured = Benchmark::runSuite(sdl, ticks, benchmarkResultsPath, startGame, mismatches);
+            return (measured && mismatches == 0) ? (0) : (1);
+        }
+
         // Game
         Game game;
-        game.start(&sdl);
+        startGame(game, layout, backend);
+
+        if (benchmarkPath)
+        {
+            bool measured = Benchmark::run(game, sdl, benchmarkPath, ticks, benchmarkResultsPath);
+            uint32_t mismatches = game.getBroadphaseMismatches() + game.getFlowFieldMismatches();
+            exitCode = (measured && mismatches == 0) ? (0) : (1);
+            game.close();
+            return exitCode;
+        }
+
+        // A headless run lasts until its replay ends, or for a fixed number of ticks without one
+        bool headless = sdl.isHeadless();
+        if (replayPath)
+        {
+            game.startReplay(replayPath);
+        }
+        uint32_t tick = 0;
+
+        // Steady state frames that allocated, a headless run reports them through the exit code
+        uint32_t allocatingFrames = 0;
 
         // Game running flag
         bool quit = false;
@@ -43,20 +341,21 @@ int main(int argc, char* args[])
         // Event handler
         SDL_Event e;
         
-        // Timing variables
+        // Timing variables, measured with the high resolution performance counter
         const uint16_t FPS = 60;
-        const uint16_t frameDelay = 1000 / FPS;
-        Uint32 fStart;
-        uint16_t fTime;
-        Uint32 pTime = SDL_GetTicks();
-        Uint32 cTime = pTime;
+        const double frameDelay = 1000.0 / FPS;
+        uint64_t fStart;
+        double fTime;
+        uint64_t pTime = FrameStats::now();
+        uint64_t cTime = pTime;
 
-        // dt(delta time) - time in seconds since the last update function was called
+        // dt(delta time) - time in seconds since the last update function was called, a headless run
+        // steps by a fixed tick
         float dt = 0.0;
 
         while (!quit)
         {
-            fStart = SDL_GetTicks();
+            fStart = FrameStats::now();
 
             // Handle events
             while (SDL_PollEvent(&e) != 0)
@@ -65,34 +364,62 @@ int main(int argc, char* args[])
             }
 
             // Determine the amount of time in seconds since the last time update was called
-            cTime = SDL_GetTicks();
-            dt = static_cast<float>(cTime - pTime) / 1000.f;
+            cTime = FrameStats::now();
+            dt = (headless) ? (BENCHMARK_TICK_TIME) : (static_cast<float>(FrameStats::toMilliseconds(cTime - pTime) / 1000.0));
+            FrameStats::endFrame(cTime - pTime);
 
             pTime = cTime;
 
-            game.update(MATH::clamp(dt, MAX_FRAME_TIME));
+            AllocationTracker::setPhase(EAllocationPhase::UPDATE);
+            {
+                FrameStatsScope updateScope(EFramePhase::UPDATE);
+                game.update(MATH::clamp(dt, MAX_FRAME_TIME));
+            }
 
             // Draw the game world to the screen
-            SDL_SetRenderDrawColor(sdl.getRenderer(), 0xD3, 0xD3, 0xD3, 0xFF);
-            SDL_RenderClear(sdl.getRenderer());
- 
-            game.render();
+            AllocationTracker::setPhase(EAllocationPhase::RENDER);
+            {
+                FrameStatsScope renderScope(EFramePhase::RENDER);
+                SDL_SetRenderDrawColor(sdl.getRenderer(), 0xD3, 0xD3, 0xD3, 0xFF);
+                SDL_RenderClear(sdl.getRenderer());
+
+                game.render();
+            }
+
+            // The overlay is drawn outside of the measured render phase
+            game.renderHUD();
 
             SDL_RenderPresent(sdl.getRenderer());
+            AllocationTracker::setPhase(EAllocationPhase::OTHER);
+            if (!AllocationTracker::endFrame(!headless))
+            {
+                ++allocatingFrames;
+            }
+            ProfiledMutex::reportPerSecond();
 
             // This measures how long this iteration of the loop took
-            fTime = SDL_GetTicks() - fStart;
+            fTime = FrameStats::toMilliseconds(FrameStats::now() - fStart);
 
-            // This keeps us from displaying more frames than 60
-            if (frameDelay > fTime)
+            // This keeps us from displaying more frames than 60, a headless run goes as fast as it can
+            if (headless)
             {
-                SDL_Delay(frameDelay - fTime);
+                ++tick;
+                quit = quit || ((replayPath) ? (!game.isPlayingReplay()) : (tick >= ticks));
+            }
+            else if (frameDelay > fTime)
+            {
+                SDL_Delay(static_cast<Uint32>(frameDelay - fTime));
             }
         }
 
+        if (allocatingFrames > 0)
+        {
+            SDL_Log("Main: %u steady state frames allocated", allocatingFrames);
+        }
+        exitCode = (game.getBroadphaseMismatches() > 0 || game.getFlowFieldMismatches() > 0 || allocatingFrames > 0) ? (1) : (0);
         game.close();
     }
 
-    return 0;
+    return exitCode;
 }
  
\ No newline at end of file
@@ -0,0 +1,153 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* MappedFile maps a whole file read only into memory, so the file's contents are used in place and paged in
+* by the operating system instead of being read through a stream.
+*/
+#include "PCH.h"
+#include "MappedFile.h"
+#ifdef _WIN32
+#include "Windows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/**
+* Default Constructor, nothing is mapped until a file is opened.
+*/
+MappedFile::MappedFile()
+{
+    mData = nullptr;
+    mSize = 0;
+#ifdef _WIN32
+    mFileHandle = INVALID_HANDLE_VALUE;
+    mMappingHandle = nullptr;
+#else
+    mFileDescriptor = -1;
+#endif
+}
+
+
+/**
+* Unmaps the file.
+*/
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+/**
+* Map a file, replacing the file mapped before.
+* @param aPath - The file to map.
+* @return bool True if the file was mapped, otherwise false.
+*/
+bool MappedFile::open(const char* aPath)
+{
+    close();
+
+#ifdef _WIN32
+    mFileHandle = CreateFileA(aPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if (mFileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFileHandle, &size) || size.QuadPart == 0)
+    {
+        // cout << "Failed to open the file to map!\n";
+        close();
+        return false;
+    }
+
+    mMappingHandle = CreateFileMappingA(mFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMappingHandle)
+    {
+        mData = static_cast<const uint8_t*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+    mSize = static_cast<size_t>(size.QuadPart);
+#else
+    mFileDescriptor = ::open(aPath, O_RDONLY);
+    struct stat status;
+    if (mFileDescriptor < 0 || fstat(mFileDescriptor, &status) != 0 || status.st_size == 0)
+    {
+        // cout << "Failed to open the file to map!\n";
+        close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, mFileDescriptor, 0);
+    if (data != MAP_FAILED)
+    {
+        mData = static_cast<const uint8_t*>(data);
+    }
+    mSize = static_cast<size_t>(status.st_size);
+#endif
+
+    if (!mData)
+    {
+        // cout << "Failed to map the file!\n";
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+/**
+* Unmap the file.
+*/
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+    }
+    if (mMappingHandle)
+    {
+        CloseHandle(mMappingHandle);
+        mMappingHandle = nullptr;
+    }
+    if (mFileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFileHandle);
+        mFileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (mData)
+    {
+        munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+    if (mFileDescriptor >= 0)
+    {
+        ::close(mFileDescriptor);
+        mFileDescriptor = -1;
+    }
+#endif
+
+    mData = nullptr;
+    mSize = 0;
+}
+
+
+/**
+* Get the mapped contents, valid until the file is closed.
+* @return const uint8_t* The file's first byte, or nullptr if no file is mapped.
+*/
+const uint8_t* MappedFile::getData() const
+{
+    return mData;
+}
+
+
+/**
+* Get the mapped file's size.
+* @return size_t The size in bytes.
+*/
+size_t MappedFile::getSize() const
+{
+    return mSize;
+}
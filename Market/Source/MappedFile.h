@@ -0,0 +1,63 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* MappedFile maps a whole file read only into memory, so the file's contents are used in place and paged in
+* by the operating system instead of being read through a stream.
+*/
+#pragma once
+#include "PCH.h"
+
+
+class MappedFile
+{
+private:
+    const uint8_t* mData;
+    size_t mSize;
+
+#ifdef _WIN32
+    void* mFileHandle;
+    void* mMappingHandle;
+#else
+    int mFileDescriptor;
+#endif
+
+public:
+    /**
+    * Default Constructor, nothing is mapped until a file is opened.
+    */
+    MappedFile();
+
+    /**
+    * Unmaps the file.
+    */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+    * Map a file, replacing the file mapped before.
+    * @param aPath - The file to map.
+    * @return bool True if the file was mapped, otherwise false.
+    */
+    bool open(const char* aPath);
+
+    /**
+    * Unmap the file.
+    */
+    void close();
+
+    /**
+    * Get the mapped contents, valid until the file is closed.
+    * @return const uint8_t* The file's first byte, or nullptr if no file is mapped.
+    */
+    const uint8_t* getData() const;
+
+    /**
+    * Get the mapped file's size.
+    * @return size_t The size in bytes.
+    */
+    size_t getSize() const;
+};
@@ -1,7 +1,10 @@
 #pragma once
 #include "PCH.h"
 #include "NPC.h"
+#include "WorldSnapshot.h"
 #include "Game.h"
+#include "PerfCounters.h"
+#include "Camera.h"
 
 
 // Construct a non-initialized NPC
@@ -10,6 +13,12 @@ NPC::NPC()
     // Default values, not deliberately specified
     mCurrLocation = mPrevLocation = mTargetLocation = Vector{ 0,0,0 };
     mTimeSinceDirectionReset = 0;
+    mMotionGeneration = 0;
+    mSkippedTime = 0;
+    mSkippingUpdates = false;
+    mFlowField = nullptr;
+    mFlowPinned = false;
+    mFlowCell = FLOW_NO_CELL;
     mCurrAnimTime = 0;
     mTexturePtr = nullptr;
     mTextureFrames = nullptr;
@@ -79,12 +88,10 @@ bool NPC::init(Texture* aTxtrPtr, SDL_Rect aTxtrFrames[], World* aWorld)
                 mTextureFrames = aTxtrFrames;
 
                 // Generate a random location for the NPC to spawn
-                mCurrLocation.x = static_cast<float>(rand() % (SDLManager::mWindowWidth));
-                mCurrLocation.y = static_cast<float>(rand() % (SDLManager::mWindowHeight));
+                mCurrLocation = mWorld->getRandomLocation();
                 mPrevLocation = mCurrLocation;
 
-                mTargetLocation.x = static_cast<float>(rand() % (SDLManager::mWindowWidth));
-                mTargetLocation.y = static_cast<float>(rand() % (SDLManager::mWindowHeight));
+                mTargetLocation = mWorld->getRandomLocation();
                 mWorld->placeEntity(getEntity());
             }
         }
@@ -129,10 +136,15 @@ ETradeState NPC::getTradeState()
 }
 
 
-// NPC's have different speeds
-void NPC::update(const float& dt, const float& aRandomX, const float& aRandomY)
+// NPC's have different speeds, an NPC in a region stepping at a lower rate takes every tick it skipped in one
+// longer step, and isn't animated while nobody can see it
+void NPC::update(const float& dt, const float& aRandomX, const float& aRandomY, const bool& aAnimate)
 {   
-    mTimeSinceDirectionReset += dt;
+    float stepTime = dt + mSkippedTime;
+    mSkippedTime = 0;
+    mSkippingUpdates = false;
+
+    mTimeSinceDirectionReset += stepTime;
     // Generate a new target location to walk to based on if the target location was reached
     if (bNewWalkLocation)
     {
@@ -148,22 +160,79 @@ void NPC::update(const float& dt, const float& aRandomX, const float& aRandomY)
         if ((changeInX * changeInX) + (changeInY * changeInY) < (NPC_TARGET_LOCATION_RANGE * NPC_TARGET_LOCATION_RANGE))
         {
             bNewWalkLocation = true;
+            ++mMotionGeneration;
         }
-        // Otherwise, move closer to the target location
+        // Otherwise, move closer to the target location, a long step stops at the target instead of walking
+        // past it
         else
         {
+            float stepLength = stepTime * mSpeed;
+            float distanceSquared = (changeInX * changeInX) + (changeInY * changeInY);
+            if ((stepLength * stepLength) > distanceSquared)
+            {
+                stepLength = static_cast<float>(sqrt(distanceSquared));
+            }
+
             mPrevLocation = mCurrLocation;
-            mCurrLocation.x += mDirection.x * (dt * mSpeed);
-            mCurrLocation.y += mDirection.y * (dt * mSpeed);
-            MATH::clamp(mCurrLocation, Vector{ static_cast<float>(SDLManager::mWindowWidth), static_cast<float>(SDLManager::mWindowHeight), 0 });
+            if (mWorld->isFlowNavigating())
+            {
+                walkFlowField(stepLength);
+            }
+            else
+            {
+                mCurrLocation.x += mDirection.x * stepLength;
+                mCurrLocation.y += mDirection.y * stepLength;
+            }
+            MATH::clamp(mCurrLocation, Vector{ static_cast<float>(mWorld->getWidth()), static_cast<float>(mWorld->getHeight()), 0 });
             
+            PERF_PHASE(EPerfPhase::REBIN);
             mWorld->placeEntity(getEntity());
         }
     }
 
     // Update and change trade state before setting the current frame
+    if (aAnimate)
+    {
+        animate(stepTime);
+    }
+
+    // The flow field sets the direction each cell while it's followed
+    if (mTimeSinceDirectionReset > NPC_RESET_DIRECTION_TIME && mFlowCell == FLOW_NO_CELL)
+    {
+        setDirection();
+    }
+
+    setOverlappingRug(false);
+}
 
-    // Set the current frame
+
+/**
+* Skip this tick's update, the time is taken in one longer step on the next update.
+* @param dt - The time the skipped tick covers in seconds.
+*/
+void NPC::skipUpdate(const float& dt)
+{
+    mSkippedTime += dt;
+    mSkippingUpdates = true;
+}
+
+
+/**
+* Whether the NPC skipped this tick's update, it doesn't move or trade until its next update.
+* @return {bool} True if the update was skipped, otherwise false.
+*/
+bool NPC::isSkippingUpdates()
+{
+    return mSkippingUpdates;
+}
+
+
+/**
+* Step the walk animation, and set the current frame.
+* @param dt - The time since the last update in seconds.
+*/
+void NPC::animate(const float& dt)
+{
     mCurrAnimTime += dt;
     if (mCurrAnimTime > mAnimationSpeed)
     {
@@ -173,27 +242,39 @@ void NPC::update(const float& dt, const float& aRandomX, const float& aRandomY)
         mCurrFrame += mState * NPC_TRADE_FRAMES;
         mCurrFrame += mCurrStep;
     }
+}
 
-    if (mTimeSinceDirectionReset > NPC_RESET_DIRECTION_TIME)
-    {
-        setDirection();
-    }
 
-    setOverlappingRug(false);
+/**
+* Set the NPC's state from a replay instead of simulating it.
+* @param aLocation  - The NPC's location.
+* @param aDirection - The direction the NPC walks in.
+* @param aState     - The NPC's trade state.
+* @param dt         - The time the replayed tick covers in seconds.
+*/
+void NPC::setReplayState(const Vector& aLocation, const Vector& aDirection, const ETradeState& aState, const float& dt)
+{
+    mPrevLocation = mCurrLocation;
+    mCurrLocation = aLocation;
+    mDirection = aDirection;
+    setTradeState(aState);
+    mWorld->placeEntity(getEntity());
+    animate(dt);
 }
 
 
-// Display NPC to user
-void NPC::render()
+// Display NPC to user, through the camera
+void NPC::render(const Camera& aCamera)
 {
     mTexturePtr->render
     (
-        static_cast<int16_t>(mCurrLocation.x - ((NPC_FRAME_WIDTH * NPC_SCALE) / 2.f)),
-        static_cast<int16_t>(mCurrLocation.y - ((NPC_FRAME_HEIGHT * NPC_SCALE) / 2.f)),
+        aCamera.toScreenX(mCurrLocation.x - ((NPC_FRAME_WIDTH * NPC_SCALE) / 2.f)),
+        aCamera.toScreenY(mCurrLocation.y - ((NPC_FRAME_HEIGHT * NPC_SCALE) / 2.f)),
         &mTextureFrames[static_cast<uint16_t>(mCurrFrame)],
         0,
         nullptr,
-        (mDirection.x < 0)? SDL_FLIP_NONE : SDL_FLIP_HORIZONTAL
+        (mDirection.x < 0)? SDL_FLIP_NONE : SDL_FLIP_HORIZONTAL,
+        aCamera.getZoom()
     );
 }
 
@@ -213,16 +294,29 @@ Entity* NPC::getEntity()
 
 
 /**
-* Given two values between [0,1) generate a random location within the window for the NPC to walk to
+* Given two values between [0,1) generate a random location within the world's layout for the NPC to walk to,
+* or while the world's NPCs seek rugs, walk to the closest rug trading a good other than the NPC's
 * @param aRandomX - Value between [0,1) to set the target x coordinate.
 * @param aRandomY - Value between [0,1) to set the target y coordinate.
 */
 void NPC::setNewWalkLocation(const float& aRandomX, const float& aRandomY)
 {
+    Rug* rug = nullptr;
+    if (mWorld->isSeekingRugs())
+    {
+        rug = mWorld->findRugToSeek(mCurrLocation, getTradeState());
+    }
+
+    // The field leading to the new target replaces the old one's, a field that isn't cached is worked out
+    // before the NPC's next update
+    releaseFlowField();
 
-    // Set target location variables
-    mTargetLocation.x = aRandomX * (SDLManager::mWindowWidth);
-    mTargetLocation.y = aRandomY * (SDLManager::mWindowHeight);
+    // Set target location variables, a random location when there's no rug to walk to
+    mTargetLocation = (rug) ? (rug->getLocation()) : (mWorld->mapLocation(aRandomX, aRandomY));
+    if (mWorld->isFlowNavigating())
+    {
+        acquireFlowField();
+    }
 
     setDirection();
 
@@ -231,6 +325,104 @@ void NPC::setNewWalkLocation(const float& aRandomX, const float& aRandomY)
 }
 
 
+/**
+* Walk along the flow field toward the target, half a cell at a time so a long step can't cut through an
+* obstacle, and straight to the target once the NPC reaches its goal region.
+* @param aStepLength - The distance to walk.
+*/
+void NPC::walkFlowField(const float& aStepLength)
+{
+    // The field requested with the target has been worked out by now, an NPC that started following the
+    // fields mid-walk requests its target's field and waits an update for it
+    if (!mFlowField)
+    {
+        if (mFlowPinned)
+        {
+            mFlowField = mWorld->findFlowField(mTargetLocation);
+        }
+        else
+        {
+            acquireFlowField();
+        }
+
+        if (!mFlowField)
+        {
+            return;
+        }
+    }
+
+    const NavigationGrid& grid = mWorld->getNavigationGrid();
+    float remaining = aStepLength;
+    while (remaining > 0.f)
+    {
+        uint32_t nextCell = FLOW_NO_CELL;
+        EFlowStep step = mFlowField->step(grid, mCurrLocation, nextCell);
+
+        // Nothing leads to the target, a new one is picked on the next update
+        if (step == EFlowStep::UNREACHABLE)
+        {
+            bNewWalkLocation = true;
+            ++mMotionGeneration;
+            return;
+        }
+
+        // Head for the center of the next cell, the direction only changes when the cell does
+        if (step == EFlowStep::FOLLOW)
+        {
+            if (nextCell != mFlowCell)
+            {
+                Vector center = grid.getCellCenter(nextCell);
+                float deltaX = center.x - mCurrLocation.x;
+                float deltaY = center.y - mCurrLocation.y;
+                float length = static_cast<float>(sqrt((deltaX * deltaX) + (deltaY * deltaY)));
+                mDirection.x = deltaX / length;
+                mDirection.y = deltaY / length;
+                mFlowCell = nextCell;
+                mTimeSinceDirectionReset = 0;
+                ++mMotionGeneration;
+            }
+        }
+        // In the goal region, or standing on an obstacle that went up, walk straight to the target
+        else if (mFlowCell != FLOW_NO_CELL)
+        {
+            mFlowCell = FLOW_NO_CELL;
+            setDirection();
+        }
+
+        float stepLength = min(remaining, grid.getCellLength() * .5f);
+        mCurrLocation.x += mDirection.x * stepLength;
+        mCurrLocation.y += mDirection.y * stepLength;
+        remaining -= stepLength;
+    }
+}
+
+
+/**
+* Pin the flow field leading to the target, it's requested from the world if it isn't cached.
+*/
+void NPC::acquireFlowField()
+{
+    mFlowField = mWorld->acquireFlowField(mTargetLocation);
+    mFlowPinned = true;
+}
+
+
+/**
+* Stop following the flow field, it's released back to the world. Must be called before the target
+* changes.
+*/
+void NPC::releaseFlowField()
+{
+    if (mFlowPinned)
+    {
+        mWorld->releaseFlowField(mTargetLocation);
+        mFlowPinned = false;
+    }
+    mFlowField = nullptr;
+    mFlowCell = FLOW_NO_CELL;
+}
+
+
 /**
 *  Set NPC's direction.
 */
@@ -245,6 +437,7 @@ void NPC::setDirection()
     mDirection.x = deltaX / hypotenuse;
     mDirection.y = deltaY / hypotenuse;
     mTimeSinceDirectionReset = 0;
+    ++mMotionGeneration;
 }
 
 
@@ -285,6 +478,57 @@ Vector NPC::getPrevLocation()
 }
 
 
+/**
+* Get the NPC's unit walking direction.
+* @return {Vector} The direction the NPC walks in.
+*/
+Vector NPC::getDirection()
+{
+    return mDirection;
+}
+
+
+/**
+* Get the location the NPC is walking to.
+* @return {Vector} The target location.
+*/
+Vector NPC::getTargetLocation()
+{
+    return mTargetLocation;
+}
+
+
+/**
+* Get the NPC's walking speed.
+* @return {float} The speed in pixels per second.
+*/
+float NPC::getSpeed()
+{
+    return mSpeed;
+}
+
+
+/**
+* Whether the NPC is walking, an NPC that reached its target stands still until it picks a new one.
+* @return {bool} True if the NPC is walking, otherwise false.
+*/
+bool NPC::isWalking()
+{
+    return !bNewWalkLocation;
+}
+
+
+/**
+* Get the NPC's motion generation, between two changes of the generation the NPC walks in a straight
+* line at a constant speed.
+* @return {uint32_t} The motion generation.
+*/
+uint32_t NPC::getMotionGeneration()
+{
+    return mMotionGeneration;
+}
+
+
 /**
 * If the NPC was set to overlap the rug this game tick.
 * @return {bool} Returns the mCurrOverlappingRug value.
@@ -314,3 +558,115 @@ void NPC::setOverlappingRug(const bool& aOverlappingRug)
     mPrevOverlappingRug = mCurrOverlappingRug;
     mCurrOverlappingRug = aOverlappingRug;
 }
+
+
+/**
+* Swap every part of the NPC's state with another NPC, including its unique ID and subspace, so the
+* NPCs can be moved in storage without either changing.
+* @param aOther - The NPC to swap with.
+*/
+void NPC::swapState(NPC& aOther)
+{
+    swapIdentity(aOther);
+
+    uint16_t state = mState.load();
+    mState.store(aOther.mState.load());
+    aOther.mState.store(state);
+
+    swap(mTexturePtr, aOther.mTexturePtr);
+    swap(mTextureFrames, aOther.mTextureFrames);
+    swap(mNPCColor, aOther.mNPCColor);
+    swap(mCurrStep, aOther.mCurrStep);
+    swap(mCurrFrame, aOther.mCurrFrame);
+    swap(mSpeed, aOther.mSpeed);
+    swap(mAnimationSpeed, aOther.mAnimationSpeed);
+    swap(mCurrAnimTime, aOther.mCurrAnimTime);
+    swap(mTimeSinceDirectionReset, aOther.mTimeSinceDirectionReset);
+    swap(mTargetLocation, aOther.mTargetLocation);
+    swap(mDirection, aOther.mDirection);
+    swap(bNewWalkLocation, aOther.bNewWalkLocation);
+    swap(mMotionGeneration, aOther.mMotionGeneration);
+    swap(mSkippedTime, aOther.mSkippedTime);
+    swap(mSkippingUpdates, aOther.mSkippingUpdates);
+    swap(mWorld, aOther.mWorld);
+    swap(mFlowField, aOther.mFlowField);
+    swap(mFlowPinned, aOther.mFlowPinned);
+    swap(mFlowCell, aOther.mFlowCell);
+    swap(mCurrLocation, aOther.mCurrLocation);
+    swap(mPrevLocation, aOther.mPrevLocation);
+    swap(mCurrOverlappingRug, aOther.mCurrOverlappingRug);
+    swap(mPrevOverlappingRug, aOther.mPrevOverlappingRug);
+}
+
+
+/**
+* Save the NPC's state to a world snapshot record.
+* @param aSnapshot - The record.
+*/
+void NPC::saveSnapshot(NPCSnapshot& aSnapshot)
+{
+    aSnapshot = {};
+    aSnapshot.mX = mCurrLocation.x;
+    aSnapshot.mY = mCurrLocation.y;
+    aSnapshot.mPrevX = mPrevLocation.x;
+    aSnapshot.mPrevY = mPrevLocation.y;
+    aSnapshot.mTargetX = mTargetLocation.x;
+    aSnapshot.mTargetY = mTargetLocation.y;
+    aSnapshot.mDirectionX = mDirection.x;
+    aSnapshot.mDirectionY = mDirection.y;
+    aSnapshot.mSpeed = mSpeed;
+    aSnapshot.mAnimationSpeed = mAnimationSpeed;
+    aSnapshot.mCurrAnimTime = mCurrAnimTime;
+    aSnapshot.mTimeSinceDirectionReset = mTimeSinceDirectionReset;
+    aSnapshot.mSkippedTime = mSkippedTime;
+    aSnapshot.mSkippingUpdates = mSkippingUpdates;
+    aSnapshot.mFlowCell = mFlowCell;
+    aSnapshot.mMotionGeneration = mMotionGeneration;
+    aSnapshot.mState = mState;
+    aSnapshot.mColor = static_cast<uint16_t>(mNPCColor);
+    aSnapshot.mCurrStep = mCurrStep;
+    aSnapshot.mCurrFrame = mCurrFrame;
+    aSnapshot.mNewWalkLocation = bNewWalkLocation;
+    aSnapshot.mCurrOverlappingRug = mCurrOverlappingRug;
+    aSnapshot.mPrevOverlappingRug = mPrevOverlappingRug;
+}
+
+
+/**
+* Restore the NPC's state from a world snapshot record, and place it in the world.
+* @param aSnapshot - The record.
+*/
+void NPC::restoreSnapshot(const NPCSnapshot& aSnapshot)
+{
+    // The old target's field is released before the target changes
+    releaseFlowField();
+
+    mCurrLocation = { aSnapshot.mX, aSnapshot.mY, 0 };
+    mPrevLocation = { aSnapshot.mPrevX, aSnapshot.mPrevY, 0 };
+    mTargetLocation = { aSnapshot.mTargetX, aSnapshot.mTargetY, 0 };
+    mDirection = { aSnapshot.mDirectionX, aSnapshot.mDirectionY, 0 };
+    mSpeed = aSnapshot.mSpeed;
+    mAnimationSpeed = aSnapshot.mAnimationSpeed;
+    mCurrAnimTime = aSnapshot.mCurrAnimTime;
+    mTimeSinceDirectionReset = aSnapshot.mTimeSinceDirectionReset;
+    mSkippedTime = aSnapshot.mSkippedTime;
+    mSkippingUpdates = (aSnapshot.mSkippingUpdates != 0);
+    mState = aSnapshot.mState;
+    mNPCColor = static_cast<EColor>(aSnapshot.mColor);
+    mCurrStep = aSnapshot.mCurrStep;
+    mCurrFrame = aSnapshot.mCurrFrame;
+    bNewWalkLocation = (aSnapshot.mNewWalkLocation != 0);
+    mCurrOverlappingRug = (aSnapshot.mCurrOverlappingRug != 0);
+    mPrevOverlappingRug = (aSnapshot.mPrevOverlappingRug != 0);
+    mMotionGeneration = aSnapshot.mMotionGeneration;
+
+    // The field for the restored target is worked out before the next update, the NPC keeps heading for
+    // the cell it was so it doesn't turn
+    if (mWorld->isFlowNavigating())
+    {
+        acquireFlowField();
+    }
+    mFlowCell = aSnapshot.mFlowCell;
+
+    mWorld->placeEntity(getEntity());
+}
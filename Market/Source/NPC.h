@@ -13,6 +13,7 @@
 #include "Texture.h"
 #include "Timer.h"
 #include "World.h"
+struct NPCSnapshot;
 
 
 // The NPC's color
@@ -60,9 +61,24 @@ private:
     Vector mDirection;
     bool bNewWalkLocation;
 
+    // Changes every time the NPC's straight line motion changes, it stops walking or picks a new direction
+    uint32_t mMotionGeneration;
+
+    // Time the NPC skipped while its region stepped at a lower rate, taken in one step on its next update,
+    // and whether it skipped this tick
+    float mSkippedTime;
+    bool mSkippingUpdates;
+
     // Reference to the world
     World* mWorld;
 
+    // The flow field leading to the target while the world's NPCs follow them, whether the NPC holds a pin
+    // on the target's field, worked out or still requested, and the cell the NPC is walking to the center
+    // of, FLOW_NO_CELL while it walks straight to the target
+    FlowField* mFlowField;
+    bool mFlowPinned;
+    uint32_t mFlowCell;
+
     // The NPC's current location
     Vector mCurrLocation;
     // The NPC's previous location
@@ -75,6 +91,30 @@ private:
     // Set NPC's direction
     void setDirection();
 
+    /**
+    * Walk along the flow field toward the target, half a cell at a time so a long step can't cut through an
+    * obstacle, and straight to the target once the NPC reaches its goal region.
+    * @param aStepLength - The distance to walk.
+    */
+    void walkFlowField(const float& aStepLength);
+
+    /**
+    * Pin the flow field leading to the target, it's requested from the world if it isn't cached.
+    */
+    void acquireFlowField();
+
+    /**
+    * Stop following the flow field, it's released back to the world. Must be called before the target
+    * changes.
+    */
+    void releaseFlowField();
+
+    /**
+    * Step the walk animation, and set the current frame.
+    * @param dt - The time since the last update in seconds.
+    */
+    void animate(const float& dt);
+
 public:
     // Default initialize the NPC, the NPC will not be properly initialized until it is
     // initialized with init(..)
@@ -86,8 +126,8 @@ public:
     // Properly initialize the NPC
     bool init(Texture* aTxtrPtr, SDL_Rect aTxtrFrames[], World* aWorld);
 
-    // Display NPC to user
-    void render();
+    // Display NPC to user, through the camera
+    void render(const Camera& aCamera);
 
     /**
     * Set this Rug's current trade state to the argument trade state.
@@ -101,9 +141,30 @@ public:
     */
     ETradeState getTradeState();
 
-    // Update the NPC
-    void update(const float& dt, const float& aRandomX, const float& aRandomY);
+    // Update the NPC over dt and any time it skipped, animating it only when it can be seen
+    void update(const float& dt, const float& aRandomX, const float& aRandomY, const bool& aAnimate = true);
+
+    /**
+    * Skip this tick's update, the time is taken in one longer step on the next update.
+    * @param dt - The time the skipped tick covers in seconds.
+    */
+    void skipUpdate(const float& dt);
+
+    /**
+    * Whether the NPC skipped this tick's update, it doesn't move or trade until its next update.
+    * @return {bool} True if the update was skipped, otherwise false.
+    */
+    bool isSkippingUpdates();
     
+    /**
+    * Set the NPC's state from a replay instead of simulating it.
+    * @param aLocation  - The NPC's location.
+    * @param aDirection - The direction the NPC walks in.
+    * @param aState     - The NPC's trade state.
+    * @param dt         - The time the replayed tick covers in seconds.
+    */
+    void setReplayState(const Vector& aLocation, const Vector& aDirection, const ETradeState& aState, const float& dt);
+
     // Generate new walk location of the NPC  
     void setNewWalkLocation(const float& aRandomX, const float& aRandomY);
     
@@ -130,6 +191,37 @@ public:
     */
     Vector getPrevLocation();
 
+    /**
+    * Get the NPC's unit walking direction.
+    * @return {Vector} The direction the NPC walks in.
+    */
+    Vector getDirection();
+
+    /**
+    * Get the location the NPC is walking to.
+    * @return {Vector} The target location.
+    */
+    Vector getTargetLocation();
+
+    /**
+    * Get the NPC's walking speed.
+    * @return {float} The speed in pixels per second.
+    */
+    float getSpeed();
+
+    /**
+    * Whether the NPC is walking, an NPC that reached its target stands still until it picks a new one.
+    * @return {bool} True if the NPC is walking, otherwise false.
+    */
+    bool isWalking();
+
+    /**
+    * Get the NPC's motion generation, between two changes of the generation the NPC walks in a straight
+    * line at a constant speed.
+    * @return {uint32_t} The motion generation.
+    */
+    uint32_t getMotionGeneration();
+
     /**
     * If the NPC was set to overlap the rug this game tick.
     * @return {bool} Returns the mCurrOverlappingRug value.
@@ -147,4 +239,23 @@ public:
     * @param aOverlapping - The new overlap state of the rug
     */
     void setOverlappingRug(const bool& aOverlapping);
+
+    /**
+    * Swap every part of the NPC's state with another NPC, including its unique ID and subspace, so the
+    * NPCs can be moved in storage without either changing.
+    * @param aOther - The NPC to swap with.
+    */
+    void swapState(NPC& aOther);
+
+    /**
+    * Save the NPC's state to a world snapshot record.
+    * @param aSnapshot - The record.
+    */
+    void saveSnapshot(NPCSnapshot& aSnapshot);
+
+    /**
+    * Restore the NPC's state from a world snapshot record, and place it in the world.
+    * @param aSnapshot - The record.
+    */
+    void restoreSnapshot(const NPCSnapshot& aSnapshot);
 };
\ No newline at end of file
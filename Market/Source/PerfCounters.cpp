@@ -0,0 +1,326 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* PerfCounters attributes hardware performance counters (cycles, instructions, L1/LLC misses, and branch
+* misses) to the phases of the simulation. Each thread opens its own perf_event group on Linux, every other
+* platform, or a Linux box where the counters are unavailable (e.g. inside a container), falls back to
+* no-op scopes.
+*/
+#include "PCH.h"
+#include "PerfCounters.h"
+#include <SDL.h>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+atomic<bool> PerfCounters::sEnabled(false);
+atomic<uint64_t> PerfCounters::sTotals[static_cast<size_t>(EPerfPhase::COUNT)][static_cast<size_t>(EPerfCounter::COUNT)] = {};
+atomic<uint32_t> PerfCounters::sOpenedThreads(0);
+atomic<uint32_t> PerfCounters::sFailedThreads(0);
+
+// Names used in the report
+static const char* const PERF_PHASE_NAMES[] = { "movement", "rebin", "order", "trade", "render-record" };
+
+// Number of counters in a group
+constexpr size_t PERF_COUNTERS = static_cast<size_t>(EPerfCounter::COUNT);
+
+
+/**
+* The counter group owned by a single thread, and the stack of phases the thread is in.
+*/
+struct PerfThreadState
+{
+    bool mOpened;
+    bool mAvailable;
+
+    // The group leader, and which slot of a group read each counter lands in (-1 if unavailable)
+    int mLeaderFd;
+    int mReadSlot[PERF_COUNTERS];
+    int mFds[PERF_COUNTERS];
+    int mOpenedCount;
+
+    // The counter values at the last phase transition
+    uint64_t mLastReading[PERF_COUNTERS];
+
+    // The phases the thread is nested in
+    EPerfPhase mPhaseStack[MAX_PERF_PHASE_DEPTH];
+    uint32_t mDepth;
+
+    PerfThreadState()
+    {
+        mOpened      = false;
+        mAvailable   = false;
+        mLeaderFd    = -1;
+        mOpenedCount = 0;
+        mDepth       = 0;
+        for (size_t i = 0; i < PERF_COUNTERS; ++i)
+        {
+            mReadSlot[i]    = -1;
+            mFds[i]         = -1;
+            mLastReading[i] = 0;
+        }
+    }
+
+    ~PerfThreadState()
+    {
+#ifdef __linux__
+        for (size_t i = 0; i < PERF_COUNTERS; ++i)
+        {
+            if (mFds[i] >= 0)
+            {
+                close(mFds[i]);
+            }
+        }
+#endif
+    }
+
+    /**
+    * Open the thread's counter group, counters the machine does not support are skipped.
+    */
+    void open()
+    {
+        mOpened = true;
+
+#ifdef __linux__
+        const uint32_t types[PERF_COUNTERS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+        const uint64_t configs[PERF_COUNTERS] =
+        {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for (size_t i = 0; i < PERF_COUNTERS; ++i)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size           = sizeof(attr);
+            attr.type           = types[i];
+            attr.config         = configs[i];
+            attr.read_format    = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+
+            // Count the calling thread on any cpu, the first counter that opens leads the group
+            int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, mLeaderFd, 0));
+            if (fd >= 0)
+            {
+                if (mLeaderFd < 0)
+                {
+                    mLeaderFd = fd;
+                }
+                mFds[i] = fd;
+                mReadSlot[i] = mOpenedCount++;
+            }
+        }
+#endif
+
+        mAvailable = (mLeaderFd >= 0);
+    }
+
+    /**
+    * Read every counter in the group.
+    * @param aValues - Receives each counter's value, unavailable counters read as 0.
+    * @return bool True if the read succeeded, otherwise false.
+    */
+    bool read(uint64_t aValues[])
+    {
+#ifdef __linux__
+        // PERF_FORMAT_GROUP layout, the number of counters followed by each counter's value
+        uint64_t buffer[1 + PERF_COUNTERS];
+        if (::read(mLeaderFd, buffer, sizeof(buffer)) <= 0)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < PERF_COUNTERS; ++i)
+        {
+            aValues[i] = (mReadSlot[i] >= 0) ? (buffer[1 + mReadSlot[i]]) : (0);
+        }
+        return true;
+#else
+        (void)aValues;
+        return false;
+#endif
+    }
+
+    /**
+    * Charge the counters since the last transition to the innermost phase.
+    * @param aTotals - The global per phase totals.
+    */
+    void chargeCurrentPhase(atomic<uint64_t> aTotals[][PERF_COUNTERS])
+    {
+        uint64_t reading[PERF_COUNTERS];
+        if (!read(reading))
+        {
+            return;
+        }
+
+        if (mDepth > 0)
+        {
+            size_t phase = static_cast<size_t>(mPhaseStack[mDepth - 1]);
+            for (size_t i = 0; i < PERF_COUNTERS; ++i)
+            {
+                aTotals[phase][i].fetch_add(reading[i] - mLastReading[i], memory_order_relaxed);
+            }
+        }
+
+        memcpy(mLastReading, reading, sizeof(reading));
+    }
+};
+
+
+/**
+* Get the calling thread's counter state, opening its counters the first time.
+* @param aOpened - Incremented when the thread's counters open.
+* @param aFailed - Incremented when the thread's counters are unavailable.
+* @return PerfThreadState& The thread's state.
+*/
+static PerfThreadState& getThreadState(atomic<uint32_t>& aOpened, atomic<uint32_t>& aFailed)
+{
+    static thread_local PerfThreadState state;
+
+    if (!state.mOpened)
+    {
+        state.open();
+        ++(state.mAvailable ? aOpened : aFailed);
+    }
+    return state;
+}
+
+
+/**
+* Whether phase scopes are currently sampling the counters.
+* @return bool True if profiling is enabled, otherwise false.
+*/
+bool PerfCounters::isEnabled()
+{
+    return sEnabled.load(memory_order_relaxed);
+}
+
+
+/**
+* Clear the totals and start attributing counters to phases.
+*/
+void PerfCounters::start()
+{
+    for (auto& phase : sTotals)
+    {
+        for (auto& counter : phase)
+        {
+            counter = 0;
+        }
+    }
+    sEnabled = true;
+}
+
+
+/**
+* Stop attributing counters and write each phase's totals to the log.
+*/
+void PerfCounters::stop()
+{
+    sEnabled = false;
+
+    if (sOpenedThreads == 0)
+    {
+        SDL_Log("Hardware counters unavailable on this machine (%u threads tried), no phase profile recorded\n", sFailedThreads.load());
+        return;
+    }
+
+    SDL_Log("%-14s %14s %14s %6s %12s %12s %12s\n", "phase", "cycles", "instructions", "IPC", "L1D miss", "LLC miss", "branch miss");
+    for (size_t phase = 0; phase < static_cast<size_t>(EPerfPhase::COUNT); ++phase)
+    {
+        uint64_t cycles       = sTotals[phase][static_cast<size_t>(EPerfCounter::CYCLES)];
+        uint64_t instructions = sTotals[phase][static_cast<size_t>(EPerfCounter::INSTRUCTIONS)];
+        SDL_Log("%-14s %14llu %14llu %6.2f %12llu %12llu %12llu\n",
+            PERF_PHASE_NAMES[phase],
+            static_cast<unsigned long long>(cycles),
+            static_cast<unsigned long long>(instructions),
+            cycles ? (static_cast<double>(instructions) / cycles) : (0.0),
+            static_cast<unsigned long long>(sTotals[phase][static_cast<size_t>(EPerfCounter::L1D_MISSES)].load()),
+            static_cast<unsigned long long>(sTotals[phase][static_cast<size_t>(EPerfCounter::LLC_MISSES)].load()),
+            static_cast<unsigned long long>(sTotals[phase][static_cast<size_t>(EPerfCounter::BRANCH_MISSES)].load()));
+    }
+
+    if (sFailedThreads)
+    {
+        SDL_Log("%u threads could not open hardware counters and were not profiled\n", sFailedThreads.load());
+    }
+}
+
+
+/**
+* Whether any thread was able to open its counters.
+* @return bool True if the phases are being sampled, otherwise false.
+*/
+bool PerfCounters::isAvailable()
+{
+    return sOpenedThreads > 0;
+}
+
+
+/**
+* Get a counter's total for a phase since profiling was last started.
+* @param aPhase   - The phase.
+* @param aCounter - The counter.
+* @return uint64_t The counter's total.
+*/
+uint64_t PerfCounters::getTotal(const EPerfPhase& aPhase, const EPerfCounter& aCounter)
+{
+    return sTotals[static_cast<size_t>(aPhase)][static_cast<size_t>(aCounter)];
+}
+
+
+/**
+* Get a phase's name, as it's written to the log.
+* @param aPhase - The phase.
+* @return const char* The phase's name.
+*/
+const char* PerfCounters::getPhaseName(const EPerfPhase& aPhase)
+{
+    return PERF_PHASE_NAMES[static_cast<size_t>(aPhase)];
+}
+
+
+/**
+* Enter a phase on the calling thread, the counters since the last transition are charged to the
+* phase being left.
+* @param aPhase - The phase being entered.
+* @return bool True if the phase was entered and leavePhase() must be called, otherwise false.
+*/
+bool PerfCounters::enterPhase(const EPerfPhase& aPhase)
+{
+    PerfThreadState& state = getThreadState(sOpenedThreads, sFailedThreads);
+    if (!state.mAvailable || state.mDepth >= MAX_PERF_PHASE_DEPTH)
+    {
+        return false;
+    }
+
+    state.chargeCurrentPhase(sTotals);
+    state.mPhaseStack[state.mDepth++] = aPhase;
+    return true;
+}
+
+
+/**
+* Leave the innermost phase on the calling thread, and resume the enclosing phase.
+*/
+void PerfCounters::leavePhase()
+{
+    PerfThreadState& state = getThreadState(sOpenedThreads, sFailedThreads);
+    if (state.mAvailable && state.mDepth > 0)
+    {
+        state.chargeCurrentPhase(sTotals);
+        --state.mDepth;
+    }
+}
@@ -0,0 +1,135 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* PerfCounters attributes hardware performance counters (cycles, instructions, L1/LLC misses, and branch
+* misses) to the phases of the simulation. Each thread opens its own perf_event group on Linux, every other
+* platform, or a Linux box where the counters are unavailable (e.g. inside a container), falls back to
+* no-op scopes.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// The simulation phases counters are attributed to
+enum class EPerfPhase
+{
+    MOVEMENT,
+    REBIN,
+    ORDER,
+    TRADE,
+    RENDER_RECORD,
+    COUNT
+};
+
+
+// The hardware counters collected for every phase
+enum class EPerfCounter
+{
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    COUNT
+};
+
+
+// Deepest nesting of phase scopes on a single thread
+constexpr uint32_t MAX_PERF_PHASE_DEPTH = 8;
+
+
+class PerfCounters
+{
+private:
+    // Whether phase scopes are currently sampling the counters
+    static atomic<bool> sEnabled;
+
+    // Counter totals of every phase since profiling was enabled, and the number of threads that could
+    // or could not open their counters
+    static atomic<uint64_t> sTotals[static_cast<size_t>(EPerfPhase::COUNT)][static_cast<size_t>(EPerfCounter::COUNT)];
+    static atomic<uint32_t> sOpenedThreads;
+    static atomic<uint32_t> sFailedThreads;
+
+public:
+    /**
+    * Whether phase scopes are currently sampling the counters.
+    * @return bool True if profiling is enabled, otherwise false.
+    */
+    static bool isEnabled();
+
+    /**
+    * Clear the totals and start attributing counters to phases.
+    */
+    static void start();
+
+    /**
+    * Stop attributing counters and write each phase's totals to the log.
+    */
+    static void stop();
+
+    /**
+    * Whether any thread was able to open its counters.
+    * @return bool True if the phases are being sampled, otherwise false.
+    */
+    static bool isAvailable();
+
+    /**
+    * Get a counter's total for a phase since profiling was last started.
+    * @param aPhase   - The phase.
+    * @param aCounter - The counter.
+    * @return uint64_t The counter's total.
+    */
+    static uint64_t getTotal(const EPerfPhase& aPhase, const EPerfCounter& aCounter);
+
+    /**
+    * Get a phase's name, as it's written to the log.
+    * @param aPhase - The phase.
+    * @return const char* The phase's name.
+    */
+    static const char* getPhaseName(const EPerfPhase& aPhase);
+
+    /**
+    * Enter a phase on the calling thread, the counters since the last transition are charged to the
+    * phase being left.
+    * @param aPhase - The phase being entered.
+    * @return bool True if the phase was entered and leavePhase() must be called, otherwise false.
+    */
+    static bool enterPhase(const EPerfPhase& aPhase);
+
+    /**
+    * Leave the innermost phase on the calling thread, and resume the enclosing phase.
+    */
+    static void leavePhase();
+};
+
+
+/**
+* Charges the counters to a phase for the lifetime of the scope, nested scopes are charged exclusively.
+*/
+class PerfPhaseScope
+{
+private:
+    bool mActive;
+
+public:
+    explicit PerfPhaseScope(const EPerfPhase& aPhase)
+    {
+        mActive = PerfCounters::isEnabled() && PerfCounters::enterPhase(aPhase);
+    }
+
+    ~PerfPhaseScope()
+    {
+        if (mActive)
+        {
+            PerfCounters::leavePhase();
+        }
+    }
+};
+
+
+// Charge the rest of the enclosing scope to PHASE
+#define PERF_PHASE_CONCAT_INNER(A, B) A##B
+#define PERF_PHASE_CONCAT(A, B) PERF_PHASE_CONCAT_INNER(A, B)
+#define PERF_PHASE(PHASE) PerfPhaseScope PERF_PHASE_CONCAT(perfPhaseScope, __LINE__)(PHASE)
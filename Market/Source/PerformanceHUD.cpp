@@ -0,0 +1,291 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* PerformanceHUD draws the FrameStats as an overlay. Text is drawn with a tiny built in bitmap font, every
+* lit glyph row is merged into a rectangle and the whole overlay is submitted with a handful of
+* SDL_RenderFillRects calls so it barely shows up in the numbers it displays.
+*/
+#include "PCH.h"
+#include "PerformanceHUD.h"
+#include "FrameStats.h"
+#include "Camera.h"
+
+
+// Dimensions of a bitmap font glyph in font pixels, and the advance to the next glyph
+constexpr int GLYPH_WIDTH   = 3;
+constexpr int GLYPH_HEIGHT  = 5;
+constexpr int GLYPH_ADVANCE = GLYPH_WIDTH + 1;
+constexpr int LINE_ADVANCE  = GLYPH_HEIGHT + 2;
+
+// Width of the phase split bar in window pixels
+constexpr int HUD_BAR_WIDTH  = 320;
+constexpr int HUD_BAR_HEIGHT = 6;
+
+
+/**
+* Get the 3x5 bitmap of a character, each row's three bits are read left to right from the 4's bit.
+* @param aCharacter - The character to look up.
+* @return const uint8_t* The five rows of the glyph, or nullptr if the character has no glyph.
+*/
+static const uint8_t* getGlyph(char aCharacter)
+{
+    static const uint8_t DIGITS[10][GLYPH_HEIGHT] =
+    {
+        { 7,5,5,5,7 }, { 2,6,2,2,7 }, { 7,1,7,4,7 }, { 7,1,3,1,7 }, { 5,5,7,1,1 },
+        { 7,4,7,1,7 }, { 7,4,7,5,7 }, { 7,1,1,1,1 }, { 7,5,7,5,7 }, { 7,5,7,1,7 }
+    };
+    static const uint8_t LETTERS[26][GLYPH_HEIGHT] =
+    {
+        { 2,5,7,5,5 }, { 6,5,6,5,6 }, { 3,4,4,4,3 }, { 6,5,5,5,6 }, { 7,4,6,4,7 }, { 7,4,6,4,4 },
+        { 3,4,5,5,3 }, { 5,5,7,5,5 }, { 7,2,2,2,7 }, { 1,1,1,5,2 }, { 5,5,6,5,5 }, { 4,4,4,4,7 },
+        { 5,7,7,5,5 }, { 6,5,5,5,5 }, { 2,5,5,5,2 }, { 6,5,6,4,4 }, { 2,5,5,6,3 }, { 6,5,6,5,5 },
+        { 3,4,2,1,6 }, { 7,2,2,2,2 }, { 5,5,5,5,7 }, { 5,5,5,5,2 }, { 5,5,7,7,5 }, { 5,5,2,5,5 },
+        { 5,5,2,2,2 }, { 7,1,2,4,7 }
+    };
+    static const uint8_t PERIOD[GLYPH_HEIGHT]  = { 0,0,0,0,2 };
+    static const uint8_t COLON[GLYPH_HEIGHT]   = { 0,2,0,2,0 };
+    static const uint8_t SLASH[GLYPH_HEIGHT]   = { 1,1,2,4,4 };
+    static const uint8_t PERCENT[GLYPH_HEIGHT] = { 5,1,2,4,5 };
+    static const uint8_t DASH[GLYPH_HEIGHT]    = { 0,0,7,0,0 };
+
+    if (aCharacter >= '0' && aCharacter <= '9')
+    {
+        return DIGITS[aCharacter - '0'];
+    }
+    if (aCharacter >= 'a' && aCharacter <= 'z')
+    {
+        aCharacter = static_cast<char>(aCharacter - 'a' + 'A');
+    }
+    if (aCharacter >= 'A' && aCharacter <= 'Z')
+    {
+        return LETTERS[aCharacter - 'A'];
+    }
+
+    switch (aCharacter)
+    {
+    case '.':
+        return PERIOD;
+    case ':':
+        return COLON;
+    case '/':
+        return SLASH;
+    case '%':
+        return PERCENT;
+    case '-':
+        return DASH;
+    default:
+        return nullptr;
+    }
+}
+
+
+/**
+* Default Constructor, the overlay starts hidden.
+*/
+PerformanceHUD::PerformanceHUD()
+{
+    mTextRectCount = 0;
+    mVisible = false;
+
+    for (atomic<uint64_t>& goodsReceived : mGoodsReceived)
+    {
+        goodsReceived = 0;
+    }
+    mLastTradeLocation = 0;
+    mTraded = false;
+}
+
+
+/**
+* Show or hide the overlay.
+*/
+void PerformanceHUD::toggle()
+{
+    mVisible = !mVisible;
+}
+
+
+/**
+* Whether the overlay is drawn.
+* @return bool True if the overlay is visible, otherwise false.
+*/
+bool PerformanceHUD::isVisible()
+{
+    return mVisible;
+}
+
+
+/**
+* Add a line of text to the text rectangles.
+* @param aText - The text, lowercase letters are drawn as uppercase and unknown characters as spaces.
+* @param aX    - The left edge of the text.
+* @param aY    - The top edge of the text.
+*/
+void PerformanceHUD::addText(const char* aText, int aX, int aY)
+{
+    for (const char* character = aText; *character; ++character, aX += GLYPH_ADVANCE * HUD_PIXEL_SCALE)
+    {
+        const uint8_t* glyph = getGlyph(*character);
+        if (!glyph)
+        {
+            continue;
+        }
+
+        for (int row = 0; row < GLYPH_HEIGHT; ++row)
+        {
+            // Merge each run of lit pixels in the row into one rectangle
+            int col = 0;
+            while (col < GLYPH_WIDTH)
+            {
+                if (!(glyph[row] & (4 >> col)))
+                {
+                    ++col;
+                    continue;
+                }
+
+                int runStart = col;
+                while (col < GLYPH_WIDTH && (glyph[row] & (4 >> col)))
+                {
+                    ++col;
+                }
+
+                if (mTextRectCount < HUD_MAX_RECTS)
+                {
+                    mTextRects[mTextRectCount++] =
+                    {
+                        aX + (runStart * HUD_PIXEL_SCALE),
+                        aY + (row * HUD_PIXEL_SCALE),
+                        (col - runStart) * HUD_PIXEL_SCALE,
+                        HUD_PIXEL_SCALE
+                    };
+                }
+            }
+        }
+    }
+}
+
+
+/**
+* Draw the overlay.
+* @param aRenderer    - The renderer to draw with.
+* @param aEntityCount - The number of entities in the world.
+* @param aCamera      - The view of the world drawn in the window, the last trade is marked through it.
+*/
+void PerformanceHUD::render(SDL_Renderer* aRenderer, const uint32_t& aEntityCount, const Camera& aCamera)
+{
+    if (!mVisible)
+    {
+        return;
+    }
+
+    float frameMean  = FrameStats::getMean(EFramePhase::FRAME);
+    float updateMean = FrameStats::getMean(EFramePhase::UPDATE);
+    float orderMean  = FrameStats::getMean(EFramePhase::ORDER);
+    float tradeMean  = FrameStats::getMean(EFramePhase::TRADE);
+    float renderMean = FrameStats::getMean(EFramePhase::RENDER);
+
+    // Build the text for this frame
+    char line[128];
+    int lineHeight = LINE_ADVANCE * HUD_PIXEL_SCALE;
+    int x = HUD_MARGIN * 2;
+    int y = HUD_MARGIN * 2;
+    mTextRectCount = 0;
+
+    snprintf(line, sizeof(line), "FPS %.1f  FRAME P50 %.2f P99 %.2f MS", (frameMean > 0) ? (1000.f / frameMean) : (0.f),
+        FrameStats::getPercentile(EFramePhase::FRAME, .5f), FrameStats::getPercentile(EFramePhase::FRAME, .99f));
+    addText(line, x, y);
+    y += lineHeight;
+
+    snprintf(line, sizeof(line), "UPDATE %.2f  ORDER %.2f  TRADE %.2f  RENDER %.2f MS", updateMean, orderMean, tradeMean, renderMean);
+    addText(line, x, y);
+    y += lineHeight;
+
+    snprintf(line, sizeof(line), "UPDATE P99 %.2f  RENDER P99 %.2f MS", FrameStats::getPercentile(EFramePhase::UPDATE, .99f),
+        FrameStats::getPercentile(EFramePhase::RENDER, .99f));
+    addText(line, x, y);
+    y += lineHeight;
+
+    snprintf(line, sizeof(line), "ENTITIES %u  TRADES/S %.1f  UPDATES SAVED/S %.0f", aEntityCount, FrameStats::getTradesPerSecond(),
+        FrameStats::getSkippedUpdatesPerSecond());
+    addText(line, x, y);
+    y += lineHeight;
+
+    snprintf(line, sizeof(line), "SUBSPACE %.0f PX  OCCUPANCY AVG %.1f MAX %u", FrameStats::getTileLength(),
+        FrameStats::getAverageOccupancy(), FrameStats::getMaxOccupancy());
+    addText(line, x, y);
+    y += lineHeight;
+
+    snprintf(line, sizeof(line), "RECEIVED CHICKEN %llu LAMB %llu BREAD %llu  DROPPED %llu",
+        static_cast<unsigned long long>(mGoodsReceived[0].load(memory_order_relaxed)), static_cast<unsigned long long>(mGoodsReceived[1].load(memory_order_relaxed)),
+        static_cast<unsigned long long>(mGoodsReceived[2].load(memory_order_relaxed)), static_cast<unsigned long long>(TradeEvents::getDropped()));
+    addText(line, x, y);
+    y += lineHeight;
+
+    // Split bar, each phase's share of the mean frame time
+    SDL_Rect bars[4];
+    const float phaseMeans[4] = { updateMean, orderMean, tradeMean, renderMean };
+    const Uint8 barColors[4][3] = { { 0x4C, 0xD9, 0x64 }, { 0xFF, 0xD6, 0x0A }, { 0xFF, 0x91, 0x00 }, { 0x40, 0x9C, 0xFF } };
+    int barX = x;
+    for (int i = 0; i < 4; ++i)
+    {
+        int width = (frameMean > 0) ? (static_cast<int>(HUD_BAR_WIDTH * min(phaseMeans[i] / frameMean, 1.f))) : (0);
+        bars[i] = { barX, y, width, HUD_BAR_HEIGHT };
+        barX += width;
+    }
+    y += HUD_BAR_HEIGHT;
+
+    // Submit the panel, the text in one batch, and the bars
+    SDL_BlendMode prevBlendMode;
+    SDL_GetRenderDrawBlendMode(aRenderer, &prevBlendMode);
+    SDL_SetRenderDrawBlendMode(aRenderer, SDL_BLENDMODE_BLEND);
+
+    SDL_Rect panel = { HUD_MARGIN, HUD_MARGIN, max(HUD_BAR_WIDTH, 60 * GLYPH_ADVANCE * HUD_PIXEL_SCALE) + (HUD_MARGIN * 2), (y - HUD_MARGIN) + HUD_MARGIN };
+    SDL_SetRenderDrawColor(aRenderer, 0x00, 0x00, 0x00, 0xA0);
+    SDL_RenderFillRect(aRenderer, &panel);
+
+    SDL_SetRenderDrawColor(aRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    SDL_RenderFillRects(aRenderer, mTextRects, static_cast<int>(mTextRectCount));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        SDL_SetRenderDrawColor(aRenderer, barColors[i][0], barColors[i][1], barColors[i][2], 0xFF);
+        SDL_RenderFillRect(aRenderer, &bars[i]);
+    }
+
+    // Mark where the last trade happened, if the camera can see it
+    if (mTraded.load(memory_order_relaxed))
+    {
+        uint64_t location = mLastTradeLocation.load(memory_order_relaxed);
+        float tradeX = static_cast<float>(static_cast<int32_t>(location >> 32));
+        float tradeY = static_cast<float>(static_cast<int32_t>(location & 0xFFFFFFFF));
+
+        Vector viewMin;
+        Vector viewMax;
+        aCamera.getView(viewMin, viewMax);
+        if (tradeX >= viewMin.x && tradeX <= viewMax.x && tradeY >= viewMin.y && tradeY <= viewMax.y)
+        {
+            SDL_Rect marker = { aCamera.toScreenX(tradeX) - (HUD_MARGIN / 2), aCamera.toScreenY(tradeY) - (HUD_MARGIN / 2), HUD_MARGIN, HUD_MARGIN };
+            SDL_SetRenderDrawColor(aRenderer, 0xFF, 0xD6, 0x0A, 0xFF);
+            SDL_RenderFillRect(aRenderer, &marker);
+        }
+    }
+
+    SDL_SetRenderDrawBlendMode(aRenderer, prevBlendMode);
+}
+
+
+/**
+* Count a trade for the overlay, called on the trade event consumer thread.
+* @param aEvent - The trade.
+*/
+void PerformanceHUD::consume(const TradeEvent& aEvent)
+{
+    if (aEvent.mReceived < 3)
+    {
+        mGoodsReceived[aEvent.mReceived].fetch_add(1, memory_order_relaxed);
+    }
+    mLastTradeLocation.store((static_cast<uint64_t>(static_cast<uint32_t>(aEvent.mX)) << 32) | static_cast<uint32_t>(aEvent.mY), memory_order_relaxed);
+    mTraded.store(true, memory_order_relaxed);
+}
@@ -0,0 +1,79 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* PerformanceHUD draws the FrameStats as an overlay. Text is drawn with a tiny built in bitmap font, every
+* lit glyph row is merged into a rectangle and the whole overlay is submitted with a handful of
+* SDL_RenderFillRects calls so it barely shows up in the numbers it displays.
+*/
+#pragma once
+#include "PCH.h"
+#include "TradeEvents.h"
+#include <SDL.h>
+class Camera;
+
+
+// Maximum number of rectangles the overlay submits per frame
+constexpr uint32_t HUD_MAX_RECTS   = 4096;
+
+// Size in pixels of one bitmap font pixel, and the overlay's margin from the window corner
+constexpr int HUD_PIXEL_SCALE      = 2;
+constexpr int HUD_MARGIN           = 8;
+
+
+class PerformanceHUD : public TradeEventConsumer
+{
+private:
+    // The goods the NPCs received, and where the last trade happened packed as (x << 32) | y, written by the
+    // trade event consumer thread
+    atomic<uint64_t> mGoodsReceived[3];
+    atomic<uint64_t> mLastTradeLocation;
+    atomic<bool> mTraded;
+
+    // The text rectangles collected for this frame
+    SDL_Rect mTextRects[HUD_MAX_RECTS];
+    uint32_t mTextRectCount;
+
+    // Whether the overlay is drawn
+    bool mVisible;
+
+    /**
+    * Add a line of text to the text rectangles.
+    * @param aText - The text, lowercase letters are drawn as uppercase and unknown characters as spaces.
+    * @param aX    - The left edge of the text.
+    * @param aY    - The top edge of the text.
+    */
+    void addText(const char* aText, int aX, int aY);
+
+public:
+    /**
+    * Default Constructor, the overlay starts hidden.
+    */
+    PerformanceHUD();
+
+    /**
+    * Show or hide the overlay.
+    */
+    void toggle();
+
+    /**
+    * Whether the overlay is drawn.
+    * @return bool True if the overlay is visible, otherwise false.
+    */
+    bool isVisible();
+
+    /**
+    * Draw the overlay.
+    * @param aRenderer    - The renderer to draw with.
+    * @param aEntityCount - The number of entities in the world.
+    * @param aCamera      - The view of the world drawn in the window, the last trade is marked through it.
+    */
+    void render(SDL_Renderer* aRenderer, const uint32_t& aEntityCount, const Camera& aCamera);
+
+    /**
+    * Count a trade for the overlay, called on the trade event consumer thread.
+    * @param aEvent - The trade.
+    */
+    void consume(const TradeEvent& aEvent) override;
+};
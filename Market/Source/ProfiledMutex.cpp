@@ -0,0 +1,235 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* ProfiledMutex is a drop in replacement for std::mutex that records how often a named lock is taken,
+* how often a thread had to wait for it, and histograms of the wait and hold times.
+*/
+#include "PCH.h"
+#include "ProfiledMutex.h"
+#include <SDL.h>
+
+
+LockStats ProfiledMutex::sStats[MAX_PROFILED_MUTEXES];
+atomic<uint32_t> ProfiledMutex::sStatsCount(0);
+mutex ProfiledMutex::sRegistryMtx;
+atomic<bool> ProfiledMutex::sReporting(false);
+
+
+/**
+* Register a lock under the given name, a lock whose name is already registered shares its statistics.
+* @param aName - The name the lock is reported under, must be a string literal.
+*/
+ProfiledMutex::ProfiledMutex(const char* aName)
+{
+    mLockedAt = 0;
+
+    lock_guard<mutex> lock(sRegistryMtx);
+
+    // Every game's World and SpriteCompositor register the same names, they're reported under one row
+    uint32_t statsCount = sStatsCount;
+    for (uint32_t i = 0; i < statsCount; ++i)
+    {
+        if (strcmp(sStats[i].mName, aName) == 0)
+        {
+            mStats = &sStats[i];
+            return;
+        }
+    }
+
+    // Names past the registry's size share the last slot
+    if (statsCount >= MAX_PROFILED_MUTEXES)
+    {
+        mStats = &sStats[MAX_PROFILED_MUTEXES - 1];
+        mStats->mName = "Other locks";
+        return;
+    }
+    mStats = &sStats[statsCount];
+    mStats->mName = aName;
+    sStatsCount = statsCount + 1;
+}
+
+
+/**
+* Take the lock, a failed first attempt counts as a contended acquisition and the time spent waiting
+* is recorded.
+*/
+void ProfiledMutex::lock()
+{
+    if (!mMutex.try_lock())
+    {
+        uint64_t waitStart = now();
+        mMutex.lock();
+        uint64_t waited = now() - waitStart;
+
+        mStats->mContendedAcquisitions.fetch_add(1, memory_order_relaxed);
+        mStats->mWaitNs.fetch_add(waited, memory_order_relaxed);
+        mStats->mWaitHistogram[bucket(waited)].fetch_add(1, memory_order_relaxed);
+    }
+    else
+    {
+        mStats->mWaitHistogram[0].fetch_add(1, memory_order_relaxed);
+    }
+
+    mStats->mAcquisitions.fetch_add(1, memory_order_relaxed);
+    mLockedAt = now();
+}
+
+
+/**
+* Try to take the lock without waiting.
+* @return bool True if the lock was taken, otherwise false.
+*/
+bool ProfiledMutex::try_lock()
+{
+    if (mMutex.try_lock())
+    {
+        mStats->mAcquisitions.fetch_add(1, memory_order_relaxed);
+        mStats->mWaitHistogram[0].fetch_add(1, memory_order_relaxed);
+        mLockedAt = now();
+        return true;
+    }
+    return false;
+}
+
+
+/**
+* Release the lock and record how long it was held.
+*/
+void ProfiledMutex::unlock()
+{
+    uint64_t held = now() - mLockedAt;
+    mStats->mHoldNs.fetch_add(held, memory_order_relaxed);
+    mStats->mHoldHistogram[bucket(held)].fetch_add(1, memory_order_relaxed);
+    mMutex.unlock();
+}
+
+
+/**
+* Enable or disable the per second report.
+* @param aReporting - True to write the statistics to the log every second.
+*/
+void ProfiledMutex::setReporting(const bool& aReporting)
+{
+    sReporting = aReporting;
+}
+
+
+/**
+* Whether the per second report is enabled.
+* @return bool True if reporting, otherwise false.
+*/
+bool ProfiledMutex::isReporting()
+{
+    return sReporting;
+}
+
+
+/**
+* Call once per frame, once a second has passed since the last report every lock's statistics are
+* written to the log (if reporting is enabled) and reset.
+*/
+void ProfiledMutex::reportPerSecond()
+{
+    static uint64_t lastReport = now();
+
+    uint64_t currTime = now();
+    if (currTime - lastReport < 1000000000ull)
+    {
+        return;
+    }
+    double seconds = (currTime - lastReport) / 1e9;
+    lastReport = currTime;
+
+    uint32_t statsCount = sStatsCount;
+    for (uint32_t i = 0; i < statsCount; ++i)
+    {
+        LockStats& stats = sStats[i];
+
+        if (sReporting)
+        {
+            uint64_t acquisitions = stats.mAcquisitions;
+            uint64_t contended    = stats.mContendedAcquisitions;
+            SDL_Log("%-26s %9.0f acq/s  %5.1f%% contended  wait %8.3f ms/s p50 %7llu ns p99 %9llu ns  hold %8.3f ms/s p50 %7llu ns p99 %9llu ns\n",
+                stats.mName,
+                acquisitions / seconds,
+                acquisitions ? (100.0 * contended / acquisitions) : (0.0),
+                stats.mWaitNs / 1e6 / seconds,
+                static_cast<unsigned long long>(percentile(stats.mWaitHistogram, .5)),
+                static_cast<unsigned long long>(percentile(stats.mWaitHistogram, .99)),
+                stats.mHoldNs / 1e6 / seconds,
+                static_cast<unsigned long long>(percentile(stats.mHoldHistogram, .5)),
+                static_cast<unsigned long long>(percentile(stats.mHoldHistogram, .99)));
+        }
+
+        stats.mAcquisitions          = 0;
+        stats.mContendedAcquisitions = 0;
+        stats.mWaitNs                = 0;
+        stats.mHoldNs                = 0;
+        for (uint32_t b = 0; b < LOCK_HISTOGRAM_BUCKETS; ++b)
+        {
+            stats.mWaitHistogram[b] = 0;
+            stats.mHoldHistogram[b] = 0;
+        }
+    }
+}
+
+
+/**
+* Get the current time in nanoseconds.
+* @return uint64_t Nanoseconds on the steady clock.
+*/
+uint64_t ProfiledMutex::now()
+{
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+/**
+* Get the histogram bucket a duration falls in, bucket 0 holds zero, and bucket b holds [2^(b-1), 2^b).
+* @param aNs - The duration in nanoseconds.
+* @return uint32_t The bucket index.
+*/
+uint32_t ProfiledMutex::bucket(uint64_t aNs)
+{
+    uint32_t index = 0;
+    while (aNs && index < LOCK_HISTOGRAM_BUCKETS - 1)
+    {
+        aNs >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+
+/**
+* Estimate a percentile from a histogram.
+* @param aHistogram  - The histogram to read.
+* @param aPercentile - The percentile in [0, 1].
+* @return uint64_t The upper bound of the bucket holding the percentile, in nanoseconds.
+*/
+uint64_t ProfiledMutex::percentile(const atomic<uint64_t> aHistogram[], const double& aPercentile)
+{
+    uint64_t total = 0;
+    for (uint32_t b = 0; b < LOCK_HISTOGRAM_BUCKETS; ++b)
+    {
+        total += aHistogram[b];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(ceil(total * aPercentile));
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < LOCK_HISTOGRAM_BUCKETS; ++b)
+    {
+        seen += aHistogram[b];
+        if (seen >= target)
+        {
+            return (b == 0) ? (0) : (1ull << b);
+        }
+    }
+    return 1ull << (LOCK_HISTOGRAM_BUCKETS - 1);
+}
@@ -0,0 +1,104 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* ProfiledMutex is a drop in replacement for std::mutex that records how often a named lock is taken,
+* how often a thread had to wait for it, and histograms of the wait and hold times.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// Number of power of two nanosecond buckets in the wait and hold time histograms, the last bucket
+// collects every time past 2^(LOCK_HISTOGRAM_BUCKETS - 2) nanoseconds
+constexpr uint32_t LOCK_HISTOGRAM_BUCKETS = 26;
+
+// Number of ProfiledMutexes that can be registered
+constexpr uint32_t MAX_PROFILED_MUTEXES   = 16;
+
+
+// The statistics collected for a single named lock since the last report
+struct LockStats
+{
+    const char* mName;
+    atomic<uint64_t> mAcquisitions;
+    atomic<uint64_t> mContendedAcquisitions;
+    atomic<uint64_t> mWaitNs;
+    atomic<uint64_t> mHoldNs;
+    atomic<uint64_t> mWaitHistogram[LOCK_HISTOGRAM_BUCKETS];
+    atomic<uint64_t> mHoldHistogram[LOCK_HISTOGRAM_BUCKETS];
+};
+
+
+class ProfiledMutex
+{
+private:
+    // Every registered name's statistics, the number of names registered so far, and the lock guarding
+    // registration, locks with the same name share their statistics so each World reports under the same rows
+    static LockStats sStats[MAX_PROFILED_MUTEXES];
+    static atomic<uint32_t> sStatsCount;
+    static mutex sRegistryMtx;
+
+    // Whether reportPerSecond() writes the statistics to the log
+    static atomic<bool> sReporting;
+
+    // The wrapped mutex, this lock's statistics, and when the current owner acquired it
+    mutex mMutex;
+    LockStats* mStats;
+    uint64_t mLockedAt;
+
+    /**
+    * Get the current time in nanoseconds.
+    * @return uint64_t Nanoseconds on the steady clock.
+    */
+    static uint64_t now();
+
+    /**
+    * Get the histogram bucket a duration falls in.
+    * @param aNs - The duration in nanoseconds.
+    * @return uint32_t The bucket index.
+    */
+    static uint32_t bucket(uint64_t aNs);
+
+    /**
+    * Estimate a percentile from a histogram.
+    * @param aHistogram  - The histogram to read.
+    * @param aPercentile - The percentile in [0, 1].
+    * @return uint64_t The upper bound of the bucket holding the percentile, in nanoseconds.
+    */
+    static uint64_t percentile(const atomic<uint64_t> aHistogram[], const double& aPercentile);
+
+public:
+    /**
+    * Register a lock under the given name, a lock whose name is already registered shares its statistics.
+    * @param aName - The name the lock is reported under, must be a string literal.
+    */
+    explicit ProfiledMutex(const char* aName);
+
+    ProfiledMutex(const ProfiledMutex&) = delete;
+    ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+    // BasicLockable/Lockable interface so the lock works with lock_guard and unique_lock
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    /**
+    * Enable or disable the per second report.
+    * @param aReporting - True to write the statistics to the log every second.
+    */
+    static void setReporting(const bool& aReporting);
+
+    /**
+    * Whether the per second report is enabled.
+    * @return bool True if reporting, otherwise false.
+    */
+    static bool isReporting();
+
+    /**
+    * Call once per frame, once a second has passed since the last report every lock's statistics are
+    * written to the log (if reporting is enabled) and reset.
+    */
+    static void reportPerSecond();
+};
@@ -0,0 +1,234 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Replay is the binary replay format shared by the ReplayRecorder and the ReplayPlayer. A replay starts with
+* a header, followed by one record per tick. A record is a type byte, the tick and the payload size as
+* varints, then the payload. Keyframes hold every entity's state, and the records between keyframes hold
+* the change since the previous tick. Coordinates are quantized to fixed point and every signed value
+* is zigzag varint encoded, so an NPC walking a few pixels per tick costs a couple of bytes.
+*/
+#include "PCH.h"
+#include "Replay.h"
+
+
+/**
+* Size the snapshot for a number of entities.
+* @param aNPCCount - The number of NPCs.
+* @param aRugCount - The number of rugs.
+*/
+void ReplaySnapshot::resize(const uint32_t& aNPCCount, const uint32_t& aRugCount)
+{
+    mTick = 0;
+    mNPCX.assign(aNPCCount, 0);
+    mNPCY.assign(aNPCCount, 0);
+    mNPCDirectionX.assign(aNPCCount, 0);
+    mNPCDirectionY.assign(aNPCCount, 0);
+    mNPCStates.assign(aNPCCount, 0);
+    mRugStates.assign(aRugCount, 0);
+}
+
+
+/**
+* Append an unsigned LEB128 varint.
+* @param aValue - The value.
+* @param aOut   - The buffer it is appended to.
+*/
+void ReplayCodec::writeVarint(uint32_t aValue, vector<uint8_t>& aOut)
+{
+    while (aValue >= 0x80)
+    {
+        aOut.push_back(static_cast<uint8_t>(aValue | 0x80));
+        aValue >>= 7;
+    }
+    aOut.push_back(static_cast<uint8_t>(aValue));
+}
+
+
+/**
+* Read an unsigned LEB128 varint.
+* @param aData  - The read position, advanced past the varint.
+* @param aEnd   - The end of the data.
+* @param aValue - The value read.
+* @return bool True if a whole varint was read, otherwise false.
+*/
+bool ReplayCodec::readVarint(const uint8_t*& aData, const uint8_t* aEnd, uint32_t& aValue)
+{
+    aValue = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7)
+    {
+        if (aData == aEnd)
+        {
+            return false;
+        }
+
+        uint8_t byte = *aData++;
+        aValue |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+* Append the entries of a state array that changed since the previous tick, as the number of changes
+* followed by (index gap, state) pairs.
+*/
+static void writeStateChanges(const vector<uint8_t>& aStates, const vector<uint8_t>& aPrevious, vector<uint8_t>& aOut)
+{
+    uint32_t changes = 0;
+    for (size_t i = 0; i < aStates.size(); ++i)
+    {
+        changes += (aStates[i] != aPrevious[i]);
+    }
+    ReplayCodec::writeVarint(changes, aOut);
+
+    uint32_t last = 0;
+    for (size_t i = 0; i < aStates.size(); ++i)
+    {
+        if (aStates[i] != aPrevious[i])
+        {
+            ReplayCodec::writeVarint(static_cast<uint32_t>(i) - last, aOut);
+            aOut.push_back(aStates[i]);
+            last = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+
+/**
+* Apply the state changes written by writeStateChanges.
+*/
+static bool readStateChanges(const uint8_t*& aData, const uint8_t* aEnd, vector<uint8_t>& aStates)
+{
+    uint32_t changes;
+    if (!ReplayCodec::readVarint(aData, aEnd, changes))
+    {
+        return false;
+    }
+
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < changes; ++i)
+    {
+        uint32_t gap;
+        if (!ReplayCodec::readVarint(aData, aEnd, gap) || aData == aEnd)
+        {
+            return false;
+        }
+
+        index += gap;
+        if (index >= aStates.size())
+        {
+            return false;
+        }
+        aStates[index] = *aData++;
+    }
+    return true;
+}
+
+
+/**
+* Append a tick's record to a buffer.
+* @param aSnapshot - The tick's state.
+* @param aPrevious - The previous tick's state, or nullptr to write a keyframe.
+* @param aOut      - The buffer the record is appended to.
+*/
+void ReplayCodec::encode(const ReplaySnapshot& aSnapshot, const ReplaySnapshot* aPrevious, vector<uint8_t>& aOut)
+{
+    // The payload is built past the record's header, whose size field is only known once it is done
+    static thread_local vector<uint8_t> payload;
+    payload.clear();
+
+    size_t npcCount = aSnapshot.mNPCX.size();
+    if (aPrevious)
+    {
+        for (size_t i = 0; i < npcCount; ++i)
+        {
+            writeVarint(zigzag(aSnapshot.mNPCX[i] - aPrevious->mNPCX[i]), payload);
+            writeVarint(zigzag(aSnapshot.mNPCY[i] - aPrevious->mNPCY[i]), payload);
+            writeVarint(zigzag(aSnapshot.mNPCDirectionX[i] - aPrevious->mNPCDirectionX[i]), payload);
+            writeVarint(zigzag(aSnapshot.mNPCDirectionY[i] - aPrevious->mNPCDirectionY[i]), payload);
+        }
+        writeStateChanges(aSnapshot.mNPCStates, aPrevious->mNPCStates, payload);
+        writeStateChanges(aSnapshot.mRugStates, aPrevious->mRugStates, payload);
+    }
+    else
+    {
+        for (size_t i = 0; i < npcCount; ++i)
+        {
+            writeVarint(zigzag(aSnapshot.mNPCX[i]), payload);
+            writeVarint(zigzag(aSnapshot.mNPCY[i]), payload);
+            writeVarint(zigzag(aSnapshot.mNPCDirectionX[i]), payload);
+            writeVarint(zigzag(aSnapshot.mNPCDirectionY[i]), payload);
+        }
+        payload.insert(payload.end(), aSnapshot.mNPCStates.begin(), aSnapshot.mNPCStates.end());
+        payload.insert(payload.end(), aSnapshot.mRugStates.begin(), aSnapshot.mRugStates.end());
+    }
+
+    aOut.push_back(static_cast<uint8_t>((aPrevious) ? (EReplayRecord::DELTA) : (EReplayRecord::KEYFRAME)));
+    writeVarint(aSnapshot.mTick, aOut);
+    writeVarint(static_cast<uint32_t>(payload.size()), aOut);
+    aOut.insert(aOut.end(), payload.begin(), payload.end());
+}
+
+
+/**
+* Apply a record's payload to the previous tick's state.
+* @param aType     - The record's type.
+* @param aPayload  - The record's payload.
+* @param aSize     - The payload's size in bytes.
+* @param aSnapshot - The previous tick's state, replaced by the record's tick. Must already be sized, and
+*                    must hold the previous tick unless the record is a keyframe.
+* @return bool True if the payload was well formed, otherwise false.
+*/
+bool ReplayCodec::decode(const EReplayRecord& aType, const uint8_t* aPayload, const size_t& aSize, ReplaySnapshot& aSnapshot)
+{
+    const uint8_t* data = aPayload;
+    const uint8_t* end = aPayload + aSize;
+    bool keyframe = (aType == EReplayRecord::KEYFRAME);
+
+    uint32_t values[4];
+    for (size_t i = 0; i < aSnapshot.mNPCX.size(); ++i)
+    {
+        for (uint32_t& value : values)
+        {
+            if (!readVarint(data, end, value))
+            {
+                return false;
+            }
+        }
+
+        int32_t base[4] = { 0, 0, 0, 0 };
+        if (!keyframe)
+        {
+            base[0] = aSnapshot.mNPCX[i];
+            base[1] = aSnapshot.mNPCY[i];
+            base[2] = aSnapshot.mNPCDirectionX[i];
+            base[3] = aSnapshot.mNPCDirectionY[i];
+        }
+        aSnapshot.mNPCX[i] = base[0] + unzigzag(values[0]);
+        aSnapshot.mNPCY[i] = base[1] + unzigzag(values[1]);
+        aSnapshot.mNPCDirectionX[i] = static_cast<int16_t>(base[2] + unzigzag(values[2]));
+        aSnapshot.mNPCDirectionY[i] = static_cast<int16_t>(base[3] + unzigzag(values[3]));
+    }
+
+    if (keyframe)
+    {
+        size_t stateCount = aSnapshot.mNPCStates.size() + aSnapshot.mRugStates.size();
+        if (static_cast<size_t>(end - data) < stateCount)
+        {
+            return false;
+        }
+
+        copy(data, data + aSnapshot.mNPCStates.size(), aSnapshot.mNPCStates.begin());
+        data += aSnapshot.mNPCStates.size();
+        copy(data, data + aSnapshot.mRugStates.size(), aSnapshot.mRugStates.begin());
+        return true;
+    }
+
+    return readStateChanges(data, end, aSnapshot.mNPCStates) && readStateChanges(data, end, aSnapshot.mRugStates);
+}
@@ -0,0 +1,124 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Replay is the binary replay format shared by the ReplayRecorder and the ReplayPlayer. A replay starts with
+* a header, followed by one record per tick. A record is a type byte, the tick and the payload size as
+* varints, then the payload. Keyframes hold every entity's state, and the records between keyframes hold
+* the change since the previous tick. Coordinates are quantized to fixed point and every signed value
+* is zigzag varint encoded, so an NPC walking a few pixels per tick costs a couple of bytes.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// "MKRP" read as a little endian uint32_t, and the format version
+constexpr uint32_t REPLAY_MAGIC   = 0x50524B4D;
+constexpr uint32_t REPLAY_VERSION = 1;
+
+// Where the replay is recorded to and played back from
+constexpr const char* REPLAY_FILE_PATH = "market_replay.bin";
+
+// Fixed point scale of the quantized locations and directions
+constexpr float REPLAY_LOCATION_SCALE  = 8.f;
+constexpr float REPLAY_DIRECTION_SCALE = 32767.f;
+
+// Ticks between keyframes, playback can only start on a keyframe
+constexpr uint32_t REPLAY_KEYFRAME_INTERVAL = 120;
+
+
+// The kind of a replay record
+enum class EReplayRecord : uint8_t
+{
+    KEYFRAME,
+    DELTA
+};
+
+
+// Header at the start of every replay
+struct ReplayHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mNPCCount;
+    uint32_t mRugCount;
+    uint32_t mKeyframeInterval;
+};
+
+
+// Every entity's quantized state on one tick, as structure of arrays
+struct ReplaySnapshot
+{
+    uint32_t mTick;
+
+    vector<int32_t> mNPCX;
+    vector<int32_t> mNPCY;
+    vector<int16_t> mNPCDirectionX;
+    vector<int16_t> mNPCDirectionY;
+    vector<uint8_t> mNPCStates;
+    vector<uint8_t> mRugStates;
+
+    /**
+    * Size the snapshot for a number of entities.
+    * @param aNPCCount - The number of NPCs.
+    * @param aRugCount - The number of rugs.
+    */
+    void resize(const uint32_t& aNPCCount, const uint32_t& aRugCount);
+};
+
+
+class ReplayCodec
+{
+public:
+    /**
+    * Append a tick's record to a buffer.
+    * @param aSnapshot - The tick's state.
+    * @param aPrevious - The previous tick's state, or nullptr to write a keyframe.
+    * @param aOut      - The buffer the record is appended to.
+    */
+    static void encode(const ReplaySnapshot& aSnapshot, const ReplaySnapshot* aPrevious, vector<uint8_t>& aOut);
+
+    /**
+    * Apply a record's payload to the previous tick's state.
+    * @param aType     - The record's type.
+    * @param aPayload  - The record's payload.
+    * @param aSize     - The payload's size in bytes.
+    * @param aSnapshot - The previous tick's state, replaced by the record's tick. Must already be sized, and
+    *                    must hold the previous tick unless the record is a keyframe.
+    * @return bool True if the payload was well formed, otherwise false.
+    */
+    static bool decode(const EReplayRecord& aType, const uint8_t* aPayload, const size_t& aSize, ReplaySnapshot& aSnapshot);
+
+    /**
+    * Append an unsigned LEB128 varint.
+    * @param aValue - The value.
+    * @param aOut   - The buffer it is appended to.
+    */
+    static void writeVarint(uint32_t aValue, vector<uint8_t>& aOut);
+
+    /**
+    * Read an unsigned LEB128 varint.
+    * @param aData  - The read position, advanced past the varint.
+    * @param aEnd   - The end of the data.
+    * @param aValue - The value read.
+    * @return bool True if a whole varint was read, otherwise false.
+    */
+    static bool readVarint(const uint8_t*& aData, const uint8_t* aEnd, uint32_t& aValue);
+
+    /**
+    * Map a signed value to an unsigned one so small magnitudes of either sign encode short.
+    */
+    static uint32_t zigzag(const int32_t& aValue)
+    {
+        return (static_cast<uint32_t>(aValue) << 1) ^ static_cast<uint32_t>(aValue >> 31);
+    }
+
+    /**
+    * Undo zigzag().
+    */
+    static int32_t unzigzag(const uint32_t& aValue)
+    {
+        return static_cast<int32_t>(aValue >> 1) ^ -static_cast<int32_t>(aValue & 1);
+    }
+};
@@ -0,0 +1,188 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* ReplayPlayer reads a replay back one tick at a time, the decoded state can be pushed into the entities
+* in place of simulating them.
+*/
+#include "PCH.h"
+#include "ReplayPlayer.h"
+#include "NPC.h"
+#include "Rug.h"
+
+
+/**
+* Default Constructor, nothing is played until a replay is opened.
+*/
+ReplayPlayer::ReplayPlayer()
+{
+    mHeader = {};
+    mHasKeyframe = false;
+}
+
+
+/**
+* Open a replay and check its header.
+* @param aPath     - The replay to play.
+* @param aNPCCount - The number of NPCs the replay must have been recorded with.
+* @param aRugCount - The number of rugs the replay must have been recorded with.
+* @return bool True if the replay was opened, otherwise false.
+*/
+bool ReplayPlayer::open(const char* aPath, const uint32_t& aNPCCount, const uint32_t& aRugCount)
+{
+    bool success = true;
+    close();
+
+    mFile.open(aPath, ios::binary);
+    if (!mFile || !mFile.read(reinterpret_cast<char*>(&mHeader), sizeof(mHeader)))
+    {
+        // cout << "Failed to open the replay!\n";
+        success = false;
+    }
+    else if (mHeader.mMagic != REPLAY_MAGIC || mHeader.mVersion != REPLAY_VERSION || mHeader.mNPCCount != aNPCCount || mHeader.mRugCount != aRugCount)
+    {
+        // cout << "The replay was recorded with a different version or world!\n";
+        success = false;
+    }
+    else
+    {
+        mSnapshot.resize(mHeader.mNPCCount, mHeader.mRugCount);
+        mHasKeyframe = false;
+    }
+
+    if (!success)
+    {
+        close();
+    }
+    return success;
+}
+
+
+/**
+* Close the replay.
+*/
+void ReplayPlayer::close()
+{
+    if (mFile.is_open())
+    {
+        mFile.close();
+    }
+    mFile.clear();
+}
+
+
+/**
+* Whether a replay is open.
+* @return bool True if playing, otherwise false.
+*/
+bool ReplayPlayer::isPlaying()
+{
+    return mFile.is_open();
+}
+
+
+/**
+* Read an unsigned LEB128 varint from the replay.
+* @param aValue - The value read.
+* @return bool True if a whole varint was read, otherwise false.
+*/
+bool ReplayPlayer::readVarint(uint32_t& aValue)
+{
+    aValue = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7)
+    {
+        int byte = mFile.get();
+        if (byte == EOF)
+        {
+            return false;
+        }
+
+        aValue |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+* Read the next tick.
+* @return bool True if a tick was read, false at the end of the replay or if the replay is damaged.
+*/
+bool ReplayPlayer::next()
+{
+    while (mFile.is_open())
+    {
+        int type = mFile.get();
+        uint32_t tick;
+        uint32_t size;
+        if (type == EOF || type > static_cast<int>(EReplayRecord::DELTA) || !readVarint(tick) || !readVarint(size))
+        {
+            return false;
+        }
+
+        mPayload.resize(size);
+        if (!mFile.read(reinterpret_cast<char*>(mPayload.data()), size))
+        {
+            return false;
+        }
+
+        // Skip to the first keyframe
+        EReplayRecord record = static_cast<EReplayRecord>(type);
+        if (record == EReplayRecord::DELTA && !mHasKeyframe)
+        {
+            continue;
+        }
+
+        if (!ReplayCodec::decode(record, mPayload.data(), mPayload.size(), mSnapshot))
+        {
+            return false;
+        }
+        mSnapshot.mTick = tick;
+        mHasKeyframe = true;
+        return true;
+    }
+
+    return false;
+}
+
+
+/**
+* Get the state of the tick read last.
+* @return const ReplaySnapshot& The tick's state.
+*/
+const ReplaySnapshot& ReplayPlayer::getSnapshot() const
+{
+    return mSnapshot;
+}
+
+
+/**
+* Push the state of the tick read last into the entities.
+* @param aNPCs - The NPCs.
+* @param aRugs - The rugs.
+* @param aDt   - The time the tick covers, used to animate the NPCs.
+*/
+void ReplayPlayer::apply(const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, const float& aDt) const
+{
+    size_t npcCount = min(aNPCs.size(), mSnapshot.mNPCX.size());
+    for (size_t i = 0; i < npcCount; ++i)
+    {
+        Vector location  = { mSnapshot.mNPCX[i] / REPLAY_LOCATION_SCALE, mSnapshot.mNPCY[i] / REPLAY_LOCATION_SCALE, 0 };
+        Vector direction = { mSnapshot.mNPCDirectionX[i] / REPLAY_DIRECTION_SCALE, mSnapshot.mNPCDirectionY[i] / REPLAY_DIRECTION_SCALE, 0 };
+        aNPCs[i]->setReplayState(location, direction, static_cast<ETradeState>(mSnapshot.mNPCStates[i]), aDt);
+    }
+
+    size_t rugCount = min(aRugs.size(), mSnapshot.mRugStates.size());
+    for (size_t i = 0; i < rugCount; ++i)
+    {
+        ETradeState state = static_cast<ETradeState>(mSnapshot.mRugStates[i]);
+        if (aRugs[i]->getTradeState() != state)
+        {
+            aRugs[i]->setTradeState(state);
+        }
+    }
+}
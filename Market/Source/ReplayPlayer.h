@@ -0,0 +1,81 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* ReplayPlayer reads a replay back one tick at a time, the decoded state can be pushed into the entities
+* in place of simulating them.
+*/
+#pragma once
+#include "PCH.h"
+#include "Replay.h"
+class NPC;
+class Rug;
+
+
+class ReplayPlayer
+{
+private:
+    ifstream mFile;
+    ReplayHeader mHeader;
+
+    // The state of the tick read last, and the payload of the record being read
+    ReplaySnapshot mSnapshot;
+    vector<uint8_t> mPayload;
+
+    // Whether a keyframe has been read, the deltas before the first one have nothing to apply to
+    bool mHasKeyframe;
+
+    /**
+    * Read an unsigned LEB128 varint from the replay.
+    * @param aValue - The value read.
+    * @return bool True if a whole varint was read, otherwise false.
+    */
+    bool readVarint(uint32_t& aValue);
+
+public:
+    /**
+    * Default Constructor, nothing is played until a replay is opened.
+    */
+    ReplayPlayer();
+
+    /**
+    * Open a replay and check its header.
+    * @param aPath     - The replay to play.
+    * @param aNPCCount - The number of NPCs the replay must have been recorded with.
+    * @param aRugCount - The number of rugs the replay must have been recorded with.
+    * @return bool True if the replay was opened, otherwise false.
+    */
+    bool open(const char* aPath, const uint32_t& aNPCCount, const uint32_t& aRugCount);
+
+    /**
+    * Close the replay.
+    */
+    void close();
+
+    /**
+    * Whether a replay is open.
+    * @return bool True if playing, otherwise false.
+    */
+    bool isPlaying();
+
+    /**
+    * Read the next tick.
+    * @return bool True if a tick was read, false at the end of the replay or if the replay is damaged.
+    */
+    bool next();
+
+    /**
+    * Get the state of the tick read last.
+    * @return const ReplaySnapshot& The tick's state.
+    */
+    const ReplaySnapshot& getSnapshot() const;
+
+    /**
+    * Push the state of the tick read last into the entities.
+    * @param aNPCs - The NPCs.
+    * @param aRugs - The rugs.
+    * @param aDt   - The time the tick covers, used to animate the NPCs.
+    */
+    void apply(const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, const float& aDt) const;
+};
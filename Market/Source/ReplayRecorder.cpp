@@ -0,0 +1,206 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* ReplayRecorder records every tick of the simulation to a replay. The simulation thread only copies the
+* entities' quantized state into one of two snapshots, a background thread encodes and writes the other.
+*/
+#include "PCH.h"
+#include "ReplayRecorder.h"
+#include "NPC.h"
+#include "Rug.h"
+#include "Trace.h"
+
+
+/**
+* Default Constructor, nothing is recorded until recording starts.
+*/
+ReplayRecorder::ReplayRecorder()
+{
+    mBackIndex = 0;
+    mPendingIndex = 0;
+    mPending = false;
+    mRecordedTicks = 0;
+    mRecording = false;
+    mStopping = false;
+}
+
+
+/**
+* Stops recording.
+*/
+ReplayRecorder::~ReplayRecorder()
+{
+    stop();
+}
+
+
+/**
+* Create the replay, replacing an existing one, and start the writer thread.
+* @param aPath     - Where to write the replay.
+* @param aNPCCount - The number of NPCs recorded every tick.
+* @param aRugCount - The number of rugs recorded every tick.
+* @return bool True if recording started, otherwise false.
+*/
+bool ReplayRecorder::start(const char* aPath, const uint32_t& aNPCCount, const uint32_t& aRugCount)
+{
+    bool success = true;
+    stop();
+
+    mFile.open(aPath, ios::binary | ios::trunc);
+    if (!mFile)
+    {
+        // cout << "Failed to create the replay!\n";
+        success = false;
+    }
+    else
+    {
+        ReplayHeader header = { REPLAY_MAGIC, REPLAY_VERSION, aNPCCount, aRugCount, REPLAY_KEYFRAME_INTERVAL };
+        mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        // Everything is sized up front so recording a tick never allocates
+        mSnapshots[0].resize(aNPCCount, aRugCount);
+        mSnapshots[1].resize(aNPCCount, aRugCount);
+        mPrevious.resize(aNPCCount, aRugCount);
+        mEncoded.clear();
+        mEncoded.reserve(static_cast<size_t>(aNPCCount) * 20 + aRugCount + 16);
+
+        mBackIndex = 0;
+        mPending = false;
+        mRecordedTicks = 0;
+        mStopping = false;
+        mRecording = true;
+        mWriterThread = thread(&ReplayRecorder::writerLoop, this);
+    }
+
+    return success;
+}
+
+
+/**
+* Write out the last snapshot and close the replay.
+*/
+void ReplayRecorder::stop()
+{
+    if (!mRecording)
+    {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lk(mMtx);
+        mStopping = true;
+    }
+    mCv.notify_all();
+
+    if (mWriterThread.joinable())
+    {
+        mWriterThread.join();
+    }
+
+    mFile.close();
+    mRecording = false;
+}
+
+
+/**
+* Whether a replay is being recorded.
+* @return bool True if recording, otherwise false.
+*/
+bool ReplayRecorder::isRecording()
+{
+    return mRecording;
+}
+
+
+/**
+* Record a tick, called on the simulation thread once the tick is done. Only waits if the writer thread
+* has not finished the previous tick.
+* @param aNPCs - The NPCs.
+* @param aRugs - The rugs.
+* @param aTick - The tick.
+*/
+void ReplayRecorder::capture(const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, const uint32_t& aTick)
+{
+    if (!mRecording)
+    {
+        return;
+    }
+
+    TRACE_SCOPE("ReplayRecorder::capture");
+    ReplaySnapshot& snapshot = mSnapshots[mBackIndex];
+    snapshot.mTick = aTick;
+
+    size_t npcCount = min(aNPCs.size(), snapshot.mNPCX.size());
+    for (size_t i = 0; i < npcCount; ++i)
+    {
+        Vector location  = aNPCs[i]->getLocation();
+        Vector direction = aNPCs[i]->getDirection();
+        snapshot.mNPCX[i] = static_cast<int32_t>(lround(location.x * REPLAY_LOCATION_SCALE));
+        snapshot.mNPCY[i] = static_cast<int32_t>(lround(location.y * REPLAY_LOCATION_SCALE));
+        snapshot.mNPCDirectionX[i] = static_cast<int16_t>(lround(direction.x * REPLAY_DIRECTION_SCALE));
+        snapshot.mNPCDirectionY[i] = static_cast<int16_t>(lround(direction.y * REPLAY_DIRECTION_SCALE));
+        snapshot.mNPCStates[i] = static_cast<uint8_t>(aNPCs[i]->getTradeState());
+    }
+
+    size_t rugCount = min(aRugs.size(), snapshot.mRugStates.size());
+    for (size_t i = 0; i < rugCount; ++i)
+    {
+        snapshot.mRugStates[i] = static_cast<uint8_t>(aRugs[i]->getTradeState());
+    }
+
+    // Hand the snapshot over once the writer is done with the previous one, and fill the other next tick
+    {
+        unique_lock<mutex> lk(mMtx);
+        mCv.wait(lk, [this] { return !mPending; });
+        mPendingIndex = mBackIndex;
+        mPending = true;
+    }
+    mCv.notify_all();
+    mBackIndex ^= 1;
+}
+
+
+/**
+* The writer thread, encodes and writes every snapshot handed to it until recording stops.
+*/
+void ReplayRecorder::writerLoop()
+{
+    while (true)
+    {
+        uint32_t index;
+        {
+            unique_lock<mutex> lk(mMtx);
+            mCv.wait(lk, [this] { return mPending || mStopping; });
+            if (!mPending)
+            {
+                return;
+            }
+            index = mPendingIndex;
+        }
+
+        const ReplaySnapshot& snapshot = mSnapshots[index];
+        bool keyframe = (mRecordedTicks % REPLAY_KEYFRAME_INTERVAL) == 0;
+
+        mEncoded.clear();
+        ReplayCodec::encode(snapshot, (keyframe) ? (nullptr) : (&mPrevious), mEncoded);
+        mFile.write(reinterpret_cast<const char*>(mEncoded.data()), static_cast<streamsize>(mEncoded.size()));
+
+        // Keep the tick for the next delta, the vectors are already sized so this only copies
+        mPrevious.mTick = snapshot.mTick;
+        mPrevious.mNPCX = snapshot.mNPCX;
+        mPrevious.mNPCY = snapshot.mNPCY;
+        mPrevious.mNPCDirectionX = snapshot.mNPCDirectionX;
+        mPrevious.mNPCDirectionY = snapshot.mNPCDirectionY;
+        mPrevious.mNPCStates = snapshot.mNPCStates;
+        mPrevious.mRugStates = snapshot.mRugStates;
+        ++mRecordedTicks;
+
+        {
+            lock_guard<mutex> lk(mMtx);
+            mPending = false;
+        }
+        mCv.notify_all();
+    }
+}
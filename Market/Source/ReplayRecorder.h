@@ -0,0 +1,82 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* ReplayRecorder records every tick of the simulation to a replay. The simulation thread only copies the
+* entities' quantized state into one of two snapshots, a background thread encodes and writes the other.
+*/
+#pragma once
+#include "PCH.h"
+#include "Replay.h"
+class NPC;
+class Rug;
+
+
+class ReplayRecorder
+{
+private:
+    ofstream mFile;
+
+    // The snapshot the simulation thread fills next, and the one handed to the writer thread
+    ReplaySnapshot mSnapshots[2];
+    uint32_t mBackIndex;
+    uint32_t mPendingIndex;
+    bool mPending;
+
+    // Writer thread state, the previous tick the deltas are taken against and the encoded records
+    ReplaySnapshot mPrevious;
+    vector<uint8_t> mEncoded;
+    uint32_t mRecordedTicks;
+
+    thread mWriterThread;
+    mutex mMtx;
+    condition_variable mCv;
+    bool mRecording;
+    bool mStopping;
+
+    /**
+    * The writer thread, encodes and writes every snapshot handed to it until recording stops.
+    */
+    void writerLoop();
+
+public:
+    /**
+    * Default Constructor, nothing is recorded until recording starts.
+    */
+    ReplayRecorder();
+
+    /**
+    * Stops recording.
+    */
+    ~ReplayRecorder();
+
+    /**
+    * Create the replay, replacing an existing one, and start the writer thread.
+    * @param aPath     - Where to write the replay.
+    * @param aNPCCount - The number of NPCs recorded every tick.
+    * @param aRugCount - The number of rugs recorded every tick.
+    * @return bool True if recording started, otherwise false.
+    */
+    bool start(const char* aPath, const uint32_t& aNPCCount, const uint32_t& aRugCount);
+
+    /**
+    * Write out the last snapshot and close the replay.
+    */
+    void stop();
+
+    /**
+    * Whether a replay is being recorded.
+    * @return bool True if recording, otherwise false.
+    */
+    bool isRecording();
+
+    /**
+    * Record a tick, called on the simulation thread once the tick is done. Only waits if the writer thread
+    * has not finished the previous tick.
+    * @param aNPCs - The NPCs.
+    * @param aRugs - The rugs.
+    * @param aTick - The tick.
+    */
+    void capture(const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, const uint32_t& aTick);
+};
@@ -9,6 +9,12 @@
 #include "Rug.h"
 #include "SDLManager.h"
 #include "World.h"
+#include "RugGoodIndex.h"
+#include "WorldSnapshot.h"
+#include "Camera.h"
+
+
+TimerWheel Rug::sCooldownWheel("Rug::sCooldownWheel");
 
 
 // Default initialize the rug, the rug will not be properly initialized until it is
@@ -21,7 +27,11 @@ Rug::Rug()
     mLocation.x = 0;
     mLocation.y = 0;
 
-    mTimeToTrade = RUG_TRADE_TIME;
+    // Rugs start cooling down
+    mTradeable = false;
+    mGoodIndex = nullptr;
+    TimerWheel::initTimer(mCooldown, &Rug::onCooldownExpired, this);
+    sCooldownWheel.schedule(mCooldown, RUG_TRADE_TIME);
 
     // References used to render the rug
     mTexturePtr    = nullptr;
@@ -33,6 +43,8 @@ Rug::Rug()
 // as they are shared between each rug instance and deallocated elsewhere
 Rug::~Rug()
 {
+    sCooldownWheel.cancel(mCooldown);
+
     if (mTexturePtr)
     {
         mTexturePtr = nullptr;
@@ -70,8 +82,7 @@ bool Rug::init(Texture* aTxtrPtr, SDL_Rect aTxtrFrames[], World& mWorld)
             mTextureFrames = aTxtrFrames;
         
             // Generate a random location for the rug to spawn
-            mLocation.x = static_cast<float>(rand() % SDLManager::mWindowWidth);
-            mLocation.y = static_cast<float>(rand() % SDLManager::mWindowHeight);
+            mLocation = mWorld.getRandomLocation();
 
             mWorld.placeEntity(this);
         }
@@ -83,36 +94,45 @@ bool Rug::init(Texture* aTxtrPtr, SDL_Rect aTxtrFrames[], World& mWorld)
 
 
 /**
-* update the rug
+* Advance every rug's trade cooldown, the rugs whose cooldown ran out become tradeable. Must not be
+* called while other threads trade with rugs.
 *
-* @param dt - time passed since last time update was called.
+* @param dt - time passed since the cooldowns were last advanced.
 */
-void Rug::update(const float& dt)
+void Rug::updateCooldowns(const float& dt)
 {
-    if (mTimeToTrade <= 0)
-    {
-        mTimeToTrade = 0;
-        return;
-    }
-    mTimeToTrade = mTimeToTrade - dt;
+    sCooldownWheel.advance(dt);
+}
+
+
+/**
+* Cooldown timer callback, makes the rug tradeable again.
+*
+* @param aRug - The rug.
+*/
+void Rug::onCooldownExpired(void* aRug)
+{
+    static_cast<Rug*>(aRug)->mTradeable = true;
 }
 
 
 /**
 * Draw just the Rug's trade object to the screen.
+* @param aCamera - The view of the world drawn in the window.
 */ 
-void Rug::render()
+void Rug::render(const Camera& aCamera)
 {
-    mTexturePtr->render(static_cast<int16_t>(mLocation.x - ((RUG_FRAME_WIDTH * RUG_SCALE) / 2.f)), static_cast<int16_t>(mLocation.y - ((RUG_FRAME_HEIGHT * RUG_SCALE) / 2.f)), &mTextureFrames[mState + RUG_FRAME_COLS]);
+    mTexturePtr->render(aCamera.toScreenX(mLocation.x - ((RUG_FRAME_WIDTH * RUG_SCALE) / 2.f)), aCamera.toScreenY(mLocation.y - ((RUG_FRAME_HEIGHT * RUG_SCALE) / 2.f)), &mTextureFrames[mState + RUG_FRAME_COLS], 0, nullptr, SDL_FLIP_NONE, aCamera.getZoom());
 }
 
 
 /**
 * Draw the full Rug.
+* @param aCamera - The view of the world drawn in the window.
 */
-void Rug::renderFull()
+void Rug::renderFull(const Camera& aCamera)
 {
-    mTexturePtr->render(static_cast<int16_t>(mLocation.x - ((RUG_FRAME_WIDTH * RUG_SCALE) / 2.f)), static_cast<int16_t>(mLocation.y - ((RUG_FRAME_WIDTH * RUG_SCALE) / 2.f)), &mTextureFrames[mState]);
+    mTexturePtr->render(aCamera.toScreenX(mLocation.x - ((RUG_FRAME_WIDTH * RUG_SCALE) / 2.f)), aCamera.toScreenY(mLocation.y - ((RUG_FRAME_WIDTH * RUG_SCALE) / 2.f)), &mTextureFrames[mState], 0, nullptr, SDL_FLIP_NONE, aCamera.getZoom());
 }
 
 
@@ -123,15 +143,31 @@ void Rug::renderFull()
 */
 void Rug::setTradeState(const ETradeState& aState)
 {
-    mTimeToTrade = RUG_TRADE_TIME;
+    mTradeable = false;
+    sCooldownWheel.schedule(mCooldown, RUG_TRADE_TIME);
 
-    if (mState != static_cast<uint16_t>(aState))
+    ETradeState prevState = static_cast<ETradeState>(mState.load());
+    if (prevState != aState)
     {
         mState = static_cast<uint16_t>(aState);
+        if (mGoodIndex)
+        {
+            mGoodIndex->move(this, prevState, aState);
+        }
     }
 }
 
 
+/**
+* Set the index the rug reports the good it trades to whenever a trade changes it.
+* @param aGoodIndex - The index, nullptr to stop reporting.
+*/
+void Rug::setGoodIndex(RugGoodIndex* aGoodIndex)
+{
+    mGoodIndex = aGoodIndex;
+}
+
+
 /**
 * Get this Rug's current trade state.
 *
@@ -188,12 +224,59 @@ Vector Rug::getLocation()
 */
 bool Rug::canTrade()
 {
-    if (mTimeToTrade <= 0)
+    return mTradeable;
+}
+
+
+/**
+* Get the time left before the rug can trade again.
+*
+* @return float The remaining cooldown in seconds, 0 if the rug can trade.
+*/
+float Rug::getTimeToTrade()
+{
+    return sCooldownWheel.getRemaining(mCooldown);
+}
+
+
+/**
+* Save the Rug's state to a world snapshot record.
+*
+* @param aSnapshot - The record.
+*/
+void Rug::saveSnapshot(RugSnapshot& aSnapshot)
+{
+    aSnapshot = {};
+    aSnapshot.mX = mLocation.x;
+    aSnapshot.mY = mLocation.y;
+    aSnapshot.mTimeToTrade = getTimeToTrade();
+    aSnapshot.mState = mState;
+    aSnapshot.mTradeable = mTradeable;
+}
+
+
+/**
+* Restore the Rug's state from a world snapshot record, and place it in the world.
+*
+* @param aSnapshot - The record.
+* @param aWorld    - The world the rug is placed in.
+*/
+void Rug::restoreSnapshot(const RugSnapshot& aSnapshot, World& aWorld)
+{
+    mLocation.x = aSnapshot.mX;
+    mLocation.y = aSnapshot.mY;
+    mState = aSnapshot.mState;
+
+    // Pick the cooldown back up where it was
+    mTradeable = (aSnapshot.mTradeable != 0);
+    if (mTradeable)
     {
-        return true;
+        sCooldownWheel.cancel(mCooldown);
     }
     else
     {
-        return false;
+        sCooldownWheel.schedule(mCooldown, aSnapshot.mTimeToTrade);
     }
+
+    aWorld.placeEntity(this);
 }
@@ -10,7 +10,10 @@
 #include "SDLManager.h"
 #include "Entity.h"
 #include "Texture.h"
+#include "TimerWheel.h"
 class World;
+class RugGoodIndex;
+struct RugSnapshot;
 
 
 // This class is a simple class that shares data with multiple threads
@@ -28,8 +31,22 @@ private:
     // The rugs coordinates
     Vector mLocation;
 
-    // The amount of time before the Rug is able to be traded
-    atomic<float> mTimeToTrade;
+    // Whether the Rug is able to be traded, cleared by a trade and set again when the cooldown timer expires
+    atomic<bool> mTradeable;
+    TimerNode mCooldown;
+
+    // The index the rug reports the good it trades to, nullptr until it is indexed
+    RugGoodIndex* mGoodIndex;
+
+    // Every rug's cooldown timer waits on this wheel, so rugs that are cooling down cost nothing per frame
+    static TimerWheel sCooldownWheel;
+
+    /**
+    * Cooldown timer callback, makes the rug tradeable again.
+    *
+    * @param aRug - The rug.
+    */
+    static void onCooldownExpired(void* aRug);
 public:
     // Default initialize the rug, the rug will not be properly initialized until it is
     // initialized with init(..)
@@ -42,17 +59,18 @@ public:
     bool init(Texture* aTxtrPtr, SDL_Rect aTxtrFrames[], World& aWorld);
 
     /**
-    * update the rug
-    * 
-    * @param dt - time passed since last time update was called.
+    * Advance every rug's trade cooldown, the rugs whose cooldown ran out become tradeable. Must not be
+    * called while other threads trade with rugs.
+    *
+    * @param dt - time passed since the cooldowns were last advanced.
     */
-    void update(const float& dt);
+    static void updateCooldowns(const float& dt);
 
-    // Only draws the rugs trade item to the screen
-    void render();
+    // Only draws the rugs trade item to the screen, through the camera
+    void render(const Camera& aCamera);
 
-    // Draw the full rug entity to the screen
-    void renderFull();
+    // Draw the full rug entity to the screen, through the camera
+    void renderFull(const Camera& aCamera);
 
     /**
     * Set this Rug's current trade state to the argument trade state.
@@ -61,6 +79,12 @@ public:
     */
     void setTradeState(const ETradeState& aState);
 
+    /**
+    * Set the index the rug reports the good it trades to whenever a trade changes it.
+    * @param aGoodIndex - The index, nullptr to stop reporting.
+    */
+    void setGoodIndex(RugGoodIndex* aGoodIndex);
+
     /**
     * Get this Rug's current trade state.
     *
@@ -91,4 +115,26 @@ public:
     * @return bool True the rug can trade, otherwise false
     */
     bool canTrade();
+
+    /**
+    * Get the time left before the rug can trade again.
+    *
+    * @return float The remaining cooldown in seconds, 0 if the rug can trade.
+    */
+    float getTimeToTrade();
+
+    /**
+    * Save the Rug's state to a world snapshot record.
+    *
+    * @param aSnapshot - The record.
+    */
+    void saveSnapshot(RugSnapshot& aSnapshot);
+
+    /**
+    * Restore the Rug's state from a world snapshot record, and place it in the world.
+    *
+    * @param aSnapshot - The record.
+    * @param aWorld    - The world the rug is placed in.
+    */
+    void restoreSnapshot(const RugSnapshot& aSnapshot, World& aWorld);
 };
\ No newline at end of file
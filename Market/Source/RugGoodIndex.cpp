@@ -0,0 +1,117 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* RugGoodIndex finds the rug closest to a point that trades a good other than one, for the NPCs heading to
+* a rug they can trade with. The rugs are split by the good they trade, one quadtree per good, and a rug is
+* moved to its new good's quadtree whenever a trade changes its good, so the index never has to be rebuilt
+* and finding a rug stays logarithmic in the number of rugs.
+*/
+#include "PCH.h"
+#include "RugGoodIndex.h"
+#include "Rug.h"
+
+
+/**
+* Default Constructor, the index is empty until it is built.
+*/
+RugGoodIndex::RugGoodIndex()
+{}
+
+
+/**
+* Build the index, and have every rug report its trades to it.
+* @param aRugs   - The rugs, each must already be placed.
+* @param aWidth  - The world's width.
+* @param aHeight - The world's height.
+*/
+void RugGoodIndex::build(const vector<Rug*>& aRugs, const uint32_t& aWidth, const uint32_t& aHeight)
+{
+    for (LooseQuadtree& good : mGoods)
+    {
+        good.init(aWidth, aHeight);
+    }
+
+    for (Rug* rug : aRugs)
+    {
+        mGoods[static_cast<size_t>(rug->getTradeState())].insert(rug);
+        rug->setGoodIndex(this);
+    }
+}
+
+
+/**
+* Move a rug whose good changed to its new good. Must not be called while other threads find rugs.
+* @param aRug      - The rug.
+* @param aPrevGood - The good the rug traded.
+* @param aGood     - The good the rug trades now.
+*/
+void RugGoodIndex::move(Rug* aRug, const ETradeState& aPrevGood, const ETradeState& aGood)
+{
+    mGoods[static_cast<size_t>(aPrevGood)].remove(aRug);
+    mGoods[static_cast<size_t>(aGood)].insert(aRug);
+}
+
+
+/**
+* Find the rug closest to a point trading a good other than one, past a distance from the point. Safe
+* to call from any thread while no rug's good changes. Each other good's closest rugs are looked at until
+* one is past the distance, and the closest of those is chosen, the first good wins a tie.
+* @param aLocation    - The point.
+* @param aGood        - The good the rug must not trade.
+* @param aMinDistance - How far from the point the rug must be.
+* @return Rug* The rug, nullptr if there is none.
+*/
+Rug* RugGoodIndex::findNearest(const Vector& aLocation, const ETradeState& aGood, const float& aMinDistance) const
+{
+    Rug* nearest = nullptr;
+    float nearestDistanceSquared = FLT_MAX;
+    float minDistanceSquared = aMinDistance * aMinDistance;
+    Entity* candidates[QUERY_MAX_NEAREST];
+
+    for (uint32_t good = 0; good < RUG_GOOD_COUNT; ++good)
+    {
+        if (good == static_cast<uint32_t>(aGood))
+        {
+            continue;
+        }
+
+        // The closest few rugs are looked at first, and more only while every one of them is too close
+        uint32_t capacity = RUG_GOOD_CANDIDATES;
+        while (true)
+        {
+            NearestQueue queue(candidates, capacity);
+            mGoods[good].queryNearest(aLocation, FLT_MAX, queue);
+            uint32_t count = queue.finish();
+
+            bool found = false;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                Vector location = candidates[i]->getLocation();
+                float deltaX = location.x - aLocation.x;
+                float deltaY = location.y - aLocation.y;
+                float distanceSquared = (deltaX * deltaX) + (deltaY * deltaY);
+                if (distanceSquared > minDistanceSquared)
+                {
+                    if (distanceSquared < nearestDistanceSquared)
+                    {
+                        nearest = static_cast<Rug*>(candidates[i]);
+                        nearestDistanceSquared = distanceSquared;
+                    }
+                    found = true;
+                    break;
+                }
+            }
+
+            // Done once a rug was past the distance, every rug of the good was looked at, or no more fit
+            if (found || count < capacity || capacity == QUERY_MAX_NEAREST)
+            {
+                break;
+            }
+            capacity = min(capacity * 2, QUERY_MAX_NEAREST);
+        }
+    }
+
+    return nearest;
+}
@@ -0,0 +1,62 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* RugGoodIndex finds the rug closest to a point that trades a good other than one, for the NPCs heading to
+* a rug they can trade with. The rugs are split by the good they trade, one quadtree per good, and a rug is
+* moved to its new good's quadtree whenever a trade changes its good, so the index never has to be rebuilt
+* and finding a rug stays logarithmic in the number of rugs.
+*/
+#pragma once
+#include "PCH.h"
+#include "LooseQuadtree.h"
+class Rug;
+
+
+// Number of goods the rugs trade
+constexpr uint32_t RUG_GOOD_COUNT = static_cast<uint32_t>(ETradeState::BREAD_WINE) + 1;
+
+// Closest rugs of each good looked at first when finding one, doubled up to QUERY_MAX_NEAREST while every
+// rug looked at is within the distance passed over
+constexpr uint32_t RUG_GOOD_CANDIDATES = 4;
+
+
+class RugGoodIndex
+{
+private:
+    // Every rug trading each good
+    LooseQuadtree mGoods[RUG_GOOD_COUNT];
+
+public:
+    /**
+    * Default Constructor, the index is empty until it is built.
+    */
+    RugGoodIndex();
+
+    /**
+    * Build the index, and have every rug report its trades to it.
+    * @param aRugs   - The rugs, each must already be placed.
+    * @param aWidth  - The world's width.
+    * @param aHeight - The world's height.
+    */
+    void build(const vector<Rug*>& aRugs, const uint32_t& aWidth, const uint32_t& aHeight);
+
+    /**
+    * Move a rug whose good changed to its new good. Must not be called while other threads find rugs.
+    * @param aRug      - The rug.
+    * @param aPrevGood - The good the rug traded.
+    * @param aGood     - The good the rug trades now.
+    */
+    void move(Rug* aRug, const ETradeState& aPrevGood, const ETradeState& aGood);
+
+    /**
+    * Find the rug closest to a point trading a good other than one, past a distance from the point. Safe
+    * to call from any thread while no rug's good changes.
+    * @param aLocation    - The point.
+    * @param aGood        - The good the rug must not trade.
+    * @param aMinDistance - How far from the point the rug must be.
+    * @return Rug* The rug, nullptr if there is none.
+    */
+    Rug* findNearest(const Vector& aLocation, const ETradeState& aGood, const float& aMinDistance) const;
+};
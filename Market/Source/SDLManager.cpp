@@ -23,6 +23,8 @@ SDLManager::SDLManager()
     mRenderer = nullptr;
     mMouseFocus = mKeyboardFocus = mFullscreen = mMinimized = false;
     mWindowHeight = mWindowWidth = 0;
+    mRenderMode = ERenderMode::WINDOWED;
+    mRenderBatching = true;
 }
 
 
@@ -59,11 +61,20 @@ SDLManager::~SDLManager()
 // Initialize SDL subsystem and create a window, with the given name, dimensions, and path to the window icon
 //
 // Returns false on failure
-bool SDLManager::init(string aTitle /*= "Balogna Engine"*/, float aWidth /*= 1280.f*/, float aHeight /*= 760.f*/, string aIconPath /*= ""*/, Uint32 aWindowFlags /*= SDL_WINDOW_MAXIMIZED*/)
+bool SDLManager::init(string aTitle /*= "Balogna Engine"*/, float aWidth /*= 1280.f*/, float aHeight /*= 760.f*/, string aIconPath /*= ""*/, Uint32 aWindowFlags /*= SDL_WINDOW_MAXIMIZED*/, ERenderMode aRenderMode /*= ERenderMode::WINDOWED*/)
 {
     // Initialization flag
     bool success = true;
 
+    // A headless window uses the dummy video driver, which needs no display, and is never shown
+    mRenderMode = aRenderMode;
+    if (mRenderMode == ERenderMode::HEADLESS)
+    {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+        aWindowFlags = (aWindowFlags & ~SDL_WINDOW_SHOWN) | SDL_WINDOW_HIDDEN;
+    }
+    SDL_SetHint(SDL_HINT_RENDER_BATCHING, (mRenderBatching) ? ("1") : ("0"));
+
     // Initialize SDL subsystems
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
@@ -124,9 +135,21 @@ bool SDLManager::init(string aTitle /*= "Balogna Engine"*/, float aWidth /*= 128
 }
 
 
-// Creates a pointer to renderer associated with this window object
+// Set whether the renderer batches draws, must be called before init
+void SDLManager::setRenderBatching(const bool& aRenderBatching)
+{
+    mRenderBatching = aRenderBatching;
+}
+
+
+// Creates a pointer to renderer associated with this window object, a headless window gets the software
+// renderer without vsync so frames are drawn as fast as the CPU allows
 SDL_Renderer* SDLManager::createRenderer()
 {
+    if (mRenderMode == ERenderMode::HEADLESS)
+    {
+        return SDL_CreateRenderer(mSDLWindow, -1, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE);
+    }
     return SDL_CreateRenderer(mSDLWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 }
 
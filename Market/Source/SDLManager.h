@@ -11,6 +11,15 @@
 #include <SDL.h>
 #include <SDL_image.h>
 
+// How the window is presented, a headless window is never shown and is drawn by the software renderer
+// without waiting for vsync, so it runs without a display or GPU
+enum class ERenderMode
+{
+    WINDOWED,
+    HEADLESS
+};
+
+
 // This class acts as an interface with the SDL Subsystem
 class SDLManager
 {
@@ -26,6 +35,10 @@ private:
     bool mFullscreen;
     bool mMinimized;
 
+    // How the window is presented, and whether the renderer batches draws
+    ERenderMode mRenderMode;
+    bool mRenderBatching;
+
 public:
     // Construct SDL subsystem
     SDLManager();
@@ -36,7 +49,10 @@ public:
     // Initialize SDL subsystem and create a window, with the given name, dimensions, and path to the window icon
     //
     // Returns false on failure
-    bool init(string = "Balogna Engine", float = 1280.f, float = 760.f, string = "", Uint32 = SDL_WINDOW_SHOWN);
+    bool init(string = "Balogna Engine", float = 1280.f, float = 760.f, string = "", Uint32 = SDL_WINDOW_SHOWN, ERenderMode = ERenderMode::WINDOWED);
+
+    // Set whether the renderer batches draws, must be called before init
+    void setRenderBatching(const bool&);
 
     // Creates renderer from internal window
     SDL_Renderer* createRenderer();
@@ -71,6 +87,18 @@ public:
         return mMinimized;
     }
 
+    // Check if the window is headless
+    bool isHeadless()
+    {
+        return mRenderMode == ERenderMode::HEADLESS;
+    }
+
+    // Check if the renderer batches draws
+    bool isRenderBatching()
+    {
+        return mRenderBatching;
+    }
+
     // Contains the windows width and height
     static int mWindowWidth;
     static int mWindowHeight;
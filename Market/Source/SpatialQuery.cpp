@@ -0,0 +1,192 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* SpatialQuery holds what the world's radius, rectangle, and nearest queries share, the filter choosing
+* which entities they report, and the queue the nearest query keeps its closest entities in. Neither
+* allocates, the queue sorts the entities in the caller's buffer.
+*/
+#include "PCH.h"
+#include "SpatialQuery.h"
+
+
+/**
+* Default Constructor, the filter reports every entity.
+*/
+QueryFilter::QueryFilter()
+{
+    mByType       = false;
+    mType         = EEntityType::NPC;
+    mByTradeState = false;
+    mTradeState   = ETradeState::CHICKEN;
+}
+
+
+/**
+* Narrow the filter to a type of entity.
+* @param aType - The type.
+* @return QueryFilter The narrowed filter.
+*/
+QueryFilter QueryFilter::withType(const EEntityType& aType) const
+{
+    QueryFilter filter = *this;
+    filter.mByType = true;
+    filter.mType   = aType;
+    return filter;
+}
+
+
+/**
+* Narrow the filter to the entities trading a good.
+* @param aTradeState - The good.
+* @return QueryFilter The narrowed filter.
+*/
+QueryFilter QueryFilter::withTradeState(const ETradeState& aTradeState) const
+{
+    QueryFilter filter = *this;
+    filter.mByTradeState = true;
+    filter.mTradeState   = aTradeState;
+    return filter;
+}
+
+
+/**
+* Whether the filter reports an entity.
+* @param aEntity - The entity.
+* @return bool True if the entity is reported, otherwise false.
+*/
+bool QueryFilter::matches(Entity* aEntity) const
+{
+    return (!mByType || aEntity->getType() == mType) && (!mByTradeState || aEntity->getTradeState() == mTradeState);
+}
+
+
+/**
+* Constructor
+* @param aEntities - The caller's buffer, the entities are written to.
+* @param aCapacity - The most entities kept, no more than QUERY_MAX_NEAREST.
+*/
+NearestQueue::NearestQueue(Entity** aEntities, const uint32_t& aCapacity)
+{
+    mEntities = aEntities;
+    mCapacity = min(aCapacity, QUERY_MAX_NEAREST);
+    mSize     = 0;
+}
+
+
+/**
+* Whether the entity at one index is farther than the entity at another, ties broken by unique ID so the
+* answer never depends on the order the entities were found in.
+* @param aFirst  - The first index.
+* @param aSecond - The second index.
+* @return bool True if the first is farther, otherwise false.
+*/
+bool NearestQueue::isFarther(const uint32_t& aFirst, const uint32_t& aSecond) const
+{
+    if (mDistancesSquared[aFirst] != mDistancesSquared[aSecond])
+    {
+        return mDistancesSquared[aFirst] > mDistancesSquared[aSecond];
+    }
+    return mEntities[aFirst]->getUniqueID() > mEntities[aSecond]->getUniqueID();
+}
+
+
+/**
+* Swap the entities at two indices.
+* @param aFirst  - The first index.
+* @param aSecond - The second index.
+*/
+void NearestQueue::swap(const uint32_t& aFirst, const uint32_t& aSecond)
+{
+    std::swap(mEntities[aFirst], mEntities[aSecond]);
+    std::swap(mDistancesSquared[aFirst], mDistancesSquared[aSecond]);
+}
+
+
+/**
+* Move the entity at an index down the heap until neither child is farther.
+* @param aIndex - The index.
+* @param aSize  - The size of the heap.
+*/
+void NearestQueue::siftDown(uint32_t aIndex, const uint32_t& aSize)
+{
+    while ((aIndex * 2) + 1 < aSize)
+    {
+        uint32_t child = (aIndex * 2) + 1;
+        if (child + 1 < aSize && isFarther(child + 1, child))
+        {
+            ++child;
+        }
+        if (!isFarther(child, aIndex))
+        {
+            return;
+        }
+        swap(aIndex, child);
+        aIndex = child;
+    }
+}
+
+
+/**
+* Get the squared distance an entity must be within to be kept, the farthest kept entity's once the
+* queue is full.
+* @return float The squared distance, FLT_MAX while the queue isn't full.
+*/
+float NearestQueue::getBoundSquared() const
+{
+    return (mSize == mCapacity && mCapacity > 0) ? (mDistancesSquared[0]) : (FLT_MAX);
+}
+
+
+/**
+* Keep an entity if it's closer than the farthest kept entity, or the queue isn't full.
+* @param aEntity          - The entity.
+* @param aDistanceSquared - The entity's squared distance from the query's center.
+*/
+void NearestQueue::offer(Entity* aEntity, const float& aDistanceSquared)
+{
+    if (mCapacity == 0)
+    {
+        return;
+    }
+
+    // Not full yet, the entity is added at the bottom and moved up past every closer parent
+    if (mSize < mCapacity)
+    {
+        uint32_t index = mSize++;
+        mEntities[index] = aEntity;
+        mDistancesSquared[index] = aDistanceSquared;
+        while (index > 0 && isFarther(index, (index - 1) / 2))
+        {
+            swap(index, (index - 1) / 2);
+            index = (index - 1) / 2;
+        }
+        return;
+    }
+
+    // Full, the entity replaces the farthest if it's closer
+    if (aDistanceSquared > mDistancesSquared[0] || (aDistanceSquared == mDistancesSquared[0] && aEntity->getUniqueID() > mEntities[0]->getUniqueID()))
+    {
+        return;
+    }
+    mEntities[0] = aEntity;
+    mDistancesSquared[0] = aDistanceSquared;
+    siftDown(0, mSize);
+}
+
+
+/**
+* Sort the kept entities closest first.
+* @return uint32_t The number of entities kept.
+*/
+uint32_t NearestQueue::finish()
+{
+    // Heap sort, the farthest is moved to the end each step
+    for (uint32_t end = mSize; end > 1; --end)
+    {
+        swap(0, end - 1);
+        siftDown(0, end - 1);
+    }
+    return mSize;
+}
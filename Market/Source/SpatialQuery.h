@@ -0,0 +1,119 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* SpatialQuery holds what the world's radius, rectangle, and nearest queries share, the filter choosing
+* which entities they report, and the queue the nearest query keeps its closest entities in. Neither
+* allocates, the queue sorts the entities in the caller's buffer.
+*/
+#pragma once
+#include "PCH.h"
+#include "Entity.h"
+
+
+// Most entities one nearest query finds
+constexpr uint32_t QUERY_MAX_NEAREST = 64;
+
+
+// Which entities a spatial query reports, every entity unless it's narrowed to a type or trade state
+struct QueryFilter
+{
+    // Only entities of this type are reported while mByType is set, and only entities trading this good
+    // while mByTradeState is set
+    bool mByType;
+    EEntityType mType;
+    bool mByTradeState;
+    ETradeState mTradeState;
+
+    /**
+    * Default Constructor, the filter reports every entity.
+    */
+    QueryFilter();
+
+    /**
+    * Narrow the filter to a type of entity.
+    * @param aType - The type.
+    * @return QueryFilter The narrowed filter.
+    */
+    QueryFilter withType(const EEntityType& aType) const;
+
+    /**
+    * Narrow the filter to the entities trading a good.
+    * @param aTradeState - The good.
+    * @return QueryFilter The narrowed filter.
+    */
+    QueryFilter withTradeState(const ETradeState& aTradeState) const;
+
+    /**
+    * Whether the filter reports an entity.
+    * @param aEntity - The entity.
+    * @return bool True if the entity is reported, otherwise false.
+    */
+    bool matches(Entity* aEntity) const;
+};
+
+
+// The closest entities a nearest query has found so far, kept as a max heap in the caller's buffer so the
+// farthest is replaced first, and sorted closest first once the query is done
+class NearestQueue
+{
+private:
+    // The caller's buffer, the squared distance of each entity in it, the most entities kept, and how many
+    // are kept
+    Entity** mEntities;
+    float mDistancesSquared[QUERY_MAX_NEAREST];
+    uint32_t mCapacity;
+    uint32_t mSize;
+
+    /**
+    * Whether the entity at one index is farther than the entity at another, ties broken by unique ID so the
+    * answer never depends on the order the entities were found in.
+    * @param aFirst  - The first index.
+    * @param aSecond - The second index.
+    * @return bool True if the first is farther, otherwise false.
+    */
+    bool isFarther(const uint32_t& aFirst, const uint32_t& aSecond) const;
+
+    /**
+    * Swap the entities at two indices.
+    * @param aFirst  - The first index.
+    * @param aSecond - The second index.
+    */
+    void swap(const uint32_t& aFirst, const uint32_t& aSecond);
+
+    /**
+    * Move the entity at an index down the heap until neither child is farther.
+    * @param aIndex - The index.
+    * @param aSize  - The size of the heap.
+    */
+    void siftDown(uint32_t aIndex, const uint32_t& aSize);
+
+public:
+    /**
+    * Constructor
+    * @param aEntities - The caller's buffer, the entities are written to.
+    * @param aCapacity - The most entities kept, no more than QUERY_MAX_NEAREST.
+    */
+    NearestQueue(Entity** aEntities, const uint32_t& aCapacity);
+
+    /**
+    * Get the squared distance an entity must be within to be kept, the farthest kept entity's once the
+    * queue is full.
+    * @return float The squared distance, FLT_MAX while the queue isn't full.
+    */
+    float getBoundSquared() const;
+
+    /**
+    * Keep an entity if it's closer than the farthest kept entity, or the queue isn't full.
+    * @param aEntity          - The entity.
+    * @param aDistanceSquared - The entity's squared distance from the query's center.
+    */
+    void offer(Entity* aEntity, const float& aDistanceSquared);
+
+    /**
+    * Sort the kept entities closest first.
+    * @return uint32_t The number of entities kept.
+    */
+    uint32_t finish();
+};
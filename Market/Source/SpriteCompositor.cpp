@@ -0,0 +1,354 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* SpriteCompositor is a render backend that draws the sprites into a framebuffer on the CPU instead of
+* issuing one SDL_RenderCopyEx per sprite. The sprites drawn during a frame are recorded, sorted into
+* painter's order, and binned into screen tiles that are rasterized in parallel on the ThreadPool. The
+* finished frame is uploaded to a streaming texture and drawn with a single copy, so the draw cost scales
+* with the cores instead of the renderer's per call overhead.
+*/
+#include "PCH.h"
+#include "SpriteCompositor.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+
+// The number of threads that have recorded a sprite, each is given the next buffer
+static atomic<uint32_t> sRecordingThreadCount(0);
+
+
+/**
+* Get the calling thread's command buffer, assigning one on the thread's first sprite.
+* @return uint32_t The buffer's index, COMPOSITOR_MAX_THREADS or more if every buffer is taken.
+*/
+static uint32_t getThreadBufferIndex()
+{
+    static thread_local uint32_t threadIndex = sRecordingThreadCount++;
+    return threadIndex;
+}
+
+
+// Screen coordinates are biased into 16 bits for the sort key
+static uint64_t keyCoordinate(const int& aCoordinate)
+{
+    return static_cast<uint64_t>(min(max(aCoordinate + 0x8000, 0), 0xFFFF));
+}
+
+
+/**
+* Draw a row of sprite pixels over a row of the framebuffer, skipping the transparent pixels.
+*/
+static void blendRow(uint32_t* aDestination, const uint32_t* aSource, const uint32_t& aCount)
+{
+    uint32_t i = 0;
+#ifdef MARKET_SSE2
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= aCount; i += 4)
+    {
+        __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aSource + i));
+        __m128i destination = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aDestination + i));
+
+        // All ones where the sprite is transparent, keep the framebuffer there
+        __m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(source, alphaMask), zero);
+        __m128i blended = _mm_or_si128(_mm_and_si128(transparent, destination), _mm_andnot_si128(transparent, source));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(aDestination + i), blended);
+    }
+#endif
+    for (; i < aCount; ++i)
+    {
+        if (aSource[i] & 0xFF000000)
+        {
+            aDestination[i] = aSource[i];
+        }
+    }
+}
+
+
+/**
+* Default Constructor, nothing is drawn until the compositor is initialized.
+*/
+SpriteCompositor::SpriteCompositor() : mCommandMtx("SpriteCompositor::mCommandMtx")
+{
+    mTarget = nullptr;
+    mWidth = 0;
+    mHeight = 0;
+    mLayer = 0;
+    mTileColumns = 0;
+    mTileRows = 0;
+}
+
+
+/**
+* Destroys the streaming texture.
+*/
+SpriteCompositor::~SpriteCompositor()
+{
+    free();
+}
+
+
+/**
+* Create the framebuffer and the streaming texture it is uploaded to.
+* @param aRenderer - The renderer the frame is drawn with.
+* @param aWidth    - The framebuffer's width.
+* @param aHeight   - The framebuffer's height.
+* @return bool True if the compositor was initialized, otherwise false.
+*/
+bool SpriteCompositor::init(SDL_Renderer* aRenderer, const uint32_t& aWidth, const uint32_t& aHeight)
+{
+    free();
+
+    mTarget = SDL_CreateTexture(aRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, static_cast<int>(aWidth), static_cast<int>(aHeight));
+    if (!mTarget)
+    {
+        // cout << "Failed to create the compositor's streaming texture! SDL Error: " << SDL_GetError() << "\n";
+        return false;
+    }
+
+    mWidth = aWidth;
+    mHeight = aHeight;
+    mFramebuffer.assign(static_cast<size_t>(mWidth) * mHeight, COMPOSITOR_CLEAR_COLOR);
+
+    mTileColumns = (mWidth + COMPOSITOR_TILE_SIZE - 1) / COMPOSITOR_TILE_SIZE;
+    mTileRows = (mHeight + COMPOSITOR_TILE_SIZE - 1) / COMPOSITOR_TILE_SIZE;
+    mTileCommands.assign(static_cast<size_t>(mTileColumns) * mTileRows, vector<uint32_t>());
+    return true;
+}
+
+
+/**
+* Destroy the streaming texture, and free the framebuffer.
+*/
+void SpriteCompositor::free()
+{
+    if (mTarget)
+    {
+        SDL_DestroyTexture(mTarget);
+        mTarget = nullptr;
+    }
+
+    mWidth = 0;
+    mHeight = 0;
+    mFramebuffer.clear();
+    mTileCommands.clear();
+    mTileColumns = 0;
+    mTileRows = 0;
+}
+
+
+/**
+* Start recording a frame.
+*/
+void SpriteCompositor::begin()
+{
+    for (SpriteCommandBuffer& buffer : mThreadCommands)
+    {
+        buffer.mCommands.clear();
+    }
+    mSharedCommands.clear();
+    mCommands.clear();
+    mLayer = 0;
+}
+
+
+/**
+* Set the layer of the sprites recorded next, a higher layer is drawn over a lower one whatever the
+* sprites' positions.
+* @param aLayer - The layer.
+*/
+void SpriteCompositor::setLayer(const uint32_t& aLayer)
+{
+    mLayer = aLayer;
+}
+
+
+/**
+* Record a sprite, safe to call from any thread, each thread records into its own buffer without a lock.
+* @param aPixels      - The texture's ARGB pixels, transparent pixels have an alpha of 0.
+* @param aPitch       - The texture's width in pixels.
+* @param aSource      - The part of the texture drawn.
+* @param aDestination - Where the sprite is drawn, scaled to fit.
+* @param aFlip        - Whether the sprite is flipped horizontally.
+*/
+void SpriteCompositor::draw(const uint32_t* aPixels, const uint32_t& aPitch, const SDL_Rect& aSource, const SDL_Rect& aDestination, const bool& aFlip)
+{
+    if (!aPixels || aSource.w <= 0 || aSource.h <= 0 || aDestination.w <= 0 || aDestination.h <= 0)
+    {
+        return;
+    }
+
+    SpriteCommand command;
+    command.mKey = (static_cast<uint64_t>(mLayer) << 48) | (keyCoordinate(aDestination.y + aDestination.h) << 16) | keyCoordinate(aDestination.x);
+    command.mPixels = aPixels;
+    command.mPitch = aPitch;
+    command.mSource = aSource;
+    command.mDestination = aDestination;
+    command.mFlip = aFlip;
+
+    uint32_t threadIndex = getThreadBufferIndex();
+    if (threadIndex < COMPOSITOR_MAX_THREADS)
+    {
+        mThreadCommands[threadIndex].mCommands.push_back(command);
+        return;
+    }
+
+    lock_guard<ProfiledMutex> lock(mCommandMtx);
+    mSharedCommands.push_back(command);
+}
+
+
+/**
+* Gather the threads' recorded sprites, rasterize the frame on the thread pool, upload it, and draw it to
+* the renderer.
+* @param aRenderer   - The renderer.
+* @param aThreadPool - The thread pool the tiles are rasterized on.
+*/
+void SpriteCompositor::present(SDL_Renderer* aRenderer, ThreadPool& aThreadPool)
+{
+    if (!mTarget)
+    {
+        return;
+    }
+
+    // The threads are done recording, their buffers are emptied into one list for sorting
+    {
+        TRACE_SCOPE("SpriteCompositor::gather");
+        mCommands.clear();
+        for (SpriteCommandBuffer& buffer : mThreadCommands)
+        {
+            mCommands.insert(mCommands.end(), buffer.mCommands.begin(), buffer.mCommands.end());
+            buffer.mCommands.clear();
+        }
+        mCommands.insert(mCommands.end(), mSharedCommands.begin(), mSharedCommands.end());
+        mSharedCommands.clear();
+    }
+
+    // Sort into painter's order, the index breaks ties so the order doesn't depend on the sort
+    {
+        TRACE_SCOPE("SpriteCompositor::sort");
+        mOrder.resize(mCommands.size());
+        for (uint32_t i = 0; i < static_cast<uint32_t>(mCommands.size()); ++i)
+        {
+            mOrder[i] = make_pair(mCommands[i].mKey, i);
+        }
+        sort(mOrder.begin(), mOrder.end());
+    }
+
+    // Bin every command into the tiles it overlaps, in order
+    {
+        TRACE_SCOPE("SpriteCompositor::bin");
+        for (vector<uint32_t>& tile : mTileCommands)
+        {
+            tile.clear();
+        }
+
+        for (const pair<uint64_t, uint32_t>& entry : mOrder)
+        {
+            const SDL_Rect& destination = mCommands[entry.second].mDestination;
+            int left   = max(destination.x, 0);
+            int top    = max(destination.y, 0);
+            int right  = min(destination.x + destination.w, static_cast<int>(mWidth)) - 1;
+            int bottom = min(destination.y + destination.h, static_cast<int>(mHeight)) - 1;
+            if (left > right || top > bottom)
+            {
+                continue;
+            }
+
+            for (uint32_t row = top / COMPOSITOR_TILE_SIZE; row <= bottom / COMPOSITOR_TILE_SIZE; ++row)
+            {
+                for (uint32_t col = left / COMPOSITOR_TILE_SIZE; col <= right / COMPOSITOR_TILE_SIZE; ++col)
+                {
+                    mTileCommands[(static_cast<size_t>(row) * mTileColumns) + col].push_back(entry.second);
+                }
+            }
+        }
+    }
+
+    {
+        TRACE_SCOPE("SpriteCompositor::rasterize");
+        aThreadPool.run(mTileColumns * mTileRows, &SpriteCompositor::compositeTileTask, this);
+    }
+
+    {
+        TRACE_SCOPE("SpriteCompositor::upload");
+        SDL_UpdateTexture(mTarget, nullptr, mFramebuffer.data(), static_cast<int>(mWidth * sizeof(uint32_t)));
+        SDL_RenderCopy(aRenderer, mTarget, nullptr, nullptr);
+    }
+}
+
+
+/**
+* ThreadPool task, rasterizes one tile.
+* @param aCompositor - The compositor.
+* @param aTile       - The tile's index.
+*/
+void SpriteCompositor::compositeTileTask(void* aCompositor, uint32_t aTile)
+{
+    static_cast<SpriteCompositor*>(aCompositor)->compositeTile(aTile);
+}
+
+
+/**
+* Rasterize one tile's commands, in order, into the framebuffer.
+* @param aTile - The tile's index.
+*/
+void SpriteCompositor::compositeTile(const uint32_t& aTile)
+{
+    int tileLeft   = static_cast<int>((aTile % mTileColumns) * COMPOSITOR_TILE_SIZE);
+    int tileTop    = static_cast<int>((aTile / mTileColumns) * COMPOSITOR_TILE_SIZE);
+    int tileRight  = min(tileLeft + static_cast<int>(COMPOSITOR_TILE_SIZE), static_cast<int>(mWidth));
+    int tileBottom = min(tileTop + static_cast<int>(COMPOSITOR_TILE_SIZE), static_cast<int>(mHeight));
+
+    // Clear the tile
+    for (int y = tileTop; y < tileBottom; ++y)
+    {
+        uint32_t* row = &mFramebuffer[(static_cast<size_t>(y) * mWidth) + tileLeft];
+        fill(row, row + (tileRight - tileLeft), COMPOSITOR_CLEAR_COLOR);
+    }
+
+    // One scaled and flipped sprite row, clipped to the tile
+    uint32_t spriteRow[COMPOSITOR_TILE_SIZE];
+
+    for (uint32_t index : mTileCommands[aTile])
+    {
+        const SpriteCommand& command = mCommands[index];
+        const SDL_Rect& source = command.mSource;
+        const SDL_Rect& destination = command.mDestination;
+
+        int left   = max(destination.x, tileLeft);
+        int top    = max(destination.y, tileTop);
+        int right  = min(destination.x + destination.w, tileRight);
+        int bottom = min(destination.y + destination.h, tileBottom);
+        if (left >= right || top >= bottom)
+        {
+            continue;
+        }
+
+        // 16.16 fixed point steps through the source for every destination pixel, sampling at the pixel's
+        // center so an integer scale repeats every source pixel exactly
+        uint32_t stepX = (static_cast<uint32_t>(source.w) << 16) / static_cast<uint32_t>(destination.w);
+        uint32_t stepY = (static_cast<uint32_t>(source.h) << 16) / static_cast<uint32_t>(destination.h);
+        uint32_t count = static_cast<uint32_t>(right - left);
+
+        for (int y = top; y < bottom; ++y)
+        {
+            uint32_t sourceY = static_cast<uint32_t>(source.y) + (((static_cast<uint32_t>(y - destination.y) * stepY) + (stepY >> 1)) >> 16);
+            const uint32_t* sourceRow = command.mPixels + (static_cast<size_t>(sourceY) * command.mPitch) + source.x;
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint32_t local = static_cast<uint32_t>(left - destination.x) + i;
+                if (command.mFlip)
+                {
+                    local = static_cast<uint32_t>(destination.w) - 1 - local;
+                }
+                spriteRow[i] = sourceRow[((local * stepX) + (stepX >> 1)) >> 16];
+            }
+
+            blendRow(&mFramebuffer[(static_cast<size_t>(y) * mWidth) + left], spriteRow, count);
+        }
+    }
+}
@@ -0,0 +1,144 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* SpriteCompositor is a render backend that draws the sprites into a framebuffer on the CPU instead of
+* issuing one SDL_RenderCopyEx per sprite. The sprites drawn during a frame are recorded, sorted into
+* painter's order, and binned into screen tiles that are rasterized in parallel on the ThreadPool. The
+* finished frame is uploaded to a streaming texture and drawn with a single copy, so the draw cost scales
+* with the cores instead of the renderer's per call overhead.
+*/
+#pragma once
+#include "PCH.h"
+#include "SDL.h"
+#include "ProfiledMutex.h"
+class ThreadPool;
+
+
+// Width and height of the screen tiles rasterized as one task
+constexpr uint32_t COMPOSITOR_TILE_SIZE = 64;
+
+// The color the framebuffer is cleared to, ARGB
+constexpr uint32_t COMPOSITOR_CLEAR_COLOR = 0xFFD3D3D3;
+
+// Most threads that record sprites into buffers of their own, the threads past it share a locked buffer
+constexpr uint32_t COMPOSITOR_MAX_THREADS = 32;
+
+
+// One sprite recorded for the frame
+struct SpriteCommand
+{
+    // Sort key, the layer, then the bottom edge, then the left edge of the sprite on screen
+    uint64_t mKey;
+
+    // The texture's ARGB pixels, transparent pixels have an alpha of 0
+    const uint32_t* mPixels;
+    uint32_t mPitch;
+
+    SDL_Rect mSource;
+    SDL_Rect mDestination;
+    bool mFlip;
+};
+
+
+// One thread's recorded sprites, padded to a cache line so two threads never write the same line
+struct SpriteCommandBuffer
+{
+    vector<SpriteCommand> mCommands;
+    uint8_t mPadding[64 - sizeof(vector<SpriteCommand>)];
+};
+
+
+class SpriteCompositor
+{
+private:
+    SDL_Texture* mTarget;
+    uint32_t mWidth;
+    uint32_t mHeight;
+    vector<uint32_t> mFramebuffer;
+
+    // The sprites each thread recorded this frame, every world partition records on its own thread, and
+    // the sprites of the threads without a buffer of their own, guarded
+    SpriteCommandBuffer mThreadCommands[COMPOSITOR_MAX_THREADS];
+    ProfiledMutex mCommandMtx;
+    vector<SpriteCommand> mSharedCommands;
+    uint32_t mLayer;
+
+    // Every sprite recorded this frame, gathered from the threads' buffers when the frame is presented
+    vector<SpriteCommand> mCommands;
+
+    // The commands sorted into painter's order, and each tile's commands in that order
+    vector<pair<uint64_t, uint32_t>> mOrder;
+    uint32_t mTileColumns;
+    uint32_t mTileRows;
+    vector<vector<uint32_t>> mTileCommands;
+
+    /**
+    * ThreadPool task, rasterizes one tile.
+    * @param aCompositor - The compositor.
+    * @param aTile       - The tile's index.
+    */
+    static void compositeTileTask(void* aCompositor, uint32_t aTile);
+
+    /**
+    * Rasterize one tile's commands, in order, into the framebuffer.
+    * @param aTile - The tile's index.
+    */
+    void compositeTile(const uint32_t& aTile);
+
+public:
+    /**
+    * Default Constructor, nothing is drawn until the compositor is initialized.
+    */
+    SpriteCompositor();
+
+    /**
+    * Destroys the streaming texture.
+    */
+    ~SpriteCompositor();
+
+    /**
+    * Create the framebuffer and the streaming texture it is uploaded to.
+    * @param aRenderer - The renderer the frame is drawn with.
+    * @param aWidth    - The framebuffer's width.
+    * @param aHeight   - The framebuffer's height.
+    * @return bool True if the compositor was initialized, otherwise false.
+    */
+    bool init(SDL_Renderer* aRenderer, const uint32_t& aWidth, const uint32_t& aHeight);
+
+    /**
+    * Destroy the streaming texture, and free the framebuffer.
+    */
+    void free();
+
+    /**
+    * Start recording a frame.
+    */
+    void begin();
+
+    /**
+    * Set the layer of the sprites recorded next, a higher layer is drawn over a lower one whatever the
+    * sprites' positions.
+    * @param aLayer - The layer.
+    */
+    void setLayer(const uint32_t& aLayer);
+
+    /**
+    * Record a sprite, safe to call from any thread, each thread records into its own buffer without a lock.
+    * @param aPixels      - The texture's ARGB pixels, transparent pixels have an alpha of 0.
+    * @param aPitch       - The texture's width in pixels.
+    * @param aSource      - The part of the texture drawn.
+    * @param aDestination - Where the sprite is drawn, scaled to fit.
+    * @param aFlip        - Whether the sprite is flipped horizontally.
+    */
+    void draw(const uint32_t* aPixels, const uint32_t& aPitch, const SDL_Rect& aSource, const SDL_Rect& aDestination, const bool& aFlip);
+
+    /**
+    * Gather the threads' recorded sprites, rasterize the frame on the thread pool, upload it, and draw it to
+    * the renderer.
+    * @param aRenderer   - The renderer.
+    * @param aThreadPool - The thread pool the tiles are rasterized on.
+    */
+    void present(SDL_Renderer* aRenderer, ThreadPool& aThreadPool);
+};
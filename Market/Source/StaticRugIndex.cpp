@@ -0,0 +1,292 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* StaticRugIndex is a uniform bin grid of the rugs, built once after the rugs are placed because rugs
+* never move. The rugs are stored bin by bin in one array, with their locations kept alongside as
+* structure of arrays, so an NPC's path can be tested against the rugs near it 8 at a time.
+*/
+#include "PCH.h"
+#include "StaticRugIndex.h"
+#include "Rug.h"
+
+
+// Location of the padding entries, far enough away that no segment in the window can reach them
+constexpr float RUG_INDEX_SENTINEL = -1.0e9f;
+
+// Segments the kernel is checked with, each against 8 circles, and the most wrong circles logged
+constexpr uint32_t RUG_KERNEL_CHECKS    = 4096;
+constexpr uint32_t RUG_KERNEL_LOG_LIMIT = 8;
+
+// Circles whose reference distance is this close to the radius in pixels may round either way in float
+constexpr double RUG_KERNEL_TOLERANCE   = 0.01;
+
+// How far off the radius the circles that must land on one side of it are placed, in pixels
+constexpr float RUG_KERNEL_NUDGE        = 0.1f;
+
+
+/**
+* Find how far a circle's center is from a line segment in double precision, the reference the kernel is
+* checked against.
+* @param aPointA  - The first point of the line segment.
+* @param aPointB  - The second point of the line segment.
+* @param aCenterX - The x coordinate of the circle's center.
+* @param aCenterY - The y coordinate of the circle's center.
+* @return double The distance from the center to the closest point on the segment.
+*/
+static double segmentDistance(const Vector& aPointA, const Vector& aPointB, const float& aCenterX, const float& aCenterY)
+{
+    double segmentX = static_cast<double>(aPointB.x) - aPointA.x;
+    double segmentY = static_cast<double>(aPointB.y) - aPointA.y;
+    double toCenterX = static_cast<double>(aCenterX) - aPointA.x;
+    double toCenterY = static_cast<double>(aCenterY) - aPointA.y;
+
+    // A segment whose points are equal is its first point
+    double lengthSquared = (segmentX * segmentX) + (segmentY * segmentY);
+    double t = (lengthSquared > 0) ? (((toCenterX * segmentX) + (toCenterY * segmentY)) / lengthSquared) : (0);
+    t = max(0.0, min(t, 1.0));
+
+    double offsetX = toCenterX - (t * segmentX);
+    double offsetY = toCenterY - (t * segmentY);
+    return sqrt((offsetX * offsetX) + (offsetY * offsetY));
+}
+
+
+/**
+* Default Constructor, the index is empty until it is built.
+*/
+StaticRugIndex::StaticRugIndex()
+{
+    mCellLength = TRADE_RADIUS;
+    mCols = 0;
+    mRows = 0;
+}
+
+
+/**
+* Get the bin column or row containing a coordinate, clamped to the grid.
+* @param aCoordinate - The x or y coordinate.
+* @param aCount      - The number of columns or rows.
+* @return uint32_t The column or row.
+*/
+uint32_t StaticRugIndex::toCell(const float& aCoordinate, const uint32_t& aCount) const
+{
+    if (aCoordinate <= 0)
+    {
+        return 0;
+    }
+
+    uint32_t cell = static_cast<uint32_t>(aCoordinate / mCellLength);
+    return (cell < aCount) ? (cell) : (aCount - 1);
+}
+
+
+/**
+* Build the index, must be called again if a rug is ever moved.
+* @param aRugs        - The rugs, each must already be placed.
+* @param aWidth       - The width of the area the rugs are placed in.
+* @param aHeight      - The height of the area the rugs are placed in.
+* @param aCellLength  - The side length of each bin.
+*/
+void StaticRugIndex::build(const vector<Rug*>& aRugs, const float& aWidth, const float& aHeight, const float& aCellLength)
+{
+    mCellLength = aCellLength;
+    mCols = static_cast<uint32_t>(aWidth / mCellLength) + 1;
+    mRows = static_cast<uint32_t>(aHeight / mCellLength) + 1;
+
+    // Count the rugs in each bin, then turn the counts into each bin's starting index
+    vector<uint32_t> rugCells(aRugs.size());
+    mCellStart.assign((static_cast<size_t>(mCols) * mRows) + 1, 0);
+    for (size_t i = 0; i < aRugs.size(); ++i)
+    {
+        Vector location = aRugs[i]->getLocation();
+        rugCells[i] = (toCell(location.y, mRows) * mCols) + toCell(location.x, mCols);
+        ++mCellStart[rugCells[i] + 1];
+    }
+    for (size_t cell = 1; cell < mCellStart.size(); ++cell)
+    {
+        mCellStart[cell] += mCellStart[cell - 1];
+    }
+
+    // Scatter the rugs into their bins
+    vector<uint32_t> next(mCellStart.begin(), mCellStart.end() - 1);
+    mRugs = aRugs;
+    mRugIndices.assign(aRugs.size(), 0);
+    mRugX.assign(aRugs.size() + 8, RUG_INDEX_SENTINEL);
+    mRugY.assign(aRugs.size() + 8, RUG_INDEX_SENTINEL);
+    for (size_t i = 0; i < aRugs.size(); ++i)
+    {
+        uint32_t slot = next[rugCells[i]]++;
+        Vector location = aRugs[i]->getLocation();
+
+        mRugIndices[slot] = static_cast<uint32_t>(i);
+        mRugX[slot] = location.x;
+        mRugY[slot] = location.y;
+    }
+}
+
+
+/**
+* Find the rugs whose trade radius the line segment overlaps.
+* @param aPointA      - The first point of the line segment.
+* @param aPointB      - The second point of the line segment.
+* @param aResults     - Buffer the overlapping rugs' indices in the vector the index was built from are
+*                       written to.
+* @param aMaxResults  - The size of aResults, rugs past it are not reported.
+* @return uint32_t The number of rugs written to aResults.
+*/
+uint32_t StaticRugIndex::querySegment(const Vector& aPointA, const Vector& aPointB, uint32_t aResults[], const uint32_t& aMaxResults) const
+{
+    uint32_t resultCount = 0;
+    if (mRugs.empty())
+    {
+        return resultCount;
+    }
+
+    // Every bin touched by the segment's bounding box grown by the trade radius
+    uint32_t firstCol = toCell(min(aPointA.x, aPointB.x) - TRADE_RADIUS, mCols);
+    uint32_t lastCol  = toCell(max(aPointA.x, aPointB.x) + TRADE_RADIUS, mCols);
+    uint32_t firstRow = toCell(min(aPointA.y, aPointB.y) - TRADE_RADIUS, mRows);
+    uint32_t lastRow  = toCell(max(aPointA.y, aPointB.y) + TRADE_RADIUS, mRows);
+
+    for (uint32_t row = firstRow; row <= lastRow; ++row)
+    {
+        // The bins of a row are adjacent, so the row's candidate rugs are one contiguous run
+        uint32_t begin = mCellStart[(static_cast<size_t>(row) * mCols) + firstCol];
+        uint32_t end   = mCellStart[(static_cast<size_t>(row) * mCols) + lastCol + 1];
+
+        for (uint32_t batch = begin; batch < end; batch += 8)
+        {
+            uint8_t overlaps = MATH::doesLineSegmentOverlapCircles8(aPointA, aPointB, &mRugX[batch], &mRugY[batch], TRADE_RADIUS);
+            if (end - batch < 8)
+            {
+                overlaps &= static_cast<uint8_t>((1u << (end - batch)) - 1);
+            }
+
+            for (uint32_t lane = 0; overlaps && lane < 8; ++lane, overlaps >>= 1)
+            {
+                if ((overlaps & 1) && resultCount < aMaxResults)
+                {
+                    aResults[resultCount++] = mRugIndices[batch + lane];
+                }
+            }
+        }
+    }
+
+    return resultCount;
+}
+
+
+/**
+* Check the batched segment versus circle kernel the queries use against the scalar test and a double
+* precision reference, over random segments, circles on and just off the radius, and segments whose
+* points are equal, logging the circles the kernel gets wrong.
+* @param aRadius - The circles' radius.
+* @return uint32_t The number of circles the kernel got wrong.
+*/
+uint32_t StaticRugIndex::verifyKernel(const float& aRadius)
+{
+    // Seeded so every run checks the same cases
+    mt19937 rng(1);
+    uniform_real_distribution<float> coordinate(0.f, 2048.f);
+    uniform_real_distribution<float> step(-48.f, 48.f);
+    uniform_real_distribution<float> offset(-2.f * aRadius, 2.f * aRadius);
+    uniform_real_distribution<float> angle(0.f, 6.2831853f);
+
+    uint32_t mismatches = 0;
+    float centerX[8];
+    float centerY[8];
+    for (uint32_t check = 0; check < RUG_KERNEL_CHECKS; ++check)
+    {
+        // Every fourth segment's points are equal, a standing NPC
+        Vector pointA = { coordinate(rng), coordinate(rng), 0 };
+        Vector pointB = pointA;
+        if (check % 4 != 0)
+        {
+            pointB.x += step(rng);
+            pointB.y += step(rng);
+        }
+
+        // The direction beside the segment, any direction if its points are equal
+        float segmentX = pointB.x - pointA.x;
+        float segmentY = pointB.y - pointA.y;
+        float length = static_cast<float>(sqrt((segmentX * segmentX) + (segmentY * segmentY)));
+        float turn = angle(rng);
+        float normalX = (length > 0) ? (-segmentY / length) : (static_cast<float>(cos(turn)));
+        float normalY = (length > 0) ? (segmentX / length) : (static_cast<float>(sin(turn)));
+
+        // Two circles anywhere near the segment, two on the radius from its first point, two on the radius
+        // beside its middle, and two just inside and just outside the radius beside its middle
+        for (uint32_t lane = 0; lane < 8; ++lane)
+        {
+            float distance = (lane == 6) ? (aRadius - RUG_KERNEL_NUDGE) : ((lane == 7) ? (aRadius + RUG_KERNEL_NUDGE) : (aRadius));
+            float side = (lane % 2 == 0) ? (1.f) : (-1.f);
+            if (lane < 2)
+            {
+                centerX[lane] = pointA.x + offset(rng);
+                centerY[lane] = pointA.y + offset(rng);
+            }
+            else if (lane < 4)
+            {
+                turn = angle(rng);
+                centerX[lane] = pointA.x + (aRadius * static_cast<float>(cos(turn)));
+                centerY[lane] = pointA.y + (aRadius * static_cast<float>(sin(turn)));
+            }
+            else
+            {
+                centerX[lane] = ((pointA.x + pointB.x) * 0.5f) + (side * distance * normalX);
+                centerY[lane] = ((pointA.y + pointB.y) * 0.5f) + (side * distance * normalY);
+            }
+        }
+
+        uint8_t overlaps = MATH::doesLineSegmentOverlapCircles8(pointA, pointB, centerX, centerY, aRadius);
+        for (uint32_t lane = 0; lane < 8; ++lane)
+        {
+            Vector center = { centerX[lane], centerY[lane], 0 };
+            bool kernelHit = ((overlaps >> lane) & 1) != 0;
+            bool scalarHit = MATH::doesLineSegmentOverlapCircle(pointA, pointB, center, aRadius);
+            double distance = segmentDistance(pointA, pointB, centerX[lane], centerY[lane]);
+
+            // The kernel must match the scalar test exactly, and the reference unless the circle is too close
+            // to call, and where it hits, the point the segment enters the circle must be a real fraction
+            bool correct = (kernelHit == scalarHit);
+            correct = correct && (fabs(distance - aRadius) <= RUG_KERNEL_TOLERANCE || kernelHit == (distance <= aRadius));
+            if (kernelHit)
+            {
+                float enters = MATH::lineSegmentEntersCircleAt(pointA, pointB, center, aRadius);
+                correct = correct && (enters >= 0.f && enters <= 1.f);
+            }
+
+            if (!correct && ++mismatches <= RUG_KERNEL_LOG_LIMIT)
+            {
+                SDL_Log("StaticRugIndex: kernel %s, scalar %s, reference distance %.4f for radius %.2f, segment (%.3f, %.3f) to (%.3f, %.3f), circle (%.3f, %.3f)",
+                    (kernelHit) ? ("hit") : ("missed"), (scalarHit) ? ("hit") : ("missed"), distance, aRadius,
+                    pointA.x, pointA.y, pointB.x, pointB.y, centerX[lane], centerY[lane]);
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+
+/**
+* Get a rug by the index query results report it with.
+* @param aIndex - The rug's index in the vector the index was built from.
+* @return Rug* The rug.
+*/
+Rug* StaticRugIndex::getRug(const uint32_t& aIndex) const
+{
+    return mRugs[aIndex];
+}
+
+
+/**
+* Get the number of rugs in the index.
+* @return size_t The rug count.
+*/
+size_t StaticRugIndex::size() const
+{
+    return mRugs.size();
+}
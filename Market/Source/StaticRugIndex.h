@@ -0,0 +1,90 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* StaticRugIndex is a uniform bin grid of the rugs, built once after the rugs are placed because rugs
+* never move. The rugs are stored bin by bin in one array, with their locations kept alongside as
+* structure of arrays, so an NPC's path can be tested against the rugs near it 8 at a time.
+*/
+#pragma once
+#include "PCH.h"
+class Rug;
+
+
+class StaticRugIndex
+{
+private:
+    // Bin grid dimensions
+    float mCellLength;
+    uint32_t mCols;
+    uint32_t mRows;
+
+    // mCellStart[i] is the index of the first rug in bin i, mCellStart[i + 1] is one past its last rug
+    vector<uint32_t> mCellStart;
+
+    // The rugs in the order the index was built from
+    vector<Rug*> mRugs;
+
+    // In bin order, each rug's index in mRugs and its location, the locations are padded by 8 far away
+    // sentinels so a batch can always read 8 lanes
+    vector<uint32_t> mRugIndices;
+    vector<float> mRugX;
+    vector<float> mRugY;
+
+    /**
+    * Get the bin column or row containing a coordinate, clamped to the grid.
+    * @param aCoordinate - The x or y coordinate.
+    * @param aCount      - The number of columns or rows.
+    * @return uint32_t The column or row.
+    */
+    uint32_t toCell(const float& aCoordinate, const uint32_t& aCount) const;
+
+public:
+    /**
+    * Default Constructor, the index is empty until it is built.
+    */
+    StaticRugIndex();
+
+    /**
+    * Build the index, must be called again if a rug is ever moved.
+    * @param aRugs        - The rugs, each must already be placed.
+    * @param aWidth       - The width of the area the rugs are placed in.
+    * @param aHeight      - The height of the area the rugs are placed in.
+    * @param aCellLength  - The side length of each bin.
+    */
+    void build(const vector<Rug*>& aRugs, const float& aWidth, const float& aHeight, const float& aCellLength = TRADE_RADIUS);
+
+    /**
+    * Find the rugs whose trade radius the line segment overlaps.
+    * @param aPointA      - The first point of the line segment.
+    * @param aPointB      - The second point of the line segment.
+    * @param aResults     - Buffer the overlapping rugs' indices in the vector the index was built from are
+    *                       written to.
+    * @param aMaxResults  - The size of aResults, rugs past it are not reported.
+    * @return uint32_t The number of rugs written to aResults.
+    */
+    uint32_t querySegment(const Vector& aPointA, const Vector& aPointB, uint32_t aResults[], const uint32_t& aMaxResults) const;
+
+    /**
+    * Check the batched segment versus circle kernel the queries use against the scalar test and a double
+    * precision reference, over random segments, circles on and just off the radius, and segments whose
+    * points are equal, logging the circles the kernel gets wrong.
+    * @param aRadius - The circles' radius.
+    * @return uint32_t The number of circles the kernel got wrong.
+    */
+    static uint32_t verifyKernel(const float& aRadius = TRADE_RADIUS);
+
+    /**
+    * Get a rug by the index query results report it with.
+    * @param aIndex - The rug's index in the vector the index was built from.
+    * @return Rug* The rug.
+    */
+    Rug* getRug(const uint32_t& aIndex) const;
+
+    /**
+    * Get the number of rugs in the index.
+    * @return size_t The rug count.
+    */
+    size_t size() const;
+};
@@ -1,8 +1,12 @@
 #include "PCH.h"
 #include "Texture.h"
+#include "Trace.h"
+#include "SpriteCompositor.h"
 
 
-mutex Texture::mRenderingMtx;
+ProfiledMutex Texture::mRenderingMtx("Texture::mRenderingMtx");
+atomic<uint64_t> Texture::sDrawCount(0);
+SpriteCompositor* Texture::sCompositor = nullptr;
 
 
 // Texture constructor
@@ -14,6 +18,8 @@ Texture::Texture()
     mHeight      = 0;
     mScale       = 1;
     mWindowScale = 1;
+    mPixelWidth  = 0;
+    mPixelHeight = 0;
 
 }
 
@@ -34,6 +40,8 @@ Texture::~Texture()
 // Load Texture from a file
 bool Texture::loadFromFile(std::string path) 
 {
+    TRACE_SCOPE("Texture::loadFromFile");
+
     // Get rid of preexisting texture
     free();
 
@@ -62,7 +70,7 @@ bool Texture::loadFromFile(std::string path)
         SDL_SetColorKey(loadedSurface, SDL_TRUE, SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
 
         // Create texture from surface pixels
-        lock_guard<mutex> lock(mRenderingMtx);
+        lock_guard<ProfiledMutex> lock(mRenderingMtx);
         newTexture = SDL_CreateTextureFromSurface(mRenderer, loadedSurface);
         if (!newTexture) {
             // cout << "Unable to create texture from " << path.c_str() << "! SDL Error: " << SDL_GetError() << "\n";
@@ -74,6 +82,25 @@ bool Texture::loadFromFile(std::string path)
             mHeight = loadedSurface->h;
         }
 
+        // Keep a copy of the pixels for the compositor, with the color keyed pixels made transparent
+        SDL_Surface* argbSurface = SDL_ConvertSurfaceFormat(loadedSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+        if (argbSurface) {
+            mPixelWidth = static_cast<uint16_t>(argbSurface->w);
+            mPixelHeight = static_cast<uint16_t>(argbSurface->h);
+            mPixels.resize(static_cast<size_t>(mPixelWidth) * mPixelHeight);
+
+            SDL_LockSurface(argbSurface);
+            for (uint16_t y = 0; y < mPixelHeight; ++y) {
+                const uint32_t* row = reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(argbSurface->pixels) + (static_cast<size_t>(y) * argbSurface->pitch));
+                for (uint16_t x = 0; x < mPixelWidth; ++x) {
+                    uint32_t pixel = row[x];
+                    mPixels[(static_cast<size_t>(y) * mPixelWidth) + x] = ((pixel & 0x00FFFFFF) == 0x0000FFFF || !(pixel & 0xFF000000)) ? (0) : (pixel | 0xFF000000);
+                }
+            }
+            SDL_UnlockSurface(argbSurface);
+            SDL_FreeSurface(argbSurface);
+        }
+
         // Get rid of old loaded surface
         SDL_FreeSurface(loadedSurface);
     }
@@ -97,6 +124,9 @@ void Texture::free() {
         mHeight = 0;
         mScale = 0;
     }
+    mPixels.clear();
+    mPixelWidth = 0;
+    mPixelHeight = 0;
 }
 
 
@@ -129,27 +159,37 @@ void Texture::setAlpha(Uint8 alpha)
 
 
 // Render texture
-void Texture::render(int16_t x, int16_t y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip)
+void Texture::render(int x, int y, SDL_Rect* clip, double angle, SDL_Point* center, SDL_RendererFlip flip, double zoom)
 {
     // Set Rendering space and render to screen
-    SDL_Rect renderQuad = { x, y, static_cast<int>(mWidth * mWindowScale), static_cast<int>(mHeight * mWindowScale) };
+    SDL_Rect renderQuad = { x, y, static_cast<int>(mWidth * mWindowScale * zoom), static_cast<int>(mHeight * mWindowScale * zoom) };
 
     // Set clip rendering dimensions
     if (clip != nullptr) {
-        renderQuad.w = static_cast<int>(clip->w * mScale * mWindowScale);
-        renderQuad.h = static_cast<int>(clip->h * mScale * mWindowScale);
+        renderQuad.w = static_cast<int>(clip->w * mScale * mWindowScale * zoom);
+        renderQuad.h = static_cast<int>(clip->h * mScale * mWindowScale * zoom);
+    }
+
+    // Draw with the compositor while it is in use
+    SpriteCompositor* compositor = sCompositor;
+    if (compositor) {
+        SDL_Rect source = (clip) ? (*clip) : (SDL_Rect{ 0, 0, mPixelWidth, mPixelHeight });
+        compositor->draw(mPixels.data(), mPixelWidth, source, renderQuad, flip == SDL_FLIP_HORIZONTAL);
+        sDrawCount.fetch_add(1, memory_order_relaxed);
+        return;
     }
 
     // Render to screen
-    lock_guard<mutex> lock(mRenderingMtx);
+    lock_guard<ProfiledMutex> lock(mRenderingMtx);
     SDL_RenderCopyEx(mRenderer, mTexture, clip, &renderQuad, angle, center, flip);
+    sDrawCount.fetch_add(1, memory_order_relaxed);
 }
 
 
 // initialize Texture with a renderer
 bool Texture::initTexture(SDL_Renderer* rend) 
 {
-    lock_guard<mutex> lock(mRenderingMtx);
+    lock_guard<ProfiledMutex> lock(mRenderingMtx);
     mRenderer = rend;
     return mRenderer;
 }
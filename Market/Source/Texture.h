@@ -9,6 +9,8 @@
 #include "PCH.h"
 #include "SDL.h"
 #include <SDL_image.h>
+#include "ProfiledMutex.h"
+class SpriteCompositor;
 
 
 // Texture wrapper class
@@ -36,8 +38,8 @@ public:
     // Set alpha modulation
     void setAlpha(Uint8 alpha);
 
-    // Renders texture at given point
-    void render(int16_t x = 0, int16_t y = 0, SDL_Rect* clip = nullptr, double angle = 0.0, SDL_Point* center = nullptr, SDL_RendererFlip = SDL_FLIP_NONE);
+    // Renders texture at given point, scaled by the camera's zoom
+    void render(int x = 0, int y = 0, SDL_Rect* clip = nullptr, double angle = 0.0, SDL_Point* center = nullptr, SDL_RendererFlip = SDL_FLIP_NONE, double zoom = 1.0);
 
     // Initialize UTexture
     bool initTexture(SDL_Renderer* rend);
@@ -53,9 +55,17 @@ public:
 
     // Set image scale
     void updateScale(double sc);
+
+    // Number of draws every texture has submitted to the renderer
+    static uint64_t getDrawCount() { return sDrawCount.load(memory_order_relaxed); }
+
+    // Send every texture's draws to the compositor instead of the renderer, or back to the renderer with nullptr
+    static void setCompositor(SpriteCompositor* aCompositor) { sCompositor = aCompositor; }
 private:
     // The actual hardware texture, and the games renderer
-    static mutex mRenderingMtx;
+    static ProfiledMutex mRenderingMtx;
+    static atomic<uint64_t> sDrawCount;
+    static SpriteCompositor* sCompositor;
     mutex mTextureMtx;
     SDL_Texture* mTexture;
     SDL_Renderer* mRenderer;
@@ -65,4 +75,9 @@ private:
     uint16_t mHeight;
     double mWindowScale;
     double mScale;
+
+    // Copy of the image's pixels the compositor draws from, ARGB with the color keyed pixels transparent
+    vector<uint32_t> mPixels;
+    uint16_t mPixelWidth;
+    uint16_t mPixelHeight;
 };
\ No newline at end of file
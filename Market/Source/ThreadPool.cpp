@@ -0,0 +1,190 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* ThreadPool keeps a fixed set of worker threads alive for the lifetime of the game, so a frame
+* can fan work out across the cores without creating threads or allocating memory.
+*/
+#include "PCH.h"
+#include "ThreadPool.h"
+#include "AllocationTracker.h"
+
+
+/**
+* Default Constructor, the pool has no workers until init(..) is called.
+*/
+ThreadPool::ThreadPool()
+{
+    mTask          = nullptr;
+    mContext       = nullptr;
+    mTaskCount     = 0;
+    mGeneration    = 0;
+    mNextTask      = 0;
+    mActiveWorkers = 0;
+    mQuit          = false;
+}
+
+
+/**
+* Joins the worker threads.
+*/
+ThreadPool::~ThreadPool()
+{
+    close();
+}
+
+
+/**
+* Start the worker threads.
+* @param aWorkerCount - The number of worker threads, the calling thread also takes part in every job.
+* @return bool True if the workers were started, otherwise false.
+*/
+bool ThreadPool::init(uint32_t aWorkerCount)
+{
+    bool success = true;
+
+    if (!mWorkers.empty())
+    {
+        // cout << "ThreadPool::init(..) was called on a running pool.\n";
+        success = false;
+    }
+    else
+    {
+        mQuit = false;
+        mWorkers.reserve(aWorkerCount);
+        for (uint32_t i = 0; i < aWorkerCount; ++i)
+        {
+            mWorkers.push_back(thread(&ThreadPool::workerLoop, this));
+        }
+    }
+
+    return success;
+}
+
+
+/**
+* Run aTaskCount tasks across the pool and block until every task has finished. Does not allocate.
+* @param aTaskCount - The number of tasks to run.
+* @param aTask      - The function called once for every task index in [0, aTaskCount).
+* @param aContext   - The context passed to every task.
+*/
+void ThreadPool::run(uint32_t aTaskCount, ThreadPoolTask aTask, void* aContext)
+{
+    if (aTaskCount == 0)
+    {
+        return;
+    }
+
+    {
+        unique_lock<mutex> lock(mJobMtx);
+
+        // A worker that woke up late for the previous job may still be claiming indices, wait for it
+        // to leave before the task counter is reset
+        mDoneCV.wait(lock, [this] { return mActiveWorkers == 0; });
+
+        mTask      = aTask;
+        mContext   = aContext;
+        mTaskCount = aTaskCount;
+        mNextTask  = 0;
+        ++mGeneration;
+    }
+    mWorkCV.notify_all();
+
+    // The calling thread works on the job too
+    runTasks(aTask, aContext, aTaskCount);
+
+    // Every task that is still running belongs to an active worker
+    unique_lock<mutex> lock(mJobMtx);
+    mDoneCV.wait(lock, [this] { return mActiveWorkers == 0; });
+}
+
+
+/**
+* Stop and join the worker threads.
+*/
+void ThreadPool::close()
+{
+    {
+        lock_guard<mutex> lock(mJobMtx);
+        mQuit = true;
+    }
+    mWorkCV.notify_all();
+
+    for (thread& worker : mWorkers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    mWorkers.clear();
+}
+
+
+/**
+* Get the number of worker threads, not counting the calling thread.
+* @return uint32_t The number of worker threads.
+*/
+uint32_t ThreadPool::getWorkerCount()
+{
+    return static_cast<uint32_t>(mWorkers.size());
+}
+
+
+/**
+* The loop each worker thread runs, waits for a new job and helps process it.
+*/
+void ThreadPool::workerLoop()
+{
+    // The workers run the frame's jobs, so their allocations count against it
+    AllocationTracker::trackThread();
+    uint64_t seenGeneration = 0;
+
+    while (true)
+    {
+        ThreadPoolTask task;
+        void* context;
+        uint32_t taskCount;
+
+        {
+            unique_lock<mutex> lock(mJobMtx);
+            mWorkCV.wait(lock, [this, seenGeneration] { return mQuit || mGeneration != seenGeneration; });
+
+            if (mQuit)
+            {
+                return;
+            }
+
+            // Copy the job while holding the lock so it can't change underneath this worker
+            seenGeneration = mGeneration;
+            task           = mTask;
+            context        = mContext;
+            taskCount      = mTaskCount;
+            ++mActiveWorkers;
+        }
+
+        runTasks(task, context, taskCount);
+
+        {
+            lock_guard<mutex> lock(mJobMtx);
+            --mActiveWorkers;
+        }
+        mDoneCV.notify_all();
+    }
+}
+
+
+/**
+* Claim and run tasks from the given job until there are none left.
+* @param aTask      - The task function.
+* @param aContext   - The context passed to the task function.
+* @param aTaskCount - The number of tasks in the job.
+*/
+void ThreadPool::runTasks(ThreadPoolTask aTask, void* aContext, uint32_t aTaskCount)
+{
+    for (uint32_t index = mNextTask++; index < aTaskCount; index = mNextTask++)
+    {
+        aTask(aContext, index);
+    }
+}
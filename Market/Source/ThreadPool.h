@@ -0,0 +1,90 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* ThreadPool keeps a fixed set of worker threads alive for the lifetime of the game, so a frame
+* can fan work out across the cores without creating threads or allocating memory.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// A task is a plain function pointer that receives the job's context and the index of the task
+typedef void (*ThreadPoolTask)(void* aContext, uint32_t aIndex);
+
+
+class ThreadPool
+{
+private:
+    // The persistent worker threads
+    vector<thread> mWorkers;
+
+    // Guards the job description and wakes the workers when a new job is posted
+    mutex mJobMtx;
+    condition_variable mWorkCV;
+    condition_variable mDoneCV;
+
+    // The job currently being processed
+    ThreadPoolTask mTask;
+    void* mContext;
+    uint32_t mTaskCount;
+    uint64_t mGeneration;
+
+    // The next task index to hand out, and the number of workers still inside the current job
+    atomic<uint32_t> mNextTask;
+    uint32_t mActiveWorkers;
+
+    // Set when the pool is closing
+    bool mQuit;
+
+    /**
+    * The loop each worker thread runs, waits for a new job and helps process it.
+    */
+    void workerLoop();
+
+    /**
+    * Claim and run tasks from the given job until there are none left.
+    * @param aTask      - The task function.
+    * @param aContext   - The context passed to the task function.
+    * @param aTaskCount - The number of tasks in the job.
+    */
+    void runTasks(ThreadPoolTask aTask, void* aContext, uint32_t aTaskCount);
+
+public:
+    /**
+    * Default Constructor, the pool has no workers until init(..) is called.
+    */
+    ThreadPool();
+
+    /**
+    * Joins the worker threads.
+    */
+    ~ThreadPool();
+
+    /**
+    * Start the worker threads.
+    * @param aWorkerCount - The number of worker threads, the calling thread also takes part in every job.
+    * @return bool True if the workers were started, otherwise false.
+    */
+    bool init(uint32_t aWorkerCount);
+
+    /**
+    * Run aTaskCount tasks across the pool and block until every task has finished. Does not allocate.
+    * @param aTaskCount - The number of tasks to run.
+    * @param aTask      - The function called once for every task index in [0, aTaskCount).
+    * @param aContext   - The context passed to every task.
+    */
+    void run(uint32_t aTaskCount, ThreadPoolTask aTask, void* aContext);
+
+    /**
+    * Stop and join the worker threads.
+    */
+    void close();
+
+    /**
+    * Get the number of worker threads, not counting the calling thread.
+    * @return uint32_t The number of worker threads.
+    */
+    uint32_t getWorkerCount();
+};
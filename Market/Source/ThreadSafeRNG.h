@@ -7,16 +7,20 @@
 */
 #pragma once
 #include "PCH.h"
+#include <sstream>
 
 // Thread Safe RNG
 std::mt19937_64 my_rng; // Defines an engine
 std::uniform_real_distribution<double> my_unif_real_dist(0.0, 1.0); // Define distribution
 std::mutex my_rng_mutex; // a mutex to guard my_rng
+uint64_t my_rng_seed = std::mt19937_64::default_seed; // the seed my_rng was last seeded with
+uint64_t my_rng_draws = 0; // the number of values drawn since my_rng was seeded
 
 
 // This is the function to call if you want a random number in the interval [0,1)
 float Rand_ThreadSafeRNG() {
     std::lock_guard<std::mutex> lock(my_rng_mutex);
+    ++my_rng_draws;
     return static_cast<float>(my_unif_real_dist(my_rng));
     // mutex is released when lock goes out of scope
 }
@@ -29,4 +33,36 @@ float Rand_ThreadSafeRNG() {
 void Seed_ThreadSafeRNG(uint16_t seed) {
     std::lock_guard<std::mutex> lock(my_rng_mutex);
     my_rng.seed(seed);
+    my_rng_seed = seed;
+    my_rng_draws = 0;
+}
+
+
+/* Function to save the random number generator, so it can be restored to
+ * draw the same values from this point on.
+ */
+void Save_ThreadSafeRNG(uint64_t& seed, uint64_t& draws, std::string& state) {
+    std::lock_guard<std::mutex> lock(my_rng_mutex);
+    std::ostringstream stream;
+    stream << my_rng;
+    seed = my_rng_seed;
+    draws = my_rng_draws;
+    state = stream.str();
+}
+
+
+/* Function to restore the random number generator saved with Save_ThreadSafeRNG,
+ * returns false if the state could not be read.
+ */
+bool Restore_ThreadSafeRNG(uint64_t seed, uint64_t draws, const std::string& state) {
+    std::lock_guard<std::mutex> lock(my_rng_mutex);
+    std::istringstream stream(state);
+    std::mt19937_64 rng;
+    if (!(stream >> rng)) {
+        return false;
+    }
+    my_rng = rng;
+    my_rng_seed = seed;
+    my_rng_draws = draws;
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,180 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TimerWheel is a hashed timer wheel. Time is cut into fixed ticks, every timer waits in an intrusive list
+* on the slot of the tick it expires on, and advancing the wheel only visits the slots of the ticks that
+* passed. Scheduling, cancelling and checking a timer are O(1) and a timer that is not due costs nothing.
+*/
+#include "PCH.h"
+#include "TimerWheel.h"
+
+
+/**
+* Constructor
+* @param aName - Name the wheel's lock is reported under.
+*/
+TimerWheel::TimerWheel(const char* aName) : mMtx(aName)
+{
+    for (TimerNode& slot : mSlots)
+    {
+        slot.mNext = slot.mPrev = &slot;
+        slot.mRounds = 0;
+        slot.mExpireTick = 0;
+        slot.mCallback = nullptr;
+        slot.mContext = nullptr;
+    }
+
+    mTick = 0;
+    mRemainder = 0;
+}
+
+
+/**
+* Set up a timer so it can be scheduled.
+* @param aNode     - The timer.
+* @param aCallback - Called when the timer expires.
+* @param aContext  - Passed to aCallback.
+*/
+void TimerWheel::initTimer(TimerNode& aNode, TimerCallback aCallback, void* aContext)
+{
+    aNode.mNext = aNode.mPrev = nullptr;
+    aNode.mRounds = 0;
+    aNode.mExpireTick = 0;
+    aNode.mCallback = aCallback;
+    aNode.mContext = aContext;
+}
+
+
+/**
+* Remove a scheduled timer from its slot, mMtx must be held.
+* @param aNode - The timer.
+*/
+void TimerWheel::unlink(TimerNode& aNode)
+{
+    if (aNode.mNext)
+    {
+        aNode.mPrev->mNext = aNode.mNext;
+        aNode.mNext->mPrev = aNode.mPrev;
+        aNode.mNext = aNode.mPrev = nullptr;
+    }
+}
+
+
+/**
+* Schedule a timer, a timer that is already scheduled is moved.
+* @param aNode  - The timer.
+* @param aDelay - Seconds until the timer expires, rounded up to whole ticks.
+*/
+void TimerWheel::schedule(TimerNode& aNode, const float& aDelay)
+{
+    uint64_t ticks = static_cast<uint64_t>(ceil(max(aDelay, 0.f) / TIMER_WHEEL_TICK));
+    ticks = max<uint64_t>(ticks, 1);
+
+    lock_guard<ProfiledMutex> lk(mMtx);
+    unlink(aNode);
+
+    // The slot is first visited (((ticks - 1) % slots) + 1) ticks from now, then once every turn after
+    aNode.mExpireTick = mTick + ticks;
+    aNode.mRounds = static_cast<uint32_t>((ticks - 1) / TIMER_WHEEL_SLOTS);
+
+    TimerNode& slot = mSlots[aNode.mExpireTick % TIMER_WHEEL_SLOTS];
+    aNode.mNext = &slot;
+    aNode.mPrev = slot.mPrev;
+    slot.mPrev->mNext = &aNode;
+    slot.mPrev = &aNode;
+}
+
+
+/**
+* Cancel a timer, does nothing if the timer is not scheduled.
+* @param aNode - The timer.
+*/
+void TimerWheel::cancel(TimerNode& aNode)
+{
+    lock_guard<ProfiledMutex> lk(mMtx);
+    unlink(aNode);
+}
+
+
+/**
+* Get the time left before a timer expires.
+* @param aNode - The timer.
+* @return float The seconds left, 0 if the timer is not scheduled.
+*/
+float TimerWheel::getRemaining(const TimerNode& aNode)
+{
+    lock_guard<ProfiledMutex> lk(mMtx);
+    if (!aNode.mNext)
+    {
+        return 0;
+    }
+
+    return ((aNode.mExpireTick - mTick) * TIMER_WHEEL_TICK) - mRemainder;
+}
+
+
+/**
+* Advance the wheel and expire every timer that came due. The callbacks are run on the calling thread
+* after the wheel's lock is released.
+* @param aDt - The time to advance by.
+*/
+void TimerWheel::advance(const float& aDt)
+{
+    // The expired timers, collected into a local list so the callbacks can schedule timers again
+    TimerNode expired;
+    expired.mNext = expired.mPrev = &expired;
+
+    {
+        lock_guard<ProfiledMutex> lk(mMtx);
+
+        mRemainder += aDt;
+        while (mRemainder >= TIMER_WHEEL_TICK)
+        {
+            mRemainder -= TIMER_WHEEL_TICK;
+            ++mTick;
+
+            TimerNode& slot = mSlots[mTick % TIMER_WHEEL_SLOTS];
+            TimerNode* node = slot.mNext;
+            while (node != &slot)
+            {
+                TimerNode* next = node->mNext;
+                if (node->mRounds > 0)
+                {
+                    --node->mRounds;
+                }
+                else
+                {
+                    unlink(*node);
+                    node->mNext = &expired;
+                    node->mPrev = expired.mPrev;
+                    expired.mPrev->mNext = node;
+                    expired.mPrev = node;
+                }
+                node = next;
+            }
+        }
+    }
+
+    while (expired.mNext != &expired)
+    {
+        TimerNode* node = expired.mNext;
+        expired.mNext = node->mNext;
+        node->mNext->mPrev = &expired;
+        node->mNext = node->mPrev = nullptr;
+
+        node->mCallback(node->mContext);
+    }
+}
+
+
+/**
+* Get the number of ticks advanced so far.
+* @return uint64_t The current tick.
+*/
+uint64_t TimerWheel::getTick()
+{
+    lock_guard<ProfiledMutex> lk(mMtx);
+    return mTick;
+}
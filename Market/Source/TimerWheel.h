@@ -0,0 +1,111 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TimerWheel is a hashed timer wheel. Time is cut into fixed ticks, every timer waits in an intrusive list
+* on the slot of the tick it expires on, and advancing the wheel only visits the slots of the ticks that
+* passed. Scheduling, cancelling and checking a timer are O(1) and a timer that is not due costs nothing.
+*/
+#pragma once
+#include "PCH.h"
+#include "ProfiledMutex.h"
+
+
+// Length of one wheel tick in seconds, timers are rounded up to whole ticks
+constexpr float TIMER_WHEEL_TICK   = 1.f / 120.f;
+
+// Number of slots in the wheel, timers further away than one turn wait extra turns
+constexpr uint32_t TIMER_WHEEL_SLOTS = 256;
+
+
+// Called when a timer expires, with the context the timer was given
+typedef void (*TimerCallback)(void*);
+
+
+// A timer, embedded in the object it times so scheduling never allocates
+struct TimerNode
+{
+    // Neighbours in the slot's list, both are nullptr while the timer is not scheduled
+    TimerNode* mNext;
+    TimerNode* mPrev;
+
+    // Full turns of the wheel left before the timer expires, and the tick it expires on
+    uint32_t mRounds;
+    uint64_t mExpireTick;
+
+    TimerCallback mCallback;
+    void* mContext;
+};
+
+
+class TimerWheel
+{
+private:
+    // Each slot's list head, the heads are circular so linking and unlinking need no branches
+    TimerNode mSlots[TIMER_WHEEL_SLOTS];
+
+    // Ticks advanced so far, and the time advanced that has not added up to a whole tick yet
+    uint64_t mTick;
+    float mRemainder;
+
+    // Guards the slots, timers can be scheduled from any thread
+    ProfiledMutex mMtx;
+
+    /**
+    * Remove a scheduled timer from its slot, mMtx must be held.
+    * @param aNode - The timer.
+    */
+    void unlink(TimerNode& aNode);
+
+public:
+    /**
+    * Constructor
+    * @param aName - Name the wheel's lock is reported under.
+    */
+    explicit TimerWheel(const char* aName);
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+    * Set up a timer so it can be scheduled.
+    * @param aNode     - The timer.
+    * @param aCallback - Called when the timer expires.
+    * @param aContext  - Passed to aCallback.
+    */
+    static void initTimer(TimerNode& aNode, TimerCallback aCallback, void* aContext);
+
+    /**
+    * Schedule a timer, a timer that is already scheduled is moved.
+    * @param aNode  - The timer.
+    * @param aDelay - Seconds until the timer expires, rounded up to whole ticks.
+    */
+    void schedule(TimerNode& aNode, const float& aDelay);
+
+    /**
+    * Cancel a timer, does nothing if the timer is not scheduled.
+    * @param aNode - The timer.
+    */
+    void cancel(TimerNode& aNode);
+
+    /**
+    * Get the time left before a timer expires.
+    * @param aNode - The timer.
+    * @return float The seconds left, 0 if the timer is not scheduled.
+    */
+    float getRemaining(const TimerNode& aNode);
+
+    /**
+    * Advance the wheel and expire every timer that came due. The callbacks are run on the calling thread
+    * after the wheel's lock is released.
+    * @param aDt - The time to advance by.
+    */
+    void advance(const float& aDt);
+
+    /**
+    * Get the number of ticks advanced so far.
+    * @return uint64_t The current tick.
+    */
+    uint64_t getTick();
+};
@@ -0,0 +1,137 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Trace records scoped markers into a ring buffer owned by each thread, and writes the captured markers
+* as Chrome trace JSON that can be opened in chrome://tracing or Perfetto.
+*/
+#include "PCH.h"
+#include "Trace.h"
+
+
+atomic<bool> Trace::sEnabled(false);
+TraceBuffer Trace::sBuffers[MAX_TRACE_THREADS];
+atomic<uint32_t> Trace::sThreadCount(0);
+
+// The time every marker is measured from
+static const chrono::steady_clock::time_point sTraceEpoch = chrono::steady_clock::now();
+
+
+/**
+* Get the calling thread's ring buffer, assigning one on the thread's first marker.
+* @return TraceBuffer* The thread's buffer, or nullptr if every buffer is taken.
+*/
+TraceBuffer* Trace::getThreadBuffer()
+{
+    static thread_local uint32_t threadIndex = sThreadCount++;
+
+    if (threadIndex >= MAX_TRACE_THREADS)
+    {
+        return nullptr;
+    }
+    return &sBuffers[threadIndex];
+}
+
+
+/**
+* Get the current time of the trace clock.
+* @return uint64_t Nanoseconds since the trace epoch.
+*/
+uint64_t Trace::now()
+{
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - sTraceEpoch).count());
+}
+
+
+/**
+* Whether markers are currently being recorded.
+* @return bool True if tracing is enabled, otherwise false.
+*/
+bool Trace::isEnabled()
+{
+    return sEnabled.load(memory_order_relaxed);
+}
+
+
+/**
+* Start recording markers, every thread's buffer is cleared.
+*/
+void Trace::start()
+{
+    for (TraceBuffer& buffer : sBuffers)
+    {
+        buffer.mWriteCount = 0;
+    }
+    sEnabled = true;
+}
+
+
+/**
+* Stop recording markers and write every captured marker to a Chrome trace file. Must be called
+* while no other thread is recording, i.e. between frames.
+* @param aPath - The path of the JSON file to write.
+* @return bool True if the file was written, otherwise false.
+*/
+bool Trace::stop(const string& aPath)
+{
+    sEnabled = false;
+
+    ofstream file(aPath);
+    if (!file)
+    {
+        // cout << "Unable to open the trace file " << aPath << "\n";
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << fixed << setprecision(3);
+
+    bool firstEvent = true;
+    uint32_t threadCount = min(sThreadCount.load(), MAX_TRACE_THREADS);
+    for (uint32_t tid = 0; tid < threadCount; ++tid)
+    {
+        const TraceBuffer& buffer = sBuffers[tid];
+        if (buffer.mWriteCount == 0)
+        {
+            continue;
+        }
+
+        // Name the thread so the viewer lists them in a readable order
+        file << (firstEvent ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+             << ",\"args\":{\"name\":\"Thread " << tid << "\"}}";
+        firstEvent = false;
+
+        // Only the newest TRACE_BUFFER_EVENTS markers survive in the ring
+        uint64_t first = (buffer.mWriteCount > TRACE_BUFFER_EVENTS) ? (buffer.mWriteCount - TRACE_BUFFER_EVENTS) : (0);
+        for (uint64_t i = first; i < buffer.mWriteCount; ++i)
+        {
+            const TraceEvent& event = buffer.mEvents[i % TRACE_BUFFER_EVENTS];
+            file << ",\n{\"name\":\"" << event.mName << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                 << ",\"ts\":" << (event.mStart / 1000.0) << ",\"dur\":" << (event.mDuration / 1000.0) << "}";
+        }
+    }
+
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+
+/**
+* Record a completed marker in the calling thread's buffer.
+* @param aName  - The marker's name, must be a string literal or otherwise outlive the trace.
+* @param aStart - The time the marker started.
+* @param aEnd   - The time the marker ended.
+*/
+void Trace::record(const char* aName, const uint64_t& aStart, const uint64_t& aEnd)
+{
+    TraceBuffer* buffer = getThreadBuffer();
+    if (buffer)
+    {
+        TraceEvent& event = buffer->mEvents[buffer->mWriteCount % TRACE_BUFFER_EVENTS];
+        event.mName     = aName;
+        event.mStart    = aStart;
+        event.mDuration = aEnd - aStart;
+        ++buffer->mWriteCount;
+    }
+}
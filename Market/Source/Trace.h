@@ -0,0 +1,123 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* Trace records scoped markers into a ring buffer owned by each thread, and writes the captured markers
+* as Chrome trace JSON that can be opened in chrome://tracing or Perfetto.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// Number of markers each thread's ring buffer holds before overwriting its oldest marker
+constexpr uint32_t TRACE_BUFFER_EVENTS = 8192;
+
+// Number of threads that can record markers, threads past this limit are ignored
+constexpr uint32_t MAX_TRACE_THREADS   = 32;
+
+// The file a capture is written to when tracing stops
+constexpr const char* TRACE_FILE_PATH  = "market_trace.json";
+
+
+// A completed marker, the times are nanoseconds since the trace epoch
+struct TraceEvent
+{
+    const char* mName;
+    uint64_t mStart;
+    uint64_t mDuration;
+};
+
+
+// The ring buffer a single thread writes its markers into
+struct TraceBuffer
+{
+    TraceEvent mEvents[TRACE_BUFFER_EVENTS];
+    uint64_t mWriteCount;
+};
+
+
+class Trace
+{
+private:
+    // Whether markers are currently being recorded
+    static atomic<bool> sEnabled;
+
+    // The per-thread ring buffers, and the number handed out so far
+    static TraceBuffer sBuffers[MAX_TRACE_THREADS];
+    static atomic<uint32_t> sThreadCount;
+
+    /**
+    * Get the calling thread's ring buffer, assigning one on the thread's first marker.
+    * @return TraceBuffer* The thread's buffer, or nullptr if every buffer is taken.
+    */
+    static TraceBuffer* getThreadBuffer();
+
+public:
+    /**
+    * Get the current time of the trace clock.
+    * @return uint64_t Nanoseconds since the trace epoch.
+    */
+    static uint64_t now();
+
+    /**
+    * Whether markers are currently being recorded.
+    * @return bool True if tracing is enabled, otherwise false.
+    */
+    static bool isEnabled();
+
+    /**
+    * Start recording markers, every thread's buffer is cleared.
+    */
+    static void start();
+
+    /**
+    * Stop recording markers and write every captured marker to a Chrome trace file. Must be called
+    * while no other thread is recording, i.e. between frames.
+    * @param aPath - The path of the JSON file to write.
+    * @return bool True if the file was written, otherwise false.
+    */
+    static bool stop(const string& aPath);
+
+    /**
+    * Record a completed marker in the calling thread's buffer.
+    * @param aName  - The marker's name, must be a string literal or otherwise outlive the trace.
+    * @param aStart - The time the marker started.
+    * @param aEnd   - The time the marker ended.
+    */
+    static void record(const char* aName, const uint64_t& aStart, const uint64_t& aEnd);
+};
+
+
+/**
+* Records a marker covering its own lifetime, does nothing while tracing is disabled.
+*/
+class TraceScope
+{
+private:
+    const char* mName;
+    uint64_t mStart;
+    bool mActive;
+
+public:
+    explicit TraceScope(const char* aName)
+    {
+        mName   = aName;
+        mActive = Trace::isEnabled();
+        mStart  = mActive ? Trace::now() : 0;
+    }
+
+    ~TraceScope()
+    {
+        if (mActive)
+        {
+            Trace::record(mName, mStart, Trace::now());
+        }
+    }
+};
+
+
+// Place a marker named NAME around the rest of the enclosing scope
+#define TRACE_CONCAT_INNER(A, B) A##B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT_INNER(A, B)
+#define TRACE_SCOPE(NAME) TraceScope TRACE_CONCAT(traceScope, __LINE__)(NAME)
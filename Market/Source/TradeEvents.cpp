@@ -0,0 +1,222 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TradeEvents publishes every trade into a bounded lock free multi producer single consumer ring. A
+* consumer thread drains the ring and hands the events to the registered consumers, so recording a trade
+* never takes a lock or allocates on the simulation threads. When the ring is full the event is dropped
+* and counted.
+*/
+#include "PCH.h"
+#include "TradeEvents.h"
+
+
+static_assert((TRADE_EVENT_CAPACITY & (TRADE_EVENT_CAPACITY - 1)) == 0, "TRADE_EVENT_CAPACITY must be a power of two");
+
+
+TradeEvents::Cell TradeEvents::sCells[TRADE_EVENT_CAPACITY];
+atomic<uint32_t> TradeEvents::sEnqueuePos(0);
+uint32_t TradeEvents::sDequeuePos = 0;
+atomic<uint64_t> TradeEvents::sDropped(0);
+atomic<uint32_t> TradeEvents::sTick(0);
+vector<TradeEventConsumer*> TradeEvents::sConsumers;
+thread TradeEvents::sConsumerThread;
+atomic<bool> TradeEvents::sRunning(false);
+
+
+/**
+* Register a consumer, only while the stream is stopped.
+* @param aConsumer - The consumer, must outlive the stream.
+*/
+void TradeEvents::addConsumer(TradeEventConsumer* aConsumer)
+{
+    if (!sRunning)
+    {
+        sConsumers.push_back(aConsumer);
+    }
+}
+
+
+/**
+* Start the consumer thread.
+*/
+void TradeEvents::start()
+{
+    if (sRunning)
+    {
+        return;
+    }
+
+    // Every slot starts out free for the producer whose position lands on it
+    for (uint32_t i = 0; i < TRADE_EVENT_CAPACITY; ++i)
+    {
+        sCells[i].mSequence.store(i, memory_order_relaxed);
+    }
+    sEnqueuePos.store(0, memory_order_relaxed);
+    sDequeuePos = 0;
+
+    sRunning = true;
+    sConsumerThread = thread(&TradeEvents::consumerLoop);
+}
+
+
+/**
+* Stop the consumer thread once every published event is consumed, then flush and forget the consumers.
+*/
+void TradeEvents::stop()
+{
+    if (!sRunning)
+    {
+        return;
+    }
+
+    sRunning = false;
+    if (sConsumerThread.joinable())
+    {
+        sConsumerThread.join();
+    }
+
+    // Events published while the thread was stopping
+    drain();
+    for (TradeEventConsumer* consumer : sConsumers)
+    {
+        consumer->flush();
+    }
+
+    // The consumers belong to the game that added them, the next game adds its own
+    sConsumers.clear();
+}
+
+
+/**
+* Set the tick stamped on the events published from now on.
+* @param aTick - The current tick.
+*/
+void TradeEvents::setTick(const uint32_t& aTick)
+{
+    sTick.store(aTick, memory_order_relaxed);
+}
+
+
+/**
+* Publish a trade, lock free and safe to call from any thread.
+* @param aRugID    - The rug's unique ID.
+* @param aNPCID    - The NPC's unique ID.
+* @param aGiven    - The good the NPC gave to the rug.
+* @param aReceived - The good the NPC received.
+* @param aLocation - Where the NPC traded.
+* @return bool True if the event was published, false if the ring was full and it was dropped.
+*/
+bool TradeEvents::publish(const uint32_t& aRugID, const uint32_t& aNPCID, const ETradeState& aGiven, const ETradeState& aReceived, const Vector& aLocation)
+{
+    if (!sRunning.load(memory_order_relaxed))
+    {
+        return false;
+    }
+
+    // Claim the next position, a slot is free when its sequence equals the position
+    uint32_t pos = sEnqueuePos.load(memory_order_relaxed);
+    Cell* cell;
+    while (true)
+    {
+        cell = &sCells[pos & (TRADE_EVENT_CAPACITY - 1)];
+        int32_t diff = static_cast<int32_t>(cell->mSequence.load(memory_order_acquire) - pos);
+
+        if (diff == 0)
+        {
+            if (sEnqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The consumer has not freed the slot from the previous lap, the ring is full
+            sDropped.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            pos = sEnqueuePos.load(memory_order_relaxed);
+        }
+    }
+
+    TradeEvent& event = cell->mEvent;
+    event.mTick     = sTick.load(memory_order_relaxed);
+    event.mRugID    = aRugID;
+    event.mNPCID    = aNPCID;
+    event.mX        = static_cast<int32_t>(aLocation.x);
+    event.mY        = static_cast<int32_t>(aLocation.y);
+    event.mGiven    = static_cast<uint8_t>(aGiven);
+    event.mReceived = static_cast<uint8_t>(aReceived);
+    event.mPadding[0] = event.mPadding[1] = 0;
+
+    // Hand the slot to the consumer
+    cell->mSequence.store(pos + 1, memory_order_release);
+    return true;
+}
+
+
+/**
+* Get the number of events dropped because the ring was full.
+* @return uint64_t The dropped event count.
+*/
+uint64_t TradeEvents::getDropped()
+{
+    return sDropped.load(memory_order_relaxed);
+}
+
+
+/**
+* Hand every event in the ring to the consumers.
+* @return uint32_t The number of events drained.
+*/
+uint32_t TradeEvents::drain()
+{
+    uint32_t drained = 0;
+
+    while (true)
+    {
+        Cell& cell = sCells[sDequeuePos & (TRADE_EVENT_CAPACITY - 1)];
+        if (cell.mSequence.load(memory_order_acquire) != sDequeuePos + 1)
+        {
+            break;
+        }
+
+        for (TradeEventConsumer* consumer : sConsumers)
+        {
+            consumer->consume(cell.mEvent);
+        }
+
+        // Free the slot for the producer one lap ahead
+        cell.mSequence.store(sDequeuePos + TRADE_EVENT_CAPACITY, memory_order_release);
+        ++sDequeuePos;
+        ++drained;
+    }
+
+    if (drained)
+    {
+        for (TradeEventConsumer* consumer : sConsumers)
+        {
+            consumer->flush();
+        }
+    }
+
+    return drained;
+}
+
+
+/**
+* The consumer thread, drains the ring until the stream stops.
+*/
+void TradeEvents::consumerLoop()
+{
+    while (sRunning)
+    {
+        if (!drain())
+        {
+            this_thread::sleep_for(chrono::milliseconds(TRADE_EVENT_IDLE_MS));
+        }
+    }
+}
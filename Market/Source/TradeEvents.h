@@ -0,0 +1,137 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TradeEvents publishes every trade into a bounded lock free multi producer single consumer ring. A
+* consumer thread drains the ring and hands the events to the registered consumers, so recording a trade
+* never takes a lock or allocates on the simulation threads. When the ring is full the event is dropped
+* and counted.
+*/
+#pragma once
+#include "PCH.h"
+
+
+// Number of events the ring holds, must be a power of two
+constexpr uint32_t TRADE_EVENT_CAPACITY = 4096;
+
+// How long the consumer thread sleeps when the ring is empty, in milliseconds
+constexpr uint32_t TRADE_EVENT_IDLE_MS  = 2;
+
+
+// A single trade, the goods are ETradeState values
+struct TradeEvent
+{
+    // The tick the trade happened on
+    uint32_t mTick;
+
+    // The unique IDs of the rug and the NPC that traded
+    uint32_t mRugID;
+    uint32_t mNPCID;
+
+    // Where the NPC traded, in world coordinates which can be past the window's
+    int32_t mX;
+    int32_t mY;
+
+    // The good the NPC gave to the rug, and the good it received
+    uint8_t mGiven;
+    uint8_t mReceived;
+    uint8_t mPadding[2];
+};
+
+
+/**
+* Receives the trade events on the consumer thread, in the order they were published.
+*/
+class TradeEventConsumer
+{
+public:
+    virtual ~TradeEventConsumer() {}
+
+    /**
+    * Handle one trade event.
+    * @param aEvent - The event.
+    */
+    virtual void consume(const TradeEvent& aEvent) = 0;
+
+    /**
+    * Called after every drained batch of events, and once more when the stream stops.
+    */
+    virtual void flush() {}
+};
+
+
+class TradeEvents
+{
+private:
+    // One slot of the ring, the sequence tells producers and the consumer whose turn the slot is
+    struct Cell
+    {
+        atomic<uint32_t> mSequence;
+        TradeEvent mEvent;
+    };
+
+    static Cell sCells[TRADE_EVENT_CAPACITY];
+    static atomic<uint32_t> sEnqueuePos;
+    static uint32_t sDequeuePos;
+
+    // Events dropped because the ring was full, and the tick stamped on published events
+    static atomic<uint64_t> sDropped;
+    static atomic<uint32_t> sTick;
+
+    // The consumers, registered before the stream starts, and the thread that feeds them
+    static vector<TradeEventConsumer*> sConsumers;
+    static thread sConsumerThread;
+    static atomic<bool> sRunning;
+
+    /**
+    * Hand every event in the ring to the consumers.
+    * @return uint32_t The number of events drained.
+    */
+    static uint32_t drain();
+
+    /**
+    * The consumer thread, drains the ring until the stream stops.
+    */
+    static void consumerLoop();
+
+public:
+    /**
+    * Register a consumer, only while the stream is stopped.
+    * @param aConsumer - The consumer, must outlive the stream.
+    */
+    static void addConsumer(TradeEventConsumer* aConsumer);
+
+    /**
+    * Start the consumer thread.
+    */
+    static void start();
+
+    /**
+    * Stop the consumer thread once every published event is consumed, then flush and forget the consumers.
+    */
+    static void stop();
+
+    /**
+    * Set the tick stamped on the events published from now on.
+    * @param aTick - The current tick.
+    */
+    static void setTick(const uint32_t& aTick);
+
+    /**
+    * Publish a trade, lock free and safe to call from any thread.
+    * @param aRugID    - The rug's unique ID.
+    * @param aNPCID    - The NPC's unique ID.
+    * @param aGiven    - The good the NPC gave to the rug.
+    * @param aReceived - The good the NPC received.
+    * @param aLocation - Where the NPC traded.
+    * @return bool True if the event was published, false if the ring was full and it was dropped.
+    */
+    static bool publish(const uint32_t& aRugID, const uint32_t& aNPCID, const ETradeState& aGiven, const ETradeState& aReceived, const Vector& aLocation);
+
+    /**
+    * Get the number of events dropped because the ring was full.
+    * @return uint64_t The dropped event count.
+    */
+    static uint64_t getDropped();
+};
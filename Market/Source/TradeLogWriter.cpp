@@ -0,0 +1,85 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TradeLogWriter is a trade event consumer that appends every trade to a binary log. The log starts with
+* the magic "MKTE", the format version and the size of one event, each a little endian uint32_t, followed by
+* the raw TradeEvent records.
+*/
+#include "PCH.h"
+#include "TradeLogWriter.h"
+
+
+/**
+* Default Constructor, nothing is written until the log is opened.
+*/
+TradeLogWriter::TradeLogWriter()
+{
+    mBufferCount = 0;
+}
+
+
+/**
+* Create the log, replacing an existing one, and write its header.
+* @param aPath - Where to write the log.
+* @return bool True if the log was created, otherwise false.
+*/
+bool TradeLogWriter::open(const char* aPath)
+{
+    bool success = true;
+
+    mFile.open(aPath, ios::binary | ios::trunc);
+    if (!mFile)
+    {
+        // cout << "Failed to create the trade log!\n";
+        success = false;
+    }
+    else
+    {
+        const uint32_t header[3] = { 0x45544B4D, TRADE_LOG_VERSION, static_cast<uint32_t>(sizeof(TradeEvent)) };
+        mFile.write(reinterpret_cast<const char*>(header), sizeof(header));
+    }
+
+    return success;
+}
+
+
+/**
+* Write out the buffered events and close the log.
+*/
+void TradeLogWriter::close()
+{
+    flush();
+    if (mFile.is_open())
+    {
+        mFile.close();
+    }
+}
+
+
+/**
+* Buffer one trade, the buffer is written when it fills.
+* @param aEvent - The trade.
+*/
+void TradeLogWriter::consume(const TradeEvent& aEvent)
+{
+    mBuffer[mBufferCount++] = aEvent;
+    if (mBufferCount == TRADE_LOG_BUFFER_EVENTS)
+    {
+        flush();
+    }
+}
+
+
+/**
+* Write out the buffered events.
+*/
+void TradeLogWriter::flush()
+{
+    if (mBufferCount && mFile.is_open())
+    {
+        mFile.write(reinterpret_cast<const char*>(mBuffer), static_cast<streamsize>(sizeof(TradeEvent)) * mBufferCount);
+    }
+    mBufferCount = 0;
+}
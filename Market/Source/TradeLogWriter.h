@@ -0,0 +1,60 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TradeLogWriter is a trade event consumer that appends every trade to a binary log. The log starts with
+* the magic "MKTE", the format version and the size of one event, each a little endian uint32_t, followed by
+* the raw TradeEvent records.
+*/
+#pragma once
+#include "PCH.h"
+#include "TradeEvents.h"
+
+
+// Where the trade log is written, and its format version
+constexpr const char* TRADE_LOG_PATH = "market_trades.bin";
+constexpr uint32_t TRADE_LOG_VERSION = 2;
+
+// Number of events buffered before they are written
+constexpr uint32_t TRADE_LOG_BUFFER_EVENTS = 256;
+
+
+class TradeLogWriter : public TradeEventConsumer
+{
+private:
+    ofstream mFile;
+
+    // Events waiting to be written
+    TradeEvent mBuffer[TRADE_LOG_BUFFER_EVENTS];
+    uint32_t mBufferCount;
+
+public:
+    /**
+    * Default Constructor, nothing is written until the log is opened.
+    */
+    TradeLogWriter();
+
+    /**
+    * Create the log, replacing an existing one, and write its header.
+    * @param aPath - Where to write the log.
+    * @return bool True if the log was created, otherwise false.
+    */
+    bool open(const char* aPath);
+
+    /**
+    * Write out the buffered events and close the log.
+    */
+    void close();
+
+    /**
+    * Buffer one trade, the buffer is written when it fills.
+    * @param aEvent - The trade.
+    */
+    void consume(const TradeEvent& aEvent) override;
+
+    /**
+    * Write out the buffered events.
+    */
+    void flush() override;
+};
@@ -0,0 +1,221 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TradeScheduler is an event driven trade engine. Between two changes of its motion generation an NPC
+* walks in a straight line at a constant speed, so the moment it walks into each rug's trade radius is
+* solved for once and queued. Every tick the contacts that came due are traded in time order, and the
+* contacts of an NPC that changed its motion are dropped and predicted again.
+*/
+#include "PCH.h"
+#include "TradeScheduler.h"
+#include "StaticRugIndex.h"
+#include "NPC.h"
+#include "Rug.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include "FrameStats.h"
+#include "TradeEvents.h"
+
+
+// Most rugs one straight walk is predicted against
+constexpr uint32_t MAX_PREDICTED_RUGS = 64;
+
+// Motion generation of an NPC whose contacts have not been predicted
+constexpr uint32_t UNPREDICTED_GENERATION = UINT32_MAX;
+
+
+/**
+* Default Constructor, the scheduler starts disabled.
+*/
+TradeScheduler::TradeScheduler()
+{
+    mNPCs = nullptr;
+    mRugs = nullptr;
+    mRugIndex = nullptr;
+    mEnabled = false;
+    mTime = 0;
+}
+
+
+/**
+* Start making the trades, the NPCs' contacts are predicted on the next update.
+* @param aNPCs     - The NPCs.
+* @param aRugs     - The rugs, in the order the rug index was built from.
+* @param aRugIndex - The index of the rugs.
+*/
+void TradeScheduler::start(const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, const StaticRugIndex& aRugIndex)
+{
+    stop();
+
+    mNPCs = &aNPCs;
+    mRugs = &aRugs;
+    mRugIndex = &aRugIndex;
+    mTime = 0;
+
+    mGenerations.assign(aNPCs.size(), UNPREDICTED_GENERATION);
+    mRugReadyTimes.resize(aRugs.size());
+    for (size_t i = 0; i < aRugs.size(); ++i)
+    {
+        mRugReadyTimes[i] = aRugs[i]->getTimeToTrade();
+    }
+
+    mEnabled = true;
+}
+
+
+/**
+* Stop making trades and drop every queued contact.
+*/
+void TradeScheduler::stop()
+{
+    mEnabled = false;
+    mContacts = priority_queue<TradeContact, vector<TradeContact>, greater<TradeContact>>();
+}
+
+
+/**
+* Whether the scheduler is making the trades.
+* @return bool True if enabled, otherwise false.
+*/
+bool TradeScheduler::isEnabled() const
+{
+    return mEnabled;
+}
+
+
+/**
+* Queue every rug the NPC will walk into before its motion can next change.
+* @param aNPC - The NPC's index.
+*/
+void TradeScheduler::predict(const uint32_t& aNPC)
+{
+    NPC* npc = (*mNPCs)[aNPC];
+    mGenerations[aNPC] = npc->getMotionGeneration();
+
+    // An NPC standing at its target has nothing to walk into until it picks a new one
+    if (!npc->isWalking() || npc->getSpeed() <= 0)
+    {
+        return;
+    }
+
+    Vector start     = npc->getLocation();
+    Vector direction = npc->getDirection();
+    Vector target    = npc->getTargetLocation();
+    float speed      = npc->getSpeed();
+
+    // The walk ends when the NPC reaches its target, or when its direction is reset, which is only noticed at
+    // the end of the tick it passes in
+    float targetDistance = static_cast<float>(sqrt(((target.x - start.x) * (target.x - start.x)) + ((target.y - start.y) * (target.y - start.y))));
+    float duration = min((targetDistance - NPC_TARGET_LOCATION_RANGE) / speed, NPC_RESET_DIRECTION_TIME + MAX_FRAME_TIME);
+    if (duration <= 0)
+    {
+        return;
+    }
+
+    Vector end = { start.x + (direction.x * speed * duration), start.y + (direction.y * speed * duration), 0 };
+    uint32_t rugs[MAX_PREDICTED_RUGS];
+    uint32_t rugCount = mRugIndex->querySegment(start, end, rugs, MAX_PREDICTED_RUGS);
+
+    for (uint32_t i = 0; i < rugCount; ++i)
+    {
+        // Solve |start + (velocity * t) - center| = TRADE_RADIUS for the times the NPC enters and leaves
+        Vector center = (*mRugs)[rugs[i]]->getLocation();
+        float offsetX = start.x - center.x;
+        float offsetY = start.y - center.y;
+        float b = (offsetX * direction.x) + (offsetY * direction.y);
+        float c = (offsetX * offsetX) + (offsetY * offsetY) - (TRADE_RADIUS * TRADE_RADIUS);
+        float discriminant = (b * b) - c;
+        if (discriminant < 0)
+        {
+            continue;
+        }
+
+        float root = static_cast<float>(sqrt(discriminant));
+        float enter = (-b - root) / speed;
+        float leave = (-b + root) / speed;
+
+        // An NPC already standing on the rug when its motion changed does not walk into it
+        if (enter < 0 || enter > duration)
+        {
+            continue;
+        }
+
+        mContacts.push({ mTime + enter, mTime + leave, aNPC, rugs[i], mGenerations[aNPC] });
+    }
+}
+
+
+/**
+* Trade every contact that came due this tick, then predict the contacts of the NPCs whose motion changed.
+* Must be called on one thread once every NPC has moved.
+* @param aDt - The time simulated this tick.
+*/
+void TradeScheduler::update(const float& aDt)
+{
+    if (!mEnabled)
+    {
+        return;
+    }
+
+    TRACE_SCOPE("TradeScheduler::update");
+    PERF_PHASE(EPerfPhase::TRADE);
+    FrameStatsScope frameStatsScope(EFramePhase::TRADE);
+
+    mTime += aDt;
+    uint32_t trades = 0;
+
+    while (!mContacts.empty() && mContacts.top().mTime <= mTime)
+    {
+        TradeContact contact = mContacts.top();
+        mContacts.pop();
+
+        // The NPC turned or stopped before it got here
+        if (contact.mGeneration != mGenerations[contact.mNPC])
+        {
+            continue;
+        }
+
+        NPC* npc = (*mNPCs)[contact.mNPC];
+        Rug* rug = (*mRugs)[contact.mRug];
+        if (npc->getTradeState() == rug->getTradeState())
+        {
+            continue;
+        }
+
+        // A rug still cooling down trades when it is ready, if the NPC has not walked off by then
+        double readyTime = mRugReadyTimes[contact.mRug];
+        if (readyTime > contact.mTime)
+        {
+            if (readyTime < contact.mExitTime)
+            {
+                contact.mTime = readyTime;
+                mContacts.push(contact);
+            }
+            continue;
+        }
+
+        // Have the entity's trade
+        ETradeState tempTradeState = rug->getTradeState();
+        TradeEvents::publish(rug->getUniqueID(), npc->getUniqueID(), npc->getTradeState(), tempTradeState, npc->getLocation());
+        rug->setTradeState(npc->getTradeState());
+        npc->setTradeState(tempTradeState);
+        mRugReadyTimes[contact.mRug] = contact.mTime + RUG_TRADE_TIME;
+        ++trades;
+    }
+
+    // Predict again for every NPC that turned, stopped, or started walking this tick
+    for (uint32_t i = 0; i < mNPCs->size(); ++i)
+    {
+        if ((*mNPCs)[i]->getMotionGeneration() != mGenerations[i])
+        {
+            predict(i);
+        }
+    }
+
+    if (trades)
+    {
+        FrameStats::addTrades(trades);
+    }
+}
@@ -0,0 +1,104 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TradeScheduler is an event driven trade engine. Between two changes of its motion generation an NPC
+* walks in a straight line at a constant speed, so the moment it walks into each rug's trade radius is
+* solved for once and queued. Every tick the contacts that came due are traded in time order, and the
+* contacts of an NPC that changed its motion are dropped and predicted again.
+*/
+#pragma once
+#include "PCH.h"
+class NPC;
+class Rug;
+class StaticRugIndex;
+
+
+// A predicted moment an NPC walks into a rug's trade radius
+struct TradeContact
+{
+    // When the NPC enters, and leaves, the trade radius
+    double mTime;
+    double mExitTime;
+
+    // The NPC's index, the rug's index, and the NPC's motion generation the contact was predicted for
+    uint32_t mNPC;
+    uint32_t mRug;
+    uint32_t mGeneration;
+
+    // Orders the queue by time, then by NPC and rug so simultaneous contacts always trade in the same order
+    bool operator>(const TradeContact& aOther) const
+    {
+        if (mTime != aOther.mTime)
+        {
+            return mTime > aOther.mTime;
+        }
+        if (mNPC != aOther.mNPC)
+        {
+            return mNPC > aOther.mNPC;
+        }
+        return mRug > aOther.mRug;
+    }
+};
+
+
+class TradeScheduler
+{
+private:
+    // The NPCs and rugs, the rugs are in the order of the rug index
+    const vector<NPC*>* mNPCs;
+    const vector<Rug*>* mRugs;
+    const StaticRugIndex* mRugIndex;
+
+    // Whether the scheduler is making the trades, and the time simulated since it started
+    bool mEnabled;
+    double mTime;
+
+    // The predicted contacts, the earliest first
+    priority_queue<TradeContact, vector<TradeContact>, greater<TradeContact>> mContacts;
+
+    // The motion generation of each NPC the queued contacts were predicted for
+    vector<uint32_t> mGenerations;
+
+    // The time each rug can trade again
+    vector<double> mRugReadyTimes;
+
+    /**
+    * Queue every rug the NPC will walk into before its motion can next change.
+    * @param aNPC - The NPC's index.
+    */
+    void predict(const uint32_t& aNPC);
+
+public:
+    /**
+    * Default Constructor, the scheduler starts disabled.
+    */
+    TradeScheduler();
+
+    /**
+    * Start making the trades, the NPCs' contacts are predicted on the next update.
+    * @param aNPCs     - The NPCs.
+    * @param aRugs     - The rugs, in the order the rug index was built from.
+    * @param aRugIndex - The index of the rugs.
+    */
+    void start(const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, const StaticRugIndex& aRugIndex);
+
+    /**
+    * Stop making trades and drop every queued contact.
+    */
+    void stop();
+
+    /**
+    * Whether the scheduler is making the trades.
+    * @return bool True if enabled, otherwise false.
+    */
+    bool isEnabled() const;
+
+    /**
+    * Trade every contact that came due this tick, then predict the contacts of the NPCs whose motion changed.
+    * Must be called on one thread once every NPC has moved.
+    * @param aDt - The time simulated this tick.
+    */
+    void update(const float& aDt);
+};
@@ -0,0 +1,77 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TradeStatistics is a trade event consumer that aggregates the trades, how often each good was traded for
+* each other good and which rugs trade the most, and logs a summary when the trade event stream stops.
+*/
+#include "PCH.h"
+#include "TradeStatistics.h"
+#include <SDL.h>
+
+
+// The goods' names in ETradeState order
+static const char* const GOOD_NAMES[TRADE_GOOD_COUNT] = { "chicken", "lamb", "bread & wine" };
+
+
+/**
+* Default Constructor
+*/
+TradeStatistics::TradeStatistics()
+{
+    memset(mTrades, 0, sizeof(mTrades));
+    mTotalTrades = 0;
+    mLogged = false;
+}
+
+
+/**
+* Count one trade.
+* @param aEvent - The trade.
+*/
+void TradeStatistics::consume(const TradeEvent& aEvent)
+{
+    if (aEvent.mGiven < TRADE_GOOD_COUNT && aEvent.mReceived < TRADE_GOOD_COUNT)
+    {
+        ++mTrades[aEvent.mGiven][aEvent.mReceived];
+    }
+    ++mTotalTrades;
+    ++mRugTrades[aEvent.mRugID];
+    mLogged = false;
+}
+
+
+/**
+* Log the summary once the stream stops.
+*/
+void TradeStatistics::logSummary()
+{
+    if (mLogged)
+    {
+        return;
+    }
+    mLogged = true;
+
+    SDL_Log("Trades: %llu total, %llu dropped", static_cast<unsigned long long>(mTotalTrades), static_cast<unsigned long long>(TradeEvents::getDropped()));
+    for (uint32_t given = 0; given < TRADE_GOOD_COUNT; ++given)
+    {
+        for (uint32_t received = 0; received < TRADE_GOOD_COUNT; ++received)
+        {
+            if (mTrades[given][received])
+            {
+                SDL_Log("  %-12s for %-12s %8llu", GOOD_NAMES[given], GOOD_NAMES[received], static_cast<unsigned long long>(mTrades[given][received]));
+            }
+        }
+    }
+
+    // The busiest rug
+    auto busiest = max_element(mRugTrades.begin(), mRugTrades.end(), [](const pair<const uint32_t, uint64_t>& aLeft, const pair<const uint32_t, uint64_t>& aRight)
+    {
+        return aLeft.second < aRight.second;
+    });
+    if (busiest != mRugTrades.end())
+    {
+        SDL_Log("  busiest rug %u with %llu trades, %u rugs traded", busiest->first, static_cast<unsigned long long>(busiest->second), static_cast<uint32_t>(mRugTrades.size()));
+    }
+}
@@ -0,0 +1,47 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* TradeStatistics is a trade event consumer that aggregates the trades, how often each good was traded for
+* each other good and which rugs trade the most, and logs a summary when the trade event stream stops.
+*/
+#pragma once
+#include "PCH.h"
+#include "TradeEvents.h"
+
+
+// Number of goods, the ETradeState values
+constexpr uint32_t TRADE_GOOD_COUNT = 3;
+
+
+class TradeStatistics : public TradeEventConsumer
+{
+private:
+    // Trades by the good the NPC gave and the good it received
+    uint64_t mTrades[TRADE_GOOD_COUNT][TRADE_GOOD_COUNT];
+    uint64_t mTotalTrades;
+
+    // Trades made by each rug, keyed by the rug's unique ID, only touched on the consumer thread
+    map<uint32_t, uint64_t> mRugTrades;
+
+    // Whether the summary for the events since the last one has been logged
+    bool mLogged;
+
+public:
+    /**
+    * Default Constructor
+    */
+    TradeStatistics();
+
+    /**
+    * Count one trade.
+    * @param aEvent - The trade.
+    */
+    void consume(const TradeEvent& aEvent) override;
+
+    /**
+    * Log the summary once the stream stops.
+    */
+    void logSummary();
+};
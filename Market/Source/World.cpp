@@ -11,297 +11,1585 @@
 #include "Rug.h"
 #include "NPC.h"
 #include "SDLManager.h"
+#include "Camera.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include "FrameStats.h"
+#include "TradeEvents.h"
+
+
+// Trace marker names for each world partition
+static const char* const ORDER_TRACE_NAMES[]  = { "World::orderWorld LEFT", "World::orderWorld CENTER", "World::orderWorld RIGHT" };
+static const char* const RENDER_TRACE_NAMES[] = { "World::render LEFT", "World::render CENTER", "World::render RIGHT" };
+
+// Most rugs a single NPC's path is checked for trades against in one tick
+constexpr uint32_t MAX_OVERLAPPING_RUGS = 16;
+
+// Most mismatched ticks logged for each broadphase while they're checked against brute force
+constexpr uint32_t BROADPHASE_MISMATCH_LOG_LIMIT = 8;
+
+// The names of the layouts and spatial indexes, in the order of their enums
+static const char* const WORLD_LAYOUT_NAMES[]  = { "uniform", "clustered", "ring" };
+static const char* const WORLD_BACKEND_NAMES[] = { "grid", "quadtree" };
+
+// A full turn in radians, for the layouts' angles
+constexpr float WORLD_LAYOUT_TURN = 6.2831853f;
+
+// Farthest a sprite reaches past its entity's location, the subspaces this far outside the view are still
+// drawn so the sprites hanging into the view aren't cut off
+constexpr float RENDER_CULL_MARGIN = (RUG_FRAME_WIDTH * RUG_SCALE) / 2.f;
+
+
+/**
+* Removes the Entity from the world, uses the Entity's subspace to determine which subspace
+* to remove from.
+* @param aEntity - Entity to remove from the world.
+*/
+void World::removeEntity(Entity* aEntity)
+{
+    uint32_t col = aEntity->getSubspace() % mHorizontalTileCount;
+
+    // Remove the Entity from the leftmost partition
+    if (col < (mHorizontalTileCount / PARTITION_COUNT))
+    {
+        lock_guard<ProfiledMutex> lk(mLeftMtx);
+
+        mWorld[aEntity->getSubspace()]->removeEntity(aEntity);
+    }
+
+    // Remove the Entity from the center partition
+    else if (col < (2 * mHorizontalTileCount) / PARTITION_COUNT)
+    {
+        lock_guard<ProfiledMutex> lk(mCenterMtx);
+
+        mWorld[aEntity->getSubspace()]->removeEntity(aEntity);
+    }
+
+    // Remove the Entity from the rightmost partition
+    else
+    {
+        lock_guard<ProfiledMutex> lk(mRightMtx);
+
+        mWorld[aEntity->getSubspace()]->removeEntity(aEntity);
+    }
+}
+
+
+/**
+* Adds the Entity to the world, uses the Entity's subspace to determine which subspace to add to.
+* @param aEntity - Entity to add to the world.
+*/
+void World::addEntity(Entity* aEntity)
+{
+    uint32_t col = aEntity->getSubspace() % mHorizontalTileCount;
+
+    // Add the Entity to the leftmost partition
+    if (col < (mHorizontalTileCount / PARTITION_COUNT))
+    {
+        lock_guard<ProfiledMutex> lk(mLeftMtx);
+
+        mWorld[aEntity->getSubspace()]->addEntity(aEntity);
+    }
+
+    // Add the Entity to the center partition
+    else if (col < (2 * mHorizontalTileCount) / PARTITION_COUNT)
+    {
+        lock_guard<ProfiledMutex> lk(mCenterMtx);
+
+        mWorld[aEntity->getSubspace()]->addEntity(aEntity);
+    }
+    // Remove the Entity from the rightmost partition
+    else
+    {
+        lock_guard<ProfiledMutex> lk(mRightMtx);
+
+        mWorld[aEntity->getSubspace()]->addEntity(aEntity);
+    }
+}
+
+
+/**
+* Get the columns of subspaces in a partition, they match the partitions addEntity and removeEntity lock.
+* @param aPartition - The partition.
+* @param aFirstCol  - Set to the partition's first column.
+* @param aEndCol    - Set to one past the partition's last column.
+*/
+void World::getPartitionColumns(const EWorldPartition& aPartition, uint32_t& aFirstCol, uint32_t& aEndCol) const
+{
+    float partition = static_cast<float>(aPartition);
+    aFirstCol = static_cast<uint32_t>(ceil((mHorizontalTileCount * partition) / PARTITION_COUNT));
+    aEndCol   = static_cast<uint32_t>(ceil((mHorizontalTileCount * (partition + 1)) / PARTITION_COUNT));
+}
+
+
+/**
+* Get the mutex guarding a partition's subspaces.
+* @param aPartition - The partition.
+* @return ProfiledMutex& The partition's mutex.
+*/
+ProfiledMutex& World::getPartitionMutex(const EWorldPartition& aPartition)
+{
+    switch (aPartition)
+    {
+    case EWorldPartition::LEFT:
+        return mLeftMtx;
+    case EWorldPartition::CENTER:
+        return mCenterMtx;
+    default:
+        return mRightMtx;
+    }
+}
+
+
+/**
+* Get the column or row of subspaces containing a coordinate, clamped to the grid.
+* @param aCoordinate - The x or y coordinate.
+* @param aCount      - The number of columns or rows.
+* @return uint32_t The column or row.
+*/
+uint32_t World::toTile(const float& aCoordinate, const uint32_t& aCount) const
+{
+    if (aCoordinate <= 0)
+    {
+        return 0;
+    }
+    return min(static_cast<uint32_t>(aCoordinate / mRenderTileLength), aCount - 1);
+}
+
+
+/**
+* Get the subspaces the camera can see, widened by how far a sprite reaches past its entity.
+* @param aCamera   - The view of the world drawn in the window.
+* @param aFirstCol - Set to the first visible column.
+* @param aEndCol   - Set to one past the last visible column.
+* @param aFirstRow - Set to the first visible row.
+* @param aEndRow   - Set to one past the last visible row.
+*/
+void World::getVisibleTiles(const Camera& aCamera, uint32_t& aFirstCol, uint32_t& aEndCol, uint32_t& aFirstRow, uint32_t& aEndRow) const
+{
+    Vector viewMin;
+    Vector viewMax;
+    aCamera.getView(viewMin, viewMax);
+
+    aFirstCol = toTile(viewMin.x - RENDER_CULL_MARGIN, mHorizontalTileCount);
+    aEndCol   = toTile(viewMax.x + RENDER_CULL_MARGIN, mHorizontalTileCount) + 1;
+    aFirstRow = toTile(viewMin.y - RENDER_CULL_MARGIN, mVerticalTileCount);
+    aEndRow   = toTile(viewMax.y + RENDER_CULL_MARGIN, mVerticalTileCount) + 1;
+}
+
+
+/**
+* Default Constructor, default iniatialize every member variable
+*/
+World::World() : mLeftMtx("World::mLeftMtx"), mCenterMtx("World::mCenterMtx"), mRightMtx("World::mRightMtx")
+{
+    mWorldWidth           = 0;
+    mWorldHeight          = 0;
+    mRenderTileLength     = 0;
+    mHorizontalTileCount  = 0;
+    mVerticalTileCount    = 0;
+    mPolledTrading        = true;
+    mSubspaceStorage      = nullptr;
+    mLayout               = EWorldLayout::UNIFORM;
+    mBackend              = EWorldBackend::GRID;
+    mBroadphaseType       = EBroadphase::GRID;
+    mBroadphase           = Broadphase::create(mBroadphaseType);
+    mVerifyingBroadphases = false;
+    mVerifiedTicks        = 0;
+    mKernelMismatches     = 0;
+    mSeekingRugs          = false;
+    mFlowNavigating       = false;
+
+    for (uint32_t broadphase = 0; broadphase < BROADPHASE_COUNT; ++broadphase)
+    {
+        mVerifyBroadphases[broadphase]    = nullptr;
+        mBroadphaseMismatches[broadphase] = 0;
+    }
+
+    for (size_t partition = 0; partition < static_cast<size_t>(PARTITION_COUNT); ++partition)
+    {
+        mOccupiedSubspaces[partition] = 0;
+        mOccupancyTotal[partition]    = 0;
+        mOccupancyMax[partition]      = 0;
+    }
+}
+
+
+/**
+* Deallocate the subspaces used in this world
+*/
+World::~World()
+{
+    mWorld.clear();
+    delete[] mSubspaceStorage;
+    mSubspaceStorage = nullptr;
+
+    delete mBroadphase;
+    mBroadphase = nullptr;
+    for (Broadphase*& broadphase : mVerifyBroadphases)
+    {
+        delete broadphase;
+        broadphase = nullptr;
+    }
+}
+
+
+/**
+* Choose the length of the subspaces' sides for a population. The subspaces are sized to hold
+* WORLD_TARGET_OCCUPANCY entities at the world's average density, so ordering a subspace stays cheap however
+* many entities there are. They are never larger than the window is WORLD_WINDOW_TILE_COUNT subspaces
+* across, which keeps the render culling tight, or smaller than an NPC's trade neighborhood, and never more
+* than WORLD_MAX_SUBSPACES of them.
+* @param aPopulation - The number of entities in the world.
+* @return float The side length.
+*/
+float World::chooseTileLength(const size_t& aPopulation) const
+{
+    float maxLength = (SDLManager::mWindowWidth + 1) / static_cast<float>(WORLD_WINDOW_TILE_COUNT);
+    float length = maxLength;
+    if (aPopulation > 0)
+    {
+        double area = static_cast<double>(mWorldWidth) * mWorldHeight;
+        length = static_cast<float>(sqrt((area * WORLD_TARGET_OCCUPANCY) / aPopulation));
+    }
+    length = min(max(length, WORLD_MIN_TILE_LENGTH), max(maxLength, WORLD_MIN_TILE_LENGTH));
+
+    // Grow the subspaces until there are few enough of them
+    while (static_cast<uint64_t>((mWorldWidth / length) + 1) * static_cast<uint64_t>((mWorldHeight / length) + 1) > WORLD_MAX_SUBSPACES)
+    {
+        length *= 1.1f;
+    }
+
+    return length;
+}
+
+
+/**
+* Split the world into empty square subspaces of a given side length, replacing the current ones.
+* @param aTileLength - The side length.
+* @param aPopulation - The number of entities in the world, the subspaces reserve room for their share.
+* @param aPeak       - The most entities a subspace is expected to hold, the subspaces reserve room for
+*                      at least this many, 0 if it isn't known yet.
+*/
+void World::buildGrid(const float& aTileLength, const size_t& aPopulation, const size_t& aPeak)
+{
+    // Because the world is made up of square render tiles, determine the dimensions
+    // and number of tiles needed, the entities can stand on the world's far edges
+    mRenderTileLength = aTileLength;
+    mHorizontalTileCount = static_cast<uint32_t>((mWorldWidth / mRenderTileLength) + 1);
+    mVerticalTileCount = static_cast<uint32_t>((mWorldHeight / mRenderTileLength) + 1);
+
+    // mWorld is a "1D" array that represents a "2D" world, the subspaces are stored in the order of their
+    // Morton codes so the neighbors a partition walks are mostly near each other in memory
+    size_t subspaceCount = static_cast<size_t>(mHorizontalTileCount) * static_cast<size_t>(mVerticalTileCount);
+    vector<uint64_t> mortonOrder(subspaceCount);
+    for (size_t i = 0; i < subspaceCount; ++i)
+    {
+        mortonOrder[i] = (static_cast<uint64_t>(getMortonCode(static_cast<uint32_t>(i))) << 32) | i;
+    }
+    sort(mortonOrder.begin(), mortonOrder.end());
+
+    // Every subspace reserves room for several times its share of the entities, or the expected peak if
+    // that's more, up front so moving between subspaces rarely reallocates during a frame, the reservations
+    // are made in Morton order too
+    size_t reserved = max(static_cast<size_t>(WORLD_TARGET_OCCUPANCY * WORLD_SUBSPACE_RESERVE_RATIO), aPeak);
+    reserved = min(aPopulation, reserved);
+    mWorld.clear();
+    delete[] mSubspaceStorage;
+    mSubspaceStorage = new Subspace[subspaceCount];
+    mWorld.assign(subspaceCount, nullptr);
+    for (size_t i = 0; i < subspaceCount; ++i)
+    {
+        mWorld[mortonOrder[i] & UINT32_MAX] = &mSubspaceStorage[i];
+        mSubspaceStorage[i].mEntities.reserve(reserved);
+    }
+    mSimulationLOD.assign(mWorld.size(), ESimulationLOD::VISIBLE);
+}
+
+
+/**
+* Initialize the World to the given dimensions, split into square subspaces sized for the population it
+* is expected to hold.
+* @param aWidth      - The world's width.
+* @param aHeight     - The world's height.
+* @param aPopulation - The number of entities the world is expected to hold.
+* @return bool True if the world was initialized, otherwise false.
+*/
+bool World::init(const uint32_t& aWidth, const uint32_t& aHeight, const size_t& aPopulation)
+{
+    bool success = true;
+
+    mWorldWidth  = aWidth;
+    mWorldHeight = aHeight;
+
+    // Confirm the SDLManager window is initialized, and the world has an area
+    if ((SDLManager::mWindowWidth * SDLManager::mWindowHeight) == 0 || (static_cast<uint64_t>(mWorldWidth) * mWorldHeight) == 0)
+    {
+        // cout << "Failed to initialize the World!\n";
+        success = false;
+    }
+    else
+    {
+        buildGrid(chooseTileLength(aPopulation), aPopulation, 0);
+        mFlowFields.init(mWorldWidth + 1, mWorldHeight + 1);
+        SDL_Log("World: %.1f pixel subspaces, %u by %u, for %u entities", mRenderTileLength, mHorizontalTileCount,
+            mVerticalTileCount, static_cast<uint32_t>(aPopulation));
+
+        // Likewise the trade candidate buffers have room for several rugs per NPC
+        for (vector<TradeCandidate>& candidates : mTradeCandidates)
+        {
+            candidates.reserve(static_cast<size_t>(ENTITY_COUNT) * 4);
+        }
+        mResolveCandidates.reserve(static_cast<size_t>(ENTITY_COUNT) * 4 * static_cast<size_t>(PARTITION_COUNT));
+
+    }
+
+    return success;
+}
+
+
+/**
+* Resize the subspaces for the world's current population, if it changed enough since they were sized to
+* call for subspaces WORLD_REGRID_RATIO times larger or smaller. Must not be called while the partitions
+* are in use.
+* @param aRugs - Every rug in the world.
+* @param aNPCs - Every NPC in the world.
+* @return bool True if the world was re-gridded, otherwise false.
+*/
+bool World::regrid(const vector<Rug*>& aRugs, const vector<NPC*>& aNPCs)
+{
+    size_t population = aRugs.size() + aNPCs.size();
+    float tileLength = chooseTileLength(population);
+    if (mWorld.empty() || (tileLength < mRenderTileLength * WORLD_REGRID_RATIO && tileLength * WORLD_REGRID_RATIO > mRenderTileLength))
+    {
+        return false;
+    }
+
+    TRACE_SCOPE("World::regrid");
+
+    // The busiest subspace seen in the old grid, scaled up to the new subspaces' area when they're larger,
+    // a crowd around one spot is no smaller in smaller subspaces
+    uint32_t most = 0;
+    for (size_t partition = 0; partition < static_cast<size_t>(PARTITION_COUNT); ++partition)
+    {
+        most = max(most, mOccupancyMax[partition]);
+    }
+    float areaRatio = max((tileLength * tileLength) / (mRenderTileLength * mRenderTileLength), 1.f);
+    buildGrid(tileLength, population, static_cast<size_t>(ceil(most * areaRatio)));
+
+    // Every entity is placed in the new subspaces as if it was new to the world
+    for (Rug* rug : aRugs)
+    {
+        rug->setSubspace(UINT32_MAX);
+        placeEntity(rug);
+    }
+    for (NPC* npc : aNPCs)
+    {
+        npc->setSubspace(UINT32_MAX);
+        placeEntity(npc);
+    }
+
+    SDL_Log("World: re-gridded to %.1f pixel subspaces, %u by %u, for %u entities", mRenderTileLength,
+        mHorizontalTileCount, mVerticalTileCount, static_cast<uint32_t>(population));
+    return true;
+}
+
+
+/**
+* Drop the quadtree after entities it doesn't track moved, like the rugs of a restored snapshot, it's
+* rebuilt with every entity on the next updateSpatialIndex(..). Must not be called while the partitions
+* are in use.
+*/
+void World::resetSpatialIndex()
+{
+    mQuadtree.clear();
+}
+
+
+/**
+* Get the length of the subspaces' sides.
+* @return float The side length.
+*/
+float World::getTileLength() const
+{
+    return mRenderTileLength;
+}
+
+
+/**
+* Report the subspaces' size and how full they were when the partitions were last ordered to FrameStats.
+* Must be called on one thread once every partition is ordered.
+*/
+void World::reportOccupancy() const
+{
+    uint32_t occupied = 0;
+    uint32_t total = 0;
+    uint32_t most = 0;
+    for (size_t partition = 0; partition < static_cast<size_t>(PARTITION_COUNT); ++partition)
+    {
+        occupied += mOccupiedSubspaces[partition];
+        total    += mOccupancyTotal[partition];
+        most      = max(most, mOccupancyMax[partition]);
+    }
+
+    // The average counts only the occupied subspaces, the empty ones cost next to nothing
+    FrameStats::setGridOccupancy(mRenderTileLength, (occupied) ? (static_cast<float>(total) / occupied) : (0.f), most);
+}
+
+
+/**
+* Get the world's width, the entities are placed between 0 and the width.
+* @return uint32_t The width.
+*/
+uint32_t World::getWidth() const
+{
+    return mWorldWidth;
+}
+
+
+/**
+* Get the world's height, the entities are placed between 0 and the height.
+* @return uint32_t The height.
+*/
+uint32_t World::getHeight() const
+{
+    return mWorldHeight;
+}
+
+
+/**
+* Generate a random location within the world's layout, rand() alone can't reach past RAND_MAX so the
+* location is mapped from fractions.
+* @return Vector The location.
+*/
+Vector World::getRandomLocation() const
+{
+    float randomX = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX) + 1.f);
+    float randomY = static_cast<float>(rand()) / (static_cast<float>(RAND_MAX) + 1.f);
+    Vector location = mapLocation(randomX, randomY);
+    return Vector{ floor(location.x), floor(location.y), 0 };
+}
+
+
+/**
+* Map two values between [0,1) to a location in the world's layout, the same values always give the same
+* location.
+* @param aRandomX - The first value.
+* @param aRandomY - The second value.
+* @return Vector The location.
+*/
+Vector World::mapLocation(const float& aRandomX, const float& aRandomY) const
+{
+    float width = static_cast<float>(mWorldWidth);
+    float height = static_cast<float>(mWorldHeight);
+    float shortSide = min(width, height);
+    Vector location{ aRandomX * width, aRandomY * height, 0 };
+
+    switch (mLayout)
+    {
+    case EWorldLayout::CLUSTERED:
+    {
+        // The first value picks the cluster and what's left of it the direction from the cluster's center,
+        // the second value the distance, so the entities pile up in the middle of each cluster
+        float scaled = aRandomX * WORLD_LAYOUT_CLUSTERS;
+        uint32_t cluster = min(static_cast<uint32_t>(scaled), WORLD_LAYOUT_CLUSTERS - 1);
+        float angle = (scaled - cluster) * WORLD_LAYOUT_TURN;
+        float distance = aRandomY * WORLD_LAYOUT_CLUSTER_RADIUS * shortSide;
+
+        // The clusters' centers are spread over the world along a low discrepancy sequence
+        float centerX = (.1f + (.8f * fmod(.5f + (cluster * .7548777f), 1.f))) * width;
+        float centerY = (.1f + (.8f * fmod(.5f + (cluster * .5698403f), 1.f))) * height;
+        location = Vector{ centerX + (cos(angle) * distance), centerY + (sin(angle) * distance), 0 };
+        break;
+    }
+    case EWorldLayout::RING:
+    {
+        float angle = aRandomX * WORLD_LAYOUT_TURN;
+        float distance = (WORLD_LAYOUT_RING_RADIUS + ((aRandomY - .5f) * WORLD_LAYOUT_RING_WIDTH)) * shortSide;
+        location = Vector{ (width / 2.f) + (cos(angle) * distance), (height / 2.f) + (sin(angle) * distance), 0 };
+        break;
+    }
+    default:
+        break;
+    }
+
+    MATH::clamp(location, Vector{ width, height, 0 });
+    return location;
+}
+
+
+/**
+* Set where the generated market's rugs are placed and its NPCs walk to, must be called before any entity
+* is placed.
+* @param aLayout - The layout.
+*/
+void World::setLayout(const EWorldLayout& aLayout)
+{
+    mLayout = aLayout;
+}
+
+
+/**
+* Get where the market is laid out.
+* @return EWorldLayout The layout.
+*/
+EWorldLayout World::getLayout() const
+{
+    return mLayout;
+}
+
+
+/**
+* Set the spatial index neighbor queries are answered from, the quadtree is built on the next
+* updateSpatialIndex(..). Must not be called while the partitions are in use.
+* @param aBackend - The spatial index.
+*/
+void World::setBackend(const EWorldBackend& aBackend)
+{
+    mBackend = aBackend;
+    mQuadtree.clear();
+}
+
+
+/**
+* Get the spatial index neighbor queries are answered from.
+* @return EWorldBackend The spatial index.
+*/
+EWorldBackend World::getBackend() const
+{
+    return mBackend;
+}
+
+
+/**
+* Get a layout's name, as it's given on the command line and written to the benchmark results.
+* @param aLayout - The layout.
+* @return const char* The name.
+*/
+const char* World::getLayoutName(const EWorldLayout& aLayout)
+{
+    return WORLD_LAYOUT_NAMES[static_cast<size_t>(aLayout)];
+}
+
+
+/**
+* Get a spatial index's name, as it's given on the command line and written to the benchmark results.
+* @param aBackend - The spatial index.
+* @return const char* The name.
+*/
+const char* World::getBackendName(const EWorldBackend& aBackend)
+{
+    return WORLD_BACKEND_NAMES[static_cast<size_t>(aBackend)];
+}
+
+
+/**
+* Bring the quadtree up to date with the entities' locations while it is the index, only the entities that
+* left their cell are moved. The rugs never move, so they're only added when the quadtree is built. Must be
+* called on one thread once every entity has moved.
+* @param aRugs - Every rug in the world.
+* @param aNPCs - Every NPC in the world.
+*/
+void World::updateSpatialIndex(const vector<Rug*>& aRugs, const vector<NPC*>& aNPCs)
+{
+    if (mBackend != EWorldBackend::QUADTREE)
+    {
+        return;
+    }
+
+    TRACE_SCOPE("World::updateSpatialIndex");
+    if (!mQuadtree.isInitialized())
+    {
+        mQuadtree.init(mWorldWidth, mWorldHeight);
+        for (Rug* rug : aRugs)
+        {
+            mQuadtree.insert(rug);
+        }
+        for (NPC* npc : aNPCs)
+        {
+            mQuadtree.insert(npc);
+        }
+        return;
+    }
+
+    for (NPC* npc : aNPCs)
+    {
+        mQuadtree.update(npc);
+    }
+}
+
+
+/**
+* Find the entities within a radius of a point in the spatial index, in no particular order. Safe to call
+* from any thread while the entities aren't moving.
+* @param aCenter   - The point.
+* @param aRadius   - The radius.
+* @param aResults  - The buffer the entities are written to.
+* @param aCapacity - The most entities written.
+* @param aFilter   - Which entities are reported.
+* @return uint32_t The number of entities written.
+*/
+uint32_t World::queryRadius(const Vector& aCenter, const float& aRadius, Entity** aResults, const uint32_t& aCapacity, const QueryFilter& aFilter) const
+{
+    if (mBackend == EWorldBackend::QUADTREE)
+    {
+        return mQuadtree.query(aCenter, aRadius, aResults, aCapacity, aFilter);
+    }
+
+    // The subspaces the circle's bounding box overlaps
+    uint32_t firstCol = toTile(aCenter.x - aRadius, mHorizontalTileCount);
+    uint32_t endCol   = toTile(aCenter.x + aRadius, mHorizontalTileCount) + 1;
+    uint32_t firstRow = toTile(aCenter.y - aRadius, mVerticalTileCount);
+    uint32_t endRow   = toTile(aCenter.y + aRadius, mVerticalTileCount) + 1;
+
+    uint32_t found = 0;
+    for (uint32_t row = firstRow; row < endRow; ++row)
+    {
+        for (uint32_t col = firstCol; col < endCol; ++col)
+        {
+            for (Entity* entity : mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->mEntities)
+            {
+                if (found == aCapacity)
+                {
+                    return found;
+                }
+                if (MATH::pointsInRange(entity->getLocation(), aCenter, aRadius) && aFilter.matches(entity))
+                {
+                    aResults[found++] = entity;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+
+/**
+* Find the entities within a rectangle in the spatial index, in no particular order. Safe to call from any
+* thread while the entities aren't moving.
+* @param aMin      - The rectangle's corner with the smallest coordinates.
+* @param aMax      - The rectangle's corner with the largest coordinates.
+* @param aResults  - The buffer the entities are written to.
+* @param aCapacity - The most entities written.
+* @param aFilter   - Which entities are reported.
+* @return uint32_t The number of entities written.
+*/
+uint32_t World::queryRect(const Vector& aMin, const Vector& aMax, Entity** aResults, const uint32_t& aCapacity, const QueryFilter& aFilter) const
+{
+    if (mBackend == EWorldBackend::QUADTREE)
+    {
+        return mQuadtree.queryRect(aMin, aMax, aResults, aCapacity, aFilter);
+    }
+
+    // The subspaces the rectangle overlaps
+    uint32_t firstCol = toTile(aMin.x, mHorizontalTileCount);
+    uint32_t endCol   = toTile(aMax.x, mHorizontalTileCount) + 1;
+    uint32_t firstRow = toTile(aMin.y, mVerticalTileCount);
+    uint32_t endRow   = toTile(aMax.y, mVerticalTileCount) + 1;
+
+    uint32_t found = 0;
+    for (uint32_t row = firstRow; row < endRow; ++row)
+    {
+        for (uint32_t col = firstCol; col < endCol; ++col)
+        {
+            for (Entity* entity : mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->mEntities)
+            {
+                if (found == aCapacity)
+                {
+                    return found;
+                }
+
+                Vector location = entity->getLocation();
+                if (location.x >= aMin.x && location.x <= aMax.x && location.y >= aMin.y && location.y <= aMax.y && aFilter.matches(entity))
+                {
+                    aResults[found++] = entity;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+
+/**
+* Find the entities closest to a point in the spatial index, closest first. Safe to call from any thread
+* while the entities aren't moving. The grid is searched in square rings of subspaces around the point's
+* subspace, and stops once the closest entities found are nearer than any subspace not yet searched.
+* @param aCenter    - The point.
+* @param aCount     - The most entities found, no more than QUERY_MAX_NEAREST.
+* @param aResults   - The buffer the entities are written to, it must hold aCount entities.
+* @param aFilter    - Which entities are reported.
+* @param aMaxRadius - The farthest an entity can be.
+* @return uint32_t The number of entities written.
+*/
+uint32_t World::queryNearest(const Vector& aCenter, const uint32_t& aCount, Entity** aResults, const QueryFilter& aFilter, const float& aMaxRadius) const
+{
+    NearestQueue queue(aResults, aCount);
+    if (mBackend == EWorldBackend::QUADTREE)
+    {
+        mQuadtree.queryNearest(aCenter, aMaxRadius, queue, aFilter);
+        return queue.finish();
+    }
+
+    int64_t centerCol = toTile(aCenter.x, mHorizontalTileCount);
+    int64_t centerRow = toTile(aCenter.y, mVerticalTileCount);
+    uint32_t lastRing = max(mHorizontalTileCount, mVerticalTileCount);
+    float maxRadiusSquared = aMaxRadius * aMaxRadius;
+
+    for (uint32_t ring = 0; ring <= lastRing; ++ring)
+    {
+        // Every subspace outside this ring is at least this far from the point
+        float ringDistance = (ring > 0) ? ((ring - 1) * mRenderTileLength) : (0.f);
+        if (ringDistance * ringDistance > maxRadiusSquared || ringDistance * ringDistance > queue.getBoundSquared())
+        {
+            break;
+        }
+
+        int64_t firstRow = max<int64_t>(centerRow - ring, 0);
+        int64_t lastRow  = min<int64_t>(centerRow + ring, static_cast<int64_t>(mVerticalTileCount) - 1);
+        for (int64_t row = firstRow; row <= lastRow; ++row)
+        {
+            // The ring's top and bottom rows are searched across, the rows between only at its two ends
+            bool edgeRow = (row == centerRow - ring || row == centerRow + ring);
+            int64_t step = (edgeRow || ring == 0) ? (1) : (2 * static_cast<int64_t>(ring));
+            for (int64_t col = centerCol - ring; col <= centerCol + ring; col += step)
+            {
+                if (col < 0 || col >= static_cast<int64_t>(mHorizontalTileCount))
+                {
+                    continue;
+                }
+
+                for (Entity* entity : mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->mEntities)
+                {
+                    Vector location = entity->getLocation();
+                    float deltaX = location.x - aCenter.x;
+                    float deltaY = location.y - aCenter.y;
+                    float distanceSquared = (deltaX * deltaX) + (deltaY * deltaY);
+                    if (distanceSquared <= maxRadiusSquared && aFilter.matches(entity))
+                    {
+                        queue.offer(entity, distanceSquared);
+                    }
+                }
+            }
+        }
+    }
+
+    return queue.finish();
+}
+
+
+/**
+* Add an entity to the world at a certain location.
+* @param Entity* - reference to the entity being added to the world
+*/
+void World::placeEntity(Entity* aEntity)
+{
+    // the vector index of the given location
+    uint32_t newRow      = static_cast<uint32_t>(aEntity->getLocation().y / mRenderTileLength);
+    uint32_t newCol      = static_cast<uint32_t>(aEntity->getLocation().x / mRenderTileLength);
+    uint32_t newSubspace = (newRow * mHorizontalTileCount) + newCol;
+
+    // Update the subspaces only if the entity moved to a different subspace
+    if (newSubspace != aEntity->getSubspace())
+    {
+        if (newSubspace > mWorld.size())
+        {
+            // cout << "[Tonia Sanzo] INDEX OUT OF RANGE EXCEPTION!\n";
+            exit(1);
+        }
+
+        // Checks if the Entity has been placed in the world, if it has it removes the Entity
+        if (aEntity->getSubspace() != UINT32_MAX)
+        {
+            removeEntity(aEntity);
+        }
+
+        // Set the entity's new subspace and add the Entity to the world
+        aEntity->setSubspace(newSubspace);
+        addEntity(aEntity);
+    }
+}
+
+
+/**
+* Build the index the NPCs find rugs to trade with in, called once after every rug is placed.
+* @param aRugs - Every rug in the world.
+*/
+void World::buildRugIndex(const vector<Rug*>& aRugs)
+{
+    mRugIndex.build(aRugs, static_cast<float>(mWorldWidth + 1), static_cast<float>(mWorldHeight + 1));
+    mRugGoods.build(aRugs, mWorldWidth + 1, mWorldHeight + 1);
+
+    // The broadphases hold on to the rugs' locations
+    mBroadphase->build(mRugIndex, static_cast<float>(mWorldWidth + 1), static_cast<float>(mWorldHeight + 1));
+    for (Broadphase* broadphase : mVerifyBroadphases)
+    {
+        if (broadphase)
+        {
+            broadphase->build(mRugIndex, static_cast<float>(mWorldWidth + 1), static_cast<float>(mWorldHeight + 1));
+        }
+    }
+}
+
+
+/**
+* Get the index of the rugs.
+* @return const StaticRugIndex& The rug index.
+*/
+const StaticRugIndex& World::getRugIndex() const
+{
+    return mRugIndex;
+}
+
+
+/**
+* Set whether the NPCs walk to the closest rug trading a good other than theirs instead of a random
+* location. Must not be called while the NPCs are updated.
+* @param aSeekingRugs - True to walk to the rugs.
+*/
+void World::setSeekingRugs(const bool& aSeekingRugs)
+{
+    mSeekingRugs = aSeekingRugs;
+}
+
+
+/**
+* Get whether the NPCs walk to the closest rug trading a good other than theirs.
+* @return bool True if the NPCs walk to the rugs, otherwise false.
+*/
+bool World::isSeekingRugs() const
+{
+    return mSeekingRugs;
+}
+
+
+/**
+* Find the rug closest to a location trading a good other than one, passing over the rugs within trade
+* range of the location. Safe to call from the NPCs' update, no rug's good changes while it runs.
+* @param aLocation - The location.
+* @param aGood     - The good the rug must not trade.
+* @return Rug* The rug, nullptr if there is none.
+*/
+Rug* World::findRugToSeek(const Vector& aLocation, const ETradeState& aGood) const
+{
+    return mRugGoods.findNearest(aLocation, aGood, TRADE_RADIUS);
+}
+
+
+/**
+* Set whether the NPCs follow the flow fields around the obstacles instead of walking straight to their
+* targets. Must not be called while the NPCs are updated.
+* @param aFlowNavigating - True to follow the flow fields.
+*/
+void World::setFlowNavigating(const bool& aFlowNavigating)
+{
+    mFlowNavigating = aFlowNavigating;
+}
+
+
+/**
+* Get whether the NPCs follow the flow fields around the obstacles.
+* @return bool True if the NPCs follow the flow fields, otherwise false.
+*/
+bool World::isFlowNavigating() const
+{
+    return mFlowNavigating;
+}
+
+
+/**
+* Set the memory the cached flow fields may take.
+* @param aBudget - The budget in bytes.
+*/
+void World::setFlowFieldBudget(const size_t& aBudget)
+{
+    mFlowFields.setBudget(aBudget);
+}
+
+
+/**
+* Add a standing obstacle covering a rectangle. Must not be called while the NPCs are updated.
+* @param aMin - The rectangle's top left corner.
+* @param aMax - The rectangle's bottom right corner.
+* @return uint32_t The obstacle's index.
+*/
+uint32_t World::addObstacle(const Vector& aMin, const Vector& aMax)
+{
+    mObstacles.push_back(WorldObstacle{ aMin, aMax, true });
+    mFlowFields.setBlocking(aMin, aMax, true);
+    return static_cast<uint32_t>(mObstacles.size() - 1);
+}
+
+
+/**
+* Put an obstacle up or take it down, the cached flow fields are repaired around it. Must not be called
+* while the NPCs are updated.
+* @param aObstacle - The obstacle's index.
+* @param aStanding - True to put the obstacle up, false to take it down.
+*/
+void World::setObstacleStanding(const uint32_t& aObstacle, const bool& aStanding)
+{
+    if (aObstacle >= mObstacles.size() || mObstacles[aObstacle].mStanding == aStanding)
+    {
+        return;
+    }
+
+    WorldObstacle& obstacle = mObstacles[aObstacle];
+    obstacle.mStanding = aStanding;
+    mFlowFields.setBlocking(obstacle.mMin, obstacle.mMax, aStanding);
+}
+
+
+/**
+* Take every obstacle down and forget them, the cached flow fields are repaired. Must not be called
+* while the NPCs are updated.
+*/
+void World::clearObstacles()
+{
+    for (uint32_t i = 0; i < mObstacles.size(); ++i)
+    {
+        setObstacleStanding(i, false);
+    }
+    mObstacles.clear();
+}
+
+
+/**
+* Get every obstacle.
+* @return const vector<WorldObstacle>& The obstacles.
+*/
+const vector<WorldObstacle>& World::getObstacles() const
+{
+    return mObstacles;
+}
+
+
+/**
+* Scatter stalls and walls over the world, alternating between them, clear of every rug's trade radius.
+* Uses rand, so a seeded market gets the same obstacles. Must be called after the rugs are placed.
+* @param aCount - The number of obstacles.
+* @param aRugs  - Every rug in the world.
+*/
+void World::generateObstacles(const uint32_t& aCount, const vector<Rug*>& aRugs)
+{
+    uint32_t placed = 0;
+    for (uint32_t i = 0; i < aCount; ++i)
+    {
+        for (uint32_t attempt = 0; attempt < WORLD_OBSTACLE_ATTEMPTS; ++attempt)
+        {
+            // Even obstacles are stalls, odd ones are walls running across or down the world
+            float width = WORLD_STALL_WIDTH;
+            float height = WORLD_STALL_HEIGHT;
+            if (i & 1)
+            {
+                float length = WORLD_WALL_MIN_LENGTH + ((rand() % 1000) / 1000.f) * (WORLD_WALL_MAX_LENGTH - WORLD_WALL_MIN_LENGTH);
+                bool across = (rand() % 2) == 0;
+                width = (across) ? (length) : (WORLD_WALL_THICKNESS);
+                height = (across) ? (WORLD_WALL_THICKNESS) : (length);
+            }
+            Vector obstacleMin{ ((rand() % 1000) / 1000.f) * max(0.f, mWorldWidth - width), ((rand() % 1000) / 1000.f) * max(0.f, mWorldHeight - height), 0 };
+            Vector obstacleMax{ obstacleMin.x + width, obstacleMin.y + height, 0 };
+
+            // The obstacle is moved somewhere else if it comes too close to a rug
+            bool clear = true;
+            for (Rug* rug : aRugs)
+            {
+                Vector location = rug->getLocation();
+                float deltaX = location.x - max(obstacleMin.x, min(location.x, obstacleMax.x));
+                float deltaY = location.y - max(obstacleMin.y, min(location.y, obstacleMax.y));
+                if ((deltaX * deltaX) + (deltaY * deltaY) < (WORLD_OBSTACLE_RUG_CLEARANCE * WORLD_OBSTACLE_RUG_CLEARANCE))
+                {
+                    clear = false;
+                    break;
+                }
+            }
+
+            if (clear)
+            {
+                addObstacle(obstacleMin, obstacleMax);
+                ++placed;
+                break;
+            }
+        }
+    }
+
+    SDL_Log("World: placed %u of %u obstacles", placed, aCount);
+}
+
+
+/**
+* Pin the flow field leading to a target, it's kept until it's released. A field that isn't cached is
+* requested instead and worked out by updateFlowFields. Safe to call from the NPCs' update.
+* @param aTarget - The target.
+* @return FlowField* The field, nullptr if it was requested.
+*/
+FlowField* World::acquireFlowField(const Vector& aTarget)
+{
+    return mFlowFields.acquire(aTarget);
+}
+
+
+/**
+* Get the cached flow field leading to a target without pinning it, for an NPC whose request was worked
+* out. Safe to call from the NPCs' update.
+* @param aTarget - The target.
+* @return FlowField* The field, nullptr if it isn't cached.
+*/
+FlowField* World::findFlowField(const Vector& aTarget) const
+{
+    return mFlowFields.find(aTarget);
+}
+
+
+/**
+* Release the flow field an NPC acquired for a target, or withdraw its request. Safe to call from the
+* NPCs' update.
+* @param aTarget - The target the field was acquired for.
+*/
+void World::releaseFlowField(const Vector& aTarget)
+{
+    mFlowFields.release(aTarget);
+}
+
+
+/**
+* Work out the flow fields the NPCs requested during their update. Must be called on one thread, after
+* the NPCs are updated.
+*/
+void World::updateFlowFields()
+{
+    mFlowFields.update();
+}
+
+
+/**
+* Set whether every flow field repaired around an obstacle is checked against one worked out from scratch.
+* @param aVerifying - True to check the repairs.
+*/
+void World::setVerifyingFlowFields(const bool& aVerifying)
+{
+    mFlowFields.setVerifyingRepairs(aVerifying);
+}
 
 
 /**
-* Removes the Entity from the world, uses the Entity's subspace to determine which subspace
-* to remove from.
-* @param aEntity - Entity to remove from the world.
+* Get the number of repaired flow fields that didn't match one worked out from scratch.
+* @return uint32_t The mismatches.
 */
-void World::removeEntity(Entity* aEntity)
+uint32_t World::getFlowFieldMismatches() const
 {
-    uint32_t col = aEntity->getSubspace() % mHorizontalTileCount;
+    return mFlowFields.getRepairMismatches();
+}
 
-    // Remove the Entity from the leftmost partition
-    if (col < (mHorizontalTileCount / PARTITION_COUNT))
-    {
-        lock_guard<mutex> lk(mLeftMtx);
 
-        mWorld[aEntity->getSubspace()]->removeEntity(aEntity);
-    }
+/**
+* Get the navigation grid the flow fields cover.
+* @return const NavigationGrid& The grid.
+*/
+const NavigationGrid& World::getNavigationGrid() const
+{
+    return mFlowFields.getGrid();
+}
 
-    // Remove the Entity from the center partition
-    else if (col < (2 * mHorizontalTileCount) / PARTITION_COUNT)
-    {
-        lock_guard<mutex> lk(mCenterMtx);
 
-        mWorld[aEntity->getSubspace()]->removeEntity(aEntity);
-    }
+/**
+* Log the cached flow fields, if the NPCs followed any.
+*/
+void World::logFlowFields()
+{
+    mFlowFields.logStats();
+}
 
-    // Remove the Entity from the rightmost partition
-    else
-    {
-        lock_guard<mutex> lk(mRightMtx);
 
-        mWorld[aEntity->getSubspace()]->removeEntity(aEntity);
+/**
+* Set whether the subspaces poll for trades while they are ordered.
+* @param aPolledTrading - True to poll for trades, false when another trade engine makes the trades.
+*/
+void World::setPolledTrading(const bool& aPolledTrading)
+{
+    mPolledTrading = aPolledTrading;
+}
+
+
+/**
+* Classify every subspace as visible, nearby, or distant from the camera. Must be called on one thread
+* before the entities are updated.
+* @param aCamera - The view of the world drawn in the window.
+*/
+void World::updateSimulationLOD(const Camera& aCamera)
+{
+    uint32_t firstCol;
+    uint32_t endCol;
+    uint32_t firstRow;
+    uint32_t endRow;
+    getVisibleTiles(aCamera, firstCol, endCol, firstRow, endRow);
+
+    // The nearby ring around the visible subspaces
+    uint32_t nearbyFirstCol = (firstCol > SIMULATION_LOD_NEARBY_TILES) ? (firstCol - SIMULATION_LOD_NEARBY_TILES) : (0);
+    uint32_t nearbyEndCol   = min(endCol + SIMULATION_LOD_NEARBY_TILES, mHorizontalTileCount);
+    uint32_t nearbyFirstRow = (firstRow > SIMULATION_LOD_NEARBY_TILES) ? (firstRow - SIMULATION_LOD_NEARBY_TILES) : (0);
+    uint32_t nearbyEndRow   = min(endRow + SIMULATION_LOD_NEARBY_TILES, mVerticalTileCount);
+
+    for (uint32_t row = 0; row < mVerticalTileCount; ++row)
+    {
+        bool visibleRow = (row >= firstRow && row < endRow);
+        bool nearbyRow = (row >= nearbyFirstRow && row < nearbyEndRow);
+        for (uint32_t col = 0; col < mHorizontalTileCount; ++col)
+        {
+            ESimulationLOD lod = ESimulationLOD::DISTANT;
+            if (visibleRow && col >= firstCol && col < endCol)
+            {
+                lod = ESimulationLOD::VISIBLE;
+            }
+            else if (nearbyRow && col >= nearbyFirstCol && col < nearbyEndCol)
+            {
+                lod = ESimulationLOD::NEARBY;
+            }
+            mSimulationLOD[(static_cast<size_t>(mHorizontalTileCount) * row) + col] = lod;
+        }
     }
 }
 
 
 /**
-* Adds the Entity to the world, uses the Entity's subspace to determine which subspace to add to.
-* @param aEntity - Entity to add to the world.
+* Get a subspace's simulation level of detail.
+* @param aSubspace - The subspace's index.
+* @return ESimulationLOD How closely the subspace is simulated.
 */
-void World::addEntity(Entity* aEntity)
+ESimulationLOD World::getSimulationLOD(const uint32_t& aSubspace) const
 {
-    uint32_t col = aEntity->getSubspace() % mHorizontalTileCount;
+    return (aSubspace < mSimulationLOD.size()) ? (mSimulationLOD[aSubspace]) : (ESimulationLOD::VISIBLE);
+}
 
-    // Add the Entity to the leftmost partition
-    if (col < (mHorizontalTileCount / PARTITION_COUNT))
-    {
-        lock_guard<mutex> lk(mLeftMtx);
 
-        mWorld[aEntity->getSubspace()]->addEntity(aEntity);
+/**
+* Get the Morton code of a subspace's column and row, sorting the subspaces by it lays them out along
+* the Z-order curve.
+* @param aSubspace - The subspace's index.
+* @return uint32_t The Morton code.
+*/
+uint32_t World::getMortonCode(const uint32_t& aSubspace) const
+{
+    if (mHorizontalTileCount == 0)
+    {
+        return 0;
     }
+    return MATH::mortonCode(aSubspace % mHorizontalTileCount, aSubspace / mHorizontalTileCount);
+}
 
-    // Add the Entity to the center partition
-    else if (col < (2 * mHorizontalTileCount) / PARTITION_COUNT)
+
+/**
+* Empty every subspace and add each entity back to the subspace it records, for after the entities'
+* storage was moved. Must not be called while the partitions are in use.
+* @param aRugs     - Every rug in the world.
+* @param aNPCPool  - The NPCs' storage, every NPC in the world in storage order.
+* @param aNPCCount - The number of NPCs in the storage.
+*/
+void World::rebuildSubspaces(const vector<Rug*>& aRugs, NPC* aNPCPool, const uint32_t& aNPCCount)
+{
+    TRACE_SCOPE("World::rebuildSubspaces");
+
+    for (Subspace* subspace : mWorld)
     {
-        lock_guard<mutex> lk(mCenterMtx);
+        subspace->mEntities.clear();
+    }
 
-        mWorld[aEntity->getSubspace()]->addEntity(aEntity);
+    // The rugs first, in the order they were added, then the NPCs in their new storage order
+    for (Rug* rug : aRugs)
+    {
+        if (rug->getSubspace() < mWorld.size())
+        {
+            mWorld[rug->getSubspace()]->addEntity(rug);
+        }
     }
-    // Remove the Entity from the rightmost partition
-    else
+    for (uint32_t slot = 0; slot < aNPCCount; ++slot)
     {
-        lock_guard<mutex> lk(mRightMtx);
+        NPC* npc = &aNPCPool[slot];
+        if (npc->getSubspace() < mWorld.size())
+        {
+            mWorld[npc->getSubspace()]->addEntity(npc);
+        }
+    }
 
-        mWorld[aEntity->getSubspace()]->addEntity(aEntity);
+    // The quadtree held the old addresses too, it's rebuilt on the next update
+    if (mQuadtree.isInitialized())
+    {
+        mQuadtree.clear();
     }
 }
 
 
 /**
-* Default Constructor, default iniatialize every member variable
+* Each Subspace's Entity chain in the given partition will be organized based on
+* the Entitiy's y-coordinate.
+* @param aPartition - The partition to order.
 */
-World::World()
+void World::orderWorld(const EWorldPartition& aPartition)
 {
-    mWindowWidth         = 0;
-    mWindowHeight        = 0;
-    mRenderTileLength    = 0;
-    mHorizontalTileCount = 9;
-    mVerticalTileCount   = 0;
+    TRACE_SCOPE(ORDER_TRACE_NAMES[static_cast<size_t>(aPartition)]);
+    bool polledTrading = mPolledTrading;
+    bool collectingTrades = (mBroadphaseType == EBroadphase::GRID);
+    vector<TradeCandidate>& candidates = mTradeCandidates[static_cast<size_t>(aPartition)];
+    candidates.clear();
+
+    uint32_t firstCol;
+    uint32_t endCol;
+    getPartitionColumns(aPartition, firstCol, endCol);
+    ProfiledMutex& partitionMtx = getPartitionMutex(aPartition);
+
+    // How full the partition's subspaces are
+    uint32_t occupied = 0;
+    uint32_t total = 0;
+    uint32_t most = 0;
+
+    for (uint32_t col = firstCol; col < endCol; ++col)
+    {
+        for (uint32_t row = 0; row < mVerticalTileCount; ++row)
+        {
+            lock_guard<ProfiledMutex> lock(partitionMtx);
+            Subspace* subspace = mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col];
+            subspace->order();
+            if (polledTrading && collectingTrades)
+            {
+                subspace->collectTradeCandidates(mRugIndex, candidates);
+            }
+
+            uint32_t occupancy = static_cast<uint32_t>(subspace->mEntities.size());
+            occupied += (occupancy > 0) ? (1) : (0);
+            total    += occupancy;
+            most      = max(most, occupancy);
+        }
+    }
+
+    mOccupiedSubspaces[static_cast<size_t>(aPartition)] = occupied;
+    mOccupancyTotal[static_cast<size_t>(aPartition)]    = total;
+    mOccupancyMax[static_cast<size_t>(aPartition)]      = most;
 }
 
 
 /**
-* Deallocate the subspaces used in this world
+* Set the way the trade pairs are found. Must not be called while the partitions are in use.
+* @param aBroadphase - The way of finding the pairs.
 */
-World::~World()
+void World::setBroadphase(const EBroadphase& aBroadphase)
 {
-    for (Subspace* subspace : mWorld)
+    delete mBroadphase;
+    mBroadphaseType = aBroadphase;
+    mBroadphase = Broadphase::create(aBroadphase);
+    if (mRugIndex.size() > 0)
     {
-        delete subspace;
+        mBroadphase->build(mRugIndex, static_cast<float>(mWorldWidth + 1), static_cast<float>(mWorldHeight + 1));
     }
-    mWorld.clear();
 }
 
 
 /**
-* Initialize the World to match the dimensions of the map
+* Get the way the trade pairs are found.
+* @return EBroadphase The way of finding the pairs.
 */
-bool World::init()
+EBroadphase World::getBroadphase() const
 {
-    bool success = true;
+    return mBroadphaseType;
+}
 
-    mWindowWidth  = SDLManager::mWindowWidth + 1;
-    mWindowHeight = SDLManager::mWindowHeight + 1;
 
-    // Confirm the SDLManager window is initialized
-    if ((mWindowHeight * mWindowWidth) == 0)
+/**
+* Set whether every broadphase's pairs are checked against brute force's each tick.
+* @param aVerifying - True to check the broadphases.
+*/
+void World::setVerifyingBroadphases(const bool& aVerifying)
+{
+    // The rug index's kernel is checked once, every broadphase but brute force finds its pairs with it
+    if (aVerifying && !mVerifyingBroadphases)
     {
-        // cout << "Failed to initialize the World!\n";
-        success = false;
+        mKernelMismatches = StaticRugIndex::verifyKernel();
     }
-    else
-    {
-        // Because the world is made up of square render tiles, determine the dimensions
-        // and number of tiles needed
-        mRenderTileLength = mWindowWidth / static_cast<float>(mHorizontalTileCount);
-        mVerticalTileCount = static_cast<uint32_t>((mWindowHeight / mRenderTileLength) + 1);
 
-        // mWorld is a "1D" array that represents a "2D" world
-        for(uint32_t i = 0; i < static_cast<size_t>(mHorizontalTileCount) * static_cast<size_t>(mVerticalTileCount); ++i)
+    mVerifyingBroadphases = aVerifying;
+    for (uint32_t broadphase = 0; broadphase < BROADPHASE_COUNT; ++broadphase)
+    {
+        // The grid is checked through the subspaces' trade candidates instead
+        if (aVerifying && !mVerifyBroadphases[broadphase] && broadphase != static_cast<uint32_t>(EBroadphase::GRID))
         {
-            mWorld.push_back(new Subspace());
+            mVerifyBroadphases[broadphase] = Broadphase::create(static_cast<EBroadphase>(broadphase));
+            if (mRugIndex.size() > 0)
+            {
+                mVerifyBroadphases[broadphase]->build(mRugIndex, static_cast<float>(mWorldWidth + 1), static_cast<float>(mWorldHeight + 1));
+            }
         }
-
     }
-
-    return success;
 }
 
 
 /**
-* Add an entity to the world at a certain location.
-* @param Entity* - reference to the entity being added to the world
+* Find this tick's pairs with every broadphase, the grid's being the subspaces' trade candidates, and
+* check them against brute force's, logging the broadphases whose pairs don't match, while the
+* broadphases are being checked. Must be called on one thread once every entity has moved.
+* @param aNPCs - Every NPC in the world.
 */
-void World::placeEntity(Entity* aEntity)
+void World::verifyBroadphases(const vector<NPC*>& aNPCs)
 {
-    // the vector index of the given location
-    uint32_t newRow      = static_cast<uint32_t>(aEntity->getLocation().y / mRenderTileLength);
-    uint32_t newCol      = static_cast<uint32_t>(aEntity->getLocation().x / mRenderTileLength);
-    uint32_t newSubspace = (newRow * mHorizontalTileCount) + newCol;
+    if (!mVerifyingBroadphases)
+    {
+        return;
+    }
 
-    // Update the subspaces only if the entity moved to a different subspace
-    if (newSubspace != aEntity->getSubspace())
+    TRACE_SCOPE("World::verifyBroadphases");
+    ++mVerifiedTicks;
+
+    // The grid's pairs are the trade candidates the subspaces collect, capped at MAX_OVERLAPPING_RUGS rugs
+    // per NPC, as the trades are made from them. They're this tick's when the grid found the trades,
+    // otherwise the subspaces collect them here
+    if (mBroadphaseType != EBroadphase::GRID || !mPolledTrading)
     {
-        if (newSubspace > mWorld.size())
+        for (vector<TradeCandidate>& candidates : mTradeCandidates)
         {
-            // cout << "[Tonia Sanzo] INDEX OUT OF RANGE EXCEPTION!\n";
-            exit(1);
+            candidates.clear();
         }
-
-        // Checks if the Entity has been placed in the world, if it has it removes the Entity
-        if (aEntity->getSubspace() != UINT32_MAX)
+        for (Subspace* subspace : mWorld)
         {
-            removeEntity(aEntity);
+            subspace->collectTradeCandidates(mRugIndex, mTradeCandidates[0]);
         }
-
-        // Set the entity's new subspace and add the Entity to the world
-        aEntity->setSubspace(newSubspace);
-        addEntity(aEntity);
     }
-}
-
 
-/**
-* Each Subspace's Entity chain in the given partition will be organized based on
-* the Entitiy's y-coordinate.
-* @param aPartition - The partition to order.
-*/
-void World::orderWorld(const EWorldPartition& aPartition)
-{
-    switch (aPartition)
+    // Each broadphase finds the pairs in its own order, so they're compared sorted, by the NPCs' unique IDs
+    // since the candidates don't know the NPCs' indices
+    for (uint32_t broadphase = 0; broadphase < BROADPHASE_COUNT; ++broadphase)
     {
-    // Order the leftmost partition
-    case EWorldPartition::LEFT:
-        for (uint32_t col = 0; col < (mHorizontalTileCount / PARTITION_COUNT); ++col)
+        vector<BroadphasePair>& pairs = mVerifyPairs[broadphase];
+        if (broadphase == static_cast<uint32_t>(EBroadphase::GRID))
         {
-            for (uint32_t row = 0; row < mVerticalTileCount; ++row)
+            pairs.clear();
+            for (const vector<TradeCandidate>& candidates : mTradeCandidates)
             {
-                lock_guard<mutex> lock(mLeftMtx);
-                mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->order();
-                mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->trade();
+                for (const TradeCandidate& candidate : candidates)
+                {
+                    pairs.push_back({ candidate.mNPCID, candidate.mRug });
+                }
             }
         }
-        break;
-
-    // Order the center partition
-    case EWorldPartition::CENTER:
-        for (uint32_t col = static_cast<uint32_t>(mHorizontalTileCount / 3.f); col < (2 * mHorizontalTileCount) / PARTITION_COUNT; ++col)
+        else
         {
-            for (uint32_t row = 0; row < mVerticalTileCount; ++row)
+            mVerifyBroadphases[broadphase]->findPairs(aNPCs, pairs);
+            for (BroadphasePair& pair : pairs)
             {
-                lock_guard<mutex> lock(mCenterMtx);
-                mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->order();
-                mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->trade();
+                pair.mNPC = aNPCs[pair.mNPC]->getUniqueID();
             }
         }
-        break;
+        sort(pairs.begin(), pairs.end(), [](const BroadphasePair& aLeft, const BroadphasePair& aRight)
+        {
+            return (aLeft.mNPC != aRight.mNPC) ? (aLeft.mNPC < aRight.mNPC) : (aLeft.mRug < aRight.mRug);
+        });
+    }
 
-    // Order the rightmost partition
-    case EWorldPartition::RIGHT:
-        for (uint32_t col = static_cast<uint32_t>((2 * mHorizontalTileCount) / 3.f); col < mHorizontalTileCount; ++col)
+    const vector<BroadphasePair>& expected = mVerifyPairs[static_cast<size_t>(EBroadphase::BRUTE_FORCE)];
+    for (uint32_t broadphase = 0; broadphase < BROADPHASE_COUNT; ++broadphase)
+    {
+        const vector<BroadphasePair>& pairs = mVerifyPairs[broadphase];
+        bool matches = (pairs.size() == expected.size()) && equal(pairs.begin(), pairs.end(), expected.begin(), [](const BroadphasePair& aLeft, const BroadphasePair& aRight)
         {
-            for (uint32_t row = 0; row < mVerticalTileCount; ++row)
-            {
-                lock_guard<mutex> lock(mRightMtx);
-                mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->order();
-                mWorld[(static_cast<size_t>(mHorizontalTileCount) * row) + col]->trade();
-            }
+            return aLeft.mNPC == aRight.mNPC && aLeft.mRug == aRight.mRug;
+        });
+
+        if (!matches && ++mBroadphaseMismatches[broadphase] <= BROADPHASE_MISMATCH_LOG_LIMIT)
+        {
+            SDL_Log("Broadphase: %s found %u pairs on checked tick %u, brute force found %u", Broadphase::getName(static_cast<EBroadphase>(broadphase)),
+                static_cast<uint32_t>(pairs.size()), mVerifiedTicks, static_cast<uint32_t>(expected.size()));
         }
-        break;
     }
 }
 
 
 /**
-* Renders every entity in a partition of the world, this is designed to be done concurrently
-* @param aPartition - The partition to render
+* Get the number of ticks any broadphase's pairs didn't match brute force's, and circles the rug index's
+* kernel got wrong.
+* @return uint32_t The mismatches, summed over the broadphases and the kernel.
 */
-void World::render(const EWorldPartition& aPartition)
+uint32_t World::getBroadphaseMismatches() const
 {
-    switch (aPartition)
+    uint32_t mismatches = mKernelMismatches;
+    for (uint32_t broadphase = 0; broadphase < BROADPHASE_COUNT; ++broadphase)
     {
-    // Render the leftmost partition
-    case EWorldPartition::LEFT:
-        for (uint32_t col = 0; col < (mHorizontalTileCount / 3.f); ++col)
+        mismatches += mBroadphaseMismatches[broadphase];
+    }
+    return mismatches;
+}
+
+
+/**
+* Log how the broadphases did against brute force, if they were checked.
+*/
+void World::logBroadphaseVerification() const
+{
+    if (!mVerifyingBroadphases)
+    {
+        return;
+    }
+
+    for (uint32_t broadphase = 0; broadphase < BROADPHASE_COUNT; ++broadphase)
+    {
+        SDL_Log("Broadphase: %s mismatched brute force on %u of %u ticks", Broadphase::getName(static_cast<EBroadphase>(broadphase)),
+            mBroadphaseMismatches[broadphase], mVerifiedTicks);
+    }
+    SDL_Log("Broadphase: the rug index's kernel got %u circles wrong", mKernelMismatches);
+}
+
+
+/**
+* Make the trades collected by every partition, or found by the broadphase, in the order the NPCs
+* reached the rugs. Must be called on one thread once every partition is ordered.
+* @param aNPCs - Every NPC in the world.
+*/
+void World::resolveTrades(const vector<NPC*>& aNPCs)
+{
+    if (!mPolledTrading)
+    {
+        return;
+    }
+
+    TRACE_SCOPE("World::resolveTrades");
+    PERF_PHASE(EPerfPhase::TRADE);
+    FrameStatsScope frameStatsScope(EFramePhase::TRADE);
+
+    mResolveCandidates.clear();
+    if (mBroadphaseType == EBroadphase::GRID)
+    {
+        for (vector<TradeCandidate>& candidates : mTradeCandidates)
         {
-            for (uint32_t row = 0; row < mVerticalTileCount; ++row)
-            {
-                size_t currIndex = (static_cast<size_t>(mHorizontalTileCount) * row) + col;
-                lock_guard<mutex> lock(mLeftMtx);
+            mResolveCandidates.insert(mResolveCandidates.end(), candidates.begin(), candidates.end());
+        }
+    }
+    else
+    {
+        TRACE_SCOPE("World::resolveTrades broadphase");
+        mBroadphase->findPairs(aNPCs, mBroadphasePairs);
+        for (const BroadphasePair& pair : mBroadphasePairs)
+        {
+            NPC* tempNPC = aNPCs[pair.mNPC];
+            Vector prevLocation = tempNPC->getPrevLocation();
+            Vector currLocation = tempNPC->getLocation();
+            Vector center = mRugIndex.getRug(pair.mRug)->getLocation();
+            mResolveCandidates.push_back({ MATH::lineSegmentEntersCircleAt(prevLocation, currLocation, center, TRADE_RADIUS), tempNPC->getUniqueID(), tempNPC, pair.mRug });
+        }
+    }
 
-                // If the current location has an entity render the location
-                if (mWorld[currIndex])
-                {
-                    renderLocation(currIndex);
-                }
-            }
+    // Ordered by when the NPC got there, ties broken by the NPC and the rug, so the outcome never depends
+    // on which thread found a candidate
+    sort(mResolveCandidates.begin(), mResolveCandidates.end(), [](const TradeCandidate& aLeft, const TradeCandidate& aRight)
+    {
+        if (aLeft.mTime != aRight.mTime)
+        {
+            return aLeft.mTime < aRight.mTime;
         }
-        break;
+        if (aLeft.mNPCID != aRight.mNPCID)
+        {
+            return aLeft.mNPCID < aRight.mNPCID;
+        }
+        return aLeft.mRug < aRight.mRug;
+    });
 
-    // Render the center partition
-    case EWorldPartition::CENTER:
-        for (uint32_t col = static_cast<uint32_t>(mHorizontalTileCount / 3.f); col < ((2 * mHorizontalTileCount) / 3.f); ++col)
+    // Number of trades made this tick
+    uint32_t trades = 0;
+
+    for (const TradeCandidate& candidate : mResolveCandidates)
+    {
+        // The NPC already traded, or is still standing on a rug, this tick
+        NPC* tempNPC = candidate.mNPC;
+        if (tempNPC->getCurrentOverlappingRug())
         {
-            for (uint32_t row = 0; row < mVerticalTileCount; ++row)
-            {
-                lock_guard<mutex> lock(mCenterMtx);
-                size_t currIndex = (static_cast<size_t>(mHorizontalTileCount) * row) + col;
+            continue;
+        }
 
-                // If the current location has an entity render the location
-                if (mWorld[currIndex])
-                {
-                    renderLocation(currIndex);
-                }
-            }
+        Rug* tempRug = mRugIndex.getRug(candidate.mRug);
+        if (tempRug->getTradeState() == tempNPC->getTradeState())
+        {
+            continue;
         }
-        break;
 
-    // Render the rightmost partition
-    case EWorldPartition::RIGHT:
-        for (uint32_t col = static_cast<uint32_t>((2 * mHorizontalTileCount) / 3.f); col < mHorizontalTileCount; ++col)
+        // Still on a rug from last tick, no trade until the NPC steps off
+        if (tempNPC->getPreviousOverlappingRug())
         {
-            for (uint32_t row = 0; row < mVerticalTileCount; ++row)
-            {
-                lock_guard<mutex> lock(mRightMtx);
-                size_t currIndex = (static_cast<size_t>(mHorizontalTileCount) * row) + col;
+            tempNPC->setOverlappingRug(true);
+            continue;
+        }
 
-                // If the current location has an entity render the location
-                if (mWorld[currIndex])
-                {
-                    renderLocation(currIndex);
-                }
+        if (!tempRug->canTrade())
+        {
+            continue;
+        }
+
+        // Have the entity's trade
+        ETradeState tempTradeState = tempRug->getTradeState();
+        TradeEvents::publish(tempRug->getUniqueID(), candidate.mNPCID, tempNPC->getTradeState(), tempTradeState, tempNPC->getLocation());
+        tempRug->setTradeState(tempNPC->getTradeState());
+        tempNPC->setTradeState(tempTradeState);
+        tempNPC->setOverlappingRug(true);
+        ++trades;
+    }
+
+    if (trades)
+    {
+        FrameStats::addTrades(trades);
+    }
+}
+
+
+/**
+* Renders every entity in a partition of the world the camera can see, this is designed to be done
+* concurrently. Only the subspaces the view overlaps are visited, so the cost follows what is visible
+* rather than how many entities the world holds.
+* @param aPartition - The partition to render.
+* @param aCamera    - The view of the world drawn in the window.
+*/
+void World::render(const EWorldPartition& aPartition, const Camera& aCamera)
+{
+    TRACE_SCOPE(RENDER_TRACE_NAMES[static_cast<size_t>(aPartition)]);
+    PERF_PHASE(EPerfPhase::RENDER_RECORD);
+
+    // The partition's columns clipped to the view
+    uint32_t firstCol;
+    uint32_t endCol;
+    uint32_t visibleFirstCol;
+    uint32_t visibleEndCol;
+    uint32_t firstRow;
+    uint32_t endRow;
+    getPartitionColumns(aPartition, firstCol, endCol);
+    getVisibleTiles(aCamera, visibleFirstCol, visibleEndCol, firstRow, endRow);
+    firstCol = max(firstCol, visibleFirstCol);
+    endCol   = min(endCol, visibleEndCol);
+
+    ProfiledMutex& partitionMtx = getPartitionMutex(aPartition);
+    for (uint32_t col = firstCol; col < endCol; ++col)
+    {
+        for (uint32_t row = firstRow; row < endRow; ++row)
+        {
+            size_t currIndex = (static_cast<size_t>(mHorizontalTileCount) * row) + col;
+            lock_guard<ProfiledMutex> lock(partitionMtx);
+
+            // If the current location has an entity render the location
+            if (mWorld[currIndex])
+            {
+                renderLocation(currIndex, aCamera);
             }
         }
-        break;
     }
 }
 
 
 /**
 * Renders the Entity chain for the given subspace
-* @param aIndex - The mWorld index of the subspace to render
+* @param aIndex  - The mWorld index of the subspace to render
+* @param aCamera - The view of the world drawn in the window.
 */
-void World::renderLocation(const size_t& aIndex)
+void World::renderLocation(const size_t& aIndex, const Camera& aCamera)
 {
     Subspace* targetSubspace = mWorld[aIndex];
 
     for (Entity* entity : targetSubspace->mEntities)
     {
-        entity->render();
+        entity->render(aCamera);
     }
 }
 
@@ -355,6 +1643,10 @@ void Subspace::removeEntity(Entity* aEntity)
 */
 void Subspace::order()
 {
+    TRACE_SCOPE("Subspace::order");
+    PERF_PHASE(EPerfPhase::ORDER);
+    FrameStatsScope frameStatsScope(EFramePhase::ORDER);
+
     // Only sort Subspaces with more than one Entity
     if (mEntities.size() > 1)
     {
@@ -434,199 +1726,42 @@ void Subspace::swap(uint32_t aIndex1, uint32_t aIndex2)
 
 
 /**
-* Trade objects when NPC's overlap Rug's in a single subspace.
+* Collect a trade candidate for every rug the path of an NPC in this subspace overlapped this tick. Only
+* reads the NPCs and rugs, so the partitions can collect at the same time.
+* @param aRugIndex   - The index to find the rugs near each NPC in.
+* @param aCandidates - The partition's candidate buffer to add to.
 */
-void Subspace::trade()
+void Subspace::collectTradeCandidates(const StaticRugIndex& aRugIndex, vector<TradeCandidate>& aCandidates)
 {
-    // Iterators to the first Entity, and one past the last Entity in the mEntities vector
-    vector<Entity*>::iterator begin = mEntities.begin();
-    vector<Entity*>::iterator end   = mEntities.end();
-    
-    // Iterators above, below, and on the current Entity
-    vector<Entity*>::iterator currEntity;
-    vector<Entity*>::iterator entityAbove;
-    vector<Entity*>::iterator entityBelow;
+    TRACE_SCOPE("Subspace::collectTradeCandidates");
+    PERF_PHASE(EPerfPhase::TRADE);
+    FrameStatsScope frameStatsScope(EFramePhase::TRADE);
 
-    // Whether we can continue looking above/below for Entity's overlapping the currEntity
-    bool lookAbove = true;
-    bool lookBelow = true;
+    // The rugs the current NPC's path overlaps
+    uint32_t overlappingRugs[MAX_OVERLAPPING_RUGS];
 
-    // Iterate through the subspace
-    for (currEntity = begin; currEntity != end; ++currEntity)
+    for (Entity* entity : mEntities)
     {
-        // If currEntity is a Rug, check for overlaps
-        if ((*currEntity)->getType() == EEntityType::RUG)
+        if (entity->getType() != EEntityType::NPC)
         {
-            Rug* tempRug = static_cast<Rug*>(*currEntity);
-
-            // Confirm the currEntity can trade
-            if (tempRug->canTrade())
-            {
-                // look for the next entity that is able to trade with the currEntity
-                entityAbove = entityBelow = currEntity;
-
-                while (lookAbove || lookBelow)
-                {
-                    if (lookAbove)
-                    {
-                        // Stop looking at entityAbove when entityAbove's location moves out of range of currEntity
-                        if (((*entityAbove)->getLocation().y - tempRug->getLocation().y) > TRADE_RADIUS)
-                        {
-                            lookAbove = false;
-                        }
-                        else
-                        {
-                            // Confirm the entityAbove is a NPC, and in a different trade state
-                            if (((*entityAbove)->getType() == EEntityType::NPC) && ((*entityAbove)->getTradeState() != tempRug->getTradeState()))
-                            {
-                                // Cast the entityAbove to a NPC, then check if the tempNPC moved within the trade 
-                                // radius of the Rug
-                                NPC* tempNPC = static_cast<NPC*>(*entityAbove);
-                                if (MATH::doesLineSegmentOverlapCircle(tempNPC->getPrevLocation(), tempNPC->getLocation(), tempRug->getLocation(), TRADE_RADIUS))
-                                {
-                                    if (!tempNPC->getPreviousOverlappingRug())
-                                    {
-                                        // Have the entity's trade
-                                        ETradeState tempTradeState = tempRug->getTradeState();
-                                        tempRug->setTradeState((*entityAbove)->getTradeState());
-                                        (*entityAbove)->setTradeState(tempTradeState);
-                                        lookAbove = lookBelow = true;
-                                    }
-
-                                    tempNPC->setOverlappingRug(true);
-                                    break;
-                                }
-                            }
-
-                            if (entityAbove == begin)
-                            {
-                                lookAbove = false;
-                            }
-                            else
-                            {
-                                --entityAbove;
-                            }
-                        }
-                    }
-
-                    if (lookBelow)
-                    {
-                        // Stop looking at entityBelow when entityBelow's location moves out of range of currEntity
-                        if (((*currEntity)->getLocation().y - (*entityBelow)->getLocation().y) > TRADE_RADIUS)
-                        {
-                            lookBelow = false; 
-                        }
-                        else
-                        {
-                            // Confirm the entityBelow is a NPC, and in a different trade state
-                            if (((*entityBelow)->getType() == EEntityType::NPC) && ((*entityBelow)->getTradeState() != tempRug->getTradeState()))
-                            {
-                                // Cast the entityBelow to a NPC, then check if the tempNPC moved within the trade 
-                                // radius of the Rug
-                                NPC* tempNPC = static_cast<NPC*>(*entityBelow);
-                                if (MATH::doesLineSegmentOverlapCircle(tempNPC->getPrevLocation(), tempNPC->getLocation(), tempRug->getLocation(), TRADE_RADIUS))
-                                {
-                                    if (!tempNPC->getPreviousOverlappingRug())
-                                    {
-                                        // Have the entity's trade
-                                        ETradeState tempTradeState = tempRug->getTradeState();
-                                        tempRug->setTradeState((*entityBelow)->getTradeState());
-                                        (*entityBelow)->setTradeState(tempTradeState);
-                                        lookAbove = lookBelow = true;
-                                    }
-
-                                    tempNPC->setOverlappingRug(true);
-                                    break;
-                                }
-                            }
-
-                            if (++entityBelow == end)
-                            {
-                                lookBelow = false;
-                            }
-                        }
-                    }
-                }
-            }
+            continue;
         }
 
-        // If currEntity is an NPC, double check for overlaps
-        if ((*currEntity)->getType() == EEntityType::NPC)
+        // An NPC that didn't step this tick is tested over its whole longer step once it takes it
+        NPC* tempNPC = static_cast<NPC*>(entity);
+        if (tempNPC->isSkippingUpdates())
         {
-            NPC* tempNPC = static_cast<NPC*>(*currEntity);
-
-            // If the currEntity was previously overlapping the rug, and not just set to overlap, confirm if it
-            // is still overlapping or not.
-            if (tempNPC->getPreviousOverlappingRug() && !tempNPC->getCurrentOverlappingRug())
-            {
-                // look for the next entity that is able to trade with the currEntity
-                entityAbove = entityBelow = currEntity;
+            continue;
+        }
 
-                while (lookAbove || lookBelow)
-                {
-                    if (lookAbove)
-                    {
-                        // Stop looking at entityAbove when entityAbove's location moves out of range of currEntity
-                        if (((*entityAbove)->getLocation().y - tempNPC->getLocation().y) > TRADE_RADIUS)
-                        {
-                            lookAbove = false;
-                        }
-                        else
-                        {
-                            // Confirm the entityAbove is a Rug, and in a different trade state
-                            if (((*entityAbove)->getType() == EEntityType::RUG) && ((*entityAbove)->getTradeState() != tempNPC->getTradeState()))
-                            {
-                                // Cast the entityAbove to a Rug, then check if the tempNPC overlaps the trade 
-                                // radius of the Rug
-                                Rug* tempRug = static_cast<Rug*>(*entityAbove);
-                                if (MATH::doesLineSegmentOverlapCircle(tempNPC->getPrevLocation(), tempNPC->getLocation(), tempRug->getLocation(), TRADE_RADIUS))
-                                {
-                                   tempNPC->setOverlappingRug(true);
-                                    break;
-                                }
-                            }
-
-                            if (entityAbove == begin)
-                            {
-                                lookAbove = false;
-                            }
-                            else
-                            {
-                                --entityAbove;
-                            }
-                        }
-                    }
+        Vector prevLocation = tempNPC->getPrevLocation();
+        Vector currLocation = tempNPC->getLocation();
+        uint32_t rugCount = aRugIndex.querySegment(prevLocation, currLocation, overlappingRugs, MAX_OVERLAPPING_RUGS);
 
-                    if (lookBelow)
-                    {
-                        // Stop looking at entityBelow when entityBelow's location moves out of range of currEntity
-                        if (((tempNPC)->getLocation().y - (*entityBelow)->getLocation().y) > TRADE_RADIUS)
-                        {
-                            lookBelow = false;
-                        }
-                        else
-                        {
-                            // Confirm the entityBelow is a Rug, and in a different trade state
-                            if (((*entityBelow)->getType() == EEntityType::RUG) && ((*entityBelow)->getTradeState() != tempNPC->getTradeState()))
-                            {
-                                // Cast the entityBelow to a Rug, then check if the NPC overlaps the trade 
-                                // radius of the Rug
-                                Rug* tempRug = static_cast<Rug*>(*entityBelow);
-                                if (MATH::doesLineSegmentOverlapCircle(tempNPC->getPrevLocation(), tempNPC->getLocation(), tempRug->getLocation(), TRADE_RADIUS))
-                                {
-                                    tempNPC->setOverlappingRug(true);
-                                    break;
-                                }
-                            }
-
-                            if (++entityBelow == end)
-                            {
-                                lookBelow = false;
-                            }
-                        }
-                    }
-                }
-            }
+        for (uint32_t i = 0; i < rugCount; ++i)
+        {
+            Vector center = aRugIndex.getRug(overlappingRugs[i])->getLocation();
+            aCandidates.push_back({ MATH::lineSegmentEntersCircleAt(prevLocation, currLocation, center, TRADE_RADIUS), entity->getUniqueID(), tempNPC, overlappingRugs[i] });
         }
     }
 }
@@ -9,6 +9,12 @@
 #pragma once
 #include "PCH.h"
 #include "Entity.h"
+#include "ProfiledMutex.h"
+#include "StaticRugIndex.h"
+#include "LooseQuadtree.h"
+#include "Broadphase.h"
+#include "RugGoodIndex.h"
+#include "FlowField.h"
 
 
 // The world is partitioned into 3 equal partitions
@@ -20,23 +26,193 @@ enum class EWorldPartition
 };
 
 
+// How closely a region of the world is simulated, by where it is relative to the camera. Visible regions
+// are simulated every tick and animated, nearby regions every tick without animating since nobody sees
+// them, and distant regions step once every few ticks over the longer interval.
+enum class ESimulationLOD
+{
+    VISIBLE,
+    NEARBY,
+    DISTANT
+};
+
+// Distant regions step once every this many ticks unless another ratio is set, 1 simulates every region
+// every tick
+constexpr uint32_t SIMULATION_LOD_DISTANT_RATIO = 4;
+
+// Number of subspaces around the view that are nearby rather than distant
+constexpr uint32_t SIMULATION_LOD_NEARBY_TILES = 1;
+
+// The subspaces are sized to hold about this many entities at the world's average density, no larger than
+// a ninth of the window across, and no smaller than an NPC's trade neighborhood
+constexpr float WORLD_TARGET_OCCUPANCY       = 8.f;
+constexpr uint32_t WORLD_WINDOW_TILE_COUNT   = 9;
+constexpr float WORLD_MIN_TILE_LENGTH        = TRADE_RADIUS * 2.f;
+
+// Most subspaces the world is split into, however dense it is
+constexpr uint32_t WORLD_MAX_SUBSPACES       = 1 << 20;
+
+// The world re-grids once its population calls for subspaces this many times larger or smaller
+constexpr float WORLD_REGRID_RATIO           = 2.f;
+
+// Room each subspace reserves up front, as a multiple of the target occupancy
+constexpr float WORLD_SUBSPACE_RESERVE_RATIO = 4.f;
+
+
+// The spatial index neighbor queries are answered from, the subspace grid, or a loose quadtree that
+// adapts to how crowded each part of the world is
+enum class EWorldBackend
+{
+    GRID,
+    QUADTREE
+};
+
+
+// Where the generated market's rugs are placed and its NPCs walk to. Spread evenly, piled up in a few
+// clusters, or in a ring around the world's center.
+enum class EWorldLayout
+{
+    UNIFORM,
+    CLUSTERED,
+    RING
+};
+
+// The clustered layout's number of clusters and their radius, and the ring layout's radius and width, as
+// fractions of the world's shorter side
+constexpr uint32_t WORLD_LAYOUT_CLUSTERS      = 5;
+constexpr float WORLD_LAYOUT_CLUSTER_RADIUS   = .08f;
+constexpr float WORLD_LAYOUT_RING_RADIUS      = .35f;
+constexpr float WORLD_LAYOUT_RING_WIDTH       = .06f;
+
+// The generated market's stalls, and its walls' thickness and shortest and longest lengths, the obstacles
+// keep this far clear of every rug's trade radius, and each is tried this many times before it's given up on
+constexpr float WORLD_STALL_WIDTH             = 48.f;
+constexpr float WORLD_STALL_HEIGHT            = 32.f;
+constexpr float WORLD_WALL_THICKNESS          = 16.f;
+constexpr float WORLD_WALL_MIN_LENGTH         = 96.f;
+constexpr float WORLD_WALL_MAX_LENGTH         = 256.f;
+constexpr float WORLD_OBSTACLE_RUG_CLEARANCE  = TRADE_RADIUS;
+constexpr uint32_t WORLD_OBSTACLE_ATTEMPTS    = 8;
+
+
+// A market stall or wall the NPCs walk around while it's standing
+struct WorldObstacle
+{
+    Vector mMin;
+    Vector mMax;
+    bool mStanding;
+};
+
+
+class NPC;
+
+
+// A rug an NPC's path overlapped this tick, collected in parallel and traded in order once every partition
+// is done
+struct TradeCandidate
+{
+    // How far along its path this tick the NPC entered the rug's trade radius, in [0, 1]
+    float mTime;
+
+    // The NPC's unique ID, which breaks ties, the NPC, and the rug's index in the rug index
+    uint32_t mNPCID;
+    NPC* mNPC;
+    uint32_t mRug;
+};
+
+
 class Subspace;
+class Rug;
+class Camera;
 class World
 {
 private:
+    // Every subspace in row major order, the subspaces themselves are stored in one block laid out along
+    // the Morton curve so neighboring subspaces are mostly neighbors in memory too
     vector<Subspace*> mWorld;
+    Subspace* mSubspaceStorage;
+
+    // The world's dimensions, independent of the window's
+    uint32_t mWorldWidth;
+    uint32_t mWorldHeight;
+
+    ProfiledMutex mLeftMtx;
+    ProfiledMutex mCenterMtx;
+    ProfiledMutex mRightMtx;
+
+    // Rugs never move, so trade detection looks them up in an index built once
+    StaticRugIndex mRugIndex;
 
-    uint32_t mWindowWidth;
-    uint32_t mWindowHeight;
+    // The rugs split by the good they trade, and whether the NPCs walk to the closest rug trading a good
+    // other than theirs instead of a random location
+    RugGoodIndex mRugGoods;
+    bool mSeekingRugs;
 
-    mutex mLeftMtx;
-    mutex mCenterMtx;
-    mutex mRightMtx;
+    // The market's obstacles, the flow fields leading the NPCs around them, and whether the NPCs follow the
+    // fields instead of walking straight to their targets
+    vector<WorldObstacle> mObstacles;
+    FlowFieldCache mFlowFields;
+    bool mFlowNavigating;
+
+    // Whether the subspaces poll for trades while they are ordered, off while another trade engine runs
+    atomic<bool> mPolledTrading;
+
+    // Each partition's trade candidates for this tick, and every candidate merged for resolving
+    vector<TradeCandidate> mTradeCandidates[static_cast<size_t>(PARTITION_COUNT)];
+    vector<TradeCandidate> mResolveCandidates;
+
+    // The way the trade pairs are found, the grid's are collected by each partition while it's ordered and
+    // the other broadphases find every pair at once before the trades are resolved
+    EBroadphase mBroadphaseType;
+    Broadphase* mBroadphase;
+    vector<BroadphasePair> mBroadphasePairs;
+
+    // Every broadphase but the grid while they're checked against brute force each tick, their pairs keyed by
+    // the NPCs' unique IDs, the ticks checked, and the ticks each broadphase's pairs didn't match
+    bool mVerifyingBroadphases;
+    Broadphase* mVerifyBroadphases[BROADPHASE_COUNT];
+    vector<BroadphasePair> mVerifyPairs[BROADPHASE_COUNT];
+    uint32_t mVerifiedTicks;
+    uint32_t mBroadphaseMismatches[BROADPHASE_COUNT];
+
+    // Circles the rug index's kernel got wrong, checked once when the broadphases start being checked
+    uint32_t mKernelMismatches;
 
     float mRenderTileLength;
     uint32_t mHorizontalTileCount;
     uint32_t mVerticalTileCount;
 
+    // Each subspace's simulation level of detail, classified once per tick from the camera
+    vector<ESimulationLOD> mSimulationLOD;
+
+    // Each partition's occupied subspaces, entities in them, and the most in one subspace, counted while
+    // the partition is ordered
+    uint32_t mOccupiedSubspaces[static_cast<size_t>(PARTITION_COUNT)];
+    uint32_t mOccupancyTotal[static_cast<size_t>(PARTITION_COUNT)];
+    uint32_t mOccupancyMax[static_cast<size_t>(PARTITION_COUNT)];
+
+    // Where the market is laid out, the spatial index queries are answered from, and the quadtree kept
+    // up to date while it is the index
+    EWorldLayout mLayout;
+    EWorldBackend mBackend;
+    LooseQuadtree mQuadtree;
+
+    /**
+    * Choose the length of the subspaces' sides for a population.
+    * @param aPopulation - The number of entities in the world.
+    * @return float The side length.
+    */
+    float chooseTileLength(const size_t& aPopulation) const;
+
+    /**
+    * Split the world into empty square subspaces of a given side length, replacing the current ones.
+    * @param aTileLength - The side length.
+    * @param aPopulation - The number of entities in the world, the subspaces reserve room for their share.
+    * @param aPeak       - The most entities a subspace is expected to hold, the subspaces reserve room for
+    *                      at least this many, 0 if it isn't known yet.
+    */
+    void buildGrid(const float& aTileLength, const size_t& aPopulation, const size_t& aPeak);
+
     /**
     * Removes the Entity from the world, uses the Entity's subspace to determine which subspace
     * to remove from.
@@ -50,6 +226,39 @@ private:
     */
     void addEntity(Entity* aEntity);
 
+    /**
+    * Get the columns of subspaces in a partition, they match the partitions addEntity and removeEntity lock.
+    * @param aPartition - The partition.
+    * @param aFirstCol  - Set to the partition's first column.
+    * @param aEndCol    - Set to one past the partition's last column.
+    */
+    void getPartitionColumns(const EWorldPartition& aPartition, uint32_t& aFirstCol, uint32_t& aEndCol) const;
+
+    /**
+    * Get the mutex guarding a partition's subspaces.
+    * @param aPartition - The partition.
+    * @return ProfiledMutex& The partition's mutex.
+    */
+    ProfiledMutex& getPartitionMutex(const EWorldPartition& aPartition);
+
+    /**
+    * Get the column or row of subspaces containing a coordinate, clamped to the grid.
+    * @param aCoordinate - The x or y coordinate.
+    * @param aCount      - The number of columns or rows.
+    * @return uint32_t The column or row.
+    */
+    uint32_t toTile(const float& aCoordinate, const uint32_t& aCount) const;
+
+    /**
+    * Get the subspaces the camera can see, widened by how far a sprite reaches past its entity.
+    * @param aCamera   - The view of the world drawn in the window.
+    * @param aFirstCol - Set to the first visible column.
+    * @param aEndCol   - Set to one past the last visible column.
+    * @param aFirstRow - Set to the first visible row.
+    * @param aEndRow   - Set to one past the last visible row.
+    */
+    void getVisibleTiles(const Camera& aCamera, uint32_t& aFirstCol, uint32_t& aEndCol, uint32_t& aFirstRow, uint32_t& aEndRow) const;
+
 public:
     /**
     * Default Constructor, default iniatialize every member variable
@@ -62,10 +271,154 @@ public:
     ~World();
 
     /**
-    * Properly initialize the world, this uses the SDLManager's window dimensions to
-    * create a vector that has an index for each pixel in the window.
+    * Properly initialize the world, the world is split into square subspaces sized for the population
+    * it is expected to hold.
+    * @param aWidth      - The world's width.
+    * @param aHeight     - The world's height.
+    * @param aPopulation - The number of entities the world is expected to hold.
+    * @return bool True if the world was initialized, otherwise false.
+    */
+    bool init(const uint32_t& aWidth, const uint32_t& aHeight, const size_t& aPopulation);
+
+    /**
+    * Resize the subspaces for the world's current population, if it changed enough since they were sized
+    * to call for subspaces WORLD_REGRID_RATIO times larger or smaller. Must not be called while the
+    * partitions are in use.
+    * @param aRugs - Every rug in the world.
+    * @param aNPCs - Every NPC in the world.
+    * @return bool True if the world was re-gridded, otherwise false.
+    */
+    bool regrid(const vector<Rug*>& aRugs, const vector<NPC*>& aNPCs);
+
+    /**
+    * Drop the quadtree after entities it doesn't track moved, like the rugs of a restored snapshot, it's
+    * rebuilt with every entity on the next updateSpatialIndex(..). Must not be called while the partitions
+    * are in use.
+    */
+    void resetSpatialIndex();
+
+    /**
+    * Get the length of the subspaces' sides.
+    * @return float The side length.
+    */
+    float getTileLength() const;
+
+    /**
+    * Report the subspaces' size and how full they were when the partitions were last ordered to
+    * FrameStats. Must be called on one thread once every partition is ordered.
+    */
+    void reportOccupancy() const;
+
+    /**
+    * Get the world's width, the entities are placed between 0 and the width.
+    * @return uint32_t The width.
+    */
+    uint32_t getWidth() const;
+
+    /**
+    * Get the world's height, the entities are placed between 0 and the height.
+    * @return uint32_t The height.
+    */
+    uint32_t getHeight() const;
+
+    /**
+    * Generate a random location within the world.
+    * @return Vector The location.
     */
-    bool init();
+    Vector getRandomLocation() const;
+
+    /**
+    * Map two values between [0,1) to a location in the world's layout, the same values always give the
+    * same location.
+    * @param aRandomX - The first value.
+    * @param aRandomY - The second value.
+    * @return Vector The location.
+    */
+    Vector mapLocation(const float& aRandomX, const float& aRandomY) const;
+
+    /**
+    * Set where the generated market's rugs are placed and its NPCs walk to, must be called before any
+    * entity is placed.
+    * @param aLayout - The layout.
+    */
+    void setLayout(const EWorldLayout& aLayout);
+
+    /**
+    * Get where the market is laid out.
+    * @return EWorldLayout The layout.
+    */
+    EWorldLayout getLayout() const;
+
+    /**
+    * Set the spatial index neighbor queries are answered from, the quadtree is built on the next
+    * updateSpatialIndex(..). Must not be called while the partitions are in use.
+    * @param aBackend - The spatial index.
+    */
+    void setBackend(const EWorldBackend& aBackend);
+
+    /**
+    * Get the spatial index neighbor queries are answered from.
+    * @return EWorldBackend The spatial index.
+    */
+    EWorldBackend getBackend() const;
+
+    /**
+    * Get a layout's name, as it's given on the command line and written to the benchmark results.
+    * @param aLayout - The layout.
+    * @return const char* The name.
+    */
+    static const char* getLayoutName(const EWorldLayout& aLayout);
+
+    /**
+    * Get a spatial index's name, as it's given on the command line and written to the benchmark results.
+    * @param aBackend - The spatial index.
+    * @return const char* The name.
+    */
+    static const char* getBackendName(const EWorldBackend& aBackend);
+
+    /**
+    * Bring the quadtree up to date with the entities' locations while it is the index, only the entities
+    * that left their cell are moved. Must be called on one thread once every entity has moved.
+    * @param aRugs - Every rug in the world.
+    * @param aNPCs - Every NPC in the world.
+    */
+    void updateSpatialIndex(const vector<Rug*>& aRugs, const vector<NPC*>& aNPCs);
+
+    /**
+    * Find the entities within a radius of a point in the spatial index, in no particular order. Safe to
+    * call from any thread while the entities aren't moving.
+    * @param aCenter   - The point.
+    * @param aRadius   - The radius.
+    * @param aResults  - The buffer the entities are written to.
+    * @param aCapacity - The most entities written.
+    * @param aFilter   - Which entities are reported.
+    * @return uint32_t The number of entities written.
+    */
+    uint32_t queryRadius(const Vector& aCenter, const float& aRadius, Entity** aResults, const uint32_t& aCapacity, const QueryFilter& aFilter = QueryFilter()) const;
+
+    /**
+    * Find the entities within a rectangle in the spatial index, in no particular order. Safe to call from
+    * any thread while the entities aren't moving.
+    * @param aMin      - The rectangle's corner with the smallest coordinates.
+    * @param aMax      - The rectangle's corner with the largest coordinates.
+    * @param aResults  - The buffer the entities are written to.
+    * @param aCapacity - The most entities written.
+    * @param aFilter   - Which entities are reported.
+    * @return uint32_t The number of entities written.
+    */
+    uint32_t queryRect(const Vector& aMin, const Vector& aMax, Entity** aResults, const uint32_t& aCapacity, const QueryFilter& aFilter = QueryFilter()) const;
+
+    /**
+    * Find the entities closest to a point in the spatial index, closest first. Safe to call from any
+    * thread while the entities aren't moving.
+    * @param aCenter    - The point.
+    * @param aCount     - The most entities found, no more than QUERY_MAX_NEAREST.
+    * @param aResults   - The buffer the entities are written to, it must hold aCount entities.
+    * @param aFilter    - Which entities are reported.
+    * @param aMaxRadius - The farthest an entity can be.
+    * @return uint32_t The number of entities written.
+    */
+    uint32_t queryNearest(const Vector& aCenter, const uint32_t& aCount, Entity** aResults, const QueryFilter& aFilter = QueryFilter(), const float& aMaxRadius = FLT_MAX) const;
 
     /**
     * Place an Entity into the game world at a certain location.
@@ -73,24 +426,251 @@ public:
     */
     void placeEntity(Entity* mEntity);
 
+    /**
+    * Get the Morton code of a subspace's column and row, sorting the subspaces by it lays them out along
+    * the Z-order curve.
+    * @param aSubspace - The subspace's index.
+    * @return uint32_t The Morton code.
+    */
+    uint32_t getMortonCode(const uint32_t& aSubspace) const;
+
+    /**
+    * Empty every subspace and add each entity back to the subspace it records, for after the entities'
+    * storage was moved. Must not be called while the partitions are in use.
+    * @param aRugs     - Every rug in the world.
+    * @param aNPCPool  - The NPCs' storage, every NPC in the world in storage order.
+    * @param aNPCCount - The number of NPCs in the storage.
+    */
+    void rebuildSubspaces(const vector<Rug*>& aRugs, NPC* aNPCPool, const uint32_t& aNPCCount);
+
+    /**
+    * Build the index the NPCs find rugs to trade with in, called once after every rug is placed.
+    * @param aRugs - Every rug in the world.
+    */
+    void buildRugIndex(const vector<Rug*>& aRugs);
+
+    /**
+    * Get the index of the rugs.
+    * @return const StaticRugIndex& The rug index.
+    */
+    const StaticRugIndex& getRugIndex() const;
+
+    /**
+    * Set whether the NPCs walk to the closest rug trading a good other than theirs instead of a random
+    * location. Must not be called while the NPCs are updated.
+    * @param aSeekingRugs - True to walk to the rugs.
+    */
+    void setSeekingRugs(const bool& aSeekingRugs);
+
+    /**
+    * Get whether the NPCs walk to the closest rug trading a good other than theirs.
+    * @return bool True if the NPCs walk to the rugs, otherwise false.
+    */
+    bool isSeekingRugs() const;
+
+    /**
+    * Find the rug closest to a location trading a good other than one, passing over the rugs within trade
+    * range of the location. Safe to call from the NPCs' update, no rug's good changes while it runs.
+    * @param aLocation - The location.
+    * @param aGood     - The good the rug must not trade.
+    * @return Rug* The rug, nullptr if there is none.
+    */
+    Rug* findRugToSeek(const Vector& aLocation, const ETradeState& aGood) const;
+
+    /**
+    * Set whether the NPCs follow the flow fields around the obstacles instead of walking straight to their
+    * targets. Must not be called while the NPCs are updated.
+    * @param aFlowNavigating - True to follow the flow fields.
+    */
+    void setFlowNavigating(const bool& aFlowNavigating);
+
+    /**
+    * Get whether the NPCs follow the flow fields around the obstacles.
+    * @return bool True if the NPCs follow the flow fields, otherwise false.
+    */
+    bool isFlowNavigating() const;
+
+    /**
+    * Set the memory the cached flow fields may take.
+    * @param aBudget - The budget in bytes.
+    */
+    void setFlowFieldBudget(const size_t& aBudget);
+
+    /**
+    * Add a standing obstacle covering a rectangle. Must not be called while the NPCs are updated.
+    * @param aMin - The rectangle's top left corner.
+    * @param aMax - The rectangle's bottom right corner.
+    * @return uint32_t The obstacle's index.
+    */
+    uint32_t addObstacle(const Vector& aMin, const Vector& aMax);
+
+    /**
+    * Put an obstacle up or take it down, the cached flow fields are repaired around it. Must not be called
+    * while the NPCs are updated.
+    * @param aObstacle - The obstacle's index.
+    * @param aStanding - True to put the obstacle up, false to take it down.
+    */
+    void setObstacleStanding(const uint32_t& aObstacle, const bool& aStanding);
+
+    /**
+    * Take every obstacle down and forget them, the cached flow fields are repaired. Must not be called
+    * while the NPCs are updated.
+    */
+    void clearObstacles();
+
+    /**
+    * Get every obstacle.
+    * @return const vector<WorldObstacle>& The obstacles.
+    */
+    const vector<WorldObstacle>& getObstacles() const;
+
+    /**
+    * Scatter stalls and walls over the world, alternating between them, clear of every rug's trade radius.
+    * Uses rand, so a seeded market gets the same obstacles. Must be called after the rugs are placed.
+    * @param aCount - The number of obstacles.
+    * @param aRugs  - Every rug in the world.
+    */
+    void generateObstacles(const uint32_t& aCount, const vector<Rug*>& aRugs);
+
+    /**
+    * Pin the flow field leading to a target, it's kept until it's released. A field that isn't cached is
+    * requested instead and worked out by updateFlowFields. Safe to call from the NPCs' update.
+    * @param aTarget - The target.
+    * @return FlowField* The field, nullptr if it was requested.
+    */
+    FlowField* acquireFlowField(const Vector& aTarget);
+
+    /**
+    * Get the cached flow field leading to a target without pinning it, for an NPC whose request was worked
+    * out. Safe to call from the NPCs' update.
+    * @param aTarget - The target.
+    * @return FlowField* The field, nullptr if it isn't cached.
+    */
+    FlowField* findFlowField(const Vector& aTarget) const;
+
+    /**
+    * Release the flow field an NPC acquired for a target, or withdraw its request. Safe to call from the
+    * NPCs' update.
+    * @param aTarget - The target the field was acquired for.
+    */
+    void releaseFlowField(const Vector& aTarget);
+
+    /**
+    * Work out the flow fields the NPCs requested during their update. Must be called on one thread, after
+    * the NPCs are updated.
+    */
+    void updateFlowFields();
+
+    /**
+    * Set whether every flow field repaired around an obstacle is checked against one worked out from scratch.
+    * @param aVerifying - True to check the repairs.
+    */
+    void setVerifyingFlowFields(const bool& aVerifying);
+
+    /**
+    * Get the number of repaired flow fields that didn't match one worked out from scratch.
+    * @return uint32_t The mismatches.
+    */
+    uint32_t getFlowFieldMismatches() const;
+
+    /**
+    * Get the navigation grid the flow fields cover.
+    * @return const NavigationGrid& The grid.
+    */
+    const NavigationGrid& getNavigationGrid() const;
+
+    /**
+    * Log the cached flow fields, if the NPCs followed any.
+    */
+    void logFlowFields();
+
+    /**
+    * Set whether the subspaces poll for trades while they are ordered.
+    * @param aPolledTrading - True to poll for trades, false when another trade engine makes the trades.
+    */
+    void setPolledTrading(const bool& aPolledTrading);
+
+    /**
+    * Classify every subspace as visible, nearby, or distant from the camera. Must be called on one thread
+    * before the entities are updated.
+    * @param aCamera - The view of the world drawn in the window.
+    */
+    void updateSimulationLOD(const Camera& aCamera);
+
+    /**
+    * Get a subspace's simulation level of detail.
+    * @param aSubspace - The subspace's index.
+    * @return ESimulationLOD How closely the subspace is simulated.
+    */
+    ESimulationLOD getSimulationLOD(const uint32_t& aSubspace) const;
+
     /**
     * Each Subspace's Entity chain in the given partition will be organized based on
-    * the Entitiy's y-coordinate.
+    * the Entitiy's y-coordinate, and the partition's trade candidates are collected while the grid
+    * broadphase finds the trade pairs.
     * @param aPartition - The partition to order.
     */
     void orderWorld(const EWorldPartition& aPartition);
 
     /**
-    * Renders every entity in a partition of the world, this is designed to be done concurrently.
+    * Set the way the trade pairs are found. Must not be called while the partitions are in use.
+    * @param aBroadphase - The way of finding the pairs.
+    */
+    void setBroadphase(const EBroadphase& aBroadphase);
+
+    /**
+    * Get the way the trade pairs are found.
+    * @return EBroadphase The way of finding the pairs.
+    */
+    EBroadphase getBroadphase() const;
+
+    /**
+    * Set whether every broadphase's pairs are checked against brute force's each tick.
+    * @param aVerifying - True to check the broadphases.
+    */
+    void setVerifyingBroadphases(const bool& aVerifying);
+
+    /**
+    * Find this tick's pairs with every broadphase, the grid's being the subspaces' trade candidates, and
+    * check them against brute force's, logging the broadphases whose pairs don't match, while the
+    * broadphases are being checked. Must be called on one thread once every entity has moved.
+    * @param aNPCs - Every NPC in the world.
+    */
+    void verifyBroadphases(const vector<NPC*>& aNPCs);
+
+    /**
+    * Get the number of ticks any broadphase's pairs didn't match brute force's, and circles the rug index's
+    * kernel got wrong.
+    * @return uint32_t The mismatches, summed over the broadphases and the kernel.
+    */
+    uint32_t getBroadphaseMismatches() const;
+
+    /**
+    * Log how the broadphases did against brute force, if they were checked.
+    */
+    void logBroadphaseVerification() const;
+
+    /**
+    * Make the trades collected by every partition, or found by the broadphase, in the order the NPCs
+    * reached the rugs. Must be called on one thread once every partition is ordered.
+    * @param aNPCs - Every NPC in the world.
+    */
+    void resolveTrades(const vector<NPC*>& aNPCs);
+
+    /**
+    * Renders every entity in a partition of the world the camera can see, this is designed to be done
+    * concurrently.
     * @param aPartition - The partition to render.
+    * @param aCamera    - The view of the world drawn in the window.
     */
-    void render(const EWorldPartition& aPartition);
+    void render(const EWorldPartition& aPartition, const Camera& aCamera);
 
     /**
     * Renders the Entity chain at the given index location.
-    * @param aIndex - The mWorld vector index of the location.
+    * @param aIndex  - The mWorld vector index of the location.
+    * @param aCamera - The view of the world drawn in the window.
     */
-    void renderLocation(const size_t& aIndex);
+    void renderLocation(const size_t& aIndex, const Camera& aCamera);
 };
 
 
@@ -156,7 +736,9 @@ private:
     void swap(uint32_t aIndex1, uint32_t aIndex2);
 
     /**
-    * Trade objects when NPC's overlap Rug's in a single subspace.
+    * Collect a trade candidate for every rug the path of an NPC in this subspace overlapped this tick.
+    * @param aRugIndex   - The index to find the rugs near each NPC in.
+    * @param aCandidates - The partition's candidate buffer to add to.
     */
-    void trade();
+    void collectTradeCandidates(const StaticRugIndex& aRugIndex, vector<TradeCandidate>& aCandidates);
 };
\ No newline at end of file
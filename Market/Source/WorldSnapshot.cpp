@@ -0,0 +1,297 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* WorldSnapshot saves the whole market, every NPC, rug and obstacle, the tick and the random number generator, to a
+* flat file that is mapped back into memory to restore it. The file holds no pointers, only fixed size
+* records at offsets from the start of the file, so the mapped records are used in place and restoring
+* costs about as much as reading the file. A restored market continues exactly like the saved one.
+*/
+#include "PCH.h"
+#include "WorldSnapshot.h"
+#include "NPC.h"
+#include "Rug.h"
+#include "World.h"
+
+
+// Records are written out this many at a time
+constexpr size_t WORLD_SNAPSHOT_WRITE_BATCH = 1024;
+
+
+/**
+* Round an offset up to the snapshot's alignment.
+*/
+static uint64_t alignOffset(const uint64_t& aOffset)
+{
+    return (aOffset + WORLD_SNAPSHOT_ALIGNMENT - 1) & ~(WORLD_SNAPSHOT_ALIGNMENT - 1);
+}
+
+
+/**
+* Write zeros up to an offset.
+*/
+static void padTo(ofstream& aFile, uint64_t& aWritten, const uint64_t& aOffset)
+{
+    static const char zeros[WORLD_SNAPSHOT_ALIGNMENT] = {};
+    aFile.write(zeros, static_cast<streamsize>(aOffset - aWritten));
+    aWritten = aOffset;
+}
+
+
+/**
+* Default Constructor, nothing is restored until a snapshot is opened.
+*/
+WorldSnapshot::WorldSnapshot()
+{
+    mHeader = nullptr;
+}
+
+
+/**
+* Save the market to a snapshot, replacing an existing one.
+* @param aPath     - Where to save the snapshot.
+* @param aNPCs     - The NPCs.
+* @param aRugs     - The rugs.
+* @param aWorld    - The world the market is in.
+* @param aTick     - The tick the market was saved on.
+* @param aRNGSeed  - The random number generator's seed.
+* @param aRNGDraws - The number of values drawn from the random number generator since it was seeded.
+* @param aRNGState - The random number generator's state.
+* @return bool True if the snapshot was saved, otherwise false.
+*/
+bool WorldSnapshot::save(const char* aPath, const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, const World& aWorld, const uint32_t& aTick,
+    const uint64_t& aRNGSeed, const uint64_t& aRNGDraws, const string& aRNGState)
+{
+    ofstream file(aPath, ios::binary | ios::trunc);
+    if (!file)
+    {
+        // cout << "Failed to create the world snapshot!\n";
+        return false;
+    }
+
+    WorldSnapshotHeader header = {};
+    header.mMagic = WORLD_SNAPSHOT_MAGIC;
+    header.mVersion = WORLD_SNAPSHOT_VERSION;
+    header.mHeaderSize = sizeof(WorldSnapshotHeader);
+    header.mTick = aTick;
+    header.mNPCCount = static_cast<uint32_t>(aNPCs.size());
+    header.mRugCount = static_cast<uint32_t>(aRugs.size());
+    header.mWorldWidth = aWorld.getWidth();
+    header.mWorldHeight = aWorld.getHeight();
+    header.mRNGSeed = aRNGSeed;
+    header.mRNGDraws = aRNGDraws;
+    header.mNPCOffset = alignOffset(sizeof(WorldSnapshotHeader));
+    header.mRugOffset = alignOffset(header.mNPCOffset + (sizeof(NPCSnapshot) * header.mNPCCount));
+    header.mRNGStateOffset = alignOffset(header.mRugOffset + (sizeof(RugSnapshot) * header.mRugCount));
+    header.mRNGStateSize = aRNGState.size();
+    header.mObstacleCount = static_cast<uint32_t>(aWorld.getObstacles().size());
+    header.mObstacleOffset = alignOffset(header.mRNGStateOffset + header.mRNGStateSize);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+
+    // The NPCs, a batch at a time
+    padTo(file, written, header.mNPCOffset);
+    vector<NPCSnapshot> npcBatch(WORLD_SNAPSHOT_WRITE_BATCH);
+    for (size_t first = 0; first < aNPCs.size(); first += WORLD_SNAPSHOT_WRITE_BATCH)
+    {
+        size_t count = min(WORLD_SNAPSHOT_WRITE_BATCH, aNPCs.size() - first);
+        for (size_t i = 0; i < count; ++i)
+        {
+            aNPCs[first + i]->saveSnapshot(npcBatch[i]);
+        }
+        file.write(reinterpret_cast<const char*>(npcBatch.data()), static_cast<streamsize>(sizeof(NPCSnapshot) * count));
+    }
+    written += sizeof(NPCSnapshot) * aNPCs.size();
+
+    // The rugs
+    padTo(file, written, header.mRugOffset);
+    vector<RugSnapshot> rugBatch(WORLD_SNAPSHOT_WRITE_BATCH);
+    for (size_t first = 0; first < aRugs.size(); first += WORLD_SNAPSHOT_WRITE_BATCH)
+    {
+        size_t count = min(WORLD_SNAPSHOT_WRITE_BATCH, aRugs.size() - first);
+        for (size_t i = 0; i < count; ++i)
+        {
+            aRugs[first + i]->saveSnapshot(rugBatch[i]);
+        }
+        file.write(reinterpret_cast<const char*>(rugBatch.data()), static_cast<streamsize>(sizeof(RugSnapshot) * count));
+    }
+    written += sizeof(RugSnapshot) * aRugs.size();
+
+    // The random number generator
+    padTo(file, written, header.mRNGStateOffset);
+    file.write(aRNGState.data(), static_cast<streamsize>(aRNGState.size()));
+    written += aRNGState.size();
+
+    // The obstacles, few enough to write one at a time
+    padTo(file, written, header.mObstacleOffset);
+    for (const WorldObstacle& obstacle : aWorld.getObstacles())
+    {
+        ObstacleSnapshot obstacleSnapshot = {};
+        obstacleSnapshot.mMinX = obstacle.mMin.x;
+        obstacleSnapshot.mMinY = obstacle.mMin.y;
+        obstacleSnapshot.mMaxX = obstacle.mMax.x;
+        obstacleSnapshot.mMaxY = obstacle.mMax.y;
+        obstacleSnapshot.mStanding = obstacle.mStanding;
+        file.write(reinterpret_cast<const char*>(&obstacleSnapshot), sizeof(obstacleSnapshot));
+    }
+
+    return static_cast<bool>(file);
+}
+
+
+/**
+* Map a snapshot and check it was saved from a market the same size as this one.
+* @param aPath     - The snapshot to restore.
+* @param aNPCCount - The number of NPCs in the market.
+* @param aRugCount - The number of rugs in the market.
+* @param aWorld    - The world the market is in.
+* @return bool True if the snapshot was opened, otherwise false.
+*/
+bool WorldSnapshot::open(const char* aPath, const uint32_t& aNPCCount, const uint32_t& aRugCount, const World& aWorld)
+{
+    bool success = true;
+    close();
+
+    if (!mFile.open(aPath) || mFile.getSize() < sizeof(WorldSnapshotHeader))
+    {
+        // cout << "Failed to open the world snapshot!\n";
+        success = false;
+    }
+    else
+    {
+        const WorldSnapshotHeader* header = reinterpret_cast<const WorldSnapshotHeader*>(mFile.getData());
+        uint64_t size = mFile.getSize();
+
+        if (header->mMagic != WORLD_SNAPSHOT_MAGIC || header->mVersion != WORLD_SNAPSHOT_VERSION || header->mHeaderSize != sizeof(WorldSnapshotHeader))
+        {
+            // cout << "The world snapshot was saved with a different version!\n";
+            success = false;
+        }
+        else if (header->mNPCCount != aNPCCount || header->mRugCount != aRugCount ||
+            header->mWorldWidth != aWorld.getWidth() || header->mWorldHeight != aWorld.getHeight())
+        {
+            // cout << "The world snapshot was saved from a different world!\n";
+            success = false;
+        }
+        else if ((header->mNPCOffset % alignof(NPCSnapshot)) || (header->mRugOffset % alignof(RugSnapshot)) ||
+            header->mNPCOffset + (sizeof(NPCSnapshot) * header->mNPCCount) > size ||
+            header->mRugOffset + (sizeof(RugSnapshot) * header->mRugCount) > size ||
+            header->mRNGStateOffset + header->mRNGStateSize > size ||
+            (header->mObstacleOffset % alignof(ObstacleSnapshot)) ||
+            header->mObstacleOffset + (sizeof(ObstacleSnapshot) * header->mObstacleCount) > size)
+        {
+            // cout << "The world snapshot is damaged!\n";
+            success = false;
+        }
+        else
+        {
+            mHeader = header;
+        }
+    }
+
+    if (!success)
+    {
+        close();
+    }
+    return success;
+}
+
+
+/**
+* Unmap the snapshot.
+*/
+void WorldSnapshot::close()
+{
+    mFile.close();
+    mHeader = nullptr;
+}
+
+
+/**
+* Get the snapshot's header, valid while the snapshot is open.
+* @return const WorldSnapshotHeader& The header.
+*/
+const WorldSnapshotHeader& WorldSnapshot::getHeader() const
+{
+    return *mHeader;
+}
+
+
+/**
+* Get the NPC records in place in the mapped file, valid while the snapshot is open.
+* @return const NPCSnapshot* The first of getHeader().mNPCCount records.
+*/
+const NPCSnapshot* WorldSnapshot::getNPCs() const
+{
+    return reinterpret_cast<const NPCSnapshot*>(mFile.getData() + mHeader->mNPCOffset);
+}
+
+
+/**
+* Get the rug records in place in the mapped file, valid while the snapshot is open.
+* @return const RugSnapshot* The first of getHeader().mRugCount records.
+*/
+const RugSnapshot* WorldSnapshot::getRugs() const
+{
+    return reinterpret_cast<const RugSnapshot*>(mFile.getData() + mHeader->mRugOffset);
+}
+
+
+/**
+* Get the obstacle records in place in the mapped file, valid while the snapshot is open.
+* @return const ObstacleSnapshot* The first of getHeader().mObstacleCount records.
+*/
+const ObstacleSnapshot* WorldSnapshot::getObstacles() const
+{
+    return reinterpret_cast<const ObstacleSnapshot*>(mFile.getData() + mHeader->mObstacleOffset);
+}
+
+
+/**
+* Get the random number generator's state.
+* @return string The state.
+*/
+string WorldSnapshot::getRNGState() const
+{
+    const char* state = reinterpret_cast<const char*>(mFile.getData() + mHeader->mRNGStateOffset);
+    return string(state, static_cast<size_t>(mHeader->mRNGStateSize));
+}
+
+
+/**
+* Copy every record into the entities and put the obstacles back up, the rug index must be rebuilt
+* afterwards since the rugs move.
+* @param aNPCs  - The NPCs.
+* @param aRugs  - The rugs.
+* @param aWorld - The world the entities are placed in.
+*/
+void WorldSnapshot::restore(const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, World& aWorld) const
+{
+    // The obstacles go back up first, through the navigation grid, so the restored NPCs follow fields
+    // worked out around the saved obstacles
+    aWorld.clearObstacles();
+    const ObstacleSnapshot* obstacleSnapshots = getObstacles();
+    for (uint32_t i = 0; i < mHeader->mObstacleCount; ++i)
+    {
+        const ObstacleSnapshot& obstacle = obstacleSnapshots[i];
+        uint32_t index = aWorld.addObstacle(Vector{ obstacle.mMinX, obstacle.mMinY, 0 }, Vector{ obstacle.mMaxX, obstacle.mMaxY, 0 });
+        if (!obstacle.mStanding)
+        {
+            aWorld.setObstacleStanding(index, false);
+        }
+    }
+
+    const NPCSnapshot* npcSnapshots = getNPCs();
+    for (size_t i = 0; i < aNPCs.size(); ++i)
+    {
+        aNPCs[i]->restoreSnapshot(npcSnapshots[i]);
+    }
+
+    const RugSnapshot* rugSnapshots = getRugs();
+    for (size_t i = 0; i < aRugs.size(); ++i)
+    {
+        aRugs[i]->restoreSnapshot(rugSnapshots[i], aWorld);
+    }
+}
@@ -0,0 +1,205 @@
+/**
+* Title: Market
+* Author: Tonia Sanzo
+* Date: 10/19/26
+*
+* WorldSnapshot saves the whole market, every NPC, rug and obstacle, the tick and the random number generator, to a
+* flat file that is mapped back into memory to restore it. The file holds no pointers, only fixed size
+* records at offsets from the start of the file, so the mapped records are used in place and restoring
+* costs about as much as reading the file. A restored market continues exactly like the saved one.
+*/
+#pragma once
+#include "PCH.h"
+#include "MappedFile.h"
+class NPC;
+class Rug;
+class World;
+
+
+// "MKWS" read as a little endian uint32_t, and the format version
+constexpr uint32_t WORLD_SNAPSHOT_MAGIC   = 0x53574B4D;
+constexpr uint32_t WORLD_SNAPSHOT_VERSION = 3;
+
+// Where the snapshot is saved to and restored from
+constexpr const char* WORLD_SNAPSHOT_FILE_PATH = "market_world.snap";
+
+// The record arrays start on this alignment, so the mapped records are read in place
+constexpr uint64_t WORLD_SNAPSHOT_ALIGNMENT = 64;
+
+
+// Header at the start of every snapshot, the offsets are from the start of the file
+struct WorldSnapshotHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mHeaderSize;
+    uint32_t mTick;
+    uint32_t mNPCCount;
+    uint32_t mRugCount;
+    uint32_t mWorldWidth;
+    uint32_t mWorldHeight;
+
+    // The seed the random number generator was seeded with, and the number of values drawn since
+    uint64_t mRNGSeed;
+    uint64_t mRNGDraws;
+
+    uint64_t mNPCOffset;
+    uint64_t mRugOffset;
+
+    // The random number generator's state as text, the standard library's portable form
+    uint64_t mRNGStateOffset;
+    uint64_t mRNGStateSize;
+
+    // The obstacles, in the order they were added
+    uint64_t mObstacleOffset;
+    uint32_t mObstacleCount;
+    uint32_t mPadding;
+};
+
+
+// One NPC's state
+struct NPCSnapshot
+{
+    float mX;
+    float mY;
+    float mPrevX;
+    float mPrevY;
+    float mTargetX;
+    float mTargetY;
+    float mDirectionX;
+    float mDirectionY;
+    float mSpeed;
+    float mAnimationSpeed;
+    float mCurrAnimTime;
+    float mTimeSinceDirectionReset;
+
+    // Time banked while the NPC's region stepped at a lower rate, taken on its next update
+    float mSkippedTime;
+
+    // The flow field cell the NPC is heading for, FLOW_NO_CELL when it isn't following a field
+    uint32_t mFlowCell;
+    uint32_t mMotionGeneration;
+    uint16_t mState;
+    uint16_t mColor;
+    uint16_t mCurrStep;
+    uint16_t mCurrFrame;
+    uint8_t mNewWalkLocation;
+    uint8_t mCurrOverlappingRug;
+    uint8_t mPrevOverlappingRug;
+    uint8_t mSkippingUpdates;
+};
+
+
+// One rug's state
+struct RugSnapshot
+{
+    float mX;
+    float mY;
+
+    // Seconds until the rug can trade again, 0 if it can trade
+    float mTimeToTrade;
+    uint16_t mState;
+    uint8_t mTradeable;
+    uint8_t mPadding;
+};
+
+
+// One obstacle, in the order they were added, standing or taken down
+struct ObstacleSnapshot
+{
+    float mMinX;
+    float mMinY;
+    float mMaxX;
+    float mMaxY;
+    uint8_t mStanding;
+    uint8_t mPadding[3];
+};
+
+
+static_assert(sizeof(WorldSnapshotHeader) == 96, "The snapshot header's layout is part of the format");
+static_assert(sizeof(NPCSnapshot) == 72, "The NPC record's layout is part of the format");
+static_assert(sizeof(RugSnapshot) == 16, "The rug record's layout is part of the format");
+static_assert(sizeof(ObstacleSnapshot) == 20, "The obstacle record's layout is part of the format");
+
+
+class WorldSnapshot
+{
+private:
+    MappedFile mFile;
+    const WorldSnapshotHeader* mHeader;
+
+public:
+    /**
+    * Default Constructor, nothing is restored until a snapshot is opened.
+    */
+    WorldSnapshot();
+
+    /**
+    * Save the market to a snapshot, replacing an existing one.
+    * @param aPath     - Where to save the snapshot.
+    * @param aNPCs     - The NPCs.
+    * @param aRugs     - The rugs.
+    * @param aWorld    - The world the market is in.
+    * @param aTick     - The tick the market was saved on.
+    * @param aRNGSeed  - The random number generator's seed.
+    * @param aRNGDraws - The number of values drawn from the random number generator since it was seeded.
+    * @param aRNGState - The random number generator's state.
+    * @return bool True if the snapshot was saved, otherwise false.
+    */
+    static bool save(const char* aPath, const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, const World& aWorld, const uint32_t& aTick,
+        const uint64_t& aRNGSeed, const uint64_t& aRNGDraws, const string& aRNGState);
+
+    /**
+    * Map a snapshot and check it was saved from a market the same size as this one.
+    * @param aPath     - The snapshot to restore.
+    * @param aNPCCount - The number of NPCs in the market.
+    * @param aRugCount - The number of rugs in the market.
+    * @param aWorld    - The world the market is in.
+    * @return bool True if the snapshot was opened, otherwise false.
+    */
+    bool open(const char* aPath, const uint32_t& aNPCCount, const uint32_t& aRugCount, const World& aWorld);
+
+    /**
+    * Unmap the snapshot.
+    */
+    void close();
+
+    /**
+    * Get the snapshot's header, valid while the snapshot is open.
+    * @return const WorldSnapshotHeader& The header.
+    */
+    const WorldSnapshotHeader& getHeader() const;
+
+    /**
+    * Get the NPC records in place in the mapped file, valid while the snapshot is open.
+    * @return const NPCSnapshot* The first of getHeader().mNPCCount records.
+    */
+    const NPCSnapshot* getNPCs() const;
+
+    /**
+    * Get the rug records in place in the mapped file, valid while the snapshot is open.
+    * @return const RugSnapshot* The first of getHeader().mRugCount records.
+    */
+    const RugSnapshot* getRugs() const;
+
+    /**
+    * Get the obstacle records in place in the mapped file, valid while the snapshot is open.
+    * @return const ObstacleSnapshot* The first of getHeader().mObstacleCount records.
+    */
+    const ObstacleSnapshot* getObstacles() const;
+
+    /**
+    * Get the random number generator's state.
+    * @return string The state.
+    */
+    string getRNGState() const;
+
+    /**
+    * Copy every record into the entities and put the obstacles back up, the rug index must be rebuilt
+    * afterwards since the rugs move.
+    * @param aNPCs  - The NPCs.
+    * @param aRugs  - The rugs.
+    * @param aWorld - The world the entities are placed in.
+    */
+    void restore(const vector<NPC*>& aNPCs, const vector<Rug*>& aRugs, World& aWorld) const;
+};
@@ -14,10 +14,14 @@ using namespace std;    // This set's the namespace for the entire project
 #include <iostream>
 #include <exception>
 #include <cmath>
+#include <cfloat>
 #include <ctime>
 #include <thread>
+#include <queue>
 #include <mutex>
 #include <vector>
+#include <map>
+#include <cstring>
 #include <memory>
 #include <random>
 #include <condition_variable>
@@ -26,6 +30,15 @@ using namespace std;    // This set's the namespace for the entire project
 #include <stdexcept>
 #include <chrono>
 #include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+// SSE2 is always available on x64, and on x86 when the compiler targets it
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MARKET_SSE2
+#include <emmintrin.h>
+#endif
 
 // The entities trade states
 enum class ETradeState
@@ -140,74 +153,182 @@ namespace MATH
     */
     inline bool pointsInRange(const Vector& aPointA, const Vector& aPointB, const float& aRange)
     {
-        if ((pow(aPointA.x - aPointB.x, 2.f) + pow(aPointA.y - aPointB.y, 2.f)) <= pow(aRange, 2.f))
-        {
-            return true;
-        }
-        else
-        {
-            return false;
-        }
+        float deltaX = aPointA.x - aPointB.x;
+        float deltaY = aPointA.y - aPointB.y;
+        return ((deltaX * deltaX) + (deltaY * deltaY)) <= (aRange * aRange);
     }
 
 
     /**
-    * Takes three vectors, two being the start and end of the line segment and the other being the intersection
-    * point. Returns true if the intersection is between the line segment points, otherwise returns false.
-    * @param aLineSegmentPointA - Endpoint of the aLineSegmentPoint1.
-    * @param aLineSegmentPointB - Endpoint of the aLineSegmentPoint2.
-    * @return bool True if the intersection point is between the line segment points, otherwise false.
+    * Determine if a line segment overlaps a circle, by finding the point on the segment closest to the
+    * circle's center. The center is projected onto the segment with a dot product, if the projection lands
+    * before the first point or past the second point the closest point is that end, otherwise the squared
+    * distance to the segment's line is compared using the cross product scaled by the segment's squared
+    * length, so there is no division, square root, or pow. A segment whose points are equal (a stationary
+    * NPC) reduces to a point in range test.
+    * @param aLineSegmentPointA - The first point of the line segment.
+    * @param aLineSegmentPointB - The second point of the line segment.
+    * @param aCircleCenterPoint - The circles center point.
+    * @param aCircleRadius      - The circle's radius.
+    * @return bool True if the circle overlaps the line segment, otherwise false.
     */
-    inline bool intersectionBetweenPoints(const Vector& aLineSegmentPointA, const Vector& aLineSegmentPointB, const Vector& aIntersectionPoint)
+    inline bool doesLineSegmentOverlapCircle(const Vector& aLineSegmentPointA, const Vector& aLineSegmentPointB, const Vector& aCircleCenterPoint, const float& aCircleRadius)
     {
-        Vector xValuesMinMax = aLineSegmentPointA.x < aLineSegmentPointB.x ? (Vector{ aLineSegmentPointA.x, aLineSegmentPointB.x, 0 }) : (Vector{ aLineSegmentPointB.x, aLineSegmentPointA.x, 0 });
-        Vector yValuesMinMax = aLineSegmentPointA.y < aLineSegmentPointB.y ? (Vector{ aLineSegmentPointA.y, aLineSegmentPointB.y, 0 }) : (Vector{ aLineSegmentPointB.y, aLineSegmentPointA.y, 0 });
+        float segmentX = aLineSegmentPointB.x - aLineSegmentPointA.x;
+        float segmentY = aLineSegmentPointB.y - aLineSegmentPointA.y;
+        float toCenterX = aCircleCenterPoint.x - aLineSegmentPointA.x;
+        float toCenterY = aCircleCenterPoint.y - aLineSegmentPointA.y;
+        float radiusSquared = aCircleRadius * aCircleRadius;
 
-        if ((aIntersectionPoint.x >= xValuesMinMax.x && aIntersectionPoint.x <= xValuesMinMax.y)
-            && (aIntersectionPoint.y >= yValuesMinMax.x && aIntersectionPoint.y <= yValuesMinMax.y))
+        // Projection of the center onto the segment, scaled by the segment's squared length
+        float projection = (toCenterX * segmentX) + (toCenterY * segmentY);
+        float segmentLengthSquared = (segmentX * segmentX) + (segmentY * segmentY);
+
+        // The closest point is the first point
+        if (projection <= 0)
         {
-            return true;
+            return ((toCenterX * toCenterX) + (toCenterY * toCenterY)) <= radiusSquared;
         }
-        else
+
+        // The closest point is the second point
+        if (projection >= segmentLengthSquared)
         {
-            return false;
+            float fromEndX = aCircleCenterPoint.x - aLineSegmentPointB.x;
+            float fromEndY = aCircleCenterPoint.y - aLineSegmentPointB.y;
+            return ((fromEndX * fromEndX) + (fromEndY * fromEndY)) <= radiusSquared;
         }
+
+        // The closest point is between the points, distance^2 to the line = cross^2 / length^2
+        float cross = (segmentX * toCenterY) - (segmentY * toCenterX);
+        return (cross * cross) <= (radiusSquared * segmentLengthSquared);
     }
 
+
     /**
-    * Determine if a line segment overlaps a circle.
+    * Find how far along a line segment it first enters a circle, for a segment known to overlap the circle.
     * @param aLineSegmentPointA - The first point of the line segment.
     * @param aLineSegmentPointB - The second point of the line segment.
     * @param aCircleCenterPoint - The circles center point.
     * @param aCircleRadius      - The circle's radius.
-    * @return bool True if the circle overlaps the line segment, otherwise false.
+    * @return float The fraction of the segment in [0, 1] where it enters the circle, 0 if it starts inside.
     */
-    inline bool doesLineSegmentOverlapCircle(Vector aLineSegmentPointA, Vector aLineSegmentPointB, Vector aCircleCenterPoint, float aCircleRadius)
+    inline float lineSegmentEntersCircleAt(const Vector& aLineSegmentPointA, const Vector& aLineSegmentPointB, const Vector& aCircleCenterPoint, const float& aCircleRadius)
     {
-        if (pointsInRange(aLineSegmentPointA, aCircleCenterPoint, aCircleRadius) || pointsInRange(aLineSegmentPointB, aCircleCenterPoint, aCircleRadius))
+        float segmentX = aLineSegmentPointB.x - aLineSegmentPointA.x;
+        float segmentY = aLineSegmentPointB.y - aLineSegmentPointA.y;
+        float offsetX  = aLineSegmentPointA.x - aCircleCenterPoint.x;
+        float offsetY  = aLineSegmentPointA.y - aCircleCenterPoint.y;
+
+        // Solve |A + (t * segment) - center| = radius for its smaller root
+        float a = (segmentX * segmentX) + (segmentY * segmentY);
+        float b = (offsetX * segmentX) + (offsetY * segmentY);
+        float c = (offsetX * offsetX) + (offsetY * offsetY) - (aCircleRadius * aCircleRadius);
+        if (a <= 0 || c <= 0)
         {
-            return true;
+            return 0;
         }
 
-        float lineSegmentSlope = (aLineSegmentPointB.y - aLineSegmentPointA.y) / (aLineSegmentPointB.x - aLineSegmentPointA.x);
-        float perpendicularLineSegmentSlope = -(((aLineSegmentPointB.x - aLineSegmentPointA.x)) / (aLineSegmentPointB.y - aLineSegmentPointA.y));
-        float lineSegmentYIntercept = aLineSegmentPointA.y - (lineSegmentSlope * aLineSegmentPointA.x);
-        float perpendicularLineSegmentYIntercept = aCircleCenterPoint.y - (perpendicularLineSegmentSlope * aCircleCenterPoint.x);
+        float discriminant = max((b * b) - (a * c), 0.f);
+        float t = (-b - static_cast<float>(sqrt(discriminant))) / a;
+        return (t < 0) ? (0.f) : ((t > 1) ? (1.f) : (t));
+    }
 
-        Vector intersectionPoint;
-        intersectionPoint.x = (perpendicularLineSegmentYIntercept - lineSegmentYIntercept) / (lineSegmentSlope - perpendicularLineSegmentSlope);
-        intersectionPoint.y = (lineSegmentSlope * intersectionPoint.x) + lineSegmentYIntercept;
 
+    /**
+    * Interleave the bits of two coordinates into their Morton code, so points close together on the
+    * Z-order curve are mostly close together in 2D.
+    * @param aX - The x coordinate, only the low 16 bits are used.
+    * @param aY - The y coordinate, only the low 16 bits are used.
+    * @return uint32_t The Morton code, x in the even bits and y in the odd bits.
+    */
+    inline uint32_t mortonCode(const uint32_t& aX, const uint32_t& aY)
+    {
+        uint32_t x = aX & 0xFFFF;
+        uint32_t y = aY & 0xFFFF;
 
-        if (pointsInRange(aCircleCenterPoint, intersectionPoint, aCircleRadius))
+        // Spread each coordinate's bits apart so there is a zero between every two
+        x = (x | (x << 8)) & 0x00FF00FF;
+        x = (x | (x << 4)) & 0x0F0F0F0F;
+        x = (x | (x << 2)) & 0x33333333;
+        x = (x | (x << 1)) & 0x55555555;
+        y = (y | (y << 8)) & 0x00FF00FF;
+        y = (y | (y << 4)) & 0x0F0F0F0F;
+        y = (y | (y << 2)) & 0x33333333;
+        y = (y | (y << 1)) & 0x55555555;
+        return x | (y << 1);
+    }
+
+
+#if defined(MARKET_SSE2)
+    /**
+    * Four lane kernel of the closest-point segment versus circle test. Every lane evaluates all three
+    * cases and selects the right one with masks so there are no branches.
+    * @return __m128 All bits set in each lane whose segment overlaps its circle.
+    */
+    inline __m128 doLineSegmentsOverlapCircles4(__m128 aPointAX, __m128 aPointAY, __m128 aPointBX, __m128 aPointBY, __m128 aCenterX, __m128 aCenterY, __m128 aRadiusSquared)
+    {
+        __m128 segmentX  = _mm_sub_ps(aPointBX, aPointAX);
+        __m128 segmentY  = _mm_sub_ps(aPointBY, aPointAY);
+        __m128 toCenterX = _mm_sub_ps(aCenterX, aPointAX);
+        __m128 toCenterY = _mm_sub_ps(aCenterY, aPointAY);
+        __m128 fromEndX  = _mm_sub_ps(aCenterX, aPointBX);
+        __m128 fromEndY  = _mm_sub_ps(aCenterY, aPointBY);
+
+        __m128 projection           = _mm_add_ps(_mm_mul_ps(toCenterX, segmentX), _mm_mul_ps(toCenterY, segmentY));
+        __m128 segmentLengthSquared = _mm_add_ps(_mm_mul_ps(segmentX, segmentX), _mm_mul_ps(segmentY, segmentY));
+        __m128 startDistanceSquared = _mm_add_ps(_mm_mul_ps(toCenterX, toCenterX), _mm_mul_ps(toCenterY, toCenterY));
+        __m128 endDistanceSquared   = _mm_add_ps(_mm_mul_ps(fromEndX, fromEndX), _mm_mul_ps(fromEndY, fromEndY));
+        __m128 cross                = _mm_sub_ps(_mm_mul_ps(segmentX, toCenterY), _mm_mul_ps(segmentY, toCenterX));
+
+        // Each case's answer, and the masks choosing which case applies
+        __m128 startHit  = _mm_cmple_ps(startDistanceSquared, aRadiusSquared);
+        __m128 endHit    = _mm_cmple_ps(endDistanceSquared, aRadiusSquared);
+        __m128 middleHit = _mm_cmple_ps(_mm_mul_ps(cross, cross), _mm_mul_ps(aRadiusSquared, segmentLengthSquared));
+        __m128 useStart  = _mm_cmple_ps(projection, _mm_setzero_ps());
+        __m128 useEnd    = _mm_andnot_ps(useStart, _mm_cmpge_ps(projection, segmentLengthSquared));
+        __m128 useMiddle = _mm_andnot_ps(_mm_or_ps(useStart, useEnd), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+        return _mm_or_ps(_mm_or_ps(_mm_and_ps(useStart, startHit), _mm_and_ps(useEnd, endHit)), _mm_and_ps(useMiddle, middleHit));
+    }
+#endif
+
+
+    /**
+    * Test one line segment against 8 circles of the same radius at once, the circle centers are given as
+    * structure of arrays. Produces the same answers as doesLineSegmentOverlapCircle.
+    * @param aLineSegmentPointA - The first point of the line segment.
+    * @param aLineSegmentPointB - The second point of the line segment.
+    * @param aCenterX           - The x coordinate of each circle's center.
+    * @param aCenterY           - The y coordinate of each circle's center.
+    * @param aCircleRadius      - The circles' radius.
+    * @return uint8_t Bit i is set if the segment overlaps circle i.
+    */
+    inline uint8_t doesLineSegmentOverlapCircles8(const Vector& aLineSegmentPointA, const Vector& aLineSegmentPointB, const float aCenterX[8], const float aCenterY[8], const float& aCircleRadius)
+    {
+        uint8_t overlaps = 0;
+
+#if defined(MARKET_SSE2)
+        const __m128 pointAX       = _mm_set1_ps(aLineSegmentPointA.x);
+        const __m128 pointAY       = _mm_set1_ps(aLineSegmentPointA.y);
+        const __m128 pointBX       = _mm_set1_ps(aLineSegmentPointB.x);
+        const __m128 pointBY       = _mm_set1_ps(aLineSegmentPointB.y);
+        const __m128 radiusSquared = _mm_set1_ps(aCircleRadius * aCircleRadius);
+
+        for (int half = 0; half < 8; half += 4)
         {
-            return intersectionBetweenPoints(aLineSegmentPointA, aLineSegmentPointB, intersectionPoint);
+            __m128 hit = doLineSegmentsOverlapCircles4(pointAX, pointAY, pointBX, pointBY,
+                _mm_loadu_ps(aCenterX + half), _mm_loadu_ps(aCenterY + half), radiusSquared);
+            overlaps |= static_cast<uint8_t>(_mm_movemask_ps(hit) << half);
         }
-        // The intersection point is out of range of the circle's overlap, therefore return false 
-        else
+#else
+        for (int i = 0; i < 8; ++i)
         {
-            return false;
+            Vector center = { aCenterX[i], aCenterY[i], 0 };
+            overlaps |= static_cast<uint8_t>(doesLineSegmentOverlapCircle(aLineSegmentPointA, aLineSegmentPointB, center, aCircleRadius) << i);
         }
+#endif
+
+        return overlaps;
     }
 }
 